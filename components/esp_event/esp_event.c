@@ -26,6 +26,8 @@
 #define LOOP_DUMP_FORMAT              "LOOP @%p,%s rx:%" PRIu32 " dr:%" PRIu32 "\n"
  // handler @<address> ev:<base, id> inv:<times invoked> time:<runtime>
 #define HANDLER_DUMP_FORMAT           "  HANDLER @%p ev:%s,%s inv:%" PRIu32 " time:%lld us\n"
+// worker <index> q:<queued events>/<most queued events> ev:<dispatched events> lat:<average>/<longest posting to dispatch time>
+#define WORKER_DUMP_FORMAT            "  WORKER %" PRIu32 " q:%" PRIu32 "/%" PRIu32 " ev:%" PRIu32 " lat:%" PRIu32 "/%" PRIu32 " us\n"
 
 #define PRINT_DUMP_INFO(dst, sz, ...)  do { \
                                             int cb = snprintf(dst, sz, __VA_ARGS__); \
@@ -34,11 +36,17 @@
                                         } while(0);
 #endif
 
+// Initial number of buckets of the dispatch table of a loop, must be a power of two
+#define DISPATCH_MIN_BUCKETS          8
+
 /* ------------------------- Static Variables ------------------------------- */
 
 static const char* TAG = "event";
 static const char* esp_event_any_base = "any";
 
+// Entry for the events with no handlers, which are not kept in the dispatch tables
+static esp_event_dispatch_entry_t s_dispatch_entry_empty;
+
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
 static SLIST_HEAD(esp_event_loop_instance_list_t, esp_event_loop_instance) s_event_loops =
         SLIST_HEAD_INITIALIZER(s_event_loops);
@@ -61,7 +69,7 @@ static int esp_event_dump_prepare(void)
     esp_event_handler_node_t* handler_it;
 
     // Count the number of items to be printed. This is needed to compute how much memory to reserve.
-    int loops = 0, handlers = 0;
+    int loops = 0, workers = 0, handlers = 0;
 
     portENTER_CRITICAL(&s_event_loops_spinlock);
 
@@ -83,6 +91,7 @@ static int esp_event_dump_prepare(void)
             }
         }
         loops++;
+        workers += loop_it->worker_count;
     }
 
     portEXIT_CRITICAL(&s_event_loops_spinlock);
@@ -90,30 +99,97 @@ static int esp_event_dump_prepare(void)
     // Reserve slightly more memory than computed
     int allowance = 3;
     int size = (((loops + allowance) * (sizeof(LOOP_DUMP_FORMAT) + 10 + 20 + 2 * 11)) +
+                        ((workers + allowance) * (sizeof(WORKER_DUMP_FORMAT) + 6 * 11)) +
                         ((handlers + allowance) * (sizeof(HANDLER_DUMP_FORMAT) + 10 + 2 * 20 + 11 + 20)));
 
     return size;
 }
 #endif
 
+static esp_err_t worker_run(esp_event_loop_worker_t* worker, TickType_t ticks_to_run);
+
 static void esp_event_loop_run_task(void* args)
 {
     esp_err_t err;
-    esp_event_loop_handle_t event_loop = (esp_event_loop_handle_t) args;
+    esp_event_loop_worker_t* worker = (esp_event_loop_worker_t*) args;
 
-    ESP_LOGD(TAG, "running task for loop %p", event_loop);
+    ESP_LOGD(TAG, "running task for loop %p", worker->loop);
 
     while(1) {
-        err = esp_event_loop_run(event_loop, portMAX_DELAY);
+        err = worker_run(worker, portMAX_DELAY);
         if (err != ESP_OK) {
             break;
         }
     }
 
-    ESP_LOGE(TAG, "suspended task for loop %p", event_loop);
+    ESP_LOGE(TAG, "suspended task for loop %p", worker->loop);
     vTaskSuspend(NULL);
 }
 
+/* Returns the worker which dispatches the events of a base */
+static inline esp_event_loop_worker_t* loop_worker(esp_event_loop_instance_t* loop, esp_event_base_t base)
+{
+    if (loop->worker_count == 1) {
+        return &(loop->workers[0]);
+    }
+    uint32_t hash = (uint32_t)(uintptr_t) base * 2654435761u;
+    return &(loop->workers[(hash >> 16) % loop->worker_count]);
+}
+
+/* Returns the worker which is dispatching an event on the calling task, NULL if there is none. The workers'
+   running_task is read without their mutexes, which is safe since only the calling task stores its own handle.
+*/
+static esp_event_loop_worker_t* loop_current_worker(esp_event_loop_instance_t* loop)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        if (loop->workers[i].running_task == task) {
+            return &(loop->workers[i]);
+        }
+    }
+    return NULL;
+}
+
+/* Returns true if the calling task is a dedicated task of the loop */
+static bool loop_is_task(esp_event_loop_instance_t* loop)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        if (loop->workers[i].task == task) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Takes the mutexes of all workers, so that no events are dispatched while the registered handlers change */
+static void loop_lock(esp_event_loop_instance_t* loop)
+{
+    if (loop->worker_count > 1) {
+        // A handler changing the handlers of its own loop lets go of the mutex of its worker, so that all tasks
+        // take the mutexes in the same order. The worker notices the changes once the handler returns.
+        esp_event_loop_worker_t* current = loop_current_worker(loop);
+        if (current) {
+            xSemaphoreGiveRecursive(current->mutex);
+        }
+    }
+
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        xSemaphoreTakeRecursive(loop->workers[i].mutex, portMAX_DELAY);
+    }
+}
+
+static void loop_unlock(esp_event_loop_instance_t* loop)
+{
+    esp_event_loop_worker_t* current = (loop->worker_count > 1) ? loop_current_worker(loop) : NULL;
+
+    for (uint32_t i = loop->worker_count; i > 0; i--) {
+        if (&(loop->workers[i - 1]) != current) {
+            xSemaphoreGiveRecursive(loop->workers[i - 1].mutex);
+        }
+    }
+}
+
 static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t post)
 {
     ESP_LOGD(TAG, "running post %s:%"PRIu32" with handler %p and context %p on loop %p", post.base, post.id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
@@ -432,20 +508,389 @@ static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
     }
 }
 
-static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
+/* Takes a free slot of the payload pool, returns NULL if there is none. Safe to call from an ISR. */
+static void* payload_slot_acquire(esp_event_loop_instance_t* loop)
+{
+    for (uint32_t word = 0; word < (loop->payload_slot_count + 31) / 32; word++) {
+        uint32_t used = atomic_load_explicit(&loop->payload_slots_used[word], memory_order_relaxed);
+        // bits past the last slot are always set, see esp_event_loop_create
+        while (used != UINT32_MAX) {
+            uint32_t bit = __builtin_ctz(~used);
+            if (atomic_compare_exchange_weak_explicit(&loop->payload_slots_used[word], &used, used | (1u << bit),
+                                                      memory_order_acquire, memory_order_relaxed)) {
+                return loop->payload_pool + (word * 32 + bit) * loop->payload_slot_size;
+            }
+        }
+    }
+    return NULL;
+}
+
+static inline bool payload_in_pool(esp_event_loop_instance_t* loop, const void* data)
+{
+    return loop->payload_pool && (const uint8_t*) data >= loop->payload_pool &&
+           (const uint8_t*) data < loop->payload_pool + loop->payload_slot_count * loop->payload_slot_size;
+}
+
+/* Returns a buffer for event data, a slot of the payload pool if it fits and one is free, otherwise heap memory */
+static void* payload_alloc(esp_event_loop_instance_t* loop, size_t size)
+{
+    void* data = NULL;
+    if (size <= loop->payload_slot_size) {
+        data = payload_slot_acquire(loop);
+    }
+    if (data == NULL) {
+        data = malloc(size);
+    }
+    return data;
+}
+
+static void payload_free(esp_event_loop_instance_t* loop, void* data)
+{
+    if (payload_in_pool(loop, data)) {
+        uint32_t slot = ((uint8_t*) data - loop->payload_pool) / loop->payload_slot_size;
+        atomic_fetch_and_explicit(&loop->payload_slots_used[slot / 32], ~(1u << (slot % 32)), memory_order_release);
+    } else {
+        free(data);
+    }
+}
+
+static void inline __attribute__((always_inline)) post_instance_delete(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
 {
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
     if (post->data_allocated && post->data.ptr) {
-        free(post->data.ptr);
+        payload_free(loop, post->data.ptr);
     }
 #else
     if (post->data) {
-        free(post->data);
+        payload_free(loop, post->data);
     }
 #endif
     memset(post, 0, sizeof(*post));
 }
 
+static size_t handler_instances_collect(esp_event_handler_nodes_t* handlers, esp_event_handler_node_t** dest, size_t count)
+{
+    esp_event_handler_node_t *handler;
+    SLIST_FOREACH(handler, handlers, next) {
+        if (dest) {
+            dest[count] = handler;
+        }
+        count++;
+    }
+    return count;
+}
+
+/* Collects the handlers to execute for an event in the order esp_event_loop_run executes them, returns
+   their number. If dest is NULL, the handlers are only counted.
+*/
+static size_t loop_collect_handlers(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_handler_node_t** dest)
+{
+    size_t count = 0;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        count = handler_instances_collect(&(loop_node->handlers), dest, count);
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                count = handler_instances_collect(&(base_node->handlers), dest, count);
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        count = handler_instances_collect(&(id_node->handlers), dest, count);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+static inline esp_event_dispatch_entries_t* dispatch_bucket(esp_event_loop_worker_t* worker, esp_event_base_t base, int32_t id)
+{
+    uint32_t hash = ((uint32_t)(uintptr_t) base + (uint32_t) id) * 2654435761u;
+    return &(worker->dispatch_buckets[(hash ^ (hash >> 16)) & (worker->dispatch_bucket_count - 1)]);
+}
+
+static void dispatch_table_grow(esp_event_loop_worker_t* worker)
+{
+    uint32_t bucket_count = worker->dispatch_bucket_count ? worker->dispatch_bucket_count * 2 : DISPATCH_MIN_BUCKETS;
+    esp_event_dispatch_entries_t* buckets = calloc(bucket_count, sizeof(*buckets));
+
+    if (!buckets) {
+        // Keep using the current table, only with longer chains
+        return;
+    }
+
+    esp_event_dispatch_entries_t* old_buckets = worker->dispatch_buckets;
+    uint32_t old_bucket_count = worker->dispatch_bucket_count;
+    worker->dispatch_buckets = buckets;
+    worker->dispatch_bucket_count = bucket_count;
+
+    for (uint32_t i = 0; i < old_bucket_count; i++) {
+        esp_event_dispatch_entry_t *it;
+        while ((it = SLIST_FIRST(&(old_buckets[i]))) != NULL) {
+            SLIST_REMOVE_HEAD(&(old_buckets[i]), next);
+            SLIST_INSERT_HEAD(dispatch_bucket(worker, it->base, it->id), it, next);
+        }
+    }
+    free(old_buckets);
+}
+
+/* Builds the entry with the handlers to execute for an event. Events with no handlers get the shared empty
+   entry, so that posting many distinct unhandled events doesn't grow the table. Returns NULL if there isn't
+   enough memory.
+*/
+static esp_event_dispatch_entry_t* dispatch_entry_add(esp_event_loop_worker_t* worker, esp_event_base_t base, int32_t id)
+{
+    esp_event_dispatch_entry_t *it;
+
+    size_t count = loop_collect_handlers(worker->loop, base, id, NULL);
+    if (count == 0) {
+        return &s_dispatch_entry_empty;
+    }
+
+    if (worker->dispatch_entry_count >= worker->dispatch_bucket_count) {
+        dispatch_table_grow(worker);
+        if (!worker->dispatch_buckets) {
+            return NULL;
+        }
+    }
+
+    it = malloc(sizeof(*it) + count * sizeof(it->handlers[0]));
+
+    if (!it) {
+        return NULL;
+    }
+
+    it->base = base;
+    it->id = id;
+    it->handler_count = loop_collect_handlers(worker->loop, base, id, it->handlers);
+    SLIST_INSERT_HEAD(dispatch_bucket(worker, base, id), it, next);
+    worker->dispatch_entry_count++;
+
+    return it;
+}
+
+/* Returns the entry with the handlers to execute for an event, builds it if the event wasn't dispatched
+   since its handlers last changed. Returns NULL if there isn't enough memory.
+*/
+static inline esp_event_dispatch_entry_t* dispatch_entry_get(esp_event_loop_worker_t* worker, esp_event_base_t base, int32_t id)
+{
+    esp_event_dispatch_entry_t *it;
+
+    if (worker->dispatch_buckets) {
+        SLIST_FOREACH(it, dispatch_bucket(worker, base, id), next) {
+            if (it->base == base && it->id == id) {
+                return it;
+            }
+        }
+    }
+
+    return dispatch_entry_add(worker, base, id);
+}
+
+static void dispatch_entry_remove(esp_event_loop_worker_t* worker, esp_event_dispatch_entries_t* bucket, esp_event_dispatch_entry_t* entry)
+{
+    SLIST_REMOVE(bucket, entry, esp_event_dispatch_entry, next);
+    worker->dispatch_entry_count--;
+
+    if (entry == worker->dispatching) {
+        // A handler of this entry changed the handlers of its own event, the worker frees the entry
+        worker->dispatching_stale = true;
+    } else {
+        free(entry);
+    }
+}
+
+static void worker_dispatch_table_update(esp_event_loop_worker_t* worker, esp_event_base_t base, int32_t id)
+{
+    if (!worker->dispatch_buckets) {
+        return;
+    }
+
+    esp_event_dispatch_entry_t *it, *temp;
+
+    if (base != esp_event_any_base && id != ESP_EVENT_ANY_ID) {
+        esp_event_dispatch_entries_t* bucket = dispatch_bucket(worker, base, id);
+        SLIST_FOREACH_SAFE(it, bucket, next, temp) {
+            if (it->base == base && it->id == id) {
+                dispatch_entry_remove(worker, bucket, it);
+                break;
+            }
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < worker->dispatch_bucket_count; i++) {
+        SLIST_FOREACH_SAFE(it, &(worker->dispatch_buckets[i]), next, temp) {
+            if (base == esp_event_any_base || it->base == base) {
+                dispatch_entry_remove(worker, &(worker->dispatch_buckets[i]), it);
+            }
+        }
+    }
+}
+
+/* Removes the entries whose handlers change by registering or unregistering a handler for base and id.
+   They are built again when their events are dispatched next.
+*/
+static void dispatch_table_update(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id)
+{
+    loop->handlers_generation++;
+
+    if (base != esp_event_any_base) {
+        // only the worker of the base has entries for it
+        worker_dispatch_table_update(loop_worker(loop, base), base, id);
+        return;
+    }
+
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        worker_dispatch_table_update(&(loop->workers[i]), base, id);
+    }
+}
+
+static void dispatch_table_delete(esp_event_loop_worker_t* worker)
+{
+    for (uint32_t i = 0; i < worker->dispatch_bucket_count; i++) {
+        esp_event_dispatch_entry_t *it;
+        while ((it = SLIST_FIRST(&(worker->dispatch_buckets[i]))) != NULL) {
+            SLIST_REMOVE_HEAD(&(worker->dispatch_buckets[i]), next);
+            free(it);
+        }
+    }
+    free(worker->dispatch_buckets);
+    worker->dispatch_buckets = NULL;
+    worker->dispatch_bucket_count = 0;
+    worker->dispatch_entry_count = 0;
+}
+
+static size_t dispatch_entry_find(esp_event_dispatch_entry_t* entry, esp_event_handler_node_t* handler)
+{
+    for (size_t i = 0; i < entry->handler_count; i++) {
+        if (entry->handlers[i] == handler) {
+            return i;
+        }
+    }
+    return entry->handler_count;
+}
+
+/* Executes the handlers of an event. Returns false if there were none. */
+static bool dispatch_execute(esp_event_loop_worker_t* worker, esp_event_dispatch_entry_t* entry, esp_event_post_instance_t post)
+{
+    bool exec = entry->handler_count > 0;
+    size_t i = 0;
+
+    worker->dispatching = entry;
+    worker->dispatching_stale = false;
+
+    while (i < entry->handler_count) {
+        esp_event_handler_node_t *handler = entry->handlers[i];
+        esp_event_handler_node_t *next = (i + 1 < entry->handler_count) ? entry->handlers[i + 1] : NULL;
+
+        handler_execute(worker->loop, handler, post);
+        i++;
+
+        if (worker->dispatching_stale) {
+            // The handler (un)registered a handler for this event, so the remaining pointers may be stale.
+            // Continue with the handler which followed it in a new entry, like a walk of the lists would.
+            free(entry);
+            entry = next ? dispatch_entry_get(worker, post.base, post.id) : NULL;
+            worker->dispatching = entry;
+            worker->dispatching_stale = false;
+
+            if (!entry) {
+                break;
+            }
+
+            i = dispatch_entry_find(entry, next);
+            if (i == entry->handler_count) {
+                // the next handler was unregistered too
+                i = dispatch_entry_find(entry, handler);
+                i = (i < entry->handler_count) ? i + 1 : entry->handler_count;
+            }
+        }
+    }
+
+    worker->dispatching = NULL;
+
+    return exec;
+}
+
+/* Returns the handler executed after `prev` for an event, or prev itself if inclusive is set, or the first
+   handler if prev is NULL. Returns NULL if there is no such handler or prev isn't registered anymore. prev is
+   only compared, never dereferenced.
+*/
+static esp_event_handler_node_t* loop_handler_after(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id,
+                                                    esp_event_handler_node_t* prev, bool inclusive)
+{
+    bool found = (prev == NULL);
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+    esp_event_handler_node_t *handler;
+
+#define HANDLER_AFTER_IN(handlers)  SLIST_FOREACH(handler, handlers, next) { \
+                                        if (found || (inclusive && handler == prev)) { \
+                                            return handler; \
+                                        } \
+                                        found = (handler == prev); \
+                                    }
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        HANDLER_AFTER_IN(&(loop_node->handlers));
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                HANDLER_AFTER_IN(&(base_node->handlers));
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        HANDLER_AFTER_IN(&(id_node->handlers));
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+#undef HANDLER_AFTER_IN
+
+    return NULL;
+}
+
+/* Executes the handlers of an event by walking the lists, used if there isn't enough memory for the
+   dispatch table. The position is kept as a handler pointer rather than list iterators, since the lists
+   may change while a handler runs. Returns false if there were no handlers.
+*/
+static bool dispatch_execute_unindexed(esp_event_loop_instance_t* loop, esp_event_post_instance_t post)
+{
+    bool exec = false;
+    esp_event_handler_node_t *handler = loop_handler_after(loop, post.base, post.id, NULL, false);
+
+    while (handler) {
+        esp_event_handler_node_t *next = loop_handler_after(loop, post.base, post.id, handler, false);
+        uint32_t generation = loop->handlers_generation;
+
+        handler_execute(loop, handler, post);
+        exec = true;
+
+        if (next && loop->handlers_generation != generation) {
+            // The handlers changed while the handler ran, and with multiple workers another task may have
+            // changed them too, so both pointers may have been freed. Continue with next if it is still
+            // registered, otherwise with whatever follows the handler which just ran, like dispatch_execute.
+            esp_event_handler_node_t *it = loop_handler_after(loop, post.base, post.id, next, true);
+            next = it ? it : loop_handler_after(loop, post.base, post.id, handler, false);
+        }
+
+        handler = next;
+    }
+
+    return exec;
+}
+
 /* ---------------------------- Public API --------------------------------- */
 
 esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, esp_event_loop_handle_t* event_loop)
@@ -462,23 +907,32 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
 
     esp_event_loop_instance_t* loop;
     esp_err_t err = ESP_ERR_NO_MEM; // most likely error
+    uint32_t worker_count = (event_loop_args->task_name != NULL && event_loop_args->task_count > 1) ?
+                            event_loop_args->task_count : 1;
 
-    loop = calloc(1, sizeof(*loop));
+    loop = calloc(1, sizeof(*loop) + worker_count * sizeof(loop->workers[0]));
     if (loop == NULL) {
         ESP_LOGE(TAG, "alloc for event loop failed");
         return err;
     }
 
-    loop->queue = xQueueCreate(event_loop_args->queue_size , sizeof(esp_event_post_instance_t));
-    if (loop->queue == NULL) {
-        ESP_LOGE(TAG, "create event loop queue failed");
-        goto on_err;
-    }
+    loop->worker_count = worker_count;
 
-    loop->mutex = xSemaphoreCreateRecursiveMutex();
-    if (loop->mutex == NULL) {
-        ESP_LOGE(TAG, "create event loop mutex failed");
-        goto on_err;
+    for (uint32_t i = 0; i < worker_count; i++) {
+        esp_event_loop_worker_t* worker = &(loop->workers[i]);
+        worker->loop = loop;
+
+        worker->queue = xQueueCreate(event_loop_args->queue_size , sizeof(esp_event_post_instance_t));
+        if (worker->queue == NULL) {
+            ESP_LOGE(TAG, "create event loop queue failed");
+            goto on_err;
+        }
+
+        worker->mutex = xSemaphoreCreateRecursiveMutex();
+        if (worker->mutex == NULL) {
+            ESP_LOGE(TAG, "create event loop mutex failed");
+            goto on_err;
+        }
     }
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
@@ -489,30 +943,48 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
     }
 #endif
 
+    if (event_loop_args->payload_slot_count > 0 && event_loop_args->payload_slot_size > 0) {
+        uint32_t count = event_loop_args->payload_slot_count;
+        // Keep the slots aligned for any type of event data
+        size_t size = (event_loop_args->payload_slot_size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+        loop->payload_pool = malloc(count * size);
+        loop->payload_slots_used = calloc((count + 31) / 32, sizeof(*loop->payload_slots_used));
+        if (loop->payload_pool == NULL || loop->payload_slots_used == NULL) {
+            ESP_LOGE(TAG, "alloc for event loop payload pool failed");
+            goto on_err;
+        }
+        if (count % 32) {
+            // Mark the bits past the last slot as used, so that they are never acquired
+            atomic_store(&loop->payload_slots_used[count / 32], UINT32_MAX << (count % 32));
+        }
+        loop->payload_slot_size = size;
+        loop->payload_slot_count = count;
+    }
+
     SLIST_INIT(&(loop->loop_nodes));
 
-    // Create the loop task if requested
+    // Create the loop tasks if requested
     if (event_loop_args->task_name != NULL) {
-        BaseType_t task_created = xTaskCreatePinnedToCore(esp_event_loop_run_task, event_loop_args->task_name,
-                    event_loop_args->task_stack_size, (void*) loop,
-                    event_loop_args->task_priority, &(loop->task), event_loop_args->task_core_id);
-
-        if (task_created != pdPASS) {
-            ESP_LOGE(TAG, "create task for loop failed");
-            err = ESP_FAIL;
-            goto on_err;
+        for (uint32_t i = 0; i < worker_count; i++) {
+            BaseType_t task_created = xTaskCreatePinnedToCore(esp_event_loop_run_task, event_loop_args->task_name,
+                        event_loop_args->task_stack_size, (void*) &(loop->workers[i]),
+                        event_loop_args->task_priority, &(loop->workers[i].task), event_loop_args->task_core_id);
+
+            if (task_created != pdPASS) {
+                ESP_LOGE(TAG, "create task for loop failed");
+                err = ESP_FAIL;
+                goto on_err;
+            }
         }
 
         loop->name = event_loop_args->task_name;
 
-        ESP_LOGD(TAG, "created task for loop %p", loop);
+        ESP_LOGD(TAG, "created %"PRIu32" task(s) for loop %p", worker_count, loop);
     } else {
         loop->name = "";
-        loop->task = NULL;
     }
 
-    loop->running_task = NULL;
-
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     portENTER_CRITICAL(&s_event_loops_spinlock);
     SLIST_INSERT_HEAD(&s_event_loops, loop, next);
@@ -526,12 +998,18 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
     return ESP_OK;
 
 on_err:
-    if (loop->queue != NULL) {
-        vQueueDelete(loop->queue);
-    }
+    for (uint32_t i = 0; i < worker_count; i++) {
+        if (loop->workers[i].task != NULL) {
+            vTaskDelete(loop->workers[i].task);
+        }
 
-    if (loop->mutex != NULL) {
-        vSemaphoreDelete(loop->mutex);
+        if (loop->workers[i].queue != NULL) {
+            vQueueDelete(loop->workers[i].queue);
+        }
+
+        if (loop->workers[i].mutex != NULL) {
+            vSemaphoreDelete(loop->workers[i].mutex);
+        }
     }
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
@@ -540,22 +1018,21 @@ on_err:
     }
 #endif
 
+    free(loop->payload_pool);
+    free(loop->payload_slots_used);
     free(loop);
 
     return err;
 }
 
-// On event lookup performance: The library implements the event list as a linked list, which results to O(n)
-// lookup time. The test comparing this implementation to the O(lg n) performance of rbtrees
-// (https://github.com/freebsd/freebsd/blob/master/sys/sys/tree.h)
-// indicate that the difference is not that substantial, especially considering the additional
-// pointers per node of rbtrees. Code for the rbtree implementation of the event loop library is archived
-// in feature/esp_event_loop_library_rbtrees if needed.
-esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
+// On event lookup performance: The library keeps the registered handlers in linked lists, and walking them
+// for each posted event takes O(n) time in the number of registered bases and ids. Instead, the handlers to
+// execute for an event are collected into an array when the event is first dispatched, and the arrays are
+// kept in a hash table by base and id. Registering or unregistering a handler drops only the arrays of the
+// events it applies to. Events with no handlers are not kept, their lists are walked each time they are posted.
+static esp_err_t worker_run(esp_event_loop_worker_t* worker, TickType_t ticks_to_run)
 {
-    assert(event_loop);
-
-    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+    esp_event_loop_instance_t* loop = worker->loop;
     esp_event_post_instance_t post;
     TickType_t marker = xTaskGetTickCount();
     TickType_t end = 0;
@@ -566,91 +1043,82 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
     int64_t remaining_ticks = ticks_to_run;
 #endif
 
-    while(xQueueReceive(loop->queue, &post, ticks_to_run) == pdTRUE) {
+    while(xQueueReceive(worker->queue, &post, ticks_to_run) == pdTRUE) {
         // The event has already been unqueued, so ensure it gets executed.
-        xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
-
-        loop->running_task = xTaskGetCurrentTaskHandle();
+        xSemaphoreTakeRecursive(worker->mutex, portMAX_DELAY);
 
-        bool exec = false;
+        worker->running_task = xTaskGetCurrentTaskHandle();
 
-        esp_event_handler_node_t *handler, *temp_handler;
-        esp_event_loop_node_t *loop_node, *temp_node;
-        esp_event_base_node_t *base_node, *temp_base;
-        esp_event_id_node_t *id_node, *temp_id_node;
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+        uint32_t queued = uxQueueMessagesWaiting(worker->queue);
+        uint32_t latency = esp_timer_get_time() - post.time;
 
-        SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
-            // Execute loop level handlers
-            SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
-                handler_execute(loop, handler, post);
-                exec |= true;
-            }
+        worker->events_dispatched++;
+        worker->queue_max = (queued > worker->queue_max) ? queued : worker->queue_max;
+        worker->latency_total += latency;
+        worker->latency_max = (latency > worker->latency_max) ? latency : worker->latency_max;
+#endif
 
-            SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
-                if (base_node->base == post.base) {
-                    // Execute base level handlers
-                    SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
-                        handler_execute(loop, handler, post);
-                        exec |= true;
-                    }
+        bool exec;
+        esp_event_dispatch_entry_t* entry = dispatch_entry_get(worker, post.base, post.id);
 
-                    SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
-                        if (id_node->id == post.id) {
-                            // Execute id level handlers
-                            SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
-                                handler_execute(loop, handler, post);
-                                exec |= true;
-                            }
-                            // Skip to next base node
-                            break;
-                        }
-                    }
-                }
-            }
+        if (entry) {
+            exec = dispatch_execute(worker, entry, post);
+        } else {
+            exec = dispatch_execute_unindexed(loop, post);
         }
 
         esp_event_base_t base = post.base;
         int32_t id = post.id;
 
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
         if (ticks_to_run != portMAX_DELAY) {
             end = xTaskGetTickCount();
             remaining_ticks -= end - marker;
             // If the ticks to run expired, return to the caller
             if (remaining_ticks <= 0) {
-                xSemaphoreGiveRecursive(loop->mutex);
+                xSemaphoreGiveRecursive(worker->mutex);
                 break;
             } else {
                 marker = end;
             }
         }
 
-        loop->running_task = NULL;
+        worker->running_task = NULL;
 
-        xSemaphoreGiveRecursive(loop->mutex);
+        xSemaphoreGiveRecursive(worker->mutex);
 
         if (!exec) {
             // No handlers were registered, not even loop/base level handlers
-            ESP_LOGD(TAG, "no handlers have been registered for event %s:%"PRIu32" posted to loop %p", base, id, event_loop);
+            ESP_LOGD(TAG, "no handlers have been registered for event %s:%"PRIu32" posted to loop %p", base, id, loop);
         }
     }
 
     return ESP_OK;
 }
 
+esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
+{
+    assert(event_loop);
+
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+
+    // Loops with no dedicated task have a single worker
+    return worker_run(&(loop->workers[0]), ticks_to_run);
+}
+
 esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
 {
     assert(event_loop);
     ESP_LOGD(TAG, "deleting loop %p", (void*) event_loop);
 
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
-    SemaphoreHandle_t loop_mutex = loop->mutex;
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     SemaphoreHandle_t loop_profiling_mutex = loop->profiling_mutex;
 #endif
 
-    xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+    loop_lock(loop);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
@@ -659,12 +1127,18 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
     portEXIT_CRITICAL(&s_event_loops_spinlock);
 #endif
 
-    // Delete the task if it was created
-    if (loop->task != NULL) {
-        vTaskDelete(loop->task);
+    // Delete the tasks if they were created
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        if (loop->workers[i].task != NULL) {
+            vTaskDelete(loop->workers[i].task);
+        }
     }
 
     // Remove all registered events and handlers in the loop
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        dispatch_table_delete(&(loop->workers[i]));
+    }
+
     esp_event_loop_node_t *it, *temp;
     SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
         loop_node_remove_all_handler(it);
@@ -672,22 +1146,29 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
         free(it);
     }
 
-    // Drop existing posts on the queue
+    // Drop existing posts on the queues
     esp_event_post_instance_t post;
-    while(xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
-        post_instance_delete(&post);
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        while(xQueueReceive(loop->workers[i].queue, &post, 0) == pdTRUE) {
+            post_instance_delete(loop, &post);
+        }
+        vQueueDelete(loop->workers[i].queue);
+    }
+
+    // Free loop mutexes before deleting
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        xSemaphoreGiveRecursive(loop->workers[i].mutex);
+        vSemaphoreDelete(loop->workers[i].mutex);
     }
 
     // Cleanup loop
-    vQueueDelete(loop->queue);
+    free(loop->payload_pool);
+    free(loop->payload_slots_used);
     free(loop);
-    // Free loop mutex before deleting
-    xSemaphoreGiveRecursive(loop_mutex);
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     xSemaphoreGive(loop_profiling_mutex);
     vSemaphoreDelete(loop_profiling_mutex);
 #endif
-    vSemaphoreDelete(loop_mutex);
 
     return ESP_OK;
 }
@@ -712,7 +1193,7 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
 
     esp_err_t err = ESP_OK;
 
-    xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+    loop_lock(loop);
 
     esp_event_loop_node_t *loop_node = NULL, *last_loop_node = NULL;
 
@@ -753,7 +1234,8 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
     }
 
 on_err:
-    xSemaphoreGiveRecursive(loop->mutex);
+    dispatch_table_update(loop, event_base, event_id);
+    loop_unlock(loop);
     return err;
 }
 
@@ -787,7 +1269,7 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
 
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
 
-    xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+    loop_lock(loop);
 
     esp_event_loop_node_t *it, *temp;
 
@@ -801,7 +1283,8 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
         }
     }
 
-    xSemaphoreGiveRecursive(loop->mutex);
+    dispatch_table_update(loop, event_base, event_id);
+    loop_unlock(loop);
 
     return ESP_OK;
 }
@@ -824,68 +1307,60 @@ esp_err_t esp_event_handler_instance_unregister_with(esp_event_loop_handle_t eve
     return esp_event_handler_unregister_with_internal(event_loop, event_base, event_id, (esp_event_handler_instance_context_t*) handler_ctx_arg, false);
 }
 
-esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
-                            const void* event_data, size_t event_data_size, TickType_t ticks_to_wait)
+/* Queues an event, event_data is NULL or a buffer from payload_alloc which is owned by the loop from here on */
+static esp_err_t post_send(esp_event_loop_instance_t* loop, esp_event_base_t event_base, int32_t event_id,
+                           void* event_data, TickType_t ticks_to_wait)
 {
-    assert(event_loop);
-
-    if (event_base == ESP_EVENT_ANY_BASE || event_id == ESP_EVENT_ANY_ID) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
-
     esp_event_post_instance_t post;
     memset((void*)(&post), 0, sizeof(post));
 
-    if (event_data != NULL && event_data_size != 0) {
-        // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
-
-        if (event_data_copy == NULL) {
-            return ESP_ERR_NO_MEM;
-        }
-
-        memcpy(event_data_copy, event_data, event_data_size);
+    if (event_data != NULL) {
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
-        post.data.ptr = event_data_copy;
+        post.data.ptr = event_data;
         post.data_allocated = true;
         post.data_set = true;
 #else
-        post.data = event_data_copy;
+        post.data = event_data;
 #endif
     }
     post.base = event_base;
     post.id = event_id;
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    post.time = esp_timer_get_time();
+#endif
 
     BaseType_t result = pdFALSE;
 
-    // Find the task that currently executes the loop. It is safe to query loop->task since it is
+    // All events of a base go to the same worker, so they are dispatched in the order they were posted
+    esp_event_loop_worker_t* worker = loop_worker(loop, event_base);
+
+    // Find the task that currently executes the loop. It is safe to query the worker tasks since they are
     // not mutated since loop creation. ENSURE THIS REMAINS TRUE.
-    if (loop->task == NULL) {
+    if (worker->task == NULL) {
         // The loop has no dedicated task. Find out what task is currently running it.
-        result = xSemaphoreTakeRecursive(loop->mutex, ticks_to_wait);
+        result = xSemaphoreTakeRecursive(worker->mutex, ticks_to_wait);
 
         if (result == pdTRUE) {
-            if (loop->running_task != xTaskGetCurrentTaskHandle()) {
-                xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
+            if (worker->running_task != xTaskGetCurrentTaskHandle()) {
+                xSemaphoreGiveRecursive(worker->mutex);
+                result = xQueueSendToBack(worker->queue, &post, ticks_to_wait);
             } else {
-                xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, 0);
+                xSemaphoreGiveRecursive(worker->mutex);
+                result = xQueueSendToBack(worker->queue, &post, 0);
             }
         }
     } else {
-        // The loop has a dedicated task.
-        if (loop->task != xTaskGetCurrentTaskHandle()) {
-            result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
+        // The loop has dedicated tasks. A loop task doesn't wait for a full queue, also not for the queue
+        // of another worker, since that worker might be waiting for the queue of this one.
+        if (!loop_is_task(loop)) {
+            result = xQueueSendToBack(worker->queue, &post, ticks_to_wait);
         } else {
-            result = xQueueSendToBack(loop->queue, &post, 0);
+            result = xQueueSendToBack(worker->queue, &post, 0);
         }
     }
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -900,6 +1375,67 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     return ESP_OK;
 }
 
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                            const void* event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    assert(event_loop);
+
+    if (event_base == ESP_EVENT_ANY_BASE || event_id == ESP_EVENT_ANY_ID) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+    void* event_data_copy = NULL;
+
+    if (event_data != NULL && event_data_size != 0) {
+        // Make persistent copy of event data in the payload pool or on heap.
+        event_data_copy = payload_alloc(loop, event_data_size);
+
+        if (event_data_copy == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        memcpy(event_data_copy, event_data, event_data_size);
+    }
+
+    return post_send(loop, event_base, event_id, event_data_copy, ticks_to_wait);
+}
+
+esp_err_t esp_event_post_acquire_to(esp_event_loop_handle_t event_loop, size_t event_data_size, void** event_data)
+{
+    assert(event_loop);
+
+    if (event_data == NULL || event_data_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *event_data = payload_alloc((esp_event_loop_instance_t*) event_loop, event_data_size);
+
+    return *event_data ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_event_post_complete_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                                     void* event_data, TickType_t ticks_to_wait)
+{
+    assert(event_loop);
+
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+
+    if (event_base == ESP_EVENT_ANY_BASE || event_id == ESP_EVENT_ANY_ID) {
+        payload_free(loop, event_data);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return post_send(loop, event_base, event_id, event_data, ticks_to_wait);
+}
+
+void esp_event_post_release_to(esp_event_loop_handle_t event_loop, void* event_data)
+{
+    assert(event_loop);
+
+    payload_free((esp_event_loop_instance_t*) event_loop, event_data);
+}
+
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
                             const void* event_data, size_t event_data_size, BaseType_t* task_unblocked)
@@ -916,24 +1452,35 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
     memset((void*)(&post), 0, sizeof(post));
 
     if (event_data_size > sizeof(post.data.val)) {
-        return ESP_ERR_INVALID_ARG;
-    }
+        // Too large for the queue item, only a slot of the payload pool can hold the data
+        void* slot = (event_data != NULL && event_data_size <= loop->payload_slot_size) ? payload_slot_acquire(loop) : NULL;
 
-    if (event_data != NULL && event_data_size != 0) {
+        if (slot == NULL) {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        memcpy(slot, event_data, event_data_size);
+        post.data.ptr = slot;
+        post.data_allocated = true;
+        post.data_set = true;
+    } else if (event_data != NULL && event_data_size != 0) {
         memcpy((void*)(&(post.data.val)), event_data, event_data_size);
         post.data_allocated = false;
         post.data_set = true;
     }
     post.base = event_base;
     post.id = event_id;
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    post.time = esp_timer_get_time();
+#endif
 
     BaseType_t result = pdFALSE;
 
     // Post the event from an ISR,
-    result = xQueueSendToBackFromISR(loop->queue, &post, task_unblocked);
+    result = xQueueSendToBackFromISR(loop_worker(loop, event_base)->queue, &post, task_unblocked);
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -976,9 +1523,17 @@ esp_err_t esp_event_dump(FILE* file)
         events_recieved = atomic_load(&loop_it->events_recieved);
         events_dropped = atomic_load(&loop_it->events_dropped);
 
-        PRINT_DUMP_INFO(dst, sz, LOOP_DUMP_FORMAT, loop_it, loop_it->task != NULL ? loop_it->name : "none" ,
+        PRINT_DUMP_INFO(dst, sz, LOOP_DUMP_FORMAT, loop_it, loop_it->workers[0].task != NULL ? loop_it->name : "none" ,
                         events_recieved, events_dropped);
 
+        for (uint32_t i = 0; i < loop_it->worker_count; i++) {
+            esp_event_loop_worker_t* worker = &(loop_it->workers[i]);
+            uint32_t latency_avg = worker->events_dispatched ? worker->latency_total / worker->events_dispatched : 0;
+
+            PRINT_DUMP_INFO(dst, sz, WORKER_DUMP_FORMAT, i, (uint32_t) uxQueueMessagesWaiting(worker->queue),
+                            worker->queue_max, worker->events_dispatched, latency_avg, worker->latency_max);
+        }
+
         int sz_bak = sz;
 
         SLIST_FOREACH(loop_node_it, &(loop_it->loop_nodes), next) {
@@ -63,6 +63,6 @@ bool esp_event_is_handler_registered(esp_event_loop_handle_t event_loop, esp_eve
     }
 
 out:
-    xSemaphoreGive(loop->mutex);
+    xSemaphoreGive(loop->workers[0].mutex);
     return result;
 }
@@ -10,6 +10,10 @@
 #define CATCH_CONFIG_MAIN
 
 #include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <deque>
+#include <vector>
 #include "esp_event.h"
 
 #include "catch.hpp"
@@ -43,6 +47,90 @@ static esp_event_loop_args_t test_event_get_default_loop_args(void)
 
 void dummy_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data) { }
 
+void counting_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    (*static_cast<int*>(event_handler_arg))++;
+}
+
+/**
+ * Single-threaded stand-in for the event queue, so that events can be posted and dispatched in a loop
+ * without a task.
+ */
+struct FakeQueue {
+    static std::deque<std::vector<uint8_t> > items;
+    static size_t item_size;
+
+    static QueueHandle_t create(const UBaseType_t length, const UBaseType_t size, const uint8_t type, int num_calls)
+    {
+        item_size = size;
+        return reinterpret_cast<QueueHandle_t>(0xdeadbeef);
+    }
+
+    static BaseType_t send(QueueHandle_t queue, const void * const item, TickType_t ticks, const BaseType_t position, int num_calls)
+    {
+        const uint8_t *data = static_cast<const uint8_t*>(item);
+        items.emplace_back(data, data + item_size);
+        return pdTRUE;
+    }
+
+    static BaseType_t send_from_isr(QueueHandle_t queue, const void * const item, BaseType_t * const woken, const BaseType_t position, int num_calls)
+    {
+        return send(queue, item, 0, position, num_calls);
+    }
+
+    static BaseType_t receive(QueueHandle_t queue, void * const buffer, TickType_t ticks, int num_calls)
+    {
+        if (items.empty()) {
+            return pdFALSE;
+        }
+        memcpy(buffer, items.front().data(), item_size);
+        items.pop_front();
+        return pdTRUE;
+    }
+
+    FakeQueue()
+    {
+        xQueueGenericCreate_Stub(create);
+        xQueueGenericSend_Stub(send);
+        xQueueGenericSendFromISR_Stub(send_from_isr);
+        xQueueReceive_Stub(receive);
+        vQueueDelete_Ignore();
+        xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+        xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+        xTaskGetTickCount_IgnoreAndReturn(0);
+        xTaskGetCurrentTaskHandle_IgnoreAndReturn(nullptr);
+    }
+
+    ~FakeQueue()
+    {
+        xQueueGenericCreate_Stub(nullptr);
+        xQueueGenericSend_Stub(nullptr);
+        xQueueGenericSendFromISR_Stub(nullptr);
+        xQueueReceive_Stub(nullptr);
+        vQueueDelete_StopIgnore();
+        xQueueTakeMutexRecursive_StopIgnore();
+        xQueueGiveMutexRecursive_StopIgnore();
+        xTaskGetTickCount_StopIgnore();
+        xTaskGetCurrentTaskHandle_StopIgnore();
+        items.clear();
+    }
+};
+
+std::deque<std::vector<uint8_t> > FakeQueue::items;
+size_t FakeQueue::item_size;
+
+struct ReceivedEvent {
+    int32_t id;
+    void *data;
+    uint32_t value;
+};
+
+void recording_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    std::vector<ReceivedEvent> *events = static_cast<std::vector<ReceivedEvent>*>(event_handler_arg);
+    events->push_back({event_id, event_data, *static_cast<uint32_t*>(event_data)});
+}
+
 }
 
 // TODO: IDF-2693, function definition just to satisfy linker, implement esp_common instead
@@ -150,3 +238,152 @@ TEST_CASE("registering with ANY_BASE but specific ID fails") {
             dummy_handler,
             nullptr) == ESP_ERR_INVALID_ARG);
 }
+
+TEST_CASE("dispatch rate with growing number of registered handlers")
+{
+    const int EVENT_IDS = 8;
+    const int EVENTS = 20000;
+    static const char bases[64][8] = { };
+
+    for (int base_count = 1; base_count <= 64; base_count *= 4) {
+        FakeQueue queue;
+        MockMutex sem(CreateAnd::IGNORE);
+        esp_event_loop_handle_t loop;
+        esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+        loop_args.task_name = nullptr;
+        REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+
+        int count = 0;
+        for (int base = 0; base < base_count; base++) {
+            for (int id = 0; id < EVENT_IDS; id++) {
+                REQUIRE(ESP_OK == esp_event_handler_register_with(loop, bases[base], id, counting_handler, &count));
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < EVENTS; i++) {
+            // Not checked one by one to keep the assertions out of the measurement, count is checked below
+            esp_event_post_to(loop, bases[i % base_count], i % EVENT_IDS, nullptr, 0, portMAX_DELAY);
+            esp_event_loop_run(loop, portMAX_DELAY);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        CHECK(count == EVENTS);
+        printf("%3d handlers: %.0f events/s\n", base_count * EVENT_IDS, EVENTS / elapsed.count());
+
+        CHECK(ESP_OK == esp_event_loop_delete(loop));
+    }
+}
+
+TEST_CASE("event data is copied into the payload pool while it has free slots")
+{
+    FakeQueue queue;
+    MockMutex sem(CreateAnd::IGNORE);
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+    loop_args.payload_slot_count = 2;
+    loop_args.payload_slot_size = sizeof(uint32_t);
+    REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+
+    std::vector<ReceivedEvent> events;
+    static const char base[] = "base";
+    REQUIRE(ESP_OK == esp_event_handler_register_with(loop, base, ESP_EVENT_ANY_ID, recording_handler, &events));
+
+    // The third event doesn't get a slot and its data is copied to the heap
+    for (uint32_t i = 0; i < 3; i++) {
+        uint32_t value = 100 + i;
+        CHECK(ESP_OK == esp_event_post_to(loop, base, i, &value, sizeof(value), portMAX_DELAY));
+    }
+    CHECK(ESP_OK == esp_event_loop_run(loop, portMAX_DELAY));
+
+    REQUIRE(events.size() == 3);
+    for (uint32_t i = 0; i < 3; i++) {
+        CHECK(events[i].id == (int32_t) i);
+        CHECK(events[i].value == 100 + i);
+    }
+    CHECK(events[0].data != events[1].data);
+
+    // Both slots are free again
+    void *first;
+    void *second;
+    CHECK(ESP_OK == esp_event_post_acquire_to(loop, sizeof(uint32_t), &first));
+    CHECK(ESP_OK == esp_event_post_acquire_to(loop, sizeof(uint32_t), &second));
+    CHECK(((first == events[0].data && second == events[1].data) || (first == events[1].data && second == events[0].data)));
+    esp_event_post_release_to(loop, first);
+    esp_event_post_release_to(loop, second);
+
+    CHECK(ESP_OK == esp_event_loop_delete(loop));
+}
+
+TEST_CASE("event data can be written into an acquired buffer")
+{
+    FakeQueue queue;
+    MockMutex sem(CreateAnd::IGNORE);
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+    loop_args.payload_slot_count = 1;
+    loop_args.payload_slot_size = sizeof(uint32_t);
+    REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+
+    std::vector<ReceivedEvent> events;
+    static const char base[] = "base";
+    REQUIRE(ESP_OK == esp_event_handler_register_with(loop, base, ESP_EVENT_ANY_ID, recording_handler, &events));
+
+    void *buffer;
+    CHECK(ESP_ERR_INVALID_ARG == esp_event_post_acquire_to(loop, 0, &buffer));
+    REQUIRE(ESP_OK == esp_event_post_acquire_to(loop, sizeof(uint32_t), &buffer));
+    *static_cast<uint32_t*>(buffer) = 47;
+    CHECK(ESP_OK == esp_event_post_complete_to(loop, base, 1, buffer, portMAX_DELAY));
+
+    // Larger than a slot, from the heap
+    void *large;
+    REQUIRE(ESP_OK == esp_event_post_acquire_to(loop, 64, &large));
+    *static_cast<uint32_t*>(large) = 48;
+    CHECK(ESP_OK == esp_event_post_complete_to(loop, base, 2, large, portMAX_DELAY));
+
+    CHECK(ESP_OK == esp_event_loop_run(loop, portMAX_DELAY));
+
+    REQUIRE(events.size() == 2);
+    CHECK(events[0].data == buffer);
+    CHECK(events[0].value == 47);
+    CHECK(events[1].data == large);
+    CHECK(events[1].value == 48);
+
+    CHECK(ESP_OK == esp_event_loop_delete(loop));
+}
+
+#if CONFIG_ESP_EVENT_POST_FROM_ISR
+TEST_CASE("data larger than 4 bytes can be posted from an ISR into the payload pool")
+{
+    FakeQueue queue;
+    MockMutex sem(CreateAnd::IGNORE);
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+    loop_args.payload_slot_count = 1;
+    loop_args.payload_slot_size = sizeof(uint64_t);
+    REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+
+    std::vector<ReceivedEvent> events;
+    static const char base[] = "base";
+    REQUIRE(ESP_OK == esp_event_handler_register_with(loop, base, ESP_EVENT_ANY_ID, recording_handler, &events));
+
+    uint64_t value = 47;
+    CHECK(ESP_OK == esp_event_isr_post_to(loop, base, 1, &value, sizeof(value), nullptr));
+    // The only slot is in use
+    CHECK(ESP_ERR_INVALID_ARG == esp_event_isr_post_to(loop, base, 2, &value, sizeof(value), nullptr));
+
+    CHECK(ESP_OK == esp_event_loop_run(loop, portMAX_DELAY));
+
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].value == 47);
+
+    CHECK(ESP_OK == esp_event_isr_post_to(loop, base, 3, &value, sizeof(value), nullptr));
+    CHECK(ESP_OK == esp_event_loop_run(loop, portMAX_DELAY));
+    CHECK(events.size() == 2);
+
+    CHECK(ESP_OK == esp_event_loop_delete(loop));
+}
+#endif
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -29,6 +29,15 @@ typedef struct {
     uint32_t task_stack_size;                   /**< stack size of the event loop task, ignored if task name is NULL */
     BaseType_t task_core_id;                    /**< core to which the event loop task is pinned to,
                                                         ignored if task name is NULL */
+    uint32_t task_count;                        /**< number of event loop tasks, 0 or 1 for a single task; all tasks
+                                                        share the name, stack size, priority and core and each has
+                                                        its own queue of queue_size events. The events of a base are
+                                                        always dispatched by the same task, in the order they were
+                                                        posted. Ignored if task name is NULL */
+    uint32_t payload_slot_count;                /**< number of slots in the pool for event data; if 0, the data
+                                                        of each event is copied to the heap */
+    size_t payload_slot_size;                   /**< size of each slot in the pool, event data which is larger
+                                                        is copied to the heap */
 } esp_event_loop_args_t;
 
 /**
@@ -391,6 +400,58 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
                             size_t event_data_size,
                             TickType_t ticks_to_wait);
 
+/**
+ * @brief Gets a buffer for the data of an event to be posted with esp_event_post_complete_to.
+ *
+ * The caller writes the event data into the buffer directly, so it isn't copied again when posting. The buffer is
+ * a slot of the payload pool of the loop if the size fits into a slot and a slot is free, otherwise it is allocated
+ * from the heap.
+ *
+ * @param[in] event_loop the event loop to post to, must not be NULL
+ * @param[in] event_data_size the size of the event data
+ * @param[out] event_data the buffer for the event data
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_ARG: event_data was NULL or event_data_size was 0
+ *  - ESP_ERR_NO_MEM: Cannot allocate memory for the buffer
+ */
+esp_err_t esp_event_post_acquire_to(esp_event_loop_handle_t event_loop,
+                                    size_t event_data_size,
+                                    void **event_data);
+
+/**
+ * @brief Posts an event with data in a buffer got from esp_event_post_acquire_to.
+ *
+ * The buffer is owned by the event loop from here on, also if posting fails, and it is released after the event
+ * has been dispatched.
+ *
+ * @param[in] event_loop the event loop to post to, must be the loop the buffer was acquired from
+ * @param[in] event_base the event base that identifies the event
+ * @param[in] event_id the event ID that identifies the event
+ * @param[in] event_data the buffer returned by esp_event_post_acquire_to
+ * @param[in] ticks_to_wait number of ticks to block on a full event queue
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_TIMEOUT: Time to wait for event queue to unblock expired
+ *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID
+ *  - Others: Fail
+ */
+esp_err_t esp_event_post_complete_to(esp_event_loop_handle_t event_loop,
+                                     esp_event_base_t event_base,
+                                     int32_t event_id,
+                                     void *event_data,
+                                     TickType_t ticks_to_wait);
+
+/**
+ * @brief Releases a buffer got from esp_event_post_acquire_to without posting an event.
+ *
+ * @param[in] event_loop the event loop the buffer was acquired from
+ * @param[in] event_data the buffer returned by esp_event_post_acquire_to
+ */
+void esp_event_post_release_to(esp_event_loop_handle_t event_loop, void *event_data);
+
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 /**
  * @brief Special variant of esp_event_post for posting events from interrupt handlers.
@@ -427,7 +488,8 @@ esp_err_t esp_event_isr_post(esp_event_base_t event_base,
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event ID that identifies the event
  * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
- * @param[in] event_data_size the size of the event data
+ * @param[in] event_data_size the size of the event data; max is 4 bytes, or the slot size of the payload pool
+ *                            of the loop while it has a free slot
  * @param[out] task_unblocked an optional parameter (can be NULL) which indicates that an event task with
  *                            higher priority than currently running task has been unblocked by the posted event;
  *                            a context switch should be requested before the interrupt is existed.
@@ -440,7 +502,7 @@ esp_err_t esp_event_isr_post(esp_event_base_t event_base,
  *  - ESP_OK: Success
  *  - ESP_FAIL: Event queue for the loop full
  *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID,
- *                          data size of more than 4 bytes
+ *                          data size of more than 4 bytes which doesn't fit into a free slot of the payload pool
  *  - Others: Fail
  */
 esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
@@ -462,6 +524,8 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
            handler
            ...
        event loop
+           worker
+           ...
            handler
            handler
            ...
@@ -476,6 +540,15 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
            total_received - number of successfully posted events
            total_dropped - number of events unsuccessfully posted due to queue being full
 
+   worker
+       format: index q:queued/max_queued ev:total_dispatched lat:average_latency/max_latency
+       where:
+           index - index of the event loop task, a loop without dedicated task has a single worker
+           queued - number of events waiting in the queue of the worker
+           max_queued - largest number of events which were waiting in the queue
+           total_dispatched - number of events dispatched by the worker
+           average_latency, max_latency - time in microseconds from posting an event until its dispatch
+
    handler
        format: address ev:base,id inv:total_invoked run:total_runtime
        where:
@@ -73,22 +73,65 @@ typedef struct esp_event_loop_node {
 
 typedef SLIST_HEAD(esp_event_loop_nodes, esp_event_loop_node) esp_event_loop_nodes_t;
 
+/// Handlers to execute for an event, in the order of dispatch
+typedef struct esp_event_dispatch_entry {
+    esp_event_base_t base;                                          /**< base identifier of the event */
+    int32_t id;                                                     /**< id number of the event */
+    SLIST_ENTRY(esp_event_dispatch_entry) next;                     /**< next entry in the same bucket */
+    size_t handler_count;                                           /**< number of handlers to execute */
+    esp_event_handler_node_t* handlers[];                           /**< handlers collected from all loop nodes */
+} esp_event_dispatch_entry_t;
+
+typedef SLIST_HEAD(esp_event_dispatch_entries, esp_event_dispatch_entry) esp_event_dispatch_entries_t;
+
+struct esp_event_loop_instance;
+
+/// Queue and task dispatching the events of a share of the event bases of a loop
+typedef struct esp_event_loop_worker {
+    struct esp_event_loop_instance* loop;                           /**< loop this worker belongs to */
+    QueueHandle_t queue;                                            /**< event queue */
+    TaskHandle_t task;                                              /**< task that consumes the event queue */
+    TaskHandle_t running_task;                                      /**< task that is dispatching an event, used
+                                                                            for loops with no dedicated task */
+    SemaphoreHandle_t mutex;                                        /**< mutex held while dispatching an event;
+                                                                            the mutexes of all workers of the loop are
+                                                                            held for updating the events linked list */
+    esp_event_dispatch_entries_t* dispatch_buckets;                 /**< hash table of the handlers to execute for
+                                                                            each event, built when an event is first
+                                                                            dispatched and updated on (un)registering */
+    uint32_t dispatch_bucket_count;                                 /**< number of buckets, a power of two */
+    uint32_t dispatch_entry_count;                                  /**< number of entries in the table */
+    esp_event_dispatch_entry_t* dispatching;                        /**< entry whose handlers are being executed */
+    bool dispatching_stale;                                         /**< set if that entry was removed from the table
+                                                                            by one of its handlers */
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    uint32_t events_dispatched;                                     /**< number of events dispatched by this worker */
+    uint32_t queue_max;                                             /**< largest number of events seen in the queue */
+    uint64_t latency_total;                                         /**< sum of the times from posting to dispatching, us */
+    uint32_t latency_max;                                           /**< longest time from posting to dispatching, us */
+#endif
+} esp_event_loop_worker_t;
+
 /// Event loop
 typedef struct esp_event_loop_instance {
     const char* name;                                               /**< name of this event loop */
-    QueueHandle_t queue;                                            /**< event queue */
-    TaskHandle_t task;                                              /**< task that consumes the event queue */
-    TaskHandle_t running_task;                                      /**< for loops with no dedicated task, the
-                                                                            task that consumes the queue */
-    SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+    uint32_t handlers_generation;                                   /**< incremented each time the registered
+                                                                            handlers change */
+    uint8_t* payload_pool;                                          /**< slots for event data, NULL if the loop has none */
+    size_t payload_slot_size;                                       /**< size of each slot */
+    uint32_t payload_slot_count;                                    /**< number of slots */
+    atomic_uint_least32_t* payload_slots_used;                      /**< bitmap of the slots in use */
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
     SemaphoreHandle_t profiling_mutex;                              /**< mutex used for profiliing */
     SLIST_ENTRY(esp_event_loop_instance) next;                      /**< next event loop in the list */
 #endif
+    uint32_t worker_count;                                          /**< number of workers */
+    esp_event_loop_worker_t workers[];                              /**< workers, the events of each base are
+                                                                            dispatched by one of them */
 } esp_event_loop_instance_t;
 
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
@@ -109,6 +152,9 @@ typedef struct esp_event_post_instance {
     esp_event_base_t base;                                           /**< the event base */
     int32_t id;                                                      /**< the event id */
     esp_event_post_data_t data;                                      /**< data associated with the event */
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    int64_t time;                                                    /**< time the event was posted at, us */
+#endif
 } esp_event_post_instance_t;
 
 #ifdef __cplusplus
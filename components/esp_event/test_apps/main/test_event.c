@@ -1518,7 +1518,7 @@ static void performance_test(bool dedicated_task)
     int average = (int) (running_sum / (running_count));
 
     if (!dedicated_task) {
-        ((esp_event_loop_instance_t*) loop)->task = mtask;
+        ((esp_event_loop_instance_t*) loop)->workers[0].task = mtask;
     }
 
     TEST_ESP_OK(esp_event_loop_delete(loop));
@@ -1957,6 +1957,182 @@ TEST_CASE("events are dispatched in the order they are registered", "[event]")
     TEST_TEARDOWN();
 }
 
+TEST_CASE("posting events with no handlers doesn't grow the loop", "[event]")
+{
+    TEST_SETUP();
+
+    const int ids = 1000;
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_name = NULL;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    int count = 0;
+    simple_arg_t arg = {
+        .data = &count,
+        .mutex = xSemaphoreCreateMutex()
+    };
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler, &arg));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(1, count);
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+
+    // Distinct events which no handler is registered for, posted in batches which fit in the queue
+    for (int i = 0; i < ids; i += loop_args.queue_size) {
+        for (int j = i; j < i + loop_args.queue_size && j < ids; j++) {
+            TEST_ESP_OK(esp_event_post_to(loop, s_test_base2, j, NULL, 0, portMAX_DELAY));
+        }
+        TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    }
+
+    // A few bytes may move around the heap, but nothing is kept for each unhandled event
+    TEST_ASSERT_LESS_THAN(ids, (int) free_before - (int) heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(2, count);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    vSemaphoreDelete(arg.mutex);
+
+    TEST_TEARDOWN();
+}
+
+typedef struct {
+    int next;
+    int out_of_order;
+    SemaphoreHandle_t done;
+} sequence_data_t;
+
+static void test_event_sequence_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    sequence_data_t* seq = (sequence_data_t*) event_handler_arg;
+
+    if (*((int*) event_data) != seq->next) {
+        seq->out_of_order++;
+    }
+    seq->next = *((int*) event_data) + 1;
+
+    xSemaphoreGive(seq->done);
+}
+
+TEST_CASE("events of each base are dispatched in order by a loop with multiple tasks", "[event]")
+{
+    TEST_SETUP();
+
+    const int events = 200;
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_count = 3;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(2 * events, 0);
+    sequence_data_t seq1 = { .done = done };
+    sequence_data_t seq2 = { .done = done };
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, ESP_EVENT_ANY_ID, test_event_sequence_handler, &seq1));
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base2, ESP_EVENT_ANY_ID, test_event_sequence_handler, &seq2));
+
+    for (int i = 0; i < events; i++) {
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &i, sizeof(i), portMAX_DELAY));
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base2, TEST_EVENT_BASE2_EV1, &i, sizeof(i), portMAX_DELAY));
+    }
+
+    for (int i = 0; i < 2 * events; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+    }
+
+    TEST_ASSERT_EQUAL(0, seq1.out_of_order);
+    TEST_ASSERT_EQUAL(0, seq2.out_of_order);
+    TEST_ASSERT_EQUAL(events, seq1.next);
+    TEST_ASSERT_EQUAL(events, seq2.next);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    vSemaphoreDelete(done);
+
+    TEST_TEARDOWN();
+}
+
+typedef struct {
+    TaskHandle_t task;
+    int count;
+    SemaphoreHandle_t release;
+    SemaphoreHandle_t done;
+} worker_data_t;
+
+static void test_event_worker_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    worker_data_t* data = (worker_data_t*) event_handler_arg;
+
+    data->task = xTaskGetCurrentTaskHandle();
+    if (data->release) {
+        xSemaphoreTake(data->release, portMAX_DELAY);
+    }
+    data->count++;
+
+    xSemaphoreGive(data->done);
+}
+
+TEST_CASE("bases are spread over the tasks of a loop and a slow handler only holds up its own base", "[event]")
+{
+    TEST_SETUP();
+
+    // The task of a base depends on its address, so look for two bases dispatched by different tasks
+    static const char bases[16][4] = { };
+    worker_data_t data[16] = { };
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_count = 3;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(16, 0);
+    SemaphoreHandle_t release = xSemaphoreCreateBinary();
+
+    int other = 0;
+    for (int i = 0; i < 16; i++) {
+        data[i].done = done;
+        TEST_ESP_OK(esp_event_handler_register_with(loop, bases[i], ESP_EVENT_ANY_ID, test_event_worker_handler, &data[i]));
+        TEST_ESP_OK(esp_event_post_to(loop, bases[i], 0, NULL, 0, portMAX_DELAY));
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+        TEST_ASSERT_NOT_NULL(data[i].task);
+        if (other == 0 && data[i].task != data[0].task) {
+            other = i;
+        }
+    }
+    TEST_ASSERT_NOT_EQUAL(0, other);
+
+    // While the handler of the first base waits, the events of the other base are still dispatched
+    data[0].release = release;
+    TEST_ESP_OK(esp_event_post_to(loop, bases[0], 0, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, bases[other], 0, NULL, 0, portMAX_DELAY));
+
+    TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(2, data[other].count);
+    TEST_ASSERT_EQUAL(1, data[0].count);
+
+    xSemaphoreGive(release);
+    TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(2, data[0].count);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    vSemaphoreDelete(done);
+    vSemaphoreDelete(release);
+
+    TEST_TEARDOWN();
+}
+
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 TEST_CASE("can properly prepare event data posted to loop", "[event]")
 {
@@ -1972,14 +2148,14 @@ TEST_CASE("can properly prepare event data posted to loop", "[event]")
     esp_event_loop_instance_t* loop_def = (esp_event_loop_instance_t*) loop;
 
     TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
-    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->workers[0].queue, &post, portMAX_DELAY));
     TEST_ASSERT_EQUAL(false, post.data_set);
     TEST_ASSERT_EQUAL(false, post.data_allocated);
     TEST_ASSERT_EQUAL(NULL, post.data.ptr);
 
     int sample = 0;
     TEST_ESP_OK(esp_event_isr_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &sample, sizeof(sample), NULL));
-    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->workers[0].queue, &post, portMAX_DELAY));
     TEST_ASSERT_EQUAL(true, post.data_set);
     TEST_ASSERT_EQUAL(false, post.data_allocated);
     TEST_ASSERT_EQUAL(false, post.data.val);
@@ -0,0 +1,447 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_http_server.h"
+
+/* Keep-alive connections are opened to the server from client threads, each
+ * connection has one request in flight at a time: a new request is sent as
+ * soon as the response of the previous one is received.
+ *
+ * The poller is measured with a handler responding at once, then the worker
+ * tasks are measured with a handler taking SLOW_HANDLER_US to respond.
+ */
+
+#define SERVER_PORT         8002
+#define CLIENT_THREADS      4
+#define MAX_CONNECTIONS     1000
+#define LEVEL_DURATION_MS   2000
+#define RESPONSE_BUF_SIZE   512
+#define SLOW_HANDLER_US     1000
+#define SLOW_CONNECTIONS    100
+
+static char s_request[64];
+static const char s_body[] = "Hello World!";
+
+typedef struct {
+    int fd;
+    uint64_t sent_ns;
+    size_t received;
+    char buf[RESPONSE_BUF_SIZE];
+} connection_t;
+
+typedef struct {
+    int first;                  // index of the first connection of the thread in s_connections
+    int count;
+    uint64_t *latencies_ns;     // latency of each completed request
+    size_t latency_count;
+    size_t latency_size;
+    int served;                 // number of 200 responses, including the first request of each connection
+    int rejected;               // number of 503 responses, including the first request of each connection
+    int errors;
+} client_t;
+
+typedef struct {
+    double requests_per_s;
+    double p50_ms;
+    double p99_ms;
+    double connect_ms;          // time to open the connections and complete a first request on each
+    int served;
+    int rejected;
+    int errors;
+} level_result_t;
+
+static connection_t *s_connections;
+static pthread_barrier_t s_barrier;
+static volatile uint64_t s_deadline_ns;
+
+static uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static esp_err_t hello_get_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, s_body, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t slow_get_handler(httpd_req_t *req)
+{
+    usleep(SLOW_HANDLER_US);
+    return httpd_resp_send(req, s_body, HTTPD_RESP_USE_STRLEN);
+}
+
+/* The headers and the body of a response are sent separately, don't let
+ * Nagle's algorithm delay the body until the headers are acknowledged
+ */
+static esp_err_t open_session(httpd_handle_t hd, int sockfd)
+{
+    int enable = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return ESP_OK;
+}
+
+static httpd_handle_t start_server(int max_open_sockets, int worker_count, int slow_max_concurrency)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.max_open_sockets = max_open_sockets;
+    config.backlog_conn = 128;
+    config.open_fn = open_session;
+    config.worker_count = worker_count;
+    config.worker_queue_size = 2 * worker_count;
+
+    httpd_handle_t server = NULL;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        return NULL;
+    }
+    const httpd_uri_t hello = {
+        .uri = "/hello",
+        .method = HTTP_GET,
+        .handler = hello_get_handler,
+    };
+    const httpd_uri_t slow = {
+        .uri = "/slow",
+        .method = HTTP_GET,
+        .handler = slow_get_handler,
+        .max_concurrency = slow_max_concurrency,
+    };
+    httpd_register_uri_handler(server, &hello);
+    httpd_register_uri_handler(server, &slow);
+    return server;
+}
+
+static int connect_to_server(void)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int send_request(connection_t *conn)
+{
+    conn->received = 0;
+    conn->sent_ns = host_time_ns();
+    size_t len = strlen(s_request);
+    return (send(conn->fd, s_request, len, 0) == len) ? 0 : -1;
+}
+
+/* Receives a part of the response, returns its status code when it is complete,
+ * 0 if it isn't, -1 on error */
+static int receive_response(connection_t *conn)
+{
+    int len = recv(conn->fd, conn->buf + conn->received, sizeof(conn->buf) - 1 - conn->received, 0);
+    if (len <= 0) {
+        return -1;
+    }
+    conn->received += len;
+    conn->buf[conn->received] = '\0';
+
+    char *body = strstr(conn->buf, "\r\n\r\n");
+    if (!body) {
+        return (conn->received < sizeof(conn->buf) - 1) ? 0 : -1;
+    }
+    body += 4;
+    int status = 0;
+    const char *content_len = strstr(conn->buf, "Content-Length: ");
+    if (sscanf(conn->buf, "HTTP/1.1 %d", &status) != 1 || !content_len || content_len > body) {
+        return -1;
+    }
+    size_t body_len = strtoul(content_len + strlen("Content-Length: "), NULL, 10);
+    return (conn->received - (body - conn->buf) >= body_len) ? status : 0;
+}
+
+static void add_latency(client_t *client, uint64_t latency_ns)
+{
+    if (client->latency_count == client->latency_size) {
+        client->latency_size = client->latency_size ? 2 * client->latency_size : 4096;
+        client->latencies_ns = realloc(client->latencies_ns, client->latency_size * sizeof(uint64_t));
+        if (!client->latencies_ns) {
+            abort();
+        }
+    }
+    client->latencies_ns[client->latency_count++] = latency_ns;
+}
+
+static void *client_thread(void *arg)
+{
+    client_t *client = (client_t *) arg;
+    connection_t *conns = &s_connections[client->first];
+    struct pollfd *fds = calloc(client->count, sizeof(struct pollfd));
+
+    /* Open the connections, and complete one request on each of them before the measurement */
+    for (int i = 0; i < client->count; i++) {
+        conns[i].fd = connect_to_server();
+        fds[i].fd = conns[i].fd;
+        fds[i].events = POLLIN;
+        if (conns[i].fd < 0 || send_request(&conns[i]) < 0) {
+            client->errors++;
+        }
+    }
+    for (int i = 0; i < client->count; i++) {
+        int ret = 0;
+        while (conns[i].fd >= 0 && ret == 0) {
+            ret = receive_response(&conns[i]);
+        }
+        if (ret < 0 || (ret != 200 && ret != 503)) {
+            client->errors++;
+        } else if (ret == 503) {
+            client->rejected++;
+        } else {
+            client->served++;
+        }
+    }
+
+    pthread_barrier_wait(&s_barrier);
+    for (int i = 0; i < client->count; i++) {
+        if (conns[i].fd >= 0 && send_request(&conns[i]) < 0) {
+            client->errors++;
+        }
+    }
+    while (host_time_ns() < s_deadline_ns && client->errors == 0) {
+        int ready = poll(fds, client->count, 100);
+        for (int i = 0; i < client->count && ready > 0; i++) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            ready--;
+            int ret = receive_response(&conns[i]);
+            if (ret < 0 || (ret > 0 && ret != 200 && ret != 503)) {
+                client->errors++;
+            } else if (ret > 0) {
+                if (ret == 503) {
+                    client->rejected++;
+                } else {
+                    client->served++;
+                }
+                add_latency(client, host_time_ns() - conns[i].sent_ns);
+                if (send_request(&conns[i]) < 0) {
+                    client->errors++;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < client->count; i++) {
+        if (conns[i].fd >= 0) {
+            close(conns[i].fd);
+        }
+    }
+    free(fds);
+    return NULL;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Runs the clients on a number of connections for LEVEL_DURATION_MS */
+static void run_level(int connections, const char *path, level_result_t *result)
+{
+    client_t clients[CLIENT_THREADS] = { 0 };
+    pthread_t threads[CLIENT_THREADS];
+    int threads_count = (connections < CLIENT_THREADS) ? connections : CLIENT_THREADS;
+
+    snprintf(s_request, sizeof(s_request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", path);
+    s_connections = calloc(connections, sizeof(connection_t));
+    pthread_barrier_init(&s_barrier, NULL, threads_count + 1);
+
+    /* The client threads are not tasks, they must not handle the signals of the FreeRTOS port */
+    sigset_t all_signals, prev_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &prev_signals);
+    for (int t = 0, first = 0; t < threads_count; t++) {
+        clients[t].first = first;
+        clients[t].count = connections / threads_count + (t < connections % threads_count ? 1 : 0);
+        first += clients[t].count;
+        pthread_create(&threads[t], NULL, client_thread, &clients[t]);
+    }
+    pthread_sigmask(SIG_SETMASK, &prev_signals, NULL);
+
+    uint64_t start = host_time_ns();
+    s_deadline_ns = UINT64_MAX;
+    pthread_barrier_wait(&s_barrier);
+    uint64_t setup_ns = host_time_ns() - start;
+    start = host_time_ns();
+    s_deadline_ns = start + LEVEL_DURATION_MS * 1000000ULL;
+
+    size_t count = 0;
+    memset(result, 0, sizeof(*result));
+    for (int t = 0; t < threads_count; t++) {
+        pthread_join(threads[t], NULL);
+        count += clients[t].latency_count;
+        result->errors += clients[t].errors;
+        result->served += clients[t].served;
+        result->rejected += clients[t].rejected;
+    }
+    uint64_t elapsed_ns = host_time_ns() - start;
+
+    uint64_t *latencies_ns = malloc((count ? count : 1) * sizeof(uint64_t));
+    for (int t = 0, n = 0; t < threads_count; t++) {
+        memcpy(&latencies_ns[n], clients[t].latencies_ns, clients[t].latency_count * sizeof(uint64_t));
+        n += clients[t].latency_count;
+        free(clients[t].latencies_ns);
+    }
+    qsort(latencies_ns, count, sizeof(uint64_t), compare_u64);
+    result->requests_per_s = count * 1e9 / elapsed_ns;
+    result->p50_ms = (count ? latencies_ns[count / 2] : 0) / 1e6;
+    result->p99_ms = (count ? latencies_ns[count * 99 / 100] : 0) / 1e6;
+    result->connect_ms = setup_ns / 1e6;
+
+    free(latencies_ns);
+    pthread_barrier_destroy(&s_barrier);
+    free(s_connections);
+}
+
+/* Measures the slow handler on the server task, then on worker tasks */
+static int run_workers(void)
+{
+    const struct {
+        int worker_count;
+        int max_concurrency;
+    } configs[] = { { 0, 0 }, { 4, 0 }, { 16, 0 }, { 16, 4 } };
+
+    printf("Slow handler (%d us), %d connections\n", SLOW_HANDLER_US, SLOW_CONNECTIONS);
+    printf("%8s %8s %12s %12s %12s %12s %8s %8s %10s %10s %10s\n", "workers", "limit", "requests/s", "p50 ms", "p99 ms",
+           "connect ms", "errors", "503", "queue max", "wait us", "handler us");
+    int errors = 0;
+    for (int i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        httpd_handle_t server = start_server(SLOW_CONNECTIONS, configs[i].worker_count, configs[i].max_concurrency);
+        if (!server) {
+            printf("Failed to start the server\n");
+            return 1;
+        }
+        level_result_t result;
+        run_level(SLOW_CONNECTIONS, "/slow", &result);
+        errors += result.errors;
+        printf("%8d %8d %12.0f %12.3f %12.3f %12.1f %8d %8d", configs[i].worker_count, configs[i].max_concurrency,
+               result.requests_per_s, result.p50_ms, result.p99_ms, result.connect_ms, result.errors, result.rejected);
+        /* let the server complete the requests in flight and close the sessions before stopping it */
+        usleep(200 * 1000);
+        httpd_worker_stats_t stats;
+        if (httpd_get_worker_stats(server, &stats) == ESP_OK && stats.completed) {
+            printf(" %10" PRIu32 " %10" PRIu64 " %10" PRIu64 "\n", stats.queued_max,
+                   stats.wait_time_us / stats.completed, stats.handler_time_us / stats.completed);
+            /* Each connection may have had a request in flight when it was closed */
+            if (stats.completed < result.served || stats.completed > result.served + SLOW_CONNECTIONS) {
+                printf("%" PRIu32 " requests completed by the workers, %d responses received\n", stats.completed, result.served);
+                errors++;
+            }
+            if (stats.rejected < result.rejected) {
+                printf("%" PRIu32 " requests rejected by the server, %d 503 responses received\n", stats.rejected, result.rejected);
+                errors++;
+            }
+        } else {
+            printf(" %10s %10s %10s\n", "-", "-", "-");
+        }
+        /* More connections than max_concurrency are sending requests, some of them must be turned away */
+        if ((configs[i].max_concurrency > 0) != (result.rejected > 0)) {
+            printf("%d 503 responses with a limit of %d\n", result.rejected, configs[i].max_concurrency);
+            errors++;
+        }
+        httpd_stop(server);
+    }
+    return errors;
+}
+
+void app_main(void)
+{
+    const int levels[] = { 10, 100, 250, 500, 1000 };
+    int max_connections = MAX_CONNECTIONS;
+#if !CONFIG_HTTPD_POLL_EPOLL
+    /* The client and the server descriptors of all the connections must be lower than FD_SETSIZE */
+    max_connections = (FD_SETSIZE - 64) / 2;
+#endif
+
+    /* A send to a connection closed by the peer must fail, not kill the process */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Each connection takes a client and a server descriptor */
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < 2 * MAX_CONNECTIONS + 64) {
+        limit.rlim_cur = (limit.rlim_max < 2 * MAX_CONNECTIONS + 64) ? limit.rlim_max : 2 * MAX_CONNECTIONS + 64;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur < 2 * max_connections + 64) {
+        max_connections = (limit.rlim_cur - 64) / 2;
+    }
+
+    /* The connections are closed with a request in flight at the end of each level */
+    esp_log_level_set("httpd_txrx", ESP_LOG_ERROR);
+    esp_log_level_set("httpd_uri", ESP_LOG_ERROR);
+    /* The requests above max_concurrency are expected to be rejected */
+    esp_log_level_set("httpd_worker", ESP_LOG_ERROR);
+
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    httpd_handle_t server = start_server(max_connections, 0, 0);
+    if (!server) {
+        printf("Failed to start the server\n");
+        return;
+    }
+
+#if CONFIG_HTTPD_POLL_EPOLL
+    printf("HTTP server load test, epoll poller\n");
+#else
+    printf("HTTP server load test, select poller\n");
+#endif
+    printf("%12s %12s %12s %12s %12s %8s\n", "connections", "requests/s", "p50 ms", "p99 ms", "connect ms", "errors");
+    int errors = 0;
+    for (int i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (levels[i] > max_connections) {
+            printf("%12d skipped, more than %d connections\n", levels[i], max_connections);
+            continue;
+        }
+        level_result_t result;
+        run_level(levels[i], "/hello", &result);
+        errors += result.errors;
+        printf("%12d %12.0f %12.3f %12.3f %12.1f %8d\n", levels[i], result.requests_per_s,
+               result.p50_ms, result.p99_ms, result.connect_ms, result.errors);
+        /* let the server close the sessions of the previous level */
+        usleep(200 * 1000);
+    }
+
+    httpd_stop(server);
+
+    errors += run_workers();
+    printf("Load test done, %d errors\n", errors);
+}
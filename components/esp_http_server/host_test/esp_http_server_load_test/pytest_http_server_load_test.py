@@ -0,0 +1,13 @@
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+import pytest
+from pytest_embedded import Dut
+
+
+@pytest.mark.linux
+@pytest.mark.host_test
+@pytest.mark.parametrize('config', ['default', 'select'], indirect=True)
+def test_http_server_load(dut: Dut) -> None:
+    dut.expect_exact('HTTP server load test')
+    dut.expect_exact('Slow handler', timeout=60)
+    dut.expect_exact('Load test done, 0 errors', timeout=120)
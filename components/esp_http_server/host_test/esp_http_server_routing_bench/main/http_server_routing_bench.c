@@ -0,0 +1,372 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_http_server.h"
+#include "esp_httpd_priv.h"
+
+/* A REST API of ROUTING_RESOURCES resources with HANDLERS_PER_RESOURCE
+ * handlers each is registered on two servers: one matching the URIs with the
+ * default function or httpd_uri_match_wildcard(), which are looked up in the
+ * URI trie, and one with a custom function doing the same matching, which
+ * makes the server compare the URI to each handler in order of registration.
+ *
+ * The same lookups are done on both servers, which must return the same
+ * handler or error, and the time per lookup is measured. The servers are then
+ * given a smaller set of handlers around the edge cases of the trie, which are
+ * compared again as handlers are unregistered and registered.
+ */
+
+#define SERVER_PORT             8010
+#define ROUTING_RESOURCES       20
+#define HANDLERS_PER_RESOURCE   6
+#define ROUTING_HANDLERS        (ROUTING_RESOURCES * HANDLERS_PER_RESOURCE)
+#define MAX_LOOKUPS             1024
+#define URI_SIZE                64
+#define BENCH_DURATION_MS       500
+
+static const char *s_resources[ROUTING_RESOURCES] = {
+    "users", "groups", "devices", "sensors", "actuators", "schedules", "scenes", "rules", "alarms", "logs",
+    "events", "firmware", "network", "wifi", "mqtt", "certs", "files", "backups", "metrics", "settings",
+};
+
+/* Handlers of a resource with the wildcard matching, the URIs being the
+ * format strings of the resource name */
+static const struct {
+    const char *format;
+    httpd_method_t method;
+} s_wildcard_handlers[HANDLERS_PER_RESOURCE] = {
+    { "/api/v1/%s",     HTTP_GET },
+    { "/api/v1/%s",     HTTP_POST },
+    { "/api/v1/%s/*",   HTTP_GET },
+    { "/api/v1/%s/*",   HTTP_PUT },
+    { "/api/v1/%s/*",   HTTP_DELETE },
+    { "/api/v1/%s/?",   HTTP_HEAD },
+};
+
+/* Actions of a resource with the default matching, the URIs being
+ * "/api/v1/<resource>/<action>" */
+static const char *s_actions[HANDLERS_PER_RESOURCE] = {
+    "list", "get", "create", "update", "delete", "stats",
+};
+
+/* Edge cases of the trie: exact and prefix routes along the same node path,
+ * with the same method or not, a root "*", "?" and "?*" templates and invalid
+ * templates, which match no URI. A URI matched by a handler with the same
+ * method can't be registered after it */
+static const struct {
+    const char *uri;
+    httpd_method_t method;
+} s_edge_handlers[] = {
+    { "/a/b",       HTTP_GET },
+    { "/a/*",       HTTP_GET },
+    { "/a/bc*",     HTTP_POST },
+    { "/a/*",       HTTP_POST },
+    { "/a/b",       HTTP_PUT },
+    { "/a/b/c?",    HTTP_HEAD },
+    { "/a/b/c?*",   HTTP_DELETE },
+    { "/a?",        HTTP_HEAD },
+    { "/x/?*",      HTTP_GET },
+    { "/x/",        HTTP_POST },
+    { "/x/y",       HTTP_PATCH },
+    { "/z",         HTTP_PUT },
+    { "*",          HTTP_PUT },
+    { "/?*",        HTTP_DELETE },
+    { "?",          HTTP_GET },
+    { "?*",         HTTP_POST },
+    { "*?",         HTTP_PATCH },
+};
+
+static const char *s_edge_uris[] = {
+    "", "/", "/a", "/ab", "/a/", "/a/b", "/a/bc", "/a/bcd", "/a/bx", "/a/b/", "/a/b/c", "/a/b/cd", "/a/b/cx",
+    "/x", "/x/", "/xy", "/x/y", "/x//", "/z", "/q", "*", "?", "?*", "*?", "/a?", "/a/*",
+};
+
+static const httpd_method_t s_methods[] = {
+    HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_DELETE, HTTP_HEAD, HTTP_PATCH,
+};
+
+typedef struct {
+    char uri[URI_SIZE];
+    size_t len;
+    httpd_method_t method;
+} lookup_t;
+
+static char s_uris[ROUTING_HANDLERS][URI_SIZE];
+static lookup_t s_lookups[MAX_LOOKUPS];
+static int s_lookup_count;
+
+static uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static esp_err_t null_handler(httpd_req_t *req)
+{
+    return ESP_OK;
+}
+
+/* Same matching as the defaults of the server, but in custom functions */
+static bool linear_match_simple(const char *reference_uri, const char *uri, size_t len)
+{
+    return strlen(reference_uri) == len && strncmp(reference_uri, uri, len) == 0;
+}
+
+static bool linear_match_wildcard(const char *reference_uri, const char *uri, size_t len)
+{
+    return httpd_uri_match_wildcard(reference_uri, uri, len);
+}
+
+static void add_lookup(const char *uri, httpd_method_t method)
+{
+    if (s_lookup_count < MAX_LOOKUPS) {
+        lookup_t *lookup = &s_lookups[s_lookup_count++];
+        snprintf(lookup->uri, sizeof(lookup->uri), "%s", uri);
+        lookup->len = strlen(lookup->uri);
+        lookup->method = method;
+    }
+}
+
+/* Hits, 404 and 405 of each resource, with all the methods */
+static void add_lookups(bool wildcard)
+{
+    s_lookup_count = 0;
+    for (int r = 0; r < ROUTING_RESOURCES; r++) {
+        char uris[8][URI_SIZE];
+        int uri_count = 0;
+        snprintf(uris[uri_count++], URI_SIZE, "/api/v1/%s", s_resources[r]);
+        snprintf(uris[uri_count++], URI_SIZE, "/api/v1/%s/", s_resources[r]);
+        snprintf(uris[uri_count++], URI_SIZE, "/api/v1/%sx", s_resources[r]);
+        snprintf(uris[uri_count++], URI_SIZE, "/api/v2/%s", s_resources[r]);
+        if (wildcard) {
+            snprintf(uris[uri_count++], URI_SIZE, "/api/v1/%s/42", s_resources[r]);
+            snprintf(uris[uri_count++], URI_SIZE, "/api/v1/%s/42/name", s_resources[r]);
+        } else {
+            snprintf(uris[uri_count++], URI_SIZE, "/api/v1/%s/%s", s_resources[r], s_actions[r % HANDLERS_PER_RESOURCE]);
+            snprintf(uris[uri_count++], URI_SIZE, "/api/v1/%s/%s/", s_resources[r], s_actions[r % HANDLERS_PER_RESOURCE]);
+        }
+        for (int u = 0; u < uri_count; u++) {
+            for (int m = 0; m < sizeof(s_methods) / sizeof(s_methods[0]); m++) {
+                add_lookup(uris[u], s_methods[m]);
+            }
+        }
+    }
+}
+
+static esp_err_t register_edge_handler(httpd_handle_t server, int i)
+{
+    httpd_uri_t uri = {
+        .uri = s_edge_handlers[i].uri,
+        .method = s_edge_handlers[i].method,
+        .handler = null_handler,
+        .user_ctx = (void *) (intptr_t) i,
+    };
+    return httpd_register_uri_handler(server, &uri);
+}
+
+static httpd_handle_t start_server(int id, httpd_uri_match_func_t match_fn, bool wildcard)
+{
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT + id;
+    config.ctrl_port = config.ctrl_port + id;
+    config.max_uri_handlers = ROUTING_HANDLERS;
+    config.uri_match_fn = match_fn;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        return NULL;
+    }
+
+    for (int i = 0; i < ROUTING_HANDLERS; i++) {
+        const char *resource = s_resources[i / HANDLERS_PER_RESOURCE];
+        int h = i % HANDLERS_PER_RESOURCE;
+        httpd_uri_t uri = {
+            .uri = s_uris[i],
+            .method = wildcard ? s_wildcard_handlers[h].method : HTTP_GET,
+            .handler = null_handler,
+            .user_ctx = (void *) (intptr_t) i,
+        };
+        if (wildcard) {
+            snprintf(s_uris[i], URI_SIZE, s_wildcard_handlers[h].format, resource);
+        } else {
+            snprintf(s_uris[i], URI_SIZE, "/api/v1/%s/%s", resource, s_actions[h]);
+        }
+        if (httpd_register_uri_handler(server, &uri) != ESP_OK) {
+            printf("Failed to register %s\n", s_uris[i]);
+            httpd_stop(server);
+            return NULL;
+        }
+    }
+    return server;
+}
+
+/* Returns the index of the handler found for a lookup, or the error code */
+static intptr_t find_handler(httpd_handle_t server, const lookup_t *lookup)
+{
+    httpd_err_code_t err;
+    httpd_uri_t *uri = httpd_find_uri_handler((struct httpd_data *) server, lookup->uri, lookup->len,
+                                              lookup->method, &err);
+    return uri ? (intptr_t) uri->user_ctx : -(intptr_t) err;
+}
+
+/* Returns the number of lookups on which the servers differ. The trie server
+ * must also still have a trie for its handlers */
+static int compare_lookups(httpd_handle_t trie, httpd_handle_t linear, const char *name, const char *step)
+{
+    int mismatches = 0;
+    struct httpd_data *hd = (struct httpd_data *) trie;
+    if (hd->hd_calls[0] && !hd->hd_uri_trie) {
+        printf("%s, %s: no URI trie\n", name, step);
+        mismatches++;
+    }
+    for (int i = 0; i < s_lookup_count; i++) {
+        intptr_t expected = find_handler(linear, &s_lookups[i]);
+        intptr_t found = find_handler(trie, &s_lookups[i]);
+        if (found != expected) {
+            printf("%s, %s: mismatch for \"%s\" method %d: %d instead of %d\n", name, step, s_lookups[i].uri,
+                   s_lookups[i].method, (int) found, (int) expected);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+static double bench_ns(httpd_handle_t server, const lookup_t *lookups, int count)
+{
+    volatile intptr_t sink = 0;
+    uint64_t lookup_count = 0;
+    uint64_t start = host_time_ns();
+    uint64_t deadline = start + (uint64_t) BENCH_DURATION_MS * 1000000;
+    uint64_t now;
+    do {
+        for (int i = 0; i < count; i++) {
+            sink += find_handler(server, &lookups[i]);
+        }
+        lookup_count += count;
+        now = host_time_ns();
+    } while (now < deadline);
+    (void) sink;
+    return (double) (now - start) / lookup_count;
+}
+
+/* Replaces the handlers of both servers with the edge cases and compares the
+ * lookups as they are unregistered and registered again */
+static int run_edge_cases(httpd_handle_t trie, httpd_handle_t linear, const char *name, bool wildcard)
+{
+    const int handler_count = sizeof(s_edge_handlers) / sizeof(s_edge_handlers[0]);
+    httpd_handle_t servers[] = { trie, linear };
+    int mismatches = 0;
+
+    s_lookup_count = 0;
+    for (int u = 0; u < sizeof(s_edge_uris) / sizeof(s_edge_uris[0]); u++) {
+        for (int m = 0; m < sizeof(s_methods) / sizeof(s_methods[0]); m++) {
+            add_lookup(s_edge_uris[u], s_methods[m]);
+        }
+    }
+
+    for (int s = 0; s < 2; s++) {
+        for (int i = 0; i < ROUTING_HANDLERS; i++) {
+            httpd_unregister_uri(servers[s], s_uris[i]);
+        }
+        for (int i = 0; i < handler_count; i++) {
+            if (register_edge_handler(servers[s], i) != ESP_OK) {
+                printf("%s: failed to register %s\n", name, s_edge_handlers[i].uri);
+                return mismatches + 1;
+            }
+        }
+    }
+    mismatches += compare_lookups(trie, linear, name, "edge cases");
+
+    /* Each step must give the expected result on both servers */
+#define EDGE_STEP(expr, expected, step) do { \
+        for (int s = 0; s < 2; s++) { \
+            httpd_handle_t server = servers[s]; \
+            esp_err_t err = (expr); \
+            if (err != (expected)) { \
+                printf("%s, %s: error 0x%x\n", name, step, err); \
+                mismatches++; \
+            } \
+        } \
+        mismatches += compare_lookups(trie, linear, name, step); \
+    } while (0)
+
+    EDGE_STEP(httpd_unregister_uri_handler(server, "/a/b", HTTP_GET), ESP_OK, "unregister GET /a/b");
+    EDGE_STEP(httpd_unregister_uri(server, "/a/*"), ESP_OK, "unregister /a/*");
+    EDGE_STEP(register_edge_handler(server, 1), ESP_OK, "register GET /a/*");
+    /* The wildcard template of GET matches the URI "/a/b" */
+    EDGE_STEP(register_edge_handler(server, 0), wildcard ? ESP_ERR_HTTPD_HANDLER_EXISTS : ESP_OK, "register GET /a/b");
+    EDGE_STEP(register_edge_handler(server, 3), ESP_OK, "register POST /a/*");
+    EDGE_STEP(httpd_unregister_uri(server, "*"), ESP_OK, "unregister *");
+    EDGE_STEP(httpd_unregister_uri(server, "/x/?*"), ESP_OK, "unregister /x/?*");
+    EDGE_STEP(httpd_unregister_uri(server, "?"), ESP_OK, "unregister ?");
+    EDGE_STEP(httpd_unregister_uri(server, "?"), ESP_ERR_NOT_FOUND, "unregister ? again");
+    EDGE_STEP(register_edge_handler(server, 12), ESP_OK, "register PUT *");
+    /* The first handler of hd_calls, the others move down */
+    EDGE_STEP(httpd_unregister_uri_handler(server, "/a/bc*", HTTP_POST), ESP_OK, "unregister POST /a/bc*");
+    for (int i = 0; i < handler_count; i++) {
+        httpd_unregister_uri(trie, s_edge_handlers[i].uri);
+        httpd_unregister_uri(linear, s_edge_handlers[i].uri);
+    }
+    /* The trie is created again with the first handler */
+    EDGE_STEP(register_edge_handler(server, 8), ESP_OK, "register GET /x/?* alone");
+#undef EDGE_STEP
+
+    return mismatches;
+}
+
+static int run_matcher(const char *name, bool wildcard)
+{
+    httpd_handle_t trie = start_server(0, wildcard ? httpd_uri_match_wildcard : NULL, wildcard);
+    httpd_handle_t linear = start_server(1, wildcard ? linear_match_wildcard : linear_match_simple, wildcard);
+    if (!trie || !linear) {
+        printf("Failed to start the servers\n");
+        if (trie) {
+            httpd_stop(trie);
+        }
+        if (linear) {
+            httpd_stop(linear);
+        }
+        return 1;
+    }
+
+    add_lookups(wildcard);
+    int mismatches = compare_lookups(trie, linear, name, "registered");
+
+    /* The handler registered last is the worst case of the linear scan */
+    lookup_t last = { .method = wildcard ? s_wildcard_handlers[HANDLERS_PER_RESOURCE - 1].method : HTTP_GET };
+    snprintf(last.uri, sizeof(last.uri), "%s", s_uris[ROUTING_HANDLERS - 1]);
+    last.len = strlen(last.uri);
+
+    double linear_ns = bench_ns(linear, s_lookups, s_lookup_count);
+    double trie_ns = bench_ns(trie, s_lookups, s_lookup_count);
+    printf("%10s %10s %8d %12.1f %12.1f %8.1fx\n", name, "mixed", s_lookup_count, linear_ns, trie_ns, linear_ns / trie_ns);
+    linear_ns = bench_ns(linear, &last, 1);
+    trie_ns = bench_ns(trie, &last, 1);
+    printf("%10s %10s %8d %12.1f %12.1f %8.1fx\n", name, "last", 1, linear_ns, trie_ns, linear_ns / trie_ns);
+
+    mismatches += run_edge_cases(trie, linear, name, wildcard);
+    httpd_stop(trie);
+    httpd_stop(linear);
+    return mismatches;
+}
+
+void app_main(void)
+{
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    printf("HTTP server routing benchmark, %d handlers\n", ROUTING_HANDLERS);
+    printf("%10s %10s %8s %12s %12s %9s\n", "matcher", "lookups", "count", "linear ns", "trie ns", "speedup");
+    int mismatches = run_matcher("simple", false);
+    mismatches += run_matcher("wildcard", true);
+    printf("Routing benchmark done, %d mismatches\n", mismatches);
+}
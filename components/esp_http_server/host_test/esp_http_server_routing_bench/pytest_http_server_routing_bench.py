@@ -0,0 +1,11 @@
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+import pytest
+from pytest_embedded import Dut
+
+
+@pytest.mark.linux
+@pytest.mark.host_test
+def test_http_server_routing_bench(dut: Dut) -> None:
+    dut.expect_exact('HTTP server routing benchmark')
+    dut.expect_exact('Routing benchmark done, 0 mismatches', timeout=60)
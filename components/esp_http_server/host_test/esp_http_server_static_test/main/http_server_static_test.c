@@ -0,0 +1,517 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_http_server.h"
+
+/* A temporary directory is served under "/www" with the default configuration
+ * and under "/raw" without index file nor precompressed variants. The
+ * responses of the server are checked with and without worker tasks */
+
+#define SERVER_PORT         8040
+#define DATA_SIZE           100
+#define BIG_SIZE            (8 * 1024 * 1024)
+#define HEADERS_SIZE        1024
+#define MAX_FILES           16
+
+/* Body of the default 404 responses of the server */
+#define NOT_FOUND           "Nothing matches the given URI"
+
+typedef struct {
+    int status;
+    char headers[HEADERS_SIZE];     // status line and headers, null terminated
+    char *body;
+    size_t body_len;
+} response_t;
+
+static char s_dir[] = "/tmp/httpd_static_XXXXXX";
+static char *s_paths[MAX_FILES];    // created files and directories, removed in reverse order
+static int s_path_count;
+static char s_data[DATA_SIZE];
+static char s_etag[64];             // ETag of data.txt
+static bool s_send_override;        // sessions opened while set don't use sendfile()
+static int s_errors;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __func__, __LINE__, #cond); \
+            s_errors++; \
+        } \
+    } while (0)
+
+static int add_path(const char *rel, bool dir, const void *data, size_t len)
+{
+    size_t size = sizeof(s_dir) + strlen(rel) + 1;
+    char *path = malloc(size);
+    if (s_path_count == MAX_FILES || !path) {
+        free(path);
+        return -1;
+    }
+    snprintf(path, size, "%s/%s", s_dir, rel);
+    s_paths[s_path_count++] = path;
+    if (dir) {
+        return mkdir(path, 0700);
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return -1;
+    }
+    size_t written = fwrite(data, 1, len, f);
+    return (fclose(f) == 0 && written == len) ? 0 : -1;
+}
+
+static int create_files(void)
+{
+    for (int i = 0; i < DATA_SIZE; i++) {
+        s_data[i] = 'a' + i % 26;
+    }
+    char *big = malloc(BIG_SIZE);
+    if (!big || !mkdtemp(s_dir)) {
+        free(big);
+        return -1;
+    }
+    for (int i = 0; i < BIG_SIZE; i++) {
+        big[i] = (char) (i % 251);
+    }
+    int ret = add_path("secret.txt", false, "secret", 6) |
+              add_path("www", true, NULL, 0) |
+              add_path("www/index.html", false, "<p>index</p>", 12) |
+              add_path("www/data.txt", false, s_data, DATA_SIZE) |
+              add_path("www/data.txt.gz", false, "gzip data", 9) |
+              add_path("www/data.txt.br", false, "br data", 7) |
+              add_path("www/dots..txt", false, "dots", 4) |
+              add_path("www/big.bin", false, big, BIG_SIZE) |
+              add_path("www/sub", true, NULL, 0) |
+              add_path("www/sub/index.html", false, "<p>sub</p>", 10);
+    free(big);
+    return ret;
+}
+
+static void remove_files(void)
+{
+    while (s_path_count > 0) {
+        remove(s_paths[--s_path_count]);
+        free(s_paths[s_path_count]);
+    }
+    rmdir(s_dir);
+}
+
+static int send_override(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    return send(sockfd, buf, buf_len, flags);
+}
+
+static esp_err_t open_session(httpd_handle_t hd, int sockfd)
+{
+    if (s_send_override) {
+        httpd_sess_set_send_override(hd, sockfd, send_override);
+    }
+    return ESP_OK;
+}
+
+static httpd_handle_t start_server(int worker_count)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.worker_count = worker_count;
+    config.open_fn = open_session;
+    httpd_handle_t server = NULL;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        return NULL;
+    }
+
+    char base_path[64];
+    snprintf(base_path, sizeof(base_path), "%s/www", s_dir);
+    httpd_static_dir_config_t www = HTTPD_STATIC_DIR_DEFAULT_CONFIG();
+    www.uri_prefix = "/www/";
+    www.base_path = base_path;
+    www.cache_control = "max-age=60";
+    httpd_static_dir_config_t raw = HTTPD_STATIC_DIR_DEFAULT_CONFIG();
+    raw.uri_prefix = "/raw";
+    raw.base_path = base_path;
+    raw.index_file = NULL;
+    raw.precompressed = false;
+    if (httpd_register_static_dir(server, &www) != ESP_OK ||
+        httpd_register_static_dir(server, &raw) != ESP_OK) {
+        httpd_stop(server);
+        return NULL;
+    }
+    return server;
+}
+
+static int connect_to_server(int rcvbuf)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (rcvbuf) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int send_request(int fd, const char *method, const char *uri, const char *headers)
+{
+    char request[512];
+    int len = snprintf(request, sizeof(request), "%s %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n",
+                       method, uri, headers ? headers : "");
+    return (send(fd, request, len, 0) == len) ? 0 : -1;
+}
+
+/* Receives a response, the body of which is allocated. The responses to
+ * HEAD requests have no body */
+static int receive_response(int fd, bool head, response_t *resp)
+{
+    memset(resp, 0, sizeof(*resp));
+    size_t received = 0;
+    char *end = NULL;
+    while (!end) {
+        /* Peek to leave the body in the socket */
+        int len = recv(fd, resp->headers, sizeof(resp->headers) - 1, MSG_PEEK);
+        if (len <= 0) {
+            return -1;
+        }
+        resp->headers[len] = '\0';
+        end = strstr(resp->headers, "\r\n\r\n");
+        if (!end && len == sizeof(resp->headers) - 1) {
+            return -1;
+        }
+        received = end ? end + 4 - resp->headers : 0;
+    }
+    if (recv(fd, resp->headers, received, MSG_WAITALL) != received) {
+        return -1;
+    }
+    resp->headers[received] = '\0';
+
+    const char *content_len = strstr(resp->headers, "\r\nContent-Length: ");
+    if (sscanf(resp->headers, "HTTP/1.1 %d", &resp->status) != 1 || !content_len) {
+        return -1;
+    }
+    resp->body_len = head ? 0 : strtoul(content_len + strlen("\r\nContent-Length: "), NULL, 10);
+    resp->body = malloc(resp->body_len + 1);
+    if (!resp->body) {
+        return -1;
+    }
+    if (resp->body_len && recv(fd, resp->body, resp->body_len, MSG_WAITALL) != resp->body_len) {
+        return -1;
+    }
+    resp->body[resp->body_len] = '\0';
+    return 0;
+}
+
+static int request(const char *method, const char *uri, const char *headers, response_t *resp)
+{
+    int fd = connect_to_server(0);
+    if (fd < 0) {
+        memset(resp, 0, sizeof(*resp));
+        return -1;
+    }
+    int ret = send_request(fd, method, uri, headers);
+    if (ret == 0) {
+        ret = receive_response(fd, strcmp(method, "HEAD") == 0, resp);
+    }
+    close(fd);
+    return ret;
+}
+
+/* Copies the value of a header of the response, returns false if absent */
+static bool get_header(const response_t *resp, const char *name, char *value, size_t size)
+{
+    char field[64];
+    snprintf(field, sizeof(field), "\r\n%s: ", name);
+    const char *start = strstr(resp->headers, field);
+    if (!start) {
+        return false;
+    }
+    start += strlen(field);
+    snprintf(value, size, "%.*s", (int) strcspn(start, "\r"), start);
+    return true;
+}
+
+/* Checks a response, the header value being NULL for a header which must be
+ * absent, and the body NULL for an empty body */
+static bool check_response(const char *what, const response_t *resp, int status,
+                           const char *header, const char *value, const void *body, size_t body_len)
+{
+    bool ok = (resp->status == status);
+    if (ok && header) {
+        char found[128];
+        bool present = get_header(resp, header, found, sizeof(found));
+        ok = value ? (present && strcmp(found, value) == 0) : !present;
+    }
+    ok = ok && resp->body_len == (body ? body_len : 0) && (!body || memcmp(resp->body, body, body_len) == 0);
+    if (!ok) {
+        printf("%s: unexpected response\n%s%.*s\n", what, resp->headers, (int) MIN(resp->body_len, 64), resp->body ? resp->body : "");
+        s_errors++;
+    }
+    return ok;
+}
+
+static void check_request(const char *method, const char *uri, const char *headers, int status,
+                          const char *header, const char *value, const void *body, size_t body_len)
+{
+    char what[256];
+    snprintf(what, sizeof(what), "%s %s %s", method, uri, headers ? headers : "");
+    what[strcspn(what, "\r")] = '\0';
+    response_t resp;
+    if (request(method, uri, headers, &resp) != 0) {
+        printf("%s: request failed\n", what);
+        s_errors++;
+    } else {
+        check_response(what, &resp, status, header, value, body, body_len);
+    }
+    free(resp.body);
+}
+
+static void test_file(void)
+{
+    response_t resp;
+    CHECK(request("GET", "/www/data.txt", NULL, &resp) == 0);
+    CHECK(check_response("data.txt", &resp, 200, "Content-Type", "text/plain", s_data, DATA_SIZE));
+    char value[64];
+    CHECK(get_header(&resp, "Accept-Ranges", value, sizeof(value)) && strcmp(value, "bytes") == 0);
+    CHECK(get_header(&resp, "Cache-Control", value, sizeof(value)) && strcmp(value, "max-age=60") == 0);
+    CHECK(get_header(&resp, "Vary", value, sizeof(value)) && strcmp(value, "Accept-Encoding") == 0);
+    CHECK(!get_header(&resp, "Content-Encoding", value, sizeof(value)));
+    CHECK(!get_header(&resp, "Content-Range", value, sizeof(value)));
+    CHECK(get_header(&resp, "ETag", s_etag, sizeof(s_etag)) && s_etag[0] == '"');
+    free(resp.body);
+
+    check_request("GET", "/www/missing.txt", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    /* Only GET and HEAD requests are answered with the files */
+    check_request("POST", "/www/data.txt", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    /* The directory without precompressed variants */
+    check_request("GET", "/raw/data.txt", "Accept-Encoding: gzip\r\n", 200, "Vary", NULL, s_data, DATA_SIZE);
+    check_request("GET", "/raw/data.txt.gz", NULL, 200, "Content-Type", "application/octet-stream", "gzip data", 9);
+}
+
+static void test_range(void)
+{
+    check_request("GET", "/www/data.txt", "Range: bytes=10-19\r\n", 206,
+                  "Content-Range", "bytes 10-19/100", s_data + 10, 10);
+    check_request("GET", "/www/data.txt", "Range: bytes=90-\r\n", 206,
+                  "Content-Range", "bytes 90-99/100", s_data + 90, 10);
+    check_request("GET", "/www/data.txt", "Range: bytes=95-200\r\n", 206,
+                  "Content-Range", "bytes 95-99/100", s_data + 95, 5);
+
+    /* Suffix ranges */
+    check_request("GET", "/www/data.txt", "Range: bytes=-5\r\n", 206,
+                  "Content-Range", "bytes 95-99/100", s_data + 95, 5);
+    check_request("GET", "/www/data.txt", "Range: bytes=-500\r\n", 206,
+                  "Content-Range", "bytes 0-99/100", s_data, DATA_SIZE);
+
+    /* Unsatisfiable ranges */
+    check_request("GET", "/www/data.txt", "Range: bytes=100-\r\n", 416,
+                  "Content-Range", "bytes */100", NULL, 0);
+    check_request("GET", "/www/data.txt", "Range: bytes=-0\r\n", 416,
+                  "Content-Range", "bytes */100", NULL, 0);
+
+    /* Ranges which are ignored: several ranges, invalid ones and other units */
+    check_request("GET", "/www/data.txt", "Range: bytes=0-1,5-6\r\n", 200, "Content-Range", NULL, s_data, DATA_SIZE);
+    check_request("GET", "/www/data.txt", "Range: bytes=5-2\r\n", 200, "Content-Range", NULL, s_data, DATA_SIZE);
+    check_request("GET", "/www/data.txt", "Range: items=0-1\r\n", 200, "Content-Range", NULL, s_data, DATA_SIZE);
+
+    /* If-Range must name the current version of the file, with a strong ETag */
+    char headers[160];
+    snprintf(headers, sizeof(headers), "Range: bytes=10-19\r\nIf-Range: %s\r\n", s_etag);
+    check_request("GET", "/www/data.txt", headers, 206, "Content-Range", "bytes 10-19/100", s_data + 10, 10);
+    snprintf(headers, sizeof(headers), "Range: bytes=10-19\r\nIf-Range: W/%s\r\n", s_etag);
+    check_request("GET", "/www/data.txt", headers, 200, "Content-Range", NULL, s_data, DATA_SIZE);
+    check_request("GET", "/www/data.txt", "Range: bytes=10-19\r\nIf-Range: \"old\"\r\n", 200,
+                  "Content-Range", NULL, s_data, DATA_SIZE);
+
+    /* The range applies to the precompressed variant */
+    check_request("GET", "/www/data.txt", "Range: bytes=0-3\r\nAccept-Encoding: gzip\r\n", 206,
+                  "Content-Range", "bytes 0-3/9", "gzip", 4);
+}
+
+static void test_encoding(void)
+{
+    const char *uri = "/www/data.txt";
+    check_request("GET", uri, "Accept-Encoding: gzip\r\n", 200, "Content-Encoding", "gzip", "gzip data", 9);
+    check_request("GET", uri, "Accept-Encoding: gzip, deflate, br\r\n", 200, "Content-Encoding", "br", "br data", 7);
+    check_request("GET", uri, "Accept-Encoding: BR\r\n", 200, "Content-Encoding", "br", "br data", 7);
+    check_request("GET", uri, "Accept-Encoding: *\r\n", 200, "Content-Encoding", "br", "br data", 7);
+    check_request("GET", uri, "Accept-Encoding: identity\r\n", 200, "Content-Encoding", NULL, s_data, DATA_SIZE);
+
+    /* q=0 refuses a coding, other q values don't */
+    check_request("GET", uri, "Accept-Encoding: br;q=0, gzip\r\n", 200, "Content-Encoding", "gzip", "gzip data", 9);
+    check_request("GET", uri, "Accept-Encoding: br; q=0.000, gzip;q=0.5\r\n", 200,
+                  "Content-Encoding", "gzip", "gzip data", 9);
+    check_request("GET", uri, "Accept-Encoding: br;q=0.001\r\n", 200, "Content-Encoding", "br", "br data", 7);
+    check_request("GET", uri, "Accept-Encoding: br;q=0, gzip;Q=0.0\r\n", 200,
+                  "Content-Encoding", NULL, s_data, DATA_SIZE);
+    check_request("GET", uri, "Accept-Encoding: *;q=0\r\n", 200, "Content-Encoding", NULL, s_data, DATA_SIZE);
+
+    /* The variants have their own ETag */
+    response_t resp;
+    char etag[64];
+    CHECK(request("GET", uri, "Accept-Encoding: gzip\r\n", &resp) == 0);
+    CHECK(get_header(&resp, "ETag", etag, sizeof(etag)) && strcmp(etag, s_etag) != 0);
+    free(resp.body);
+}
+
+static void test_etag(void)
+{
+    const char *uri = "/www/data.txt";
+    char headers[160];
+    snprintf(headers, sizeof(headers), "If-None-Match: %s\r\n", s_etag);
+    check_request("GET", uri, headers, 304, "ETag", s_etag, NULL, 0);
+
+    /* If-None-Match compares the ETags weakly */
+    snprintf(headers, sizeof(headers), "If-None-Match: W/%s\r\n", s_etag);
+    check_request("GET", uri, headers, 304, "ETag", s_etag, NULL, 0);
+    snprintf(headers, sizeof(headers), "If-None-Match: \"other\", W/\"x\",%s\r\n", s_etag);
+    check_request("GET", uri, headers, 304, "ETag", s_etag, NULL, 0);
+    check_request("GET", uri, "If-None-Match: *\r\n", 304, "ETag", s_etag, NULL, 0);
+    check_request("GET", uri, "If-None-Match: \"other\"\r\n", 200, "ETag", s_etag, s_data, DATA_SIZE);
+
+    /* A matching ETag takes precedence over a range */
+    snprintf(headers, sizeof(headers), "If-None-Match: %s\r\nRange: bytes=0-1\r\n", s_etag);
+    check_request("GET", uri, headers, 304, "Content-Range", NULL, NULL, 0);
+
+    /* The ETag of the file doesn't match its precompressed variants */
+    snprintf(headers, sizeof(headers), "If-None-Match: %s\r\nAccept-Encoding: gzip\r\n", s_etag);
+    check_request("GET", uri, headers, 200, "Content-Encoding", "gzip", "gzip data", 9);
+}
+
+static void test_traversal(void)
+{
+    check_request("GET", "/www/../secret.txt", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    check_request("GET", "/www/sub/../../secret.txt", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    check_request("GET", "/www/sub/../data.txt", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    check_request("GET", "/www/..", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    check_request("GET", "/raw/../secret.txt", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    check_request("GET", "/raw/..", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+
+    /* ".." is only refused as a path segment */
+    check_request("GET", "/www/dots..txt", NULL, 200, NULL, NULL, "dots", 4);
+}
+
+static void test_index_and_head(void)
+{
+    check_request("GET", "/www/", NULL, 200, "Content-Type", "text/html", "<p>index</p>", 12);
+    check_request("GET", "/www", NULL, 200, "Content-Type", "text/html", "<p>index</p>", 12);
+    check_request("GET", "/www/sub/", NULL, 200, "Content-Type", "text/html", "<p>sub</p>", 10);
+    check_request("GET", "/www/sub/index.html", NULL, 200, "Content-Type", "text/html", "<p>sub</p>", 10);
+    check_request("HEAD", "/www/sub/", NULL, 200, "Content-Length", "10", NULL, 0);
+    /* Without index file, the directories are not found */
+    check_request("GET", "/raw/", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    check_request("GET", "/raw/sub/", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    /* A directory isn't a file */
+    check_request("GET", "/www/sub", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+
+    /* HEAD has the headers of GET without the body */
+    check_request("HEAD", "/www/data.txt", NULL, 200, "Content-Length", "100", NULL, 0);
+    check_request("HEAD", "/www/data.txt", "Range: bytes=10-19\r\n", 206, "Content-Range", "bytes 10-19/100", NULL, 0);
+    check_request("HEAD", "/www/data.txt", "Range: bytes=10-19\r\n", 206, "Content-Length", "10", NULL, 0);
+    check_request("HEAD", "/www/data.txt", "Accept-Encoding: gzip\r\n", 200, "Content-Length", "9", NULL, 0);
+    check_request("HEAD", "/www/missing.txt", NULL, 404, NULL, NULL, NULL, 0);
+}
+
+/* A worker task keeps serving a file from the buffer of its directory while
+ * the directory is unregistered */
+static void test_unregister_in_flight(httpd_handle_t server)
+{
+    char base_path[64];
+    snprintf(base_path, sizeof(base_path), "%s/www", s_dir);
+    httpd_static_dir_config_t big = HTTPD_STATIC_DIR_DEFAULT_CONFIG();
+    big.uri_prefix = "/big";
+    big.base_path = base_path;
+    big.buffer_size = 512;
+    CHECK(httpd_register_static_dir(server, &big) == ESP_OK);
+
+    /* The file is read into the buffer of the directory, not sent with
+     * sendfile(), and the small receive window holds the worker up */
+    s_send_override = true;
+    int fd = connect_to_server(4096);
+    s_send_override = false;
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    CHECK(send_request(fd, "GET", "/big/big.bin", NULL) == 0);
+    usleep(100 * 1000);
+    CHECK(httpd_unregister_static_dir(server, "/big") == ESP_OK);
+
+    response_t resp;
+    CHECK(receive_response(fd, false, &resp) == 0);
+    close(fd);
+    CHECK(resp.status == 200);
+    CHECK(resp.body_len == BIG_SIZE);
+    for (size_t i = 0; i < resp.body_len; i++) {
+        if (resp.body[i] != (char) (i % 251)) {
+            printf("big.bin differs at %zu\n", i);
+            s_errors++;
+            break;
+        }
+    }
+    free(resp.body);
+
+    check_request("GET", "/big/big.bin", NULL, 404, NULL, NULL, NOT_FOUND, strlen(NOT_FOUND));
+    CHECK(httpd_unregister_static_dir(server, "/big") == ESP_ERR_NOT_FOUND);
+}
+
+void app_main(void)
+{
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_log_level_set("httpd_uri", ESP_LOG_ERROR);
+    esp_log_level_set("httpd_txrx", ESP_LOG_ERROR);
+    esp_log_level_set("httpd_static", ESP_LOG_ERROR);
+
+    printf("HTTP server static files test\n");
+    bool created = (create_files() == 0);
+    if (!created) {
+        printf("Failed to create the files in %s (%d)\n", s_dir, errno);
+        s_errors++;
+    }
+
+    const int worker_counts[] = { 0, 2 };
+    for (int i = 0; i < sizeof(worker_counts) / sizeof(worker_counts[0]) && created; i++) {
+        printf("Server with %d worker tasks\n", worker_counts[i]);
+        httpd_handle_t server = start_server(worker_counts[i]);
+        if (!server) {
+            printf("Failed to start the server\n");
+            s_errors++;
+            break;
+        }
+        test_file();
+        test_range();
+        test_encoding();
+        test_etag();
+        test_traversal();
+        test_index_and_head();
+        if (worker_counts[i]) {
+            test_unregister_in_flight(server);
+        }
+        httpd_stop(server);
+    }
+
+    remove_files();
+    printf("Static files test done, %d errors\n", s_errors);
+}
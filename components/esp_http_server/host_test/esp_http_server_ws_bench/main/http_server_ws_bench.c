@@ -0,0 +1,508 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_http_server.h"
+#include "esp_httpd_priv.h"
+
+/* Three parts of the WebSocket receive and send paths are measured, in MB/s:
+ *
+ * - the unmasking of a payload by the server, against the byte loop it replaces,
+ * - the receive of TELEMETRY_SIZE binary frames from a client, either into a
+ *   buffer allocated for the whole payload, or in RECV_CHUNK_SIZE parts with
+ *   httpd_ws_recv_frame_chunk(),
+ * - the send of a TELEMETRY_SIZE frame to BROADCAST_CLIENTS clients, with
+ *   httpd_ws_send_frame_async() for each client or with httpd_ws_broadcast().
+ *
+ * The received payloads are checked against the data sent.
+ */
+
+#define SERVER_PORT             8030
+#define TELEMETRY_SIZE          (100 * 1024)
+#define RECV_CHUNK_SIZE         16384
+#define RECV_FRAMES             500
+#define BROADCAST_CLIENTS       8
+#define BROADCAST_ROUNDS        100
+#define UNMASK_DURATION_MS      300
+#define CLIENT_HEADER_SIZE      14      /* 2 bytes, 8 bytes length and mask key */
+#define SERVER_HEADER_SIZE      10      /* 2 bytes and 8 bytes length, not masked */
+
+static const uint8_t s_mask_key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+typedef enum {
+    RECV_FULL,
+    RECV_CHUNKED,
+} recv_mode_t;
+
+static recv_mode_t s_recv_mode;
+static uint8_t s_chunk[RECV_CHUNK_SIZE];
+static size_t s_received;
+static int s_mismatches;
+
+typedef struct {
+    httpd_handle_t server;
+    bool broadcast;
+    httpd_ws_frame_t frame;
+    sem_t done;
+    esp_err_t err;
+} send_work_t;
+
+static uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double mb_per_s(uint64_t bytes, uint64_t ns)
+{
+    return (double) bytes * 1000 / ns;
+}
+
+static uint8_t payload_byte(size_t idx)
+{
+    return (uint8_t) (idx * 7 + (idx >> 8));
+}
+
+/* The unmasking as it was done before, one byte at a time */
+static void unmask_bytes(uint8_t *payload, size_t len, const uint8_t *mask_key, size_t offset)
+{
+    for (size_t idx = 0; idx < len; idx++) {
+        payload[idx] ^= mask_key[(offset + idx) % 4];
+    }
+}
+
+/* Compares the unmasking of the server with the byte loop for all the
+ * alignments of the payload and positions in the frame */
+static int check_unmask(void)
+{
+    static uint8_t expected[1100];
+    static uint8_t unmasked[1100];
+    const size_t lengths[] = { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 33, 64, 100, 1000 };
+    int mismatches = 0;
+
+    for (size_t align = 0; align < 8; align++) {
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            for (size_t offset = 0; offset < 8; offset++) {
+                size_t len = lengths[l];
+                for (size_t i = 0; i < len; i++) {
+                    expected[align + i] = unmasked[align + i] = payload_byte(i);
+                }
+                unmask_bytes(expected + align, len, s_mask_key, offset);
+                httpd_ws_unmask_payload(unmasked + align, len, s_mask_key, offset);
+                if (memcmp(expected + align, unmasked + align, len) != 0) {
+                    printf("Unmask mismatch: alignment %zu, length %zu, offset %zu\n", align, len, offset);
+                    mismatches++;
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+static double bench_unmask(uint8_t *payload, size_t len, bool bytes)
+{
+    uint64_t total = 0;
+    uint64_t start = host_time_ns();
+    uint64_t deadline = start + (uint64_t) UNMASK_DURATION_MS * 1000000;
+    uint64_t now;
+    do {
+        for (int i = 0; i < 16; i++) {
+            if (bytes) {
+                unmask_bytes(payload, len, s_mask_key, 0);
+            } else {
+                httpd_ws_unmask_payload(payload, len, s_mask_key, 0);
+            }
+        }
+        total += 16 * len;
+        now = host_time_ns();
+    } while (now < deadline);
+    return mb_per_s(total, now - start);
+}
+
+static void run_unmask(void)
+{
+    const size_t sizes[] = { 64, 1024, TELEMETRY_SIZE };
+    uint8_t *buf = malloc(TELEMETRY_SIZE + 1);
+    if (!buf) {
+        abort();
+    }
+    memset(buf, 0x5a, TELEMETRY_SIZE + 1);
+
+    printf("%10s %10s %12s %12s %9s\n", "size", "alignment", "byte MB/s", "word MB/s", "speedup");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t align = 0; align < 2; align++) {
+            double byte_mbs = bench_unmask(buf + align, sizes[s], true);
+            double word_mbs = bench_unmask(buf + align, sizes[s], false);
+            printf("%10zu %10zu %12.1f %12.1f %8.1fx\n", sizes[s], align, byte_mbs, word_mbs, word_mbs / byte_mbs);
+        }
+    }
+    free(buf);
+}
+
+static void check_payload(const uint8_t *payload, size_t len, size_t offset)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (payload[i] != payload_byte(offset + i)) {
+            s_mismatches++;
+            return;
+        }
+    }
+}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        /* Handshake */
+        return ESP_OK;
+    }
+
+    httpd_ws_frame_t frame = { 0 };
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (frame.type == HTTPD_WS_TYPE_TEXT) {
+        /* Sync request of the client, answered once all the frames sent before are received */
+        uint8_t text[16];
+        frame.payload = text;
+        ret = httpd_ws_recv_frame(req, &frame, sizeof(text));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        frame.payload = (uint8_t *) "ok";
+        frame.len = 2;
+        return httpd_ws_send_frame(req, &frame);
+    }
+
+    if (s_recv_mode == RECV_FULL) {
+        size_t len = frame.len;
+        frame.payload = malloc(len);
+        if (!frame.payload) {
+            return ESP_ERR_NO_MEM;
+        }
+        ret = httpd_ws_recv_frame(req, &frame, len);
+        if (ret == ESP_OK) {
+            check_payload(frame.payload, frame.len, 0);
+            s_received += frame.len;
+        }
+        free(frame.payload);
+        return ret;
+    }
+
+    size_t received;
+    for (size_t offset = 0; offset < frame.len; offset += received) {
+        ret = httpd_ws_recv_frame_chunk(req, s_chunk, sizeof(s_chunk), &received);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        check_payload(s_chunk, received, offset);
+        s_received += received;
+    }
+    return ESP_OK;
+}
+
+static httpd_handle_t start_server(void)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.max_open_sockets = BROADCAST_CLIENTS + 2;
+
+    httpd_handle_t server = NULL;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        return NULL;
+    }
+    const httpd_uri_t ws = {
+        .uri = "/ws",
+        .method = HTTP_GET,
+        .handler = ws_handler,
+        .is_websocket = true,
+    };
+    httpd_register_uri_handler(server, &ws);
+    return server;
+}
+
+static int send_all(int fd, const uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t sent = send(fd, buf, len, 0);
+        if (sent <= 0) {
+            return -1;
+        }
+        buf += sent;
+        len -= sent;
+    }
+    return 0;
+}
+
+static int recv_all(int fd, uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t received = recv(fd, buf, len, 0);
+        if (received <= 0) {
+            return -1;
+        }
+        buf += received;
+        len -= received;
+    }
+    return 0;
+}
+
+/* Opens a connection to the server and upgrades it to WebSocket */
+static int connect_ws_client(void)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    const char handshake[] = "GET /ws HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Upgrade: websocket\r\n"
+                             "Connection: Upgrade\r\n"
+                             "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                             "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        send_all(fd, (const uint8_t *) handshake, strlen(handshake)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    /* The response has no body, read it up to the end of the headers */
+    char response[256];
+    size_t len = 0;
+    while (len < sizeof(response) - 1) {
+        if (recv(fd, response + len, 1, 0) != 1) {
+            break;
+        }
+        response[++len] = '\0';
+        if (len >= 4 && strcmp(response + len - 4, "\r\n\r\n") == 0) {
+            if (strncmp(response, "HTTP/1.1 101", 12) == 0) {
+                return fd;
+            }
+            break;
+        }
+    }
+    close(fd);
+    return -1;
+}
+
+/* Encodes a masked client frame, whose payload is masked in place */
+static size_t encode_client_frame(uint8_t *header, uint8_t opcode, uint8_t *payload, size_t len)
+{
+    size_t header_len;
+    header[0] = 0x80 | opcode;
+    if (len < 126) {
+        header[1] = 0x80 | len;
+        header_len = 2;
+    } else {
+        header[1] = 0x80 | 127;
+        for (int i = 0; i < 8; i++) {
+            header[2 + i] = (uint64_t) len >> (8 * (7 - i));
+        }
+        header_len = 10;
+    }
+    memcpy(header + header_len, s_mask_key, sizeof(s_mask_key));
+    unmask_bytes(payload, len, s_mask_key, 0);
+    return header_len + sizeof(s_mask_key);
+}
+
+/* Sends a text frame and waits for the answer of the server */
+static int sync_client(int fd)
+{
+    uint8_t frame[CLIENT_HEADER_SIZE + 4];
+    uint8_t text[4] = { 's', 'y', 'n', 'c' };
+    size_t header_len = encode_client_frame(frame, HTTPD_WS_TYPE_TEXT, text, sizeof(text));
+    memcpy(frame + header_len, text, sizeof(text));
+
+    uint8_t answer[4];
+    if (send_all(fd, frame, header_len + sizeof(text)) < 0 || recv_all(fd, answer, sizeof(answer)) < 0) {
+        return -1;
+    }
+    return (answer[0] == (0x80 | HTTPD_WS_TYPE_TEXT) && answer[1] == 2) ? 0 : -1;
+}
+
+static double run_recv(int fd, recv_mode_t mode, uint8_t *frame, size_t frame_len)
+{
+    s_recv_mode = mode;
+    s_received = 0;
+    uint64_t start = host_time_ns();
+    for (int i = 0; i < RECV_FRAMES; i++) {
+        if (send_all(fd, frame, frame_len) < 0) {
+            return 0;
+        }
+    }
+    if (sync_client(fd) < 0) {
+        return 0;
+    }
+    uint64_t ns = host_time_ns() - start;
+    if (s_received != (size_t) RECV_FRAMES * TELEMETRY_SIZE) {
+        printf("Received %zu bytes instead of %zu\n", s_received, (size_t) RECV_FRAMES * TELEMETRY_SIZE);
+        s_mismatches++;
+    }
+    return mb_per_s(s_received, ns);
+}
+
+/* Reads BROADCAST_ROUNDS frames sent by the server to a client */
+static void *broadcast_client_thread(void *arg)
+{
+    int fd = (intptr_t) arg;
+    uint8_t *frame = malloc(SERVER_HEADER_SIZE + TELEMETRY_SIZE);
+    intptr_t mismatches = 0;
+    for (int i = 0; i < BROADCAST_ROUNDS && frame; i++) {
+        if (recv_all(fd, frame, SERVER_HEADER_SIZE + TELEMETRY_SIZE) < 0) {
+            mismatches++;
+            break;
+        }
+        uint64_t len = 0;
+        for (int b = 0; b < 8; b++) {
+            len = (len << 8) | frame[2 + b];
+        }
+        if (frame[0] != (0x80 | HTTPD_WS_TYPE_BINARY) || frame[1] != 127 || len != TELEMETRY_SIZE ||
+            frame[SERVER_HEADER_SIZE + 1] != payload_byte(1) || frame[SERVER_HEADER_SIZE + TELEMETRY_SIZE - 1] != payload_byte(TELEMETRY_SIZE - 1)) {
+            mismatches++;
+        }
+    }
+    free(frame);
+    return (void *) mismatches;
+}
+
+/* Runs on the server task, as the send functions must */
+static void send_work(void *arg)
+{
+    send_work_t *work = arg;
+    work->err = ESP_OK;
+    for (int i = 0; i < BROADCAST_ROUNDS && work->err == ESP_OK; i++) {
+        if (work->broadcast) {
+            size_t sent_count = 0;
+            work->err = httpd_ws_broadcast(work->server, NULL, 0, &work->frame, &sent_count);
+            if (work->err == ESP_OK && sent_count != BROADCAST_CLIENTS) {
+                work->err = ESP_FAIL;
+            }
+            continue;
+        }
+        size_t fd_count = BROADCAST_CLIENTS + 2;
+        int fds[BROADCAST_CLIENTS + 2];
+        httpd_get_client_list(work->server, &fd_count, fds);
+        for (size_t c = 0; c < fd_count && work->err == ESP_OK; c++) {
+            if (httpd_ws_get_fd_info(work->server, fds[c]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+                work->err = httpd_ws_send_frame_async(work->server, fds[c], &work->frame);
+            }
+        }
+    }
+    sem_post(&work->done);
+}
+
+static double run_send(httpd_handle_t server, const int *fds, bool broadcast, uint8_t *payload)
+{
+    send_work_t work = {
+        .server = server,
+        .broadcast = broadcast,
+        .frame = {
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = payload,
+            .len = TELEMETRY_SIZE,
+        },
+    };
+    sem_init(&work.done, 0, 0);
+
+    pthread_t threads[BROADCAST_CLIENTS];
+    uint64_t start = host_time_ns();
+    for (int c = 0; c < BROADCAST_CLIENTS; c++) {
+        pthread_create(&threads[c], NULL, broadcast_client_thread, (void *) (intptr_t) fds[c]);
+    }
+    if (httpd_queue_work(server, send_work, &work) != ESP_OK) {
+        abort();
+    }
+    for (int c = 0; c < BROADCAST_CLIENTS; c++) {
+        void *mismatches;
+        pthread_join(threads[c], &mismatches);
+        s_mismatches += (intptr_t) mismatches;
+    }
+    uint64_t ns = host_time_ns() - start;
+    sem_wait(&work.done);
+    sem_destroy(&work.done);
+    if (work.err != ESP_OK) {
+        printf("Failed to send the frames: %d\n", work.err);
+        s_mismatches++;
+    }
+    return mb_per_s((uint64_t) BROADCAST_ROUNDS * BROADCAST_CLIENTS * TELEMETRY_SIZE, ns);
+}
+
+void app_main(void)
+{
+    /* A send to a connection closed by the peer must fail, not kill the process */
+    signal(SIGPIPE, SIG_IGN);
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    printf("HTTP server WebSocket benchmark, %d bytes frames\n", TELEMETRY_SIZE);
+    s_mismatches = check_unmask();
+    run_unmask();
+
+    httpd_handle_t server = start_server();
+    if (!server) {
+        printf("Failed to start the server\n");
+        return;
+    }
+    int fds[BROADCAST_CLIENTS];
+    for (int c = 0; c < BROADCAST_CLIENTS; c++) {
+        fds[c] = connect_ws_client();
+        if (fds[c] < 0) {
+            printf("Failed to connect client %d\n", c);
+            abort();
+        }
+    }
+
+    uint8_t *frame = malloc(CLIENT_HEADER_SIZE + TELEMETRY_SIZE);
+    if (!frame) {
+        abort();
+    }
+    uint8_t *payload = frame + CLIENT_HEADER_SIZE;
+    for (size_t i = 0; i < TELEMETRY_SIZE; i++) {
+        payload[i] = payload_byte(i);
+    }
+    size_t header_len = encode_client_frame(frame, HTTPD_WS_TYPE_BINARY, payload, TELEMETRY_SIZE);
+
+    printf("%10s %12s %12s\n", "receive", "full MB/s", "chunk MB/s");
+    double full_mbs = run_recv(fds[0], RECV_FULL, frame, header_len + TELEMETRY_SIZE);
+    double chunk_mbs = run_recv(fds[0], RECV_CHUNKED, frame, header_len + TELEMETRY_SIZE);
+    printf("%10d %12.1f %12.1f\n", RECV_FRAMES, full_mbs, chunk_mbs);
+
+    /* The server sends the payload unmasked */
+    unmask_bytes(payload, TELEMETRY_SIZE, s_mask_key, 0);
+    printf("%10s %12s %12s\n", "send to", "each MB/s", "broadcast MB/s");
+    double each_mbs = run_send(server, fds, false, payload);
+    double broadcast_mbs = run_send(server, fds, true, payload);
+    printf("%10d %12.1f %12.1f\n", BROADCAST_CLIENTS, each_mbs, broadcast_mbs);
+
+    for (int c = 0; c < BROADCAST_CLIENTS; c++) {
+        close(fds[c]);
+    }
+    free(frame);
+    httpd_stop(server);
+    printf("WebSocket benchmark done, %d mismatches\n", s_mismatches);
+}
@@ -75,7 +75,11 @@ initializer that should be kept in sync
         .keep_alive_count = 0,                          \
         .open_fn = NULL,                                \
         .close_fn = NULL,                               \
-        .uri_match_fn = NULL                            \
+        .uri_match_fn = NULL,                           \
+        .worker_count = 0,                              \
+        .worker_queue_size = 4,                         \
+        .worker_stack_size = 4096,                      \
+        .worker_task_priority = tskIDLE_PRIORITY+5,     \
 }
 
 #define ESP_ERR_HTTPD_BASE              (0xb000)                    /*!< Starting number of HTTPD error codes */
@@ -271,8 +275,43 @@ typedef struct httpd_config {
      *
      * Users can implement their own matching functions (See description
      * of the `httpd_uri_match_func_t` function prototype)
+     *
+     * With the two available options, the registered URIs are kept in a
+     * trie, and the handler of a request is found in a time depending on the
+     * length of its URI rather than on the number of registered handlers.
+     * A custom function is called for each registered URI in turn.
      */
     httpd_uri_match_func_t uri_match_fn;
+
+    /**
+     * Number of worker tasks running the URI handlers.
+     *
+     * If 0, the URI handlers run on the server task, and a slow handler delays
+     * all the other connections.
+     *
+     * Otherwise the server task only accepts the connections and parses the
+     * requests, then hands each request over to the first free worker task.
+     * The session isn't read by the server task until the handler returns. The
+     * WebSocket handshakes and frames are still handled on the server task.
+     *
+     * Inside handlers running on a worker, the request and its session context
+     * `req->sess_ctx` can be used as usual. Other sessions must only be
+     * accessed through functions which can be called from any task, such as
+     * httpd_queue_work() and httpd_ws_send_frame_async().
+     */
+    uint8_t  worker_count;
+
+    /**
+     * Maximum number of requests waiting for a free worker task.
+     *
+     * When the queue is full, the server task waits for a worker to complete a
+     * request before reading the next one, so the clients are slowed down by
+     * TCP flow control instead of being refused.
+     */
+    uint16_t worker_queue_size;
+
+    size_t   worker_stack_size;     /*!< Stack size of each worker task */
+    unsigned worker_task_priority;  /*!< Priority of the worker tasks, they run on any core */
 } httpd_config_t;
 
 /**
@@ -434,6 +473,16 @@ typedef struct httpd_uri {
      */
     void *user_ctx;
 
+    /**
+     * Maximum number of requests to this URI handled at once by the worker
+     * tasks, 0 for no limit (see httpd_config_t::worker_count).
+     *
+     * The requests above the limit are answered with "503 Service Unavailable"
+     * by the server task, e.g. to protect a resource which can only serve a
+     * few clients at once.
+     */
+    uint8_t max_concurrency;
+
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     /**
      * Flag for indicating a WebSocket endpoint.
@@ -1633,6 +1682,129 @@ esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *ar
  * @}
  */
 
+/* ************** Group: Worker Tasks ************** */
+/** @name Worker Tasks
+ * APIs related to the worker tasks running the URI handlers
+ * @{
+ */
+
+/**
+ * @brief Statistics of the worker tasks, see httpd_config_t::worker_count
+ */
+typedef struct httpd_worker_stats {
+    uint32_t queued;                /*!< Requests waiting for a free worker */
+    uint32_t queued_max;            /*!< Highest number of requests waiting for a free worker */
+    uint32_t active;                /*!< Requests being handled by the workers */
+    uint32_t completed;             /*!< Requests handled by the workers */
+    uint32_t rejected;              /*!< Requests answered with 503 because of the max_concurrency of their URI */
+    uint32_t queue_full;            /*!< Times the server task waited for room in the queue */
+    uint64_t wait_time_us;          /*!< Total time spent by the completed requests waiting for a worker */
+    uint64_t handler_time_us;       /*!< Total time spent by the completed requests in their handler */
+    uint32_t handler_time_max_us;   /*!< Longest time spent by a request in its handler */
+} httpd_worker_stats_t;
+
+/**
+ * @brief   Get the statistics of the worker tasks
+ *
+ * The average latency of the handlers is handler_time_us / completed.
+ *
+ * @param[in]  handle   Handle to server returned by httpd_start
+ * @param[out] stats    Statistics
+ *
+ * @return
+ *  - ESP_OK : Statistics retrieved
+ *  - ESP_ERR_INVALID_ARG   : Null arguments
+ *  - ESP_ERR_INVALID_STATE : The server has no worker tasks
+ */
+esp_err_t httpd_get_worker_stats(httpd_handle_t handle, httpd_worker_stats_t *stats);
+
+/** End of Group Worker Tasks
+ * @}
+ */
+
+/* ************** Group: Static Files ************** */
+/** @name Static Files
+ * APIs for serving the files of a directory
+ * @{
+ */
+
+/**
+ * @brief Configuration of a directory of static files, see httpd_register_static_dir()
+ */
+typedef struct httpd_static_dir_config {
+    const char *uri_prefix;     /*!< URI prefix of the files, e.g. "/www", or "/" for all the URIs */
+    const char *base_path;      /*!< Path of the directory in the VFS, e.g. "/spiffs/www" */
+    const char *index_file;     /*!< File served for the URIs ending with '/', NULL to answer them with 404 */
+    const char *cache_control;  /*!< Value of the Cache-Control header of the responses, NULL for none */
+    size_t buffer_size;         /*!< Size of the buffer the files are read into when they can't be sent with sendfile() */
+    bool precompressed;         /*!< Serve "<file>.br" or "<file>.gz" instead of "<file>", if present and accepted by the client */
+} httpd_static_dir_config_t;
+
+#define HTTPD_STATIC_DIR_DEFAULT_CONFIG() {             \
+        .uri_prefix         = "/",                      \
+        .base_path          = NULL,                     \
+        .index_file         = "index.html",             \
+        .cache_control      = NULL,                     \
+        .buffer_size        = 4096,                     \
+        .precompressed      = true,                     \
+}
+
+/**
+ * @brief   Serves the files of a VFS directory under a URI prefix
+ *
+ * A GET or HEAD request which doesn't match any URI handler, and whose path
+ * starts with uri_prefix, is answered with the file at the rest of the path
+ * under base_path. If the URIs of several directories match, the longest
+ * prefix is used. The responses carry:
+ *     - a Content-Type guessed from the extension of the file
+ *     - an ETag computed from the size and the modification time of the file,
+ *       and 304 Not Modified is answered to a matching If-None-Match
+ *     - the part of the file requested by a single byte Range, with
+ *       206 Partial Content
+ *     - Content-Encoding: br or gzip, if precompressed is set, the
+ *       Accept-Encoding of the request allows it, and the compressed file
+ *       is present next to the requested one
+ *
+ * The files are sent with sendfile() where the platform supports it and the
+ * session uses the default send function, i.e. not on TLS sessions. Otherwise
+ * they are read into a buffer of buffer_size bytes, allocated once for the
+ * directory. Another buffer is allocated while it is in use by another
+ * worker task.
+ *
+ * Paths containing a ".." segment are answered with 404, and the URI is not
+ * percent-decoded.
+ *
+ * @param[in] handle    Handle to server returned by httpd_start
+ * @param[in] config    Configuration of the directory, the strings are copied
+ *
+ * @return
+ *  - ESP_OK : Directory registered
+ *  - ESP_ERR_INVALID_ARG : Null arguments, or uri_prefix not starting with '/'
+ *  - ESP_ERR_HTTPD_HANDLER_EXISTS : A directory is already registered with this prefix
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : Failed to allocate memory
+ */
+esp_err_t httpd_register_static_dir(httpd_handle_t handle, const httpd_static_dir_config_t *config);
+
+/**
+ * @brief   Stops serving a directory registered by httpd_register_static_dir()
+ *
+ * The requests for files of the directory already being handled, e.g. by
+ * worker tasks, are completed, and its memory is freed after the last one.
+ *
+ * @param[in] handle        Handle to server returned by httpd_start
+ * @param[in] uri_prefix    URI prefix of the directory
+ *
+ * @return
+ *  - ESP_OK : Directory unregistered
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ *  - ESP_ERR_NOT_FOUND   : No directory registered with this prefix
+ */
+esp_err_t httpd_unregister_static_dir(httpd_handle_t handle, const char *uri_prefix);
+
+/** End of Group Static Files
+ * @}
+ */
+
 /* ************** Group: WebSocket ************** */
 /** @name WebSocket
  * Functions and structs for WebSocket server
@@ -1702,6 +1874,41 @@ typedef void (*transfer_complete_cb)(esp_err_t err, int socket, void *arg);
  */
 esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len);
 
+/**
+ * @brief Receive the next part of the payload of a WebSocket frame
+ *
+ * Large frames can be processed as they arrive, without a buffer for the
+ * whole payload: after httpd_ws_recv_frame() is called with max_len as 0 to
+ * get the frame length in pkt->len, each call receives the next bytes of the
+ * payload directly into buf, with a single recv(), and unmasks them.
+ *
+ * @code{c}
+ * httpd_ws_frame_t frame = { 0 };
+ * size_t received;
+ * httpd_ws_recv_frame(req, &frame, 0);
+ * for (size_t left = frame.len; left > 0; left -= received) {
+ *     if (httpd_ws_recv_frame_chunk(req, buf, sizeof(buf), &received) != ESP_OK) {
+ *         return ESP_FAIL;
+ *     }
+ *     process(buf, received);
+ * }
+ * @endcode
+ *
+ * @note    The whole payload must be received before the handler returns, and the chunks
+ *          of a frame must not be mixed with a second call of httpd_ws_recv_frame().
+ *
+ * @param[in]   req         Current request
+ * @param[out]  buf         Buffer for the next part of the payload
+ * @param[in]   buf_len     Size of the buffer
+ * @param[out]  recv_len    Number of bytes received, 0 when the whole payload was received
+ * @return
+ *  - ESP_OK                    : On successful
+ *  - ESP_FAIL                  : Socket errors occurs
+ *  - ESP_ERR_INVALID_STATE     : Handshake was not done
+ *  - ESP_ERR_INVALID_ARG       : Argument is invalid (null or non-WebSocket)
+ */
+esp_err_t httpd_ws_recv_frame_chunk(httpd_req_t *req, uint8_t *buf, size_t buf_len, size_t *recv_len);
+
 /**
  * @brief Construct and send a WebSocket frame
  * @param[in]   req     Current request
@@ -1731,6 +1938,30 @@ esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *pkt);
  */
 esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame);
 
+/**
+ * @brief Send a WebSocket frame to several clients
+ *
+ * The header of the frame is encoded once, then sent to each client followed
+ * by the payload, which is sent from frame->payload without being copied.
+ *
+ * @note    Like httpd_ws_send_frame_async(), this API must be called in the context of the
+ *          server task, i.e. from a WebSocket handler or a function queued with httpd_queue_work().
+ *          A client which doesn't receive the frame isn't closed by this API.
+ *
+ * @param[in]  hd          Server instance data
+ * @param[in]  fds         Socket descriptors of the clients, or NULL for all the WebSocket clients
+ * @param[in]  fd_count    Number of descriptors in fds
+ * @param[in]  frame       WebSocket frame
+ * @param[out] sent_count  Number of clients the frame was sent to (can be NULL)
+ * @return
+ *  - ESP_OK                    : The frame was sent to all the clients
+ *  - ESP_FAIL                  : A descriptor isn't a WebSocket client, or socket errors occurred
+ *                                for some clients (the others received the frame)
+ *  - ESP_ERR_INVALID_ARG       : Argument is invalid
+ */
+esp_err_t httpd_ws_broadcast(httpd_handle_t hd, const int *fds, size_t fd_count,
+                             httpd_ws_frame_t *frame, size_t *sent_count);
+
 /**
  * @brief Checks the supplied socket descriptor if it belongs to any active client
  * of this server instance and if the websoket protocol is active
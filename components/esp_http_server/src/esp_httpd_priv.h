@@ -17,6 +17,9 @@
 
 #include <esp_http_server.h>
 #include "osal.h"
+#if CONFIG_HTTPD_POLL_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -73,6 +76,10 @@ struct sock_db {
     char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
     size_t pending_len;                     /*!< Length of pending data to be received */
     bool for_async_req;                     /*!< If true, the socket will not be LRU purged */
+    bool poll_ready;                        /*!< Session is listed by the poller to be processed, see httpd_poll_enum_ready() */
+    bool in_worker;                         /*!< A request of the session was handed over to a worker task, the server task doesn't read the session meanwhile */
+    bool worker_failed;                     /*!< The handler run by the worker failed, the session is to be closed */
+    bool worker_close;                      /*!< Closing the session was requested while it was in a worker */
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     bool ws_handshake_done;                 /*!< True if it has done WebSocket handshake (if this socket is a valid WS) */
     bool ws_close;                          /*!< Set to true to close the socket later (when WS Close frame received) */
@@ -105,9 +112,75 @@ struct httpd_req_aux {
     httpd_ws_type_t ws_type;                        /*!< WebSocket frame type */
     bool ws_final;                                  /*!< WebSocket FIN bit (final frame or not) */
     uint8_t mask_key[4];                            /*!< WebSocket mask key for this payload */
+    size_t ws_payload_len;                          /*!< WebSocket payload length of the current frame */
+    size_t ws_payload_received;                     /*!< WebSocket payload bytes of the current frame already received */
+#endif
+};
+
+/**
+ * @brief   State of the poller, which waits for activity on the sockets of the server
+ */
+struct httpd_poll {
+#if CONFIG_HTTPD_POLL_EPOLL
+    int epoll_fd;                           /*!< epoll instance watching the listener, ctrl and session FDs */
+    struct epoll_event *events;             /*!< Events returned by epoll_wait() */
+    int max_events;                         /*!< Number of entries in events */
+    bool listen_watched;                    /*!< The listener FD is in the epoll set */
+    bool listen_ready;                      /*!< The listener FD was reported readable by the last wait */
+    bool ctrl_ready;                        /*!< The ctrl FD was reported readable by the last wait */
+    struct sock_db **ready;                 /*!< Sessions to process: readable ones, and ones with pending data */
+    int ready_count;                        /*!< Number of valid entries in ready */
+#else
+    fd_set read_set;                        /*!< Descriptors reported readable by the last select() */
 #endif
 };
 
+/**
+ * @brief   A request handed over to a worker task. The request data is copied,
+ *          so that the server task can go on with the other sessions.
+ */
+struct httpd_worker_job {
+    struct httpd_req req;                   /*!< The request, req.aux points to aux */
+    struct httpd_req_aux aux;               /*!< Additional data about the request */
+    const httpd_uri_t *uri;                 /*!< Matching URI handler, only compared for max_concurrency. NULL if the job slot is free */
+    esp_err_t (*handler)(httpd_req_t *r);   /*!< Handler function, copied in case the URI is unregistered meanwhile */
+    int64_t queued_us;                      /*!< Time when the request was handed over */
+};
+
+/**
+ * @brief   A worker task
+ */
+struct httpd_worker {
+    struct httpd_data *hd;                  /*!< Server instance data */
+    othread_t handle;                       /*!< Handle to thread/task */
+    struct httpd_worker_job *job;           /*!< Job being handled, NULL if idle */
+};
+
+/**
+ * @brief   Pool of worker tasks running the URI handlers, see httpd_config_t::worker_count
+ */
+struct httpd_workers {
+    struct httpd_worker *workers;           /*!< Worker tasks, NULL if the URI handlers run on the server task */
+    int started;                            /*!< Number of worker tasks started */
+    struct httpd_worker_job *jobs;          /*!< Job slots, one per worker plus worker_queue_size */
+    int job_count;                          /*!< Number of job slots */
+    struct resp_hdr *resp_hdrs;             /*!< Additional response headers of all the job slots */
+    struct httpd_worker_job **free;         /*!< Stack of the free job slots */
+    int free_count;                         /*!< Number of entries of free */
+    struct httpd_worker_job **queue;        /*!< FIFO of the jobs waiting for a worker, a NULL job stops a worker */
+    int queue_size;                         /*!< Number of entries of queue */
+    int queue_head;                         /*!< Index in queue of the next job, stats.queued jobs follow */
+    struct sock_db **done;                  /*!< Sessions whose request was completed by a worker */
+    int done_count;                         /*!< Number of entries of done */
+    bool wakeup_pending;                    /*!< The server task was asked to process the done list */
+    bool stopping;                          /*!< The worker tasks are being stopped */
+    omutex_t lock;                          /*!< Protects the lists and the statistics */
+    osem_t free_jobs;                       /*!< Counts the free job slots */
+    osem_t queued_jobs;                     /*!< Counts the entries of queue */
+    osem_t stopped;                         /*!< Given by each worker task when it exits */
+    httpd_worker_stats_t stats;             /*!< Statistics */
+};
+
 /**
  * @brief   Server data for each instance. This is exposed publicly as
  *          httpd_handle_t but internal structure/members are kept private.
@@ -123,9 +196,16 @@ struct httpd_data {
     struct thread_data hd_td;               /*!< Information for the HTTPD thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
     int hd_sd_active_count;                 /*!< The number of the active sockets */
+    int *hd_sd_index;                       /*!< Indexes in hd_sd of the active sessions, hashed by FD, -1 if empty */
+    int hd_sd_index_mask;                   /*!< Number of entries of hd_sd_index minus 1, the number is a power of 2 */
+    int *hd_sd_free;                        /*!< Stack of the indexes in hd_sd of the free sessions */
+    struct httpd_poll hd_poll;              /*!< Poller state */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
+    struct httpd_uri_node *hd_uri_trie;     /*!< Trie of the URIs of hd_calls, NULL if they are scanned linearly */
+    struct httpd_static_dir *hd_static_dirs; /*!< Directories of static files */
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
+    struct httpd_workers hd_workers;        /*!< Worker tasks running the URI handlers */
     uint64_t lru_counter;                   /*!< LRU counter */
 
     /* Array of registered error handler functions */
@@ -185,6 +265,15 @@ void httpd_sess_delete_invalid(struct httpd_data *hd);
  */
 void httpd_sess_init(struct httpd_data *hd);
 
+/**
+ * @brief   Size of the index of the sessions by FD for a maximum number of sessions
+ *
+ * @param[in] max_open_sockets Maximum number of sessions
+ *
+ * @return Number of entries of hd_sd_index
+ */
+int httpd_sess_index_size(int max_open_sockets);
+
 /**
  * @brief   Starts a new session for client requesting connection and adds
  *          it's descriptor to the socket database.
@@ -296,6 +385,91 @@ void httpd_sess_close_all(struct httpd_data *hd);
  * @}
  */
 
+/****************** Group : Polling ********************/
+/** @name Polling
+ * Methods for waiting for activity on the sockets of the server, with select()
+ * or with epoll depending on CONFIG_HTTPD_POLL_EPOLL
+ * @{
+ */
+
+/**
+ * @brief   Initializes the poller and starts watching the listener and ctrl FDs
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - ESP_OK    : on success
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : if the poller state couldn't be allocated
+ *  - ESP_FAIL  : if the poller couldn't be created
+ */
+esp_err_t httpd_poll_init(struct httpd_data *hd);
+
+/**
+ * @brief   Releases the resources of the poller
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_poll_deinit(struct httpd_data *hd);
+
+/**
+ * @brief   Starts watching the FD of a new session
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] session Session
+ *
+ * @return
+ *  - ESP_OK    : on success
+ *  - ESP_FAIL  : if the FD can't be watched
+ */
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Stops watching the FD of a session, before it is closed
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] session Session
+ */
+void httpd_poll_del(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Waits until the ctrl FD, the listener FD or a session FD is readable,
+ *          or doesn't wait if a session has pending data
+ *
+ * @param[in] hd          Server instance data
+ * @param[in] accept_conn Whether to watch the listener FD for new connections
+ *
+ * @return
+ *  - Number of ready FDs, may be 0
+ *  - -1 : on error
+ */
+int httpd_poll_wait(struct httpd_data *hd, bool accept_conn);
+
+/**
+ * @brief   Checks if the listener or ctrl FD was reported readable by the last wait
+ *
+ * @param[in] hd  Server instance data
+ * @param[in] fd  Listener or ctrl FD
+ *
+ * @return True if the FD is readable
+ */
+bool httpd_poll_is_ready(struct httpd_data *hd, int fd);
+
+/**
+ * @brief   Calls a function for each session which was reported readable by the
+ *          last wait or which has pending data (see httpd_sess_pending())
+ *
+ * The function may delete the session. Its return value is ignored.
+ *
+ * @param[in] hd            Server instance data
+ * @param[in] enum_function Function to call for each ready session
+ * @param[in] context       Context, which will be passed to the function
+ */
+void httpd_poll_enum_ready(struct httpd_data *hd, httpd_session_enum_function enum_function, void *context);
+
+/** End of Group : Polling
+ * @}
+ */
+
 /****************** Group : URI Handling ********************/
 /** @name URI Handling
  * Methods for accessing URI handlers
@@ -314,6 +488,29 @@ void httpd_sess_close_all(struct httpd_data *hd);
  */
 esp_err_t httpd_uri(struct httpd_data *hd);
 
+/**
+ * @brief   Finds the URI handler registered first for a URI and a method
+ *
+ * The URIs are looked up in a trie if they are matched by the default
+ * function or httpd_uri_match_wildcard(), and compared to each registered
+ * URI in order of registration otherwise.
+ *
+ * @param[in]  hd       Server instance data
+ * @param[in]  uri      URI to match, not null terminated
+ * @param[in]  uri_len  Length of the URI
+ * @param[in]  method   Method of the request
+ * @param[out] err      HTTPD_404_NOT_FOUND or HTTPD_405_METHOD_NOT_ALLOWED if no
+ *                      handler was found, 0 otherwise. Can be NULL.
+ *
+ * @return
+ *  - Registered URI handler
+ *  - NULL : if not found
+ */
+httpd_uri_t *httpd_find_uri_handler(struct httpd_data *hd,
+                                    const char *uri, size_t uri_len,
+                                    httpd_method_t method,
+                                    httpd_err_code_t *err);
+
 /**
  * @brief   Unregister all URI handlers
  *
@@ -342,10 +539,100 @@ bool httpd_validate_req_ptr(httpd_req_t *r);
 #define httpd_valid_req(r)  true
 #endif
 
+/**
+ * @brief   Finds the directory of static files serving a URI, see
+ *          httpd_register_static_dir()
+ *
+ * The directory is kept until its handler is called with the request, which
+ * must then happen, even if it is unregistered meanwhile.
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] uri      Path of the URI, not null terminated
+ * @param[in] uri_len  Length of the path
+ *
+ * @return
+ *  - URI handler of the directory with the longest prefix matching the path
+ *  - NULL : if no directory matches
+ */
+httpd_uri_t *httpd_static_dir_find(struct httpd_data *hd, const char *uri, size_t uri_len);
+
+/**
+ * @brief   Unregister all directories of static files
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_unregister_all_static_dirs(struct httpd_data *hd);
+
 /** End of Group : URI Handling
  * @}
  */
 
+/****************** Group : Workers ********************/
+/** @name Workers
+ * Methods for running the URI handlers on a pool of worker tasks
+ * @{
+ */
+
+/**
+ * @brief   Starts the worker tasks, if httpd_config_t::worker_count isn't 0
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - ESP_OK    : on success
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : if the pool couldn't be allocated
+ *  - ESP_ERR_HTTPD_TASK : if a worker task couldn't be started
+ */
+esp_err_t httpd_worker_init(struct httpd_data *hd);
+
+/**
+ * @brief   Stops the worker tasks, after they complete the queued requests,
+ *          and releases the pool
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_worker_deinit(struct httpd_data *hd);
+
+/**
+ * @brief   Hands the request being processed by the server task over to a worker
+ *          task, which runs the handler and completes the request
+ *
+ * The server task waits for a free job slot if all of them are taken. The
+ * session isn't watched by the poller until httpd_worker_complete() returns
+ * it. If the URI has reached its max_concurrency, the request is answered
+ * with 503 instead.
+ *
+ * @param[in] hd  Server instance data
+ * @param[in] uri URI handler matching the request
+ *
+ * @return
+ *  - ESP_OK    : if the request was handed over, or rejected
+ *  - ESP_FAIL  : if the rejection couldn't be sent
+ */
+esp_err_t httpd_worker_dispatch(struct httpd_data *hd, const httpd_uri_t *uri);
+
+/**
+ * @brief   Returns to the poller the sessions whose request was completed by
+ *          a worker task, or closes them if the handler failed. Must be called
+ *          from the server task.
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_worker_complete(struct httpd_data *hd);
+
+/**
+ * @brief   Request being handled by the calling task, if it is a worker task
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return The request, or NULL if not called from a worker task
+ */
+httpd_req_t *httpd_worker_current_req(struct httpd_data *hd);
+
+/** End of Group : Workers
+ * @}
+ */
+
 /****************** Group : Processing ********************/
 /** @name Processing
  * Methods for processing HTTP requests
@@ -381,6 +668,22 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd);
  */
 esp_err_t httpd_req_delete(struct httpd_data *hd);
 
+/**
+ * @brief   Completes a request after its handler returned: purges any data
+ *          left to be received and stores the session context back into the
+ *          session. httpd_req_delete() does this for the request of the
+ *          server task.
+ *
+ * @param[in] r       The request
+ * @param[in] failed  The handler failed, in which case the session is going to
+ *                    be closed and nothing is purged
+ *
+ * @return
+ *  - ESP_OK    : if the request was completed
+ *  - ESP_FAIL  : if the handler failed or the data couldn't be purged
+ */
+esp_err_t httpd_req_finish(httpd_req_t *r, bool failed);
+
 /**
  * @brief   For handling HTTP errors by invoking registered
  *          error handler function
@@ -417,6 +720,33 @@ esp_err_t httpd_req_handle_err(httpd_req_t *req, httpd_err_code_t error);
  */
 int httpd_send(httpd_req_t *req, const char *buf, size_t buf_len);
 
+/**
+ * @brief   Sends all the data of a buffer in response to an HTTP request
+ *
+ * @param[in] req     Pointer to the HTTP request for which the response needs to be sent
+ * @param[in] buf     Pointer to the data
+ * @param[in] buf_len Length of the data
+ *
+ * @return
+ *  - ESP_OK   : if all the data was sent
+ *  - ESP_FAIL : if failed
+ */
+esp_err_t httpd_send_all(httpd_req_t *req, const char *buf, size_t buf_len);
+
+/**
+ * @brief   Sends the status line and the headers of a response, for a body
+ *          of content_len bytes to be sent by the caller with httpd_send_all()
+ *
+ * @param[in] req         Pointer to the HTTP request for which the response needs to be sent
+ * @param[in] content_len Value of the Content-Length header
+ *
+ * @return
+ *  - ESP_OK : if the headers were sent
+ *  - ESP_ERR_HTTPD_RESP_HDR  : Essential headers are too large for internal buffer
+ *  - ESP_ERR_HTTPD_RESP_SEND : Error in raw send
+ */
+esp_err_t httpd_resp_send_hdrs(httpd_req_t *req, size_t content_len);
+
 /**
  * @brief   For receiving HTTP request data
  *
@@ -532,6 +862,19 @@ esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *suppor
  */
 esp_err_t httpd_ws_get_frame_type(httpd_req_t *req);
 
+/**
+ * @brief   Unmasks a part of a WebSocket payload in place
+ *
+ * The bytes are XORed a machine word at a time, with the mask key rotated
+ * to the position of the part in the payload.
+ *
+ * @param[in,out] payload   Part of the payload to unmask
+ * @param[in]     len       Length of the part
+ * @param[in]     mask_key  Mask key of the frame
+ * @param[in]     offset    Position of the part in the payload of the frame
+ */
+void httpd_ws_unmask_payload(uint8_t *payload, size_t len, const uint8_t *mask_key, size_t offset);
+
 /**
  * @brief   Trigger an httpd session close externally
  *
@@ -22,6 +22,12 @@
 
 #if defined(CONFIG_LWIP_MAX_SOCKETS)
 #define HTTPD_MAX_SOCKETS CONFIG_LWIP_MAX_SOCKETS
+#elif CONFIG_HTTPD_POLL_EPOLL
+/* The descriptors aren't limited by the poller, only by the process */
+#define HTTPD_MAX_SOCKETS (UINT16_MAX + 3)
+#elif CONFIG_IDF_TARGET_LINUX
+/* The descriptors passed to select() must be lower than FD_SETSIZE */
+#define HTTPD_MAX_SOCKETS FD_SETSIZE
 #else
 /* LwIP component is not included into the build, use a default value */
 #define HTTPD_MAX_SOCKETS 15
@@ -31,11 +37,6 @@ static const int DEFAULT_KEEP_ALIVE_IDLE = 5;
 static const int DEFAULT_KEEP_ALIVE_INTERVAL= 5;
 static const int DEFAULT_KEEP_ALIVE_COUNT= 3;
 
-typedef struct {
-    fd_set *fdset;
-    struct httpd_data *hd;
-} process_session_context_t;
-
 static const char *TAG = "httpd";
 
 ESP_EVENT_DEFINE_BASE(ESP_HTTP_SERVER_EVENT);
@@ -247,14 +248,10 @@ static int httpd_process_session(struct sock_db *session, void *context)
         return 1;
     }
 
-    process_session_context_t *ctx = (process_session_context_t *)context;
-    int fd = session->fd;
-
-    if (FD_ISSET(fd, ctx->fdset) || httpd_sess_pending(ctx->hd, session)) {
-        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), fd);
-        if (httpd_sess_process(ctx->hd, session) != ESP_OK) {
-            httpd_sess_delete(ctx->hd, session); // Delete session
-        }
+    struct httpd_data *hd = (struct httpd_data *) context;
+    ESP_LOGD(TAG, LOG_FMT("processing socket %d"), session->fd);
+    if (httpd_sess_process(hd, session) != ESP_OK) {
+        httpd_sess_delete(hd, session); // Delete session
     }
     return 1;
 }
@@ -262,32 +259,19 @@ static int httpd_process_session(struct sock_db *session, void *context)
 /* Manage in-coming connection or data requests */
 static esp_err_t httpd_server(struct httpd_data *hd)
 {
-    fd_set read_set;
-    FD_ZERO(&read_set);
-    if (hd->config.lru_purge_enable || httpd_is_sess_available(hd)) {
-        /* Only listen for new connections if server has capacity to
-         * handle more (or when LRU purge is enabled, in which case
-         * older connections will be closed) */
-        FD_SET(hd->listen_fd, &read_set);
-    }
-    FD_SET(hd->ctrl_fd, &read_set);
-
-    int tmp_max_fd;
-    httpd_sess_set_descriptors(hd, &read_set, &tmp_max_fd);
-    int maxfd = MAX(hd->listen_fd, tmp_max_fd);
-    tmp_max_fd = maxfd;
-    maxfd = MAX(hd->ctrl_fd, tmp_max_fd);
-
-    ESP_LOGD(TAG, LOG_FMT("doing select maxfd+1 = %d"), maxfd + 1);
-    int active_cnt = select(maxfd + 1, &read_set, NULL, NULL, NULL);
+    /* Only listen for new connections if server has capacity to
+     * handle more (or when LRU purge is enabled, in which case
+     * older connections will be closed) */
+    bool accept_conn = hd->config.lru_purge_enable || httpd_is_sess_available(hd);
+
+    int active_cnt = httpd_poll_wait(hd, accept_conn);
     if (active_cnt < 0) {
-        ESP_LOGE(TAG, LOG_FMT("error in select (%d)"), errno);
         httpd_sess_delete_invalid(hd);
         return ESP_OK;
     }
 
     /* Case0: Do we have a control message? */
-    if (FD_ISSET(hd->ctrl_fd, &read_set)) {
+    if (httpd_poll_is_ready(hd, hd->ctrl_fd)) {
         ESP_LOGD(TAG, LOG_FMT("processing ctrl message"));
         httpd_process_ctrl_msg(hd);
         if (hd->hd_td.status == THREAD_STOPPING) {
@@ -296,17 +280,17 @@ static esp_err_t httpd_server(struct httpd_data *hd)
         }
     }
 
+    /* Return to the poller the sessions whose request was completed
+     * by a worker, in case the wake-up message was lost */
+    httpd_worker_complete(hd);
+
     /* Case1: Do we have any activity on the current data
      * sessions? */
-    process_session_context_t context = {
-        .fdset = &read_set,
-        .hd = hd
-    };
-    httpd_sess_enum(hd, httpd_process_session, &context);
+    httpd_poll_enum_ready(hd, httpd_process_session, hd);
 
     /* Case2: Do we have any incoming connection requests to
      * process? */
-    if (FD_ISSET(hd->listen_fd, &read_set)) {
+    if (httpd_poll_is_ready(hd, hd->listen_fd)) {
         ESP_LOGD(TAG, LOG_FMT("processing listen socket %d"), hd->listen_fd);
         if (httpd_accept_conn(hd, hd->listen_fd) != ESP_OK) {
             ESP_LOGW(TAG, LOG_FMT("error accepting new connection"));
@@ -331,9 +315,11 @@ static void httpd_thread(void *arg)
     }
 
     ESP_LOGD(TAG, LOG_FMT("web server exiting"));
+    httpd_worker_deinit(hd);
     close(hd->msg_fd);
     cs_free_ctrl_sock(hd->ctrl_fd);
     httpd_sess_close_all(hd);
+    httpd_poll_deinit(hd);
     close(hd->listen_fd);
     hd->hd_td.status = THREAD_STOPPED;
     httpd_os_thread_delete();
@@ -407,6 +393,13 @@ static esp_err_t httpd_server_init(struct httpd_data *hd)
     hd->listen_fd = fd;
     hd->ctrl_fd = ctrl_fd;
     hd->msg_fd  = msg_fd;
+
+    if (httpd_poll_init(hd) != ESP_OK) {
+        close(fd);
+        close(ctrl_fd);
+        close(msg_fd);
+        return ESP_FAIL;
+    }
     return ESP_OK;
 }
 
@@ -431,10 +424,25 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
         free(hd);
         return NULL;
     }
+    int index_size = httpd_sess_index_size(config->max_open_sockets);
+    hd->hd_sd_index = calloc(index_size, sizeof(int));
+    hd->hd_sd_free = calloc(config->max_open_sockets, sizeof(int));
+    if (!hd->hd_sd_index || !hd->hd_sd_free) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP session index"));
+        free(hd->hd_sd_free);
+        free(hd->hd_sd_index);
+        free(hd->hd_sd);
+        free(hd->hd_calls);
+        free(hd);
+        return NULL;
+    }
+    hd->hd_sd_index_mask = index_size - 1;
     struct httpd_req_aux *ra = &hd->hd_req_aux;
     ra->resp_hdrs = calloc(config->max_resp_headers, sizeof(struct resp_hdr));
     if (!ra->resp_hdrs) {
         ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP response headers"));
+        free(hd->hd_sd_free);
+        free(hd->hd_sd_index);
         free(hd->hd_sd);
         free(hd->hd_calls);
         free(hd);
@@ -444,6 +452,8 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
     if (!hd->err_handler_fns) {
         ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP error handlers"));
         free(ra->resp_hdrs);
+        free(hd->hd_sd_free);
+        free(hd->hd_sd_index);
         free(hd->hd_sd);
         free(hd->hd_calls);
         free(hd);
@@ -460,10 +470,13 @@ static void httpd_delete(struct httpd_data *hd)
     /* Free memory of httpd instance data */
     free(hd->err_handler_fns);
     free(ra->resp_hdrs);
+    free(hd->hd_sd_free);
+    free(hd->hd_sd_index);
     free(hd->hd_sd);
 
     /* Free registered URI handlers */
     httpd_unregister_all_uri_handlers(hd);
+    httpd_unregister_all_static_dirs(hd);
     free(hd->hd_calls);
     free(hd);
 }
@@ -515,12 +528,20 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
     }
 
     httpd_sess_init(hd);
+    esp_err_t err = httpd_worker_init(hd);
+    if (err != ESP_OK) {
+        httpd_poll_deinit(hd);
+        httpd_delete(hd);
+        return err;
+    }
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd,
                                hd->config.core_id) != ESP_OK) {
         /* Failed to launch task */
+        httpd_worker_deinit(hd);
+        httpd_poll_deinit(hd);
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
@@ -803,9 +803,18 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
  */
 esp_err_t httpd_req_delete(struct httpd_data *hd)
 {
-    httpd_req_t *r = &hd->hd_req;
+    return httpd_req_finish(&hd->hd_req, false);
+}
+
+esp_err_t httpd_req_finish(httpd_req_t *r, bool failed)
+{
     struct httpd_req_aux *ra = r->aux;
 
+    if (failed) {
+        httpd_req_cleanup(r);
+        return ESP_FAIL;
+    }
+
     /* Finish off reading any pending/leftover data */
     while (ra->remaining_len) {
         /* Any length small enough not to overload the stack, but large
@@ -847,6 +856,10 @@ bool httpd_validate_req_ptr(httpd_req_t *r)
             if (httpd_os_thread_handle() == hd->hd_td.handle) {
                 return true;
             }
+            /* or of the worker task handling this request */
+            if (httpd_worker_current_req(hd) == r) {
+                return true;
+            }
         }
     }
     return false;
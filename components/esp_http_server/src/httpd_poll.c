@@ -0,0 +1,272 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/param.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_poll";
+
+#if CONFIG_HTTPD_POLL_EPOLL
+
+/* The FDs are registered level-triggered, so a session which isn't fully
+ * read by one request is reported again by the next epoll_wait(). The
+ * sessions with data buffered above the socket (pending_len, or the TLS
+ * layer behind pending_fn) are kept in the ready list by
+ * httpd_poll_enum_ready(), and epoll_wait() doesn't block while the list
+ * isn't empty.
+ */
+
+static esp_err_t poll_ctl(struct httpd_data *hd, int op, int fd)
+{
+    struct epoll_event event = {
+        .events = EPOLLIN,
+        .data.fd = fd,
+    };
+    if (epoll_ctl(hd->hd_poll.epoll_fd, op, fd, &event) < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in epoll_ctl %d for fd %d (%d)"), op, fd, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/* Appends a session to the ready list, once */
+static void poll_set_ready(struct httpd_poll *poll, struct sock_db *session)
+{
+    if (!session->poll_ready) {
+        session->poll_ready = true;
+        poll->ready[poll->ready_count++] = session;
+    }
+}
+
+esp_err_t httpd_poll_init(struct httpd_data *hd)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    memset(poll, 0, sizeof(*poll));
+    poll->epoll_fd = -1;
+
+    /* Listener, ctrl and all the sessions may be ready at once */
+    poll->max_events = hd->config.max_open_sockets + 2;
+    poll->events = calloc(poll->max_events, sizeof(struct epoll_event));
+    poll->ready = calloc(hd->config.max_open_sockets, sizeof(struct sock_db *));
+    if (!poll->events || !poll->ready) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for poller"));
+        free(poll->events);
+        free(poll->ready);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
+    poll->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (poll->epoll_fd < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in epoll_create1 (%d)"), errno);
+        free(poll->events);
+        free(poll->ready);
+        return ESP_FAIL;
+    }
+    if (poll_ctl(hd, EPOLL_CTL_ADD, hd->ctrl_fd) != ESP_OK) {
+        httpd_poll_deinit(hd);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void httpd_poll_deinit(struct httpd_data *hd)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    if (poll->epoll_fd >= 0) {
+        close(poll->epoll_fd);
+    }
+    free(poll->events);
+    free(poll->ready);
+    memset(poll, 0, sizeof(*poll));
+    poll->epoll_fd = -1;
+}
+
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session)
+{
+    session->poll_ready = false;
+    if (poll_ctl(hd, EPOLL_CTL_ADD, session->fd) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    /* A session back from a worker may have data buffered above the socket */
+    if (httpd_sess_pending(hd, session)) {
+        poll_set_ready(&hd->hd_poll, session);
+    }
+    return ESP_OK;
+}
+
+void httpd_poll_del(struct httpd_data *hd, struct sock_db *session)
+{
+    /* A stale entry of the ready list is skipped by httpd_poll_enum_ready() */
+    session->poll_ready = false;
+    epoll_ctl(hd->hd_poll.epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+}
+
+int httpd_poll_wait(struct httpd_data *hd, bool accept_conn)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    poll->listen_ready = false;
+    poll->ctrl_ready = false;
+
+    if (accept_conn != poll->listen_watched) {
+        if (poll_ctl(hd, accept_conn ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, hd->listen_fd) != ESP_OK) {
+            return -1;
+        }
+        poll->listen_watched = accept_conn;
+    }
+
+    int timeout = poll->ready_count ? 0 : -1;
+    ESP_LOGD(TAG, LOG_FMT("doing epoll_wait, timeout = %d"), timeout);
+    int active_cnt = epoll_wait(poll->epoll_fd, poll->events, poll->max_events, timeout);
+    if (active_cnt < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        ESP_LOGE(TAG, LOG_FMT("error in epoll_wait (%d)"), errno);
+        return -1;
+    }
+
+    for (int i = 0; i < active_cnt; i++) {
+        int fd = poll->events[i].data.fd;
+        if (fd == hd->listen_fd) {
+            poll->listen_ready = true;
+        } else if (fd == hd->ctrl_fd) {
+            poll->ctrl_ready = true;
+        } else {
+            struct sock_db *session = httpd_sess_get(hd, fd);
+            if (session) {
+                poll_set_ready(poll, session);
+            }
+        }
+    }
+    return active_cnt;
+}
+
+bool httpd_poll_is_ready(struct httpd_data *hd, int fd)
+{
+    if (fd == hd->listen_fd) {
+        return hd->hd_poll.listen_ready;
+    }
+    if (fd == hd->ctrl_fd) {
+        return hd->hd_poll.ctrl_ready;
+    }
+    return false;
+}
+
+void httpd_poll_enum_ready(struct httpd_data *hd, httpd_session_enum_function enum_function, void *context)
+{
+    struct httpd_poll *poll = &hd->hd_poll;
+    int count = poll->ready_count;
+    poll->ready_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        struct sock_db *session = poll->ready[i];
+        /* Skip sessions deleted since they were listed */
+        if (!session->poll_ready) {
+            continue;
+        }
+        session->poll_ready = false;
+        enum_function(session, context);
+
+        /* Keep the session listed while it has data buffered above the socket,
+         * unless it was deleted or handed over to a worker. The list is
+         * compacted in place, ready_count never passes i.
+         */
+        if ((session->fd != -1) && !session->in_worker && httpd_sess_pending(hd, session)) {
+            poll_set_ready(poll, session);
+        }
+    }
+}
+
+#else /* CONFIG_HTTPD_POLL_EPOLL */
+
+typedef struct {
+    fd_set *fdset;
+    struct httpd_data *hd;
+    httpd_session_enum_function enum_function;
+    void *context;
+} enum_ready_context_t;
+
+esp_err_t httpd_poll_init(struct httpd_data *hd)
+{
+    FD_ZERO(&hd->hd_poll.read_set);
+    return ESP_OK;
+}
+
+void httpd_poll_deinit(struct httpd_data *hd)
+{
+}
+
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session)
+{
+    /* The descriptor set is rebuilt before each select() */
+    return ESP_OK;
+}
+
+void httpd_poll_del(struct httpd_data *hd, struct sock_db *session)
+{
+}
+
+int httpd_poll_wait(struct httpd_data *hd, bool accept_conn)
+{
+    fd_set *read_set = &hd->hd_poll.read_set;
+    FD_ZERO(read_set);
+    if (accept_conn) {
+        FD_SET(hd->listen_fd, read_set);
+    }
+    FD_SET(hd->ctrl_fd, read_set);
+
+    int tmp_max_fd;
+    httpd_sess_set_descriptors(hd, read_set, &tmp_max_fd);
+    int maxfd = MAX(hd->listen_fd, tmp_max_fd);
+    tmp_max_fd = maxfd;
+    maxfd = MAX(hd->ctrl_fd, tmp_max_fd);
+
+    ESP_LOGD(TAG, LOG_FMT("doing select maxfd+1 = %d"), maxfd + 1);
+    int active_cnt = select(maxfd + 1, read_set, NULL, NULL, NULL);
+    if (active_cnt < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in select (%d)"), errno);
+        FD_ZERO(read_set);
+    }
+    return active_cnt;
+}
+
+bool httpd_poll_is_ready(struct httpd_data *hd, int fd)
+{
+    return FD_ISSET(fd, &hd->hd_poll.read_set);
+}
+
+static int enum_ready_function(struct sock_db *session, void *context)
+{
+    enum_ready_context_t *ctx = (enum_ready_context_t *) context;
+    if (session->fd < 0 || session->in_worker) {
+        return 1;
+    }
+    if (FD_ISSET(session->fd, ctx->fdset) || httpd_sess_pending(ctx->hd, session)) {
+        ctx->enum_function(session, ctx->context);
+    }
+    return 1;
+}
+
+void httpd_poll_enum_ready(struct httpd_data *hd, httpd_session_enum_function enum_function, void *context)
+{
+    enum_ready_context_t ctx = {
+        .fdset = &hd->hd_poll.read_set,
+        .hd = hd,
+        .enum_function = enum_function,
+        .context = context
+    };
+    httpd_sess_enum(hd, enum_ready_function, &ctx);
+}
+
+#endif /* CONFIG_HTTPD_POLL_EPOLL */
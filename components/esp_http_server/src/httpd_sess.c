@@ -19,8 +19,6 @@ typedef enum {
     HTTPD_TASK_NONE = 0,
     HTTPD_TASK_INIT,            // Init session
     HTTPD_TASK_GET_ACTIVE,      // Get active session (fd!=-1)
-    HTTPD_TASK_GET_FREE,        // Get free session slot (fd<0)
-    HTTPD_TASK_FIND_FD,         // Find session with specific fd
     HTTPD_TASK_SET_DESCRIPTOR,  // Set descriptor
     HTTPD_TASK_DELETE_INVALID,  // Delete invalid session
     HTTPD_TASK_FIND_LOWEST_LRU, // Find session with lowest lru
@@ -77,17 +75,9 @@ static int enum_function(struct sock_db *session, void *context)
     case HTTPD_TASK_GET_ACTIVE:
         found = (session->fd != -1);
         break;
-    // Get free slot
-    case HTTPD_TASK_GET_FREE:
-        found = (session->fd < 0);
-        break;
-    // Find fd
-    case HTTPD_TASK_FIND_FD:
-        found = (session->fd == ctx->fd);
-        break;
     // Set descriptor
     case HTTPD_TASK_SET_DESCRIPTOR:
-        if (session->fd != -1) {
+        if (session->fd != -1 && !session->in_worker) {
             FD_SET(session->fd, ctx->fdset);
             if (session->fd > ctx->max_fd) {
                 ctx->max_fd = session->fd;
@@ -96,7 +86,7 @@ static int enum_function(struct sock_db *session, void *context)
         break;
     // Delete invalid session
     case HTTPD_TASK_DELETE_INVALID:
-        if (!fd_is_valid(session->fd)) {
+        if (!session->in_worker && !fd_is_valid(session->fd)) {
             ESP_LOGW(TAG, LOG_FMT("Closing invalid socket %d"), session->fd);
             httpd_sess_delete(ctx->hd, session);
         }
@@ -108,7 +98,7 @@ static int enum_function(struct sock_db *session, void *context)
             return 0;
         }
         // Only close sockets that are not in use
-        if (session->for_async_req == false) {
+        if (session->for_async_req == false && session->in_worker == false) {
             // Check/update lowest lru
             if (session->lru_counter < ctx->lru_counter) {
                 ctx->lru_counter = session->lru_counter;
@@ -132,6 +122,72 @@ static int enum_function(struct sock_db *session, void *context)
     return 1;
 }
 
+/* The sessions are indexed by FD in hd_sd_index, a hash table with open
+ * addressing and linear probing, kept at most half full. The free slots
+ * of hd_sd are kept in the hd_sd_free stack.
+ */
+int httpd_sess_index_size(int max_open_sockets)
+{
+    int size = 1;
+    while (size < 2 * max_open_sockets) {
+        size <<= 1;
+    }
+    return size;
+}
+
+static inline int sess_index_home(struct httpd_data *hd, int fd)
+{
+    return fd & hd->hd_sd_index_mask;
+}
+
+static void sess_index_add(struct httpd_data *hd, struct sock_db *session)
+{
+    int i = sess_index_home(hd, session->fd);
+    while (hd->hd_sd_index[i] != -1) {
+        i = (i + 1) & hd->hd_sd_index_mask;
+    }
+    hd->hd_sd_index[i] = session - hd->hd_sd;
+}
+
+static void sess_index_remove(struct httpd_data *hd, struct sock_db *session)
+{
+    int mask = hd->hd_sd_index_mask;
+    int slot = session - hd->hd_sd;
+    int hole = sess_index_home(hd, session->fd);
+    while (hd->hd_sd_index[hole] != slot) {
+        if (hd->hd_sd_index[hole] == -1) {
+            return;
+        }
+        hole = (hole + 1) & mask;
+    }
+
+    /* Shift back the following entries of the probe sequence which
+     * wouldn't be found anymore with a hole before them
+     */
+    for (int i = (hole + 1) & mask; hd->hd_sd_index[i] != -1; i = (i + 1) & mask) {
+        int home = sess_index_home(hd, hd->hd_sd[hd->hd_sd_index[i]].fd);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            hd->hd_sd_index[hole] = hd->hd_sd_index[i];
+            hole = i;
+        }
+    }
+    hd->hd_sd_index[hole] = -1;
+}
+
+static struct sock_db *sess_index_find(struct httpd_data *hd, int fd)
+{
+    if (fd < 0) {
+        return NULL;
+    }
+    for (int i = sess_index_home(hd, fd); hd->hd_sd_index[i] != -1; i = (i + 1) & hd->hd_sd_index_mask) {
+        struct sock_db *session = &hd->hd_sd[hd->hd_sd_index[i]];
+        if (session->fd == fd) {
+            return session;
+        }
+    }
+    return NULL;
+}
+
 static void httpd_sess_close(void *arg)
 {
     struct sock_db *sock_db = (struct sock_db *) arg;
@@ -144,6 +200,11 @@ static void httpd_sess_close(void *arg)
         return;
     }
     sock_db->lru_socket = false;
+    if (sock_db->in_worker) {
+        // Closed when the worker completes the request
+        sock_db->worker_close = true;
+        return;
+    }
     struct httpd_data *hd = (struct httpd_data *) sock_db->handle;
     httpd_sess_delete(hd, sock_db);
 }
@@ -153,11 +214,8 @@ struct sock_db *httpd_sess_get_free(struct httpd_data *hd)
     if ((!hd) || (hd->hd_sd_active_count == hd->config.max_open_sockets)) {
         return NULL;
     }
-    enum_context_t context = {
-        .task = HTTPD_TASK_GET_FREE
-    };
-    httpd_sess_enum(hd, enum_function, &context);
-    return context.session;
+    int free_count = hd->config.max_open_sockets - hd->hd_sd_active_count;
+    return &hd->hd_sd[hd->hd_sd_free[free_count - 1]];
 }
 
 bool httpd_is_sess_available(struct httpd_data *hd)
@@ -165,6 +223,19 @@ bool httpd_is_sess_available(struct httpd_data *hd)
     return httpd_sess_get_free(hd) ? true : false;
 }
 
+// Request being handled by the calling task: the one handed over to the
+// calling worker task, otherwise the one of the server task
+static httpd_req_t *sess_current_req(struct httpd_data *hd, struct httpd_req_aux **aux)
+{
+    httpd_req_t *req = httpd_worker_current_req(hd);
+    if (req) {
+        *aux = req->aux;
+        return req;
+    }
+    *aux = &hd->hd_req_aux;
+    return &hd->hd_req;
+}
+
 struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
 {
     if ((!hd) || (!hd->hd_sd) || (!hd->config.max_open_sockets)) {
@@ -173,16 +244,13 @@ struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
 
     // Check if called inside a request handler, and the session sockfd in use is same as the parameter
     // => Just return the pointer to the sock_db corresponding to the request
-    if ((hd->hd_req_aux.sd) && (hd->hd_req_aux.sd->fd == sockfd)) {
-        return hd->hd_req_aux.sd;
+    struct httpd_req_aux *ra;
+    sess_current_req(hd, &ra);
+    if ((ra->sd) && (ra->sd->fd == sockfd)) {
+        return ra->sd;
     }
 
-    enum_context_t context = {
-        .task = HTTPD_TASK_FIND_FD,
-        .fd = sockfd
-    };
-    httpd_sess_enum(hd, enum_function, &context);
-    return context.session;
+    return sess_index_find(hd, sockfd);
 }
 
 esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
@@ -207,8 +275,15 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
     session->send_fn = httpd_default_send;
     session->recv_fn = httpd_default_recv;
 
-    // increment number of sessions
+    // increment number of sessions, this takes the slot from the free stack
     hd->hd_sd_active_count++;
+    sess_index_add(hd, session);
+
+    if (httpd_poll_add(hd, session) != ESP_OK) {
+        httpd_sess_delete(hd, session);
+        ESP_LOGD(TAG, LOG_FMT("unable to poll fd = %d"), newfd);
+        return ESP_FAIL;
+    }
 
     // Call user-defined session opening function
     if (hd->config.open_fn) {
@@ -268,8 +343,10 @@ void *httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
     // request handler, in which case fetch the context from
     // the httpd_req_t structure
     struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == session) {
-        return hd->hd_req.sess_ctx;
+    struct httpd_req_aux *ra;
+    httpd_req_t *req = sess_current_req(hd, &ra);
+    if (ra->sd == session) {
+        return req->sess_ctx;
     }
     return session->ctx;
 }
@@ -285,16 +362,18 @@ void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void *ctx, httpd_free
     // request handler, in which case set the context inside
     // the httpd_req_t structure
     struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == session) {
-        if (hd->hd_req.sess_ctx != ctx) {
+    struct httpd_req_aux *ra;
+    httpd_req_t *req = sess_current_req(hd, &ra);
+    if (ra->sd == session) {
+        if (req->sess_ctx != ctx) {
             // Don't free previous context if it is in sockdb
             // as it will be freed inside httpd_req_cleanup()
-            if (session->ctx != hd->hd_req.sess_ctx) {
-                httpd_sess_free_ctx(&hd->hd_req.sess_ctx, hd->hd_req.free_ctx); // Free previous context
+            if (session->ctx != req->sess_ctx) {
+                httpd_sess_free_ctx(&req->sess_ctx, req->free_ctx); // Free previous context
             }
-            hd->hd_req.sess_ctx = ctx;
+            req->sess_ctx = ctx;
         }
-        hd->hd_req.free_ctx = free_fn;
+        req->free_ctx = free_fn;
         return;
     }
 
@@ -367,6 +446,9 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
         }
     }
 
+    httpd_poll_del(hd, session);
+    sess_index_remove(hd, session);
+
     // Call close function if defined
     if (hd->config.close_fn) {
         hd->config.close_fn(hd, session->fd);
@@ -381,7 +463,8 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
     // mark session slot as available
     session->fd = -1;
 
-    // decrement number of sessions
+    // decrement number of sessions, and put the slot back on the free stack
+    hd->hd_sd_free[hd->config.max_open_sockets - hd->hd_sd_active_count] = session - hd->hd_sd;
     hd->hd_sd_active_count--;
     ESP_LOGD(TAG, LOG_FMT("active sockets: %d"), hd->hd_sd_active_count);
     if (!hd->hd_sd_active_count) {
@@ -395,6 +478,16 @@ void httpd_sess_init(struct httpd_data *hd)
         .task = HTTPD_TASK_INIT
     };
     httpd_sess_enum(hd, enum_function, &context);
+
+    int index_size = hd->hd_sd_index_mask + 1;
+    for (int i = 0; i < index_size; i++) {
+        hd->hd_sd_index[i] = -1;
+    }
+    // the first slots are taken first
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        hd->hd_sd_free[i] = hd->config.max_open_sockets - 1 - i;
+    }
+    hd->hd_sd_active_count = 0;
 }
 
 bool httpd_sess_pending(struct httpd_data *hd, struct sock_db *session)
@@ -426,6 +519,11 @@ esp_err_t httpd_sess_process(struct httpd_data *hd, struct sock_db *session)
     if (httpd_req_new(hd, session) != ESP_OK) {
         return ESP_FAIL;
     }
+    if (session->in_worker) {
+        // The request was handed over to a worker task, which completes it
+        ESP_LOGD(TAG, LOG_FMT("handed over to a worker"));
+        return ESP_OK;
+    }
     ESP_LOGD(TAG, LOG_FMT("httpd_req_delete"));
     if (httpd_req_delete(hd) != ESP_OK) {
         return ESP_FAIL;
@@ -443,13 +541,9 @@ esp_err_t httpd_sess_update_lru_counter(httpd_handle_t handle, int sockfd)
 
     struct httpd_data *hd = (struct httpd_data *) handle;
 
-    enum_context_t context = {
-        .task = HTTPD_TASK_FIND_FD,
-        .fd = sockfd
-    };
-    httpd_sess_enum(hd, enum_function, &context);
-    if (context.session) {
-        context.session->lru_counter = ++hd->lru_counter;
+    struct sock_db *session = httpd_sess_get(hd, sockfd);
+    if (session) {
+        session->lru_counter = ++hd->lru_counter;
         return ESP_OK;
     }
     return ESP_ERR_NOT_FOUND;
@@ -0,0 +1,573 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+#include <esp_log.h>
+#include <esp_err.h>
+#include <http_parser.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_static";
+
+/* Longest path of a file, with the suffix of a precompressed variant */
+#define STATIC_PATH_SIZE    256
+
+/* Sizes of the buffers the request headers are read into. Longer values
+ * are truncated, which may only hide a coding, ETag or range at their end */
+#define STATIC_HDR_SIZE     128
+
+/**
+ * @brief   Directory of static files, see httpd_register_static_dir()
+ */
+struct httpd_static_dir {
+    char *uri_prefix;                       /*!< URI prefix without its trailing '/' */
+    size_t uri_prefix_len;                  /*!< Length of uri_prefix */
+    char *base_path;                        /*!< Path of the directory without its trailing '/' */
+    char *index_file;                       /*!< File served for the URIs ending with '/', or NULL */
+    char *cache_control;                    /*!< Value of the Cache-Control header, or NULL */
+    bool precompressed;                     /*!< Look for the .br and .gz variants of the files */
+    char *buf;                              /*!< Buffer the files are read into */
+    size_t buf_size;                        /*!< Size of buf */
+    osem_t buf_free;                        /*!< Taken while buf is in use */
+    unsigned refs;                          /*!< 1 while registered, plus 1 per request being handled */
+    omutex_t refs_lock;                     /*!< Protects refs */
+    httpd_uri_t uri;                        /*!< URI handler serving the directory, user_ctx points back here */
+    struct httpd_static_dir *next;          /*!< Next directory of the server */
+};
+
+static const struct {
+    const char *extension;
+    const char *type;
+} s_content_types[] = {
+    { ".html",  "text/html" },
+    { ".htm",   "text/html" },
+    { ".css",   "text/css" },
+    { ".js",    "application/javascript" },
+    { ".mjs",   "application/javascript" },
+    { ".json",  HTTPD_TYPE_JSON },
+    { ".map",   HTTPD_TYPE_JSON },
+    { ".txt",   "text/plain" },
+    { ".xml",   "text/xml" },
+    { ".svg",   "image/svg+xml" },
+    { ".png",   "image/png" },
+    { ".jpg",   "image/jpeg" },
+    { ".jpeg",  "image/jpeg" },
+    { ".gif",   "image/gif" },
+    { ".ico",   "image/x-icon" },
+    { ".webp",  "image/webp" },
+    { ".woff",  "font/woff" },
+    { ".woff2", "font/woff2" },
+    { ".wasm",  "application/wasm" },
+    { ".pdf",   "application/pdf" },
+};
+
+/* Precompressed variants, in order of preference */
+static const struct {
+    const char *coding;
+    const char *suffix;
+} s_encodings[] = {
+    { "br",     ".br" },
+    { "gzip",   ".gz" },
+};
+
+static const char *static_content_type(const char *path)
+{
+    const char *extension = strrchr(path, '.');
+    if (extension && !strchr(extension, '/')) {
+        for (int i = 0; i < sizeof(s_content_types) / sizeof(s_content_types[0]); i++) {
+            if (strcasecmp(extension, s_content_types[i].extension) == 0) {
+                return s_content_types[i].type;
+            }
+        }
+    }
+    return HTTPD_TYPE_OCTET;
+}
+
+/* Checks a q value of Accept-Encoding, e.g. "0" or "0.000" refuse a coding */
+static bool static_q_is_zero(const char *q, const char *end)
+{
+    if (q >= end || *q != '0') {
+        return false;
+    }
+    q++;
+    if (q < end && *q == '.') {
+        q++;
+        while (q < end && *q == '0') {
+            q++;
+        }
+    }
+    return q >= end || *q == ' ' || *q == '\t' || *q == ';';
+}
+
+/* Checks if an Accept-Encoding value allows a content coding */
+static bool static_accepts_encoding(const char *accept, const char *coding)
+{
+    const size_t coding_len = strlen(coding);
+    const char *p = accept;
+
+    while (*p) {
+        p += strspn(p, " \t,");
+        const char *end = p + strcspn(p, ",");
+        const size_t name_len = strcspn(p, " \t;,");
+        if ((name_len == coding_len && strncasecmp(p, coding, coding_len) == 0) ||
+            (name_len == 1 && *p == '*')) {
+            /* Look for a "q=" parameter */
+            const char *param = p + name_len;
+            while (param < end) {
+                param += strspn(param, " \t;");
+                if (param + 1 < end && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                    return !static_q_is_zero(param + 2, end);
+                }
+                param += strcspn(param, ";,");
+            }
+            return true;
+        }
+        p = end;
+    }
+    return false;
+}
+
+/* Checks if an If-None-Match value lists the ETag, comparing weakly */
+static bool static_etag_matches(const char *list, const char *etag)
+{
+    const size_t etag_len = strlen(etag);
+    const char *p = list;
+
+    while (*p) {
+        p += strspn(p, " \t,");
+        if (*p == '*') {
+            return true;
+        }
+        if (strncmp(p, "W/", 2) == 0) {
+            p += 2;
+        }
+        const size_t len = strcspn(p, " \t,");
+        if (len == etag_len && strncmp(p, etag, len) == 0) {
+            return true;
+        }
+        p += len;
+    }
+    return false;
+}
+
+/* Parses a Range value of a file of size bytes. Only a single byte range is
+ * supported, the whole file is sent for the others as allowed by RFC 7233.
+ *
+ * Returns 1 with the range in first and last, 0 to send the whole file, or
+ * -1 if the range can't be satisfied.
+ */
+static int static_parse_range(const char *range, size_t size, size_t *first, size_t *last)
+{
+    if (strncasecmp(range, "bytes=", 6) != 0 || strchr(range, ',')) {
+        return 0;
+    }
+    const char *p = range + 6;
+    char *end;
+
+    if (*p == '-') {
+        /* Suffix range: the last bytes of the file */
+        unsigned long long count = strtoull(p + 1, &end, 10);
+        if (end == p + 1 || *end) {
+            return 0;
+        }
+        if (count == 0 || size == 0) {
+            return -1;
+        }
+        *first = (count < size) ? size - count : 0;
+        *last = size - 1;
+        return 1;
+    }
+
+    unsigned long long range_first = strtoull(p, &end, 10);
+    if (end == p || *end != '-') {
+        return 0;
+    }
+    p = end + 1;
+    unsigned long long range_last = ULLONG_MAX;
+    if (*p) {
+        range_last = strtoull(p, &end, 10);
+        if (end == p || *end || range_last < range_first) {
+            return 0;
+        }
+    }
+    if (range_first >= size) {
+        return -1;
+    }
+    *first = range_first;
+    *last = MIN(range_last, size - 1);
+    return 1;
+}
+
+/* Builds the path of the file for the part of the URI following the prefix.
+ * Returns false if the URI can't be mapped to a file */
+static bool static_file_path(const struct httpd_static_dir *dir, const char *rel, size_t rel_len,
+                             char *path, size_t path_size)
+{
+    /* Refuse to leave base_path */
+    for (size_t i = 0; i < rel_len; i++) {
+        if (rel[i] == '.' && i > 0 && rel[i - 1] == '/' && i + 1 < rel_len && rel[i + 1] == '.' &&
+            (i + 2 == rel_len || rel[i + 2] == '/')) {
+            return false;
+        }
+    }
+
+    const bool index = (rel_len == 0 || rel[rel_len - 1] == '/');
+    if (index && !dir->index_file) {
+        return false;
+    }
+    int len = snprintf(path, path_size, "%s%s%.*s%s", dir->base_path, (rel_len && rel[0] == '/') ? "" : "/",
+                       (int) rel_len, rel, index ? dir->index_file : "");
+    /* Keep room for the suffix of a precompressed variant */
+    return len > 0 && len + sizeof(".br") <= path_size;
+}
+
+/* Opens a regular file, returns its descriptor or -1 */
+static int static_file_open(const char *path, struct stat *st)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, st) != 0 || !S_ISREG(st->st_mode)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static esp_err_t static_send_body(struct httpd_static_dir *dir, httpd_req_t *req, int fd,
+                                  off_t offset, size_t length)
+{
+#if defined(__linux__)
+    /* The file goes from the page cache to the socket, unless it must pass
+     * through the send function of the session, e.g. for TLS */
+    struct httpd_req_aux *ra = req->aux;
+    if (ra->sd->send_fn == httpd_default_send) {
+        while (length > 0) {
+            ssize_t sent = sendfile(ra->sd->fd, fd, &offset, length);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent <= 0) {
+                ESP_LOGD(TAG, LOG_FMT("error in sendfile (%d)"), errno);
+                return ESP_ERR_HTTPD_RESP_SEND;
+            }
+            length -= sent;
+        }
+        return ESP_OK;
+    }
+#endif
+
+    /* The buffer of the directory is shared by the worker tasks */
+    char *buf = dir->buf;
+    if (!httpd_os_sem_try_take(dir->buf_free)) {
+        buf = malloc(dir->buf_size);
+        if (!buf) {
+            ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for file buffer"));
+            return ESP_ERR_HTTPD_ALLOC_MEM;
+        }
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (offset && lseek(fd, offset, SEEK_SET) != offset) {
+        ret = ESP_FAIL;
+    }
+    while (ret == ESP_OK && length > 0) {
+        ssize_t len = read(fd, buf, MIN(length, dir->buf_size));
+        if (len <= 0) {
+            ESP_LOGD(TAG, LOG_FMT("error in read (%d)"), errno);
+            ret = ESP_FAIL;
+        } else if (httpd_send_all(req, buf, len) != ESP_OK) {
+            ret = ESP_ERR_HTTPD_RESP_SEND;
+        } else {
+            length -= len;
+        }
+    }
+
+    if (buf == dir->buf) {
+        httpd_os_sem_give(dir->buf_free);
+    } else {
+        free(buf);
+    }
+    return ret;
+}
+
+static esp_err_t static_dir_serve(struct httpd_static_dir *dir, httpd_req_t *req)
+{
+    struct httpd_req_aux *ra = req->aux;
+    const struct http_parser_url *res = &ra->url_parse_res;
+
+    /* The path of the URI starts with the prefix, see httpd_static_dir_find() */
+    const char *rel = req->uri + res->field_data[UF_PATH].off + dir->uri_prefix_len;
+    size_t rel_len = res->field_data[UF_PATH].len - dir->uri_prefix_len;
+
+    char path[STATIC_PATH_SIZE];
+    if (!static_file_path(dir, rel, rel_len, path, sizeof(path))) {
+        return httpd_req_handle_err(req, HTTPD_404_NOT_FOUND);
+    }
+
+    /* Look for a precompressed variant accepted by the client */
+    const char *coding = NULL;
+    struct stat st;
+    int fd = -1;
+    char hdr[STATIC_HDR_SIZE];
+    if (dir->precompressed) {
+        esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept-Encoding", hdr, sizeof(hdr));
+        if (ret == ESP_OK || ret == ESP_ERR_HTTPD_RESULT_TRUNC) {
+            size_t path_len = strlen(path);
+            for (int i = 0; i < sizeof(s_encodings) / sizeof(s_encodings[0]) && fd < 0; i++) {
+                if (static_accepts_encoding(hdr, s_encodings[i].coding)) {
+                    strcpy(path + path_len, s_encodings[i].suffix);
+                    fd = static_file_open(path, &st);
+                    coding = (fd >= 0) ? s_encodings[i].coding : NULL;
+                }
+            }
+            path[path_len] = '\0';
+        }
+    }
+    if (fd < 0) {
+        fd = static_file_open(path, &st);
+        if (fd < 0) {
+            ESP_LOGD(TAG, LOG_FMT("file %s not found"), path);
+            return httpd_req_handle_err(req, HTTPD_404_NOT_FOUND);
+        }
+    }
+
+    const size_t size = st.st_size;
+    char etag[40];
+    snprintf(etag, sizeof(etag), "\"%" PRIx32 "-%" PRIx32 "%s%s\"", (uint32_t) size, (uint32_t) st.st_mtime,
+             coding ? "-" : "", coding ? coding : "");
+
+    size_t first = 0, last = size - 1;
+    int range = 0;
+    bool not_modified = false;
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", hdr, sizeof(hdr)) != ESP_ERR_NOT_FOUND) {
+        not_modified = static_etag_matches(hdr, etag);
+    }
+    if (!not_modified && httpd_req_get_hdr_value_str(req, "Range", hdr, sizeof(hdr)) == ESP_OK) {
+        /* A range applies only to the version of the file named by If-Range */
+        char if_range[sizeof(etag)];
+        esp_err_t ret = httpd_req_get_hdr_value_str(req, "If-Range", if_range, sizeof(if_range));
+        if (ret == ESP_ERR_NOT_FOUND || (ret == ESP_OK && strcmp(if_range, etag) == 0)) {
+            range = static_parse_range(hdr, size, &first, &last);
+        }
+    }
+
+    /* The header values are sent from these buffers */
+    char content_range[48];
+    if (range > 0) {
+        snprintf(content_range, sizeof(content_range), "bytes %" NEWLIB_NANO_COMPAT_FORMAT "-%"
+                 NEWLIB_NANO_COMPAT_FORMAT "/%" NEWLIB_NANO_COMPAT_FORMAT, NEWLIB_NANO_COMPAT_CAST(first),
+                 NEWLIB_NANO_COMPAT_CAST(last), NEWLIB_NANO_COMPAT_CAST(size));
+        httpd_resp_set_status(req, "206 Partial Content");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+    } else if (range < 0) {
+        snprintf(content_range, sizeof(content_range), "bytes */%" NEWLIB_NANO_COMPAT_FORMAT,
+                 NEWLIB_NANO_COMPAT_CAST(size));
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+    } else if (not_modified) {
+        httpd_resp_set_status(req, "304 Not Modified");
+    }
+    httpd_resp_set_type(req, static_content_type(path));
+    if (coding) {
+        httpd_resp_set_hdr(req, "Content-Encoding", coding);
+    }
+    httpd_resp_set_hdr(req, "ETag", etag);
+    if (dir->precompressed) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+    httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+    if (dir->cache_control) {
+        httpd_resp_set_hdr(req, "Cache-Control", dir->cache_control);
+    }
+
+    esp_err_t ret;
+    if (range < 0 || not_modified) {
+        ret = httpd_resp_send(req, NULL, 0);
+    } else {
+        size_t length = (size == 0) ? 0 : last - first + 1;
+        ret = httpd_resp_send_hdrs(req, length);
+        if (ret == ESP_OK && req->method != HTTP_HEAD && length > 0) {
+            ret = static_send_body(dir, req, fd, first, length);
+            if (ret == ESP_OK) {
+                esp_http_server_event_data evt_data = {
+                    .fd = ra->sd->fd,
+                    .data_len = length,
+                };
+                esp_http_server_dispatch_event(HTTP_SERVER_EVENT_SENT_DATA, &evt_data, sizeof(esp_http_server_event_data));
+            }
+        }
+    }
+    close(fd);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, LOG_FMT("failed to send %s (0x%x)"), path, ret);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void static_dir_free(struct httpd_static_dir *dir)
+{
+    if (dir->refs_lock) {
+        httpd_os_mutex_delete(dir->refs_lock);
+    }
+    if (dir->buf_free) {
+        httpd_os_sem_delete(dir->buf_free);
+    }
+    free(dir->buf);
+    free(dir->cache_control);
+    free(dir->index_file);
+    free(dir->base_path);
+    free(dir->uri_prefix);
+    free(dir);
+}
+
+/* Drops a reference to the directory, freeing it with the last one */
+static void static_dir_release(struct httpd_static_dir *dir)
+{
+    httpd_os_mutex_lock(dir->refs_lock);
+    bool last = (--dir->refs == 0);
+    httpd_os_mutex_unlock(dir->refs_lock);
+    if (last) {
+        static_dir_free(dir);
+    }
+}
+
+/* The reference taken by httpd_static_dir_find() keeps the directory until
+ * the request is handled, even if it is unregistered meanwhile */
+static esp_err_t static_dir_handler(httpd_req_t *req)
+{
+    struct httpd_static_dir *dir = (struct httpd_static_dir *) req->user_ctx;
+    esp_err_t ret = static_dir_serve(dir, req);
+    static_dir_release(dir);
+    return ret;
+}
+
+/* Copies a path or a URI prefix without its trailing '/' */
+static char *static_strdup_dir(const char *path)
+{
+    size_t len = strlen(path);
+    while (len > 0 && path[len - 1] == '/') {
+        len--;
+    }
+    return strndup(path, len);
+}
+
+esp_err_t httpd_register_static_dir(httpd_handle_t handle, const httpd_static_dir_config_t *config)
+{
+    if (handle == NULL || config == NULL || config->uri_prefix == NULL ||
+        config->base_path == NULL || config->uri_prefix[0] != '/' || config->buffer_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data *hd = (struct httpd_data *) handle;
+    struct httpd_static_dir *dir = calloc(1, sizeof(struct httpd_static_dir));
+    if (!dir) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    dir->uri_prefix = static_strdup_dir(config->uri_prefix);
+    dir->base_path = static_strdup_dir(config->base_path);
+    dir->index_file = config->index_file ? strdup(config->index_file) : NULL;
+    dir->cache_control = config->cache_control ? strdup(config->cache_control) : NULL;
+    dir->buf = malloc(config->buffer_size);
+    if (!dir->uri_prefix || !dir->base_path || !dir->buf ||
+        (config->index_file && !dir->index_file) ||
+        (config->cache_control && !dir->cache_control) ||
+        httpd_os_sem_create(&dir->buf_free, 1, 1) != OS_SUCCESS ||
+        httpd_os_mutex_create(&dir->refs_lock) != OS_SUCCESS) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for static directory"));
+        static_dir_free(dir);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    dir->uri_prefix_len = strlen(dir->uri_prefix);
+    dir->buf_size = config->buffer_size;
+    dir->precompressed = config->precompressed;
+    dir->refs = 1;
+    dir->uri.uri = dir->uri_prefix;
+    dir->uri.method = HTTP_GET;
+    dir->uri.handler = static_dir_handler;
+    dir->uri.user_ctx = dir;
+
+    struct httpd_static_dir **tail = &hd->hd_static_dirs;
+    for (; *tail; tail = &(*tail)->next) {
+        if (strcmp((*tail)->uri_prefix, dir->uri_prefix) == 0) {
+            ESP_LOGW(TAG, LOG_FMT("static directory %s already registered"), config->uri_prefix);
+            static_dir_free(dir);
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    *tail = dir;
+    ESP_LOGD(TAG, LOG_FMT("serving %s under %s"), dir->base_path, config->uri_prefix);
+    return ESP_OK;
+}
+
+esp_err_t httpd_unregister_static_dir(httpd_handle_t handle, const char *uri_prefix)
+{
+    if (handle == NULL || uri_prefix == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data *hd = (struct httpd_data *) handle;
+    size_t prefix_len = strlen(uri_prefix);
+    while (prefix_len > 0 && uri_prefix[prefix_len - 1] == '/') {
+        prefix_len--;
+    }
+    for (struct httpd_static_dir **link = &hd->hd_static_dirs; *link; link = &(*link)->next) {
+        struct httpd_static_dir *dir = *link;
+        if (dir->uri_prefix_len == prefix_len && strncmp(dir->uri_prefix, uri_prefix, prefix_len) == 0) {
+            *link = dir->next;
+            static_dir_release(dir);
+            return ESP_OK;
+        }
+    }
+    ESP_LOGW(TAG, LOG_FMT("static directory %s not found"), uri_prefix);
+    return ESP_ERR_NOT_FOUND;
+}
+
+void httpd_unregister_all_static_dirs(struct httpd_data *hd)
+{
+    while (hd->hd_static_dirs) {
+        struct httpd_static_dir *dir = hd->hd_static_dirs;
+        hd->hd_static_dirs = dir->next;
+        static_dir_release(dir);
+    }
+}
+
+httpd_uri_t *httpd_static_dir_find(struct httpd_data *hd, const char *uri, size_t uri_len)
+{
+    struct httpd_static_dir *found = NULL;
+    for (struct httpd_static_dir *dir = hd->hd_static_dirs; dir; dir = dir->next) {
+        /* The prefix must be followed by a '/' or end the URI */
+        if (uri_len >= dir->uri_prefix_len &&
+            strncmp(uri, dir->uri_prefix, dir->uri_prefix_len) == 0 &&
+            (uri_len == dir->uri_prefix_len || uri[dir->uri_prefix_len] == '/') &&
+            (!found || dir->uri_prefix_len > found->uri_prefix_len)) {
+            found = dir;
+        }
+    }
+    if (!found) {
+        return NULL;
+    }
+    httpd_os_mutex_lock(found->refs_lock);
+    found->refs++;
+    httpd_os_mutex_unlock(found->refs_lock);
+    return &found->uri;
+}
@@ -21,16 +21,20 @@ static bool httpd_uri_match_simple(const char *uri1, const char *uri2, size_t le
         (strncmp(uri1, uri2, len2) == 0);   // Then match actual URIs
 }
 
-bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
+/* Splits a template of httpd_uri_match_wildcard() into the number of characters
+ * to match exactly and its trailing special characters. If '?' is present, the
+ * optional character is template[*exact_len]. Returns false for an invalid
+ * template, which matches no URI */
+static bool httpd_uri_wildcard_parse(const char *template, size_t *exact_len,
+                                     bool *quest, bool *asterisk)
 {
     const size_t tpl_len = strlen(template);
-    size_t exact_match_chars = tpl_len;
 
     /* Check for trailing question mark and asterisk */
     const char last = (const char) (tpl_len > 0 ? template[tpl_len - 1] : 0);
     const char prevlast = (const char) (tpl_len > 1 ? template[tpl_len - 2] : 0);
-    const bool asterisk = last == '*' || (prevlast == '*' && last == '?');
-    const bool quest = last == '?' || (prevlast == '?' && last == '*');
+    *asterisk = last == '*' || (prevlast == '*' && last == '?');
+    *quest = last == '?' || (prevlast == '?' && last == '*');
 
     /* Minimum template string length must be:
      *      0 : if neither of '*' and '?' are present
@@ -41,14 +45,24 @@ bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
      * The expression (asterisk + quest*2) serves as a
      * case wise generator of these length values
      */
-
-    /* abort in cases such as "?" with no preceding character (invalid template) */
-    if (exact_match_chars < asterisk + quest*2) {
+    if (tpl_len < *asterisk + *quest*2) {
         return false;
     }
 
     /* account for special characters and the optional character if "?" is used */
-    exact_match_chars -= asterisk + quest*2;
+    *exact_len = tpl_len - (*asterisk + *quest*2);
+    return true;
+}
+
+bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
+{
+    size_t exact_match_chars;
+    bool asterisk, quest;
+
+    /* abort in cases such as "?" with no preceding character (invalid template) */
+    if (!httpd_uri_wildcard_parse(template, &exact_match_chars, &quest, &asterisk)) {
+        return false;
+    }
 
     if (len < exact_match_chars) {
         return false;
@@ -80,13 +94,295 @@ bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
     }
 }
 
-/* Find handler with matching URI and method, and set
- * appropriate error code if URI or method not found */
-static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
-                                           const char *uri, size_t uri_len,
-                                           httpd_method_t method,
-                                           httpd_err_code_t *err)
+/* The registered handlers are indexed by a radix trie of their URIs when the
+ * URIs are matched by httpd_uri_match_simple() or httpd_uri_match_wildcard().
+ * A URI template is split into the characters to match exactly, which form
+ * the path to a node, and its trailing wildcards:
+ *
+ *      "/led"      exact route at "/led"
+ *      "/led*"     prefix route at "/led"
+ *      "/led?"     exact routes at "/le" and "/led"
+ *      "/led?*"    exact route at "/le" and prefix route at "/led"
+ *
+ * A lookup walks down the trie along the URI, matching the prefix routes of
+ * the nodes on its way and the exact routes of the node where the URI ends.
+ * Of these, the handler registered first with the method of the request is
+ * chosen, as the linear scan of hd_calls would. The labels of the nodes point
+ * into the URI strings of hd_calls and the routes keep the index of their
+ * handler in hd_calls, so the trie is rebuilt when handlers are unregistered.
+ * If memory runs out, the trie is dropped and hd_calls is scanned instead.
+ */
+
+struct httpd_uri_route {
+    httpd_uri_t *uri;                       /*!< Registered URI handler */
+    int index;                              /*!< Index of the handler in hd_calls */
+    struct httpd_uri_route *next;           /*!< Next route of the node, in order of registration */
+};
+
+struct httpd_uri_node {
+    const char *label;                      /*!< Characters following the parent node, not null terminated */
+    size_t label_len;                       /*!< Length of label, only 0 for the root */
+    struct httpd_uri_node **children;       /*!< Child nodes, sorted by the first character of their label */
+    int child_count;                        /*!< Number of children */
+    struct httpd_uri_route *exact;          /*!< Routes of the URIs ending at this node */
+    struct httpd_uri_route *prefix;         /*!< Routes of the URIs starting with this node */
+};
+
+static bool uri_trie_enabled(struct httpd_data *hd)
+{
+    return hd->config.uri_match_fn == NULL ||
+           hd->config.uri_match_fn == httpd_uri_match_wildcard;
+}
+
+static void uri_trie_free_routes(struct httpd_uri_route *route)
+{
+    while (route) {
+        struct httpd_uri_route *next = route->next;
+        free(route);
+        route = next;
+    }
+}
+
+static void uri_trie_free(struct httpd_uri_node *node)
+{
+    if (!node) {
+        return;
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        uri_trie_free(node->children[i]);
+    }
+    uri_trie_free_routes(node->exact);
+    uri_trie_free_routes(node->prefix);
+    free(node->children);
+    free(node);
+}
+
+static struct httpd_uri_node *uri_trie_node_new(const char *label, size_t label_len)
 {
+    struct httpd_uri_node *node = calloc(1, sizeof(struct httpd_uri_node));
+    if (node) {
+        node->label = label;
+        node->label_len = label_len;
+    }
+    return node;
+}
+
+/* Binary search of the child whose label starts with c. Returns its position,
+ * or the position where such a child is to be inserted */
+static int uri_trie_child_pos(const struct httpd_uri_node *node, char c, bool *found)
+{
+    int low = 0, high = node->child_count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        unsigned char first = node->children[mid]->label[0];
+        if (first == (unsigned char) c) {
+            *found = true;
+            return mid;
+        }
+        if (first < (unsigned char) c) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *found = false;
+    return low;
+}
+
+/* Returns the node reached by key, adding or splitting nodes as needed */
+static struct httpd_uri_node *uri_trie_node_get(struct httpd_uri_node *node,
+                                                const char *key, size_t key_len)
+{
+    size_t pos = 0;
+    while (pos < key_len) {
+        bool found;
+        int i = uri_trie_child_pos(node, key[pos], &found);
+        if (!found) {
+            struct httpd_uri_node **children = realloc(node->children,
+                                                       (node->child_count + 1) * sizeof(struct httpd_uri_node *));
+            if (!children) {
+                return NULL;
+            }
+            node->children = children;
+            struct httpd_uri_node *leaf = uri_trie_node_new(key + pos, key_len - pos);
+            if (!leaf) {
+                return NULL;
+            }
+            memmove(&children[i + 1], &children[i], (node->child_count - i) * sizeof(struct httpd_uri_node *));
+            children[i] = leaf;
+            node->child_count++;
+            return leaf;
+        }
+
+        struct httpd_uri_node *child = node->children[i];
+        size_t common = 1;
+        while (common < child->label_len && pos + common < key_len &&
+               child->label[common] == key[pos + common]) {
+            common++;
+        }
+        if (common < child->label_len) {
+            /* The key ends or differs inside the label of the child, which is
+             * split: a new node with the common characters takes its place */
+            struct httpd_uri_node *split = uri_trie_node_new(child->label, common);
+            if (!split) {
+                return NULL;
+            }
+            split->children = malloc(sizeof(struct httpd_uri_node *));
+            if (!split->children) {
+                free(split);
+                return NULL;
+            }
+            split->children[0] = child;
+            split->child_count = 1;
+            child->label += common;
+            child->label_len -= common;
+            node->children[i] = split;
+            child = split;
+        }
+        node = child;
+        pos += common;
+    }
+    return node;
+}
+
+static bool uri_trie_add_route(struct httpd_uri_node *root, const char *key, size_t key_len,
+                               bool prefix, httpd_uri_t *uri, int index)
+{
+    struct httpd_uri_node *node = uri_trie_node_get(root, key, key_len);
+    if (!node) {
+        return false;
+    }
+    struct httpd_uri_route *route = malloc(sizeof(struct httpd_uri_route));
+    if (!route) {
+        return false;
+    }
+    route->uri = uri;
+    route->index = index;
+    route->next = NULL;
+
+    /* Handlers are added in order of registration */
+    struct httpd_uri_route **tail = prefix ? &node->prefix : &node->exact;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = route;
+    return true;
+}
+
+/* Adds the routes of the handler at index in hd_calls to the trie. The trie is
+ * created with the first handler, and stays dropped after running out of
+ * memory until it is rebuilt */
+static void uri_trie_add(struct httpd_data *hd, int index)
+{
+    if (!uri_trie_enabled(hd)) {
+        return;
+    }
+    if (!hd->hd_uri_trie) {
+        if (index != 0) {
+            return;
+        }
+        hd->hd_uri_trie = uri_trie_node_new("", 0);
+        if (!hd->hd_uri_trie) {
+            ESP_LOGW(TAG, LOG_FMT("no memory for the URI trie, matching URIs linearly"));
+            return;
+        }
+    }
+
+    httpd_uri_t *uri = hd->hd_calls[index];
+    size_t exact_len = strlen(uri->uri);
+    bool quest = false, asterisk = false;
+    bool ok = true;
+    if (hd->config.uri_match_fn &&
+        !httpd_uri_wildcard_parse(uri->uri, &exact_len, &quest, &asterisk)) {
+        /* An invalid template matches no URI, it has no route */
+    } else if (quest) {
+        /* Without the optional character, then with it */
+        ok = uri_trie_add_route(hd->hd_uri_trie, uri->uri, exact_len, false, uri, index) &&
+             uri_trie_add_route(hd->hd_uri_trie, uri->uri, exact_len + 1, asterisk, uri, index);
+    } else {
+        ok = uri_trie_add_route(hd->hd_uri_trie, uri->uri, exact_len, asterisk, uri, index);
+    }
+
+    if (!ok) {
+        ESP_LOGW(TAG, LOG_FMT("no memory for the URI trie, matching URIs linearly"));
+        uri_trie_free(hd->hd_uri_trie);
+        hd->hd_uri_trie = NULL;
+    }
+}
+
+/* Rebuilds the trie after handlers were removed from hd_calls */
+static void uri_trie_rebuild(struct httpd_data *hd)
+{
+    uri_trie_free(hd->hd_uri_trie);
+    hd->hd_uri_trie = NULL;
+    for (int i = 0; i < hd->config.max_uri_handlers; i++) {
+        if (!hd->hd_calls[i]) {
+            break;
+        }
+        uri_trie_add(hd, i);
+    }
+}
+
+/* Keeps the route registered first with the method, the routes of a node
+ * being in order of registration */
+static void uri_trie_match(const struct httpd_uri_route *route, httpd_method_t method,
+                           const struct httpd_uri_route **best, bool *uri_found)
+{
+    if (route) {
+        *uri_found = true;
+    }
+    for (; route; route = route->next) {
+        if (route->uri->method == method) {
+            if (!*best || route->index < (*best)->index) {
+                *best = route;
+            }
+            return;
+        }
+    }
+}
+
+static httpd_uri_t *uri_trie_find(const struct httpd_uri_node *node,
+                                  const char *uri, size_t uri_len,
+                                  httpd_method_t method, httpd_err_code_t *err)
+{
+    const struct httpd_uri_route *best = NULL;
+    bool uri_found = false;
+    size_t pos = 0;
+
+    while (true) {
+        uri_trie_match(node->prefix, method, &best, &uri_found);
+        if (pos == uri_len) {
+            uri_trie_match(node->exact, method, &best, &uri_found);
+            break;
+        }
+        bool found;
+        int i = uri_trie_child_pos(node, uri[pos], &found);
+        if (!found) {
+            break;
+        }
+        node = node->children[i];
+        if (node->label_len > uri_len - pos ||
+            memcmp(node->label, uri + pos, node->label_len) != 0) {
+            break;
+        }
+        pos += node->label_len;
+    }
+
+    if (err) {
+        *err = best ? 0 : (uri_found ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND);
+    }
+    return best ? best->uri : NULL;
+}
+
+httpd_uri_t *httpd_find_uri_handler(struct httpd_data *hd,
+                                    const char *uri, size_t uri_len,
+                                    httpd_method_t method,
+                                    httpd_err_code_t *err)
+{
+    if (hd->hd_uri_trie) {
+        return uri_trie_find(hd->hd_uri_trie, uri, uri_len, method, err);
+    }
+
     if (err) {
         *err = HTTPD_404_NOT_FOUND;
     }
@@ -164,6 +460,7 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
             hd->hd_calls[i]->method   = uri_handler->method;
             hd->hd_calls[i]->handler  = uri_handler->handler;
             hd->hd_calls[i]->user_ctx = uri_handler->user_ctx;
+            hd->hd_calls[i]->max_concurrency = uri_handler->max_concurrency;
 #ifdef CONFIG_HTTPD_WS_SUPPORT
             hd->hd_calls[i]->is_websocket = uri_handler->is_websocket;
             hd->hd_calls[i]->handle_ws_control_frames = uri_handler->handle_ws_control_frames;
@@ -173,6 +470,7 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
                 hd->hd_calls[i]->supported_subprotocol = NULL;
             }
 #endif
+            uri_trie_add(hd, i);
             ESP_LOGD(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
             return ESP_OK;
         }
@@ -212,6 +510,7 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
             }
             /* Nullify the following non null entry */
             hd->hd_calls[i-1] = NULL;
+            uri_trie_rebuild(hd);
             return ESP_OK;
         }
     }
@@ -253,7 +552,9 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
         hd->hd_calls[k] = NULL;
     }
 
-    if (!found) {
+    if (found) {
+        uri_trie_rebuild(hd);
+    } else {
         ESP_LOGW(TAG, LOG_FMT("no handler found for URI %s"), uri);
     }
     return (found ? ESP_OK : ESP_ERR_NOT_FOUND);
@@ -271,6 +572,8 @@ void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
         free(hd->hd_calls[i]);
         hd->hd_calls[i] = NULL;
     }
+    uri_trie_free(hd->hd_uri_trie);
+    hd->hd_uri_trie = NULL;
 }
 
 esp_err_t httpd_uri(struct httpd_data *hd)
@@ -288,6 +591,12 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     if (res->field_set & (1 << UF_PATH)) {
         uri = httpd_find_uri_handler(hd, req->uri + res->field_data[UF_PATH].off,
                                      res->field_data[UF_PATH].len, req->method, &err);
+
+        /* The URIs without handler may be files of a static directory */
+        if (uri == NULL && (req->method == HTTP_GET || req->method == HTTP_HEAD)) {
+            uri = httpd_static_dir_find(hd, req->uri + res->field_data[UF_PATH].off,
+                                        res->field_data[UF_PATH].len);
+        }
     }
 
     /* If URI with method not found, respond with error code */
@@ -325,6 +634,16 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     }
 #endif
 
+    /* Hand the request over to a worker task, the WebSocket endpoints
+     * stay on the server task */
+    bool use_worker = (hd->config.worker_count != 0);
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    use_worker = use_worker && !uri->is_websocket;
+#endif
+    if (use_worker) {
+        return httpd_worker_dispatch(hd, uri);
+    }
+
     /* Invoke handler */
     if (uri->handler(req) != ESP_OK) {
         /* Handler returns error, this socket should be closed */
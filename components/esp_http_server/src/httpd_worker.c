@@ -0,0 +1,346 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_worker";
+
+/* The server task parses a request, then copies it into a free job slot and
+ * queues the job. The session is removed from the poller, so only the worker
+ * reads and writes the socket until the handler returns and the request is
+ * completed. The worker then puts the session on the done list and wakes the
+ * server task up with a work item, which puts the session back in the poller.
+ *
+ * The job slots are taken by the server task before queuing, so when all the
+ * workers are busy and the queue is full, the server task stops reading
+ * requests and the clients are slowed down by TCP flow control.
+ */
+
+static void worker_free(struct httpd_workers *pool)
+{
+    if (pool->stopped) {
+        httpd_os_sem_delete(pool->stopped);
+    }
+    if (pool->queued_jobs) {
+        httpd_os_sem_delete(pool->queued_jobs);
+    }
+    if (pool->free_jobs) {
+        httpd_os_sem_delete(pool->free_jobs);
+    }
+    if (pool->lock) {
+        httpd_os_mutex_delete(pool->lock);
+    }
+    free(pool->done);
+    free(pool->queue);
+    free(pool->free);
+    free(pool->resp_hdrs);
+    free(pool->jobs);
+    free(pool->workers);
+    memset(pool, 0, sizeof(*pool));
+}
+
+/* Called on the server task, after a worker put a session on the done list */
+static void worker_wakeup(void *arg)
+{
+    httpd_worker_complete((struct httpd_data *) arg);
+}
+
+static void worker_thread(void *arg)
+{
+    struct httpd_worker *worker = (struct httpd_worker *) arg;
+    struct httpd_data *hd = worker->hd;
+    struct httpd_workers *pool = &hd->hd_workers;
+
+    while (1) {
+        httpd_os_sem_take(pool->queued_jobs);
+        httpd_os_mutex_lock(pool->lock);
+        struct httpd_worker_job *job = pool->queue[pool->queue_head];
+        pool->queue_head = (pool->queue_head + 1) % pool->queue_size;
+        pool->stats.queued--;
+        if (job) {
+            pool->stats.active++;
+            worker->job = job;
+        }
+        httpd_os_mutex_unlock(pool->lock);
+        if (!job) {
+            break;
+        }
+
+        int64_t start_us = httpd_os_get_time_us();
+        bool failed = (job->handler(&job->req) != ESP_OK);
+        int64_t end_us = httpd_os_get_time_us();
+        if (failed) {
+            /* Handler returns error, this socket should be closed */
+            ESP_LOGW(TAG, LOG_FMT("uri handler execution failed"));
+        }
+
+        struct sock_db *sd = job->aux.sd;
+        sd->worker_failed = (httpd_req_finish(&job->req, failed) != ESP_OK);
+
+        httpd_os_mutex_lock(pool->lock);
+        worker->job = NULL;
+        job->uri = NULL;
+        pool->free[pool->free_count++] = job;
+        pool->done[pool->done_count++] = sd;
+
+        httpd_worker_stats_t *stats = &pool->stats;
+        uint32_t handler_time_us = (uint32_t) (end_us - start_us);
+        stats->active--;
+        stats->completed++;
+        stats->wait_time_us += start_us - job->queued_us;
+        stats->handler_time_us += handler_time_us;
+        if (handler_time_us > stats->handler_time_max_us) {
+            stats->handler_time_max_us = handler_time_us;
+        }
+
+        /* One wake-up is enough for all the sessions put on the done list
+         * until the server task processes it */
+        bool wakeup = !pool->wakeup_pending && !pool->stopping;
+        pool->wakeup_pending = true;
+        httpd_os_mutex_unlock(pool->lock);
+        httpd_os_sem_give(pool->free_jobs);
+
+        if (wakeup && httpd_queue_work(hd, worker_wakeup, hd) != ESP_OK) {
+            /* The server task processes the done list on each iteration anyway */
+            ESP_LOGW(TAG, LOG_FMT("failed to wake the server task up"));
+            httpd_os_mutex_lock(pool->lock);
+            pool->wakeup_pending = false;
+            httpd_os_mutex_unlock(pool->lock);
+        }
+    }
+
+    ESP_LOGD(TAG, LOG_FMT("worker exiting"));
+    httpd_os_sem_give(pool->stopped);
+    httpd_os_thread_delete();
+}
+
+esp_err_t httpd_worker_init(struct httpd_data *hd)
+{
+    struct httpd_workers *pool = &hd->hd_workers;
+    memset(pool, 0, sizeof(*pool));
+    if (hd->config.worker_count == 0) {
+        return ESP_OK;
+    }
+
+    int worker_count = hd->config.worker_count;
+    pool->job_count = worker_count + hd->config.worker_queue_size;
+    /* Room for all the jobs, and for the NULL jobs stopping the workers */
+    pool->queue_size = pool->job_count + worker_count;
+
+    pool->workers = calloc(worker_count, sizeof(struct httpd_worker));
+    pool->jobs = calloc(pool->job_count, sizeof(struct httpd_worker_job));
+    pool->resp_hdrs = calloc(pool->job_count * hd->config.max_resp_headers, sizeof(struct resp_hdr));
+    pool->free = calloc(pool->job_count, sizeof(struct httpd_worker_job *));
+    pool->queue = calloc(pool->queue_size, sizeof(struct httpd_worker_job *));
+    pool->done = calloc(hd->config.max_open_sockets, sizeof(struct sock_db *));
+    if (!pool->workers || !pool->jobs || (!pool->resp_hdrs && hd->config.max_resp_headers) ||
+        !pool->free || !pool->queue || !pool->done ||
+        httpd_os_mutex_create(&pool->lock) != OS_SUCCESS ||
+        httpd_os_sem_create(&pool->free_jobs, pool->job_count, pool->job_count) != OS_SUCCESS ||
+        httpd_os_sem_create(&pool->queued_jobs, pool->queue_size, 0) != OS_SUCCESS ||
+        httpd_os_sem_create(&pool->stopped, worker_count, 0) != OS_SUCCESS) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for worker tasks"));
+        worker_free(pool);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
+    for (int i = 0; i < pool->job_count; i++) {
+        pool->free[pool->free_count++] = &pool->jobs[i];
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        struct httpd_worker *worker = &pool->workers[i];
+        worker->hd = hd;
+        if (httpd_os_thread_create(&worker->handle, "httpd_worker",
+                                   hd->config.worker_stack_size,
+                                   hd->config.worker_task_priority,
+                                   worker_thread, worker,
+                                   tskNO_AFFINITY) != OS_SUCCESS) {
+            ESP_LOGE(TAG, LOG_FMT("Failed to launch worker task"));
+            httpd_worker_deinit(hd);
+            return ESP_ERR_HTTPD_TASK;
+        }
+        pool->started++;
+    }
+    return ESP_OK;
+}
+
+void httpd_worker_deinit(struct httpd_data *hd)
+{
+    struct httpd_workers *pool = &hd->hd_workers;
+    if (!pool->workers) {
+        return;
+    }
+
+    /* The NULL jobs are taken after the requests already queued */
+    httpd_os_mutex_lock(pool->lock);
+    pool->stopping = true;
+    for (int i = 0; i < pool->started; i++) {
+        pool->queue[(pool->queue_head + pool->stats.queued) % pool->queue_size] = NULL;
+        pool->stats.queued++;
+    }
+    httpd_os_mutex_unlock(pool->lock);
+    for (int i = 0; i < pool->started; i++) {
+        httpd_os_sem_give(pool->queued_jobs);
+    }
+    for (int i = 0; i < pool->started; i++) {
+        httpd_os_sem_take(pool->stopped);
+    }
+    worker_free(pool);
+}
+
+/* Number of requests to a URI queued or being handled */
+static int worker_uri_load(struct httpd_workers *pool, const httpd_uri_t *uri)
+{
+    int load = 0;
+    for (int i = 0; i < pool->job_count; i++) {
+        if (pool->jobs[i].uri == uri) {
+            load++;
+        }
+    }
+    return load;
+}
+
+esp_err_t httpd_worker_dispatch(struct httpd_data *hd, const httpd_uri_t *uri)
+{
+    struct httpd_workers *pool = &hd->hd_workers;
+    httpd_req_t *r = &hd->hd_req;
+    struct httpd_req_aux *ra = &hd->hd_req_aux;
+    struct sock_db *sd = ra->sd;
+
+    if (uri->max_concurrency) {
+        httpd_os_mutex_lock(pool->lock);
+        bool reject = (worker_uri_load(pool, uri) >= uri->max_concurrency);
+        if (reject) {
+            pool->stats.rejected++;
+        }
+        httpd_os_mutex_unlock(pool->lock);
+        if (reject) {
+            ESP_LOGW(TAG, LOG_FMT("too many requests for URI '%s'"), r->uri);
+            httpd_resp_set_status(r, "503 Service Unavailable");
+            httpd_resp_set_type(r, HTTPD_TYPE_TEXT);
+            return httpd_resp_send(r, "Service Unavailable", HTTPD_RESP_USE_STRLEN);
+        }
+    }
+
+    /* Wait for a worker to complete a request if all the job slots are taken */
+    if (!httpd_os_sem_try_take(pool->free_jobs)) {
+        httpd_os_mutex_lock(pool->lock);
+        pool->stats.queue_full++;
+        httpd_os_mutex_unlock(pool->lock);
+        ESP_LOGD(TAG, LOG_FMT("waiting for a free worker"));
+        httpd_os_sem_take(pool->free_jobs);
+    }
+
+    httpd_os_mutex_lock(pool->lock);
+    struct httpd_worker_job *job = pool->free[--pool->free_count];
+    httpd_os_mutex_unlock(pool->lock);
+
+    /* Copy the request, with its own response headers */
+    memcpy(&job->req, r, sizeof(job->req));
+    memcpy(&job->aux, ra, sizeof(job->aux));
+    job->req.aux = &job->aux;
+    job->aux.resp_hdrs = &pool->resp_hdrs[(job - pool->jobs) * hd->config.max_resp_headers];
+    memset(job->aux.resp_hdrs, 0, hd->config.max_resp_headers * sizeof(struct resp_hdr));
+    job->handler = uri->handler;
+    job->queued_us = httpd_os_get_time_us();
+
+    /* The worker owns the session until the request is completed */
+    ESP_LOGD(TAG, LOG_FMT("handing sock %d over to a worker"), sd->fd);
+    httpd_poll_del(hd, sd);
+    sd->in_worker = true;
+    sd->worker_failed = false;
+    sd->worker_close = false;
+    sd->lru_counter = ++hd->lru_counter;
+
+    /* The request of the server task is done with, the session context
+     * is stored back into the session by the worker */
+    ra->sd = NULL;
+    r->handle = NULL;
+    r->aux = NULL;
+    r->user_ctx = NULL;
+
+    httpd_os_mutex_lock(pool->lock);
+    job->uri = uri;
+    pool->queue[(pool->queue_head + pool->stats.queued) % pool->queue_size] = job;
+    pool->stats.queued++;
+    if (pool->stats.queued > pool->stats.queued_max) {
+        pool->stats.queued_max = pool->stats.queued;
+    }
+    httpd_os_mutex_unlock(pool->lock);
+    httpd_os_sem_give(pool->queued_jobs);
+    return ESP_OK;
+}
+
+void httpd_worker_complete(struct httpd_data *hd)
+{
+    struct httpd_workers *pool = &hd->hd_workers;
+    if (!pool->workers) {
+        return;
+    }
+
+    while (1) {
+        httpd_os_mutex_lock(pool->lock);
+        struct sock_db *sd = pool->done_count ? pool->done[--pool->done_count] : NULL;
+        if (!sd) {
+            pool->wakeup_pending = false;
+        }
+        httpd_os_mutex_unlock(pool->lock);
+        if (!sd) {
+            break;
+        }
+
+        sd->in_worker = false;
+        if (sd->worker_failed || sd->worker_close) {
+            httpd_sess_delete(hd, sd);
+            continue;
+        }
+        ESP_LOGD(TAG, LOG_FMT("sock %d back from a worker"), sd->fd);
+        sd->lru_counter = ++hd->lru_counter;
+        if (httpd_poll_add(hd, sd) != ESP_OK) {
+            httpd_sess_delete(hd, sd);
+        }
+    }
+}
+
+httpd_req_t *httpd_worker_current_req(struct httpd_data *hd)
+{
+    struct httpd_workers *pool = &hd->hd_workers;
+    if (!pool->workers) {
+        return NULL;
+    }
+    othread_t self = httpd_os_thread_handle();
+    for (int i = 0; i < pool->started; i++) {
+        if (pool->workers[i].handle == self) {
+            struct httpd_worker_job *job = pool->workers[i].job;
+            return job ? &job->req : NULL;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t httpd_get_worker_stats(httpd_handle_t handle, httpd_worker_stats_t *stats)
+{
+    if (handle == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data *hd = (struct httpd_data *) handle;
+    struct httpd_workers *pool = &hd->hd_workers;
+    if (!pool->workers) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    httpd_os_mutex_lock(pool->lock);
+    *stats = pool->stats;
+    httpd_os_mutex_unlock(pool->lock);
+    return ESP_OK;
+}
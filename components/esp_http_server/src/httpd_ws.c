@@ -45,6 +45,10 @@ static const char *TAG="httpd_ws";
 #define HTTPD_WS_MASK_BIT       0x80U
 #define HTTPD_WS_LENGTH_BITS    0x7fU
 
+/* Maximum length of the header of a frame sent by the server: 2 bytes header
+ * and 8 bytes length, as the payload isn't masked */
+#define HTTPD_WS_MAX_HEADER_LEN 10
+
 /*
  * The magic GUID string used for handshake
  * Please refer to RFC6455 Section 1.3 for more details.
@@ -228,18 +232,43 @@ static esp_err_t httpd_ws_check_req(httpd_req_t *req)
     return ESP_OK;
 }
 
-static esp_err_t httpd_ws_unmask_payload(uint8_t *payload, size_t len, const uint8_t *mask_key)
+/* Machine word the payload is unmasked with, which may alias the bytes of the payload */
+typedef size_t __attribute__((__may_alias__)) httpd_ws_word_t;
+
+void httpd_ws_unmask_payload(uint8_t *payload, size_t len, const uint8_t *mask_key, size_t offset)
 {
-    if (len < 1 || !payload) {
-        ESP_LOGW(TAG, LOG_FMT("Invalid payload provided"));
-        return ESP_ERR_INVALID_ARG;
-    }
+    size_t idx = 0;
+
+    /* Bytes before the first aligned word */
+    while (idx < len && ((uintptr_t)(payload + idx) % sizeof(httpd_ws_word_t)) != 0) {
+        payload[idx] ^= mask_key[(offset + idx) % 4];
+        idx++;
+    }
+
+    size_t word_count = (len - idx) / sizeof(httpd_ws_word_t);
+    if (word_count > 0) {
+        /* The mask key repeated over a word, starting at the position of the
+         * first aligned byte. As the size of a word is a multiple of 4, the
+         * same word unmasks all the following ones */
+        uint8_t mask_bytes[sizeof(httpd_ws_word_t)];
+        for (size_t i = 0; i < sizeof(mask_bytes); i++) {
+            mask_bytes[i] = mask_key[(offset + idx + i) % 4];
+        }
+        httpd_ws_word_t mask_word;
+        memcpy(&mask_word, mask_bytes, sizeof(mask_word));
 
-    for (size_t idx = 0; idx < len; idx++) {
-        payload[idx] = (payload[idx] ^ mask_key[idx % 4]);
+        httpd_ws_word_t *words = (httpd_ws_word_t *)(payload + idx);
+        for (size_t i = 0; i < word_count; i++) {
+            words[i] ^= mask_word;
+        }
+        idx += word_count * sizeof(httpd_ws_word_t);
     }
 
-    return ESP_OK;
+    /* Bytes after the last word */
+    while (idx < len) {
+        payload[idx] ^= mask_key[(offset + idx) % 4];
+        idx++;
+    }
 }
 
 esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len)
@@ -319,6 +348,8 @@ esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t
             ESP_LOGW(TAG, LOG_FMT("WS frame is not properly masked."));
             return ESP_ERR_INVALID_STATE;
         }
+        aux->ws_payload_len = frame->len;
+        aux->ws_payload_received = 0;
     }
     /* We only accept the incoming packet length that is smaller than the max_len (or it will overflow the buffer!) */
     /* If max_len is 0, regard it OK for userspace to get frame len */
@@ -351,15 +382,48 @@ esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t
             ESP_LOGW(TAG, LOG_FMT("Failed to receive payload"));
             return ESP_FAIL;
         }
+        /* Unmask the bytes just received, while they are still in the cache */
+        httpd_ws_unmask_payload(frame->payload + offset, read_len, aux->mask_key, aux->ws_payload_received);
+        aux->ws_payload_received += read_len;
         offset += read_len;
         left_len -= read_len;
 
         ESP_LOGD(TAG, "Frame length: %"NEWLIB_NANO_COMPAT_FORMAT", Bytes Read: %"NEWLIB_NANO_COMPAT_FORMAT, NEWLIB_NANO_COMPAT_CAST(frame->len), NEWLIB_NANO_COMPAT_CAST(offset));
     }
 
-    /* Unmask payload */
-    httpd_ws_unmask_payload(frame->payload, frame->len, aux->mask_key);
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_recv_frame_chunk(httpd_req_t *req, uint8_t *buf, size_t buf_len, size_t *recv_len)
+{
+    esp_err_t ret = httpd_ws_check_req(req);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (!buf || !buf_len || !recv_len) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_req_aux *aux = req->aux;
+    *recv_len = 0;
 
+    /* The payload is received straight into the buffer of the caller, one
+     * recv() at a time, and unmasked at its position in the frame */
+    size_t left_len = aux->ws_payload_len - aux->ws_payload_received;
+    if (left_len == 0) {
+        return ESP_OK;
+    }
+
+    int read_len = httpd_recv_with_opt(req, (char *)buf, MIN(buf_len, left_len), false);
+    if (read_len <= 0) {
+        ESP_LOGW(TAG, LOG_FMT("Failed to receive payload"));
+        return ESP_FAIL;
+    }
+    httpd_ws_unmask_payload(buf, read_len, aux->mask_key, aux->ws_payload_received);
+    aux->ws_payload_received += read_len;
+    *recv_len = read_len;
     return ESP_OK;
 }
 
@@ -372,16 +436,12 @@ esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
     return httpd_ws_send_frame_async(req->handle, httpd_req_to_sockfd(req), frame);
 }
 
-esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+/* Encodes the header of a frame to be sent into header_buf, which must hold
+ * HTTPD_WS_MAX_HEADER_LEN bytes, and returns its length */
+static size_t httpd_ws_encode_header(const httpd_ws_frame_t *frame, uint8_t *header_buf)
 {
-    if (!frame) {
-        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    /* Prepare Tx buffer - maximum length is 14, which includes 2 bytes header, 8 bytes length, 4 bytes mask key */
-    uint8_t tx_len = 0;
-    uint8_t header_buf[10] = {0 };
+    size_t tx_len = 0;
+    memset(header_buf, 0, HTTPD_WS_MAX_HEADER_LEN);
     /* Set the `FIN` bit by default if message is not fragmented. Else, set it as per the `final` field */
     header_buf[0] |= (!frame->fragmented) ? HTTPD_WS_FIN_BIT : (frame->final? HTTPD_WS_FIN_BIT: HTTPD_WS_CONTINUE);
     header_buf[0] |= frame->type; /* Type (opcode): 4 bits */
@@ -409,6 +469,42 @@ esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t
 
     /* WebSocket server does not required to mask response payload, so leave the MASK bit as 0. */
     header_buf[1] &= (~HTTPD_WS_MASK_BIT);
+    return tx_len;
+}
+
+/* The header of a frame is sent with MSG_MORE where the TCP stack supports it,
+ * so that it goes out in the same segment as the start of the payload */
+#ifdef MSG_MORE
+#define HTTPD_WS_MSG_MORE   MSG_MORE
+#else
+#define HTTPD_WS_MSG_MORE   0
+#endif
+
+/* Sends the whole buffer to a session, as send_fn may send only a part of it */
+static esp_err_t httpd_ws_send_all(httpd_handle_t hd, struct sock_db *sess, const uint8_t *buf, size_t buf_len,
+                                   int flags)
+{
+    while (buf_len > 0) {
+        int ret = sess->send_fn(hd, sess->fd, (const char *)buf, buf_len, flags);
+        /* A send function which makes no progress would otherwise keep this loop spinning */
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        buf     += ret;
+        buf_len -= ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    if (!frame) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t header_buf[HTTPD_WS_MAX_HEADER_LEN];
+    size_t tx_len = httpd_ws_encode_header(frame, header_buf);
 
     struct sock_db *sess = httpd_sess_get(hd, fd);
     if (!sess) {
@@ -416,14 +512,15 @@ esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t
     }
 
     /* Send off header */
-    if (sess->send_fn(hd, fd, (const char *)header_buf, tx_len, 0) < 0) {
+    bool payload = (frame->len > 0 && frame->payload != NULL);
+    if (httpd_ws_send_all(hd, sess, header_buf, tx_len, payload ? HTTPD_WS_MSG_MORE : 0) != ESP_OK) {
         ESP_LOGW(TAG, LOG_FMT("Failed to send WS header"));
         return ESP_FAIL;
     }
 
     /* Send off payload */
-    if(frame->len > 0 && frame->payload != NULL) {
-        if (sess->send_fn(hd, fd, (const char *)frame->payload, frame->len, 0) < 0) {
+    if (payload) {
+        if (httpd_ws_send_all(hd, sess, frame->payload, frame->len, 0) != ESP_OK) {
             ESP_LOGW(TAG, LOG_FMT("Failed to send WS payload"));
             return ESP_FAIL;
         }
@@ -432,6 +529,78 @@ esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t
     return ESP_OK;
 }
 
+typedef struct {
+    httpd_handle_t handle;
+    const uint8_t *header;      /* Header encoded once for all the clients */
+    size_t header_len;
+    const uint8_t *payload;     /* Payload of the caller, sent after the header, NULL if empty */
+    size_t payload_len;
+    size_t sent_count;
+    size_t fail_count;
+} ws_broadcast_t;
+
+static void httpd_ws_broadcast_to(ws_broadcast_t *broadcast, struct sock_db *sess)
+{
+    int flags = broadcast->payload ? HTTPD_WS_MSG_MORE : 0;
+    if (httpd_ws_send_all(broadcast->handle, sess, broadcast->header, broadcast->header_len, flags) != ESP_OK ||
+        (broadcast->payload &&
+         httpd_ws_send_all(broadcast->handle, sess, broadcast->payload, broadcast->payload_len, 0) != ESP_OK)) {
+        ESP_LOGW(TAG, LOG_FMT("Failed to send WS frame to fd %d"), sess->fd);
+        broadcast->fail_count++;
+        return;
+    }
+    broadcast->sent_count++;
+}
+
+static int httpd_ws_broadcast_enum(struct sock_db *session, void *context)
+{
+    if (session->fd >= 0 && session->ws_handshake_done && !session->ws_close) {
+        httpd_ws_broadcast_to(context, session);
+    }
+    return 1;
+}
+
+esp_err_t httpd_ws_broadcast(httpd_handle_t hd, const int *fds, size_t fd_count,
+                             httpd_ws_frame_t *frame, size_t *sent_count)
+{
+    if (!hd || !frame || (frame->len > 0 && !frame->payload)) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sent_count) {
+        *sent_count = 0;
+    }
+
+    uint8_t header_buf[HTTPD_WS_MAX_HEADER_LEN];
+    size_t header_len = httpd_ws_encode_header(frame, header_buf);
+    ws_broadcast_t broadcast = {
+        .handle = hd,
+        .header = header_buf,
+        .header_len = header_len,
+        .payload = frame->len > 0 ? frame->payload : NULL,
+        .payload_len = frame->len,
+    };
+
+    if (fds) {
+        for (size_t i = 0; i < fd_count; i++) {
+            struct sock_db *sess = httpd_sess_get(hd, fds[i]);
+            if (!sess || !sess->ws_handshake_done || sess->ws_close) {
+                ESP_LOGW(TAG, LOG_FMT("fd %d is not a WebSocket client"), fds[i]);
+                broadcast.fail_count++;
+                continue;
+            }
+            httpd_ws_broadcast_to(&broadcast, sess);
+        }
+    } else {
+        httpd_sess_enum(hd, httpd_ws_broadcast_enum, &broadcast);
+    }
+
+    if (sent_count) {
+        *sent_count = broadcast.sent_count;
+    }
+    return broadcast.fail_count ? ESP_FAIL : ESP_OK;
+}
+
 esp_err_t httpd_ws_get_frame_type(httpd_req_t *req)
 {
     esp_err_t ret = httpd_ws_check_req(req);
@@ -460,6 +629,8 @@ esp_err_t httpd_ws_get_frame_type(httpd_req_t *req)
         ESP_LOGW(TAG, LOG_FMT("Failed to read header byte (socket FD invalid), closing socket now"));
         aux->ws_final = true;
         aux->ws_type = HTTPD_WS_TYPE_CLOSE;
+        aux->ws_payload_len = 0;
+        aux->ws_payload_received = 0;
         return ESP_OK;
     }
 
@@ -469,6 +640,10 @@ esp_err_t httpd_ws_get_frame_type(httpd_req_t *req)
     aux->ws_final = (first_byte & HTTPD_WS_FIN_BIT) != 0;
     aux->ws_type = (first_byte & HTTPD_WS_OPCODE_BITS);
 
+    /* The length of the payload is known once the rest of the header is received */
+    aux->ws_payload_len = 0;
+    aux->ws_payload_received = 0;
+
     /* If userspace requests control frames, do not deal with the control frames */
     if (!sd->ws_control_frames) {
         ESP_LOGD(TAG, LOG_FMT("Handler not requests control frames"));
@@ -9,8 +9,10 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <esp_timer.h>
 
 #ifdef __cplusplus
@@ -21,6 +23,8 @@ extern "C" {
 #define OS_FAIL    ESP_FAIL
 
 typedef TaskHandle_t othread_t;
+typedef SemaphoreHandle_t osem_t;
+typedef SemaphoreHandle_t omutex_t;
 
 static inline int httpd_os_thread_create(othread_t *thread,
                                  const char *name, uint16_t stacksize, int prio,
@@ -50,6 +54,58 @@ static inline othread_t httpd_os_thread_handle(void)
     return xTaskGetCurrentTaskHandle();
 }
 
+static inline int httpd_os_sem_create(osem_t *sem, unsigned max_count, unsigned initial_count)
+{
+    *sem = xSemaphoreCreateCounting(max_count, initial_count);
+    return *sem ? OS_SUCCESS : OS_FAIL;
+}
+
+static inline void httpd_os_sem_take(osem_t sem)
+{
+    xSemaphoreTake(sem, portMAX_DELAY);
+}
+
+static inline bool httpd_os_sem_try_take(osem_t sem)
+{
+    return xSemaphoreTake(sem, 0) == pdTRUE;
+}
+
+static inline void httpd_os_sem_give(osem_t sem)
+{
+    xSemaphoreGive(sem);
+}
+
+static inline void httpd_os_sem_delete(osem_t sem)
+{
+    vSemaphoreDelete(sem);
+}
+
+static inline int httpd_os_mutex_create(omutex_t *mutex)
+{
+    *mutex = xSemaphoreCreateMutex();
+    return *mutex ? OS_SUCCESS : OS_FAIL;
+}
+
+static inline void httpd_os_mutex_lock(omutex_t mutex)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+static inline void httpd_os_mutex_unlock(omutex_t mutex)
+{
+    xSemaphoreGive(mutex);
+}
+
+static inline void httpd_os_mutex_delete(omutex_t mutex)
+{
+    vSemaphoreDelete(mutex);
+}
+
+static inline int64_t httpd_os_get_time_us(void)
+{
+    return esp_timer_get_time();
+}
+
 #ifdef __cplusplus
 }
 #endif
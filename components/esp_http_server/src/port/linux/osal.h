@@ -7,6 +7,9 @@
 
 #include <unistd.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
 #include <pthread.h>
 
 #ifdef __cplusplus
@@ -18,6 +21,16 @@ extern "C" {
 
 typedef TaskHandle_t othread_t;
 
+/* The server and worker threads are not FreeRTOS tasks, so they are synchronized
+ * with pthread primitives */
+struct httpd_os_sem {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned count;
+};
+typedef struct httpd_os_sem *osem_t;
+typedef pthread_mutex_t *omutex_t;
+
 static inline int httpd_os_thread_create(othread_t *thread,
                                  const char *name, uint16_t stacksize, int prio,
                                  void (*thread_routine)(void *arg), void *arg,
@@ -50,6 +63,87 @@ static inline othread_t httpd_os_thread_handle(void)
     return (othread_t)pthread_self();
 }
 
+static inline int httpd_os_sem_create(osem_t *sem, unsigned max_count, unsigned initial_count)
+{
+    *sem = malloc(sizeof(struct httpd_os_sem));
+    if (*sem == NULL) {
+        return OS_FAIL;
+    }
+    pthread_mutex_init(&(*sem)->lock, NULL);
+    pthread_cond_init(&(*sem)->cond, NULL);
+    (*sem)->count = initial_count;
+    return OS_SUCCESS;
+}
+
+static inline void httpd_os_sem_take(osem_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0) {
+        pthread_cond_wait(&sem->cond, &sem->lock);
+    }
+    sem->count--;
+    pthread_mutex_unlock(&sem->lock);
+}
+
+static inline bool httpd_os_sem_try_take(osem_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool taken = (sem->count != 0);
+    if (taken) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return taken;
+}
+
+static inline void httpd_os_sem_give(osem_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    sem->count++;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->lock);
+}
+
+static inline void httpd_os_sem_delete(osem_t sem)
+{
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->lock);
+    free(sem);
+}
+
+static inline int httpd_os_mutex_create(omutex_t *mutex)
+{
+    *mutex = malloc(sizeof(pthread_mutex_t));
+    if (*mutex == NULL) {
+        return OS_FAIL;
+    }
+    pthread_mutex_init(*mutex, NULL);
+    return OS_SUCCESS;
+}
+
+static inline void httpd_os_mutex_lock(omutex_t mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+static inline void httpd_os_mutex_unlock(omutex_t mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+static inline void httpd_os_mutex_delete(omutex_t mutex)
+{
+    pthread_mutex_destroy(mutex);
+    free(mutex);
+}
+
+static inline int64_t httpd_os_get_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 #ifdef __cplusplus
 }
 #endif
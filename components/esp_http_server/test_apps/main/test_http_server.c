@@ -6,9 +6,11 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <esp_system.h>
 #include <esp_http_server.h>
 
+#include "lwip/sockets.h"
 #include "unity.h"
 #include "test_utils.h"
 
@@ -225,6 +227,54 @@ TEST_CASE("URI Wildcard Matcher Tests", "[HTTP SERVER]")
     }
 }
 
+static bool s_worker_handler_on_worker;
+
+static esp_err_t worker_sess_ctx_handler(httpd_req_t *req)
+{
+    s_worker_handler_on_worker = (strcmp(pcTaskGetName(NULL), "httpd_worker") == 0);
+
+    /* Count the requests of the session in its context */
+    if (!req->sess_ctx) {
+        req->sess_ctx = calloc(1, sizeof(int));
+        req->free_ctx = free;
+        if (!req->sess_ctx) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    int *count = req->sess_ctx;
+    char body[8];
+    snprintf(body, sizeof(body), "%d", ++*count);
+    return httpd_resp_sendstr(req, body);
+}
+
+/* Sends a GET request on the socket and returns the body of the response */
+static void worker_get(int sock, const char *uri, char *body, size_t size)
+{
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", uri);
+    TEST_ASSERT_EQUAL(len, send(sock, buf, len, 0));
+
+    /* Read the headers and then the number of bytes of their Content-Length */
+    size_t received = 0;
+    char *content = NULL;
+    size_t content_len = 0;
+    while (!content || received - (content - buf) < content_len) {
+        int ret = recv(sock, buf + received, sizeof(buf) - 1 - received, 0);
+        TEST_ASSERT_GREATER_THAN(0, ret);
+        received += ret;
+        buf[received] = '\0';
+        char *end = strstr(buf, "\r\n\r\n");
+        if (!content && end) {
+            content = end + 4;
+            char *field = strstr(buf, "Content-Length: ");
+            TEST_ASSERT_NOT_NULL(field);
+            content_len = atoi(field + strlen("Content-Length: "));
+        }
+    }
+    TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 200 OK", buf, strlen("HTTP/1.1 200 OK"));
+    strlcpy(body, content, size);
+}
+
 TEST_CASE("Max Allowed Sockets Test", "[HTTP SERVER]")
 {
     test_case_uses_tcpip();
@@ -244,6 +294,89 @@ TEST_CASE("Max Allowed Sockets Test", "[HTTP SERVER]")
     TEST_ASSERT(httpd_start(&hd, &config) != ESP_OK);
 }
 
+TEST_CASE("Worker Tasks Test", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_worker_stats_t stats;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+
+    /* Without workers, the handlers run on the server task */
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    TEST_ASSERT(httpd_get_worker_stats(hd, &stats) == ESP_ERR_INVALID_STATE);
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+
+    /* The worker tasks are started with the server and stopped with it */
+    unsigned task_count = uxTaskGetNumberOfTasks();
+    config.worker_count = 2;
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    vTaskDelay(10);
+    TEST_ASSERT_EQUAL(task_count + 1 + config.worker_count, uxTaskGetNumberOfTasks());
+
+    TEST_ASSERT(httpd_get_worker_stats(hd, &stats) == ESP_OK);
+    TEST_ASSERT_EQUAL(0, stats.completed);
+    TEST_ASSERT_EQUAL(0, stats.queued);
+    TEST_ASSERT(httpd_get_worker_stats(hd, NULL) == ESP_ERR_INVALID_ARG);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    vTaskDelay(10);
+    TEST_ASSERT_EQUAL(task_count, uxTaskGetNumberOfTasks());
+}
+
+TEST_CASE("Worker Tasks Session Context Test", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_worker_stats_t stats;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.worker_count = 2;
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+
+    httpd_uri_t uri = {
+        .uri      = "/worker",
+        .method   = HTTP_GET,
+        .handler  = worker_sess_ctx_handler,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    TEST_ASSERT(sock >= 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config.server_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    TEST_ASSERT_EQUAL(0, connect(sock, (struct sockaddr *)&addr, sizeof(addr)));
+
+    /* Both requests of the connection are handled on a worker, and the context
+     * set by the first one is given back to the second one */
+    char body[8];
+    s_worker_handler_on_worker = false;
+    worker_get(sock, "/worker", body, sizeof(body));
+    TEST_ASSERT(s_worker_handler_on_worker);
+    TEST_ASSERT_EQUAL_STRING("1", body);
+
+    s_worker_handler_on_worker = false;
+    worker_get(sock, "/worker", body, sizeof(body));
+    TEST_ASSERT(s_worker_handler_on_worker);
+    TEST_ASSERT_EQUAL_STRING("2", body);
+    close(sock);
+
+    /* The worker counts the request once the response is sent */
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT(httpd_get_worker_stats(hd, &stats) == ESP_OK);
+        if (stats.completed == 2) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    TEST_ASSERT_EQUAL(2, stats.completed);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
 void app_main(void)
 {
     unity_run_menu();
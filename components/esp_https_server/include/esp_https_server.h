@@ -142,7 +142,11 @@ typedef struct httpd_ssl_config httpd_ssl_config_t;
         .keep_alive_count = 0,                    \
         .open_fn = NULL,                          \
         .close_fn = NULL,                         \
-        .uri_match_fn = NULL                      \
+        .uri_match_fn = NULL,                     \
+        .worker_count = 0,                        \
+        .worker_queue_size = 4,                   \
+        .worker_stack_size = 4096,                \
+        .worker_task_priority = tskIDLE_PRIORITY+5, \
     },                                            \
     .servercert = NULL,                           \
     .servercert_len = 0,                          \
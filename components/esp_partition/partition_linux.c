@@ -538,6 +538,11 @@ static size_t s_esp_partition_stat_block_erase_time = 37142;
 static size_t esp_partition_stat_time_interpolate(uint32_t bytes, size_t *lut)
 {
     const int lut_size = sizeof(s_esp_partition_stat_read_times) / sizeof(s_esp_partition_stat_read_times[0]);
+    const uint32_t lut_max_bytes = 4 << (lut_size - 1);
+    if (bytes > lut_max_bytes) {
+        // larger operations are timed as a sequence of blocks of the largest size in the table
+        return (size_t) (((uint64_t) bytes * lut[lut_size - 1]) / lut_max_bytes);
+    }
     int lz = __builtin_clz(bytes / 4);
     int log_size = 32 - lz;
     size_t x2 = 1 << (log_size + 2);
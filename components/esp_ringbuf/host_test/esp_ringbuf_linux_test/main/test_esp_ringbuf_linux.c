@@ -0,0 +1,226 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+#include "unity.h"
+
+#define BUFFER_SIZE         1024
+#define MAX_ITEMS           16
+
+typedef struct {
+    RingbufHandle_t buffer;
+    RingbufferType_t type;
+    size_t item_size;           // size of the items sent, random sizes up to the maximum item size if 0
+    size_t total_size;          // number of bytes to transfer
+    UBaseType_t max_items;      // maximum number of items received at once, xRingbufferReceive is used if 1
+    SemaphoreHandle_t done;
+    int errors;                 // number of bytes received out of order
+    UBaseType_t items_received;
+} transfer_t;
+
+static uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* The n-th byte of the transferred data */
+static inline uint8_t data_byte(size_t n)
+{
+    return (uint8_t)(n * 7 + (n >> 8));
+}
+
+static void producer_task(void *arg)
+{
+    transfer_t *transfer = (transfer_t *) arg;
+    size_t max_size = xRingbufferGetMaxItemSize(transfer->buffer);
+    uint8_t *item = malloc(max_size);
+    size_t sent = 0;
+
+    while (sent < transfer->total_size) {
+        size_t size = transfer->item_size ? transfer->item_size : (size_t) rand() % (max_size + 1);
+        if (size > transfer->total_size - sent) {
+            size = transfer->total_size - sent;
+        }
+        for (size_t i = 0; i < size; i++) {
+            item[i] = data_byte(sent + i);
+        }
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(transfer->buffer, item, size, portMAX_DELAY));
+        sent += size;
+    }
+    free(item);
+    xSemaphoreGive(transfer->done);
+    vTaskDelete(NULL);
+}
+
+static void consumer_task(void *arg)
+{
+    transfer_t *transfer = (transfer_t *) arg;
+    void *items[MAX_ITEMS];
+    size_t sizes[MAX_ITEMS];
+    size_t received = 0;
+
+    while (received < transfer->total_size) {
+        UBaseType_t count;
+        if (transfer->max_items > 1) {
+            count = xRingbufferReceiveMany(transfer->buffer, items, sizes, transfer->max_items, portMAX_DELAY);
+        } else if (transfer->type == RINGBUF_TYPE_BYTEBUF) {
+            items[0] = xRingbufferReceiveUpTo(transfer->buffer, &sizes[0], portMAX_DELAY, BUFFER_SIZE / 4);
+            count = (items[0] != NULL) ? 1 : 0;
+        } else {
+            items[0] = xRingbufferReceive(transfer->buffer, &sizes[0], portMAX_DELAY);
+            count = (items[0] != NULL) ? 1 : 0;
+        }
+        for (UBaseType_t j = 0; j < count; j++) {
+            const uint8_t *data = (const uint8_t *) items[j];
+            for (size_t i = 0; i < sizes[j]; i++) {
+                if (data[i] != data_byte(received + i)) {
+                    transfer->errors++;
+                }
+            }
+            received += sizes[j];
+            vRingbufferReturnItem(transfer->buffer, items[j]);
+        }
+        transfer->items_received += count;
+    }
+    xSemaphoreGive(transfer->done);
+    vTaskDelete(NULL);
+}
+
+/* Transfers the data from a producer task to a consumer task, returns the time taken in ns */
+static uint64_t run_transfer(transfer_t *transfer, UBaseType_t producer_priority)
+{
+    transfer->done = xSemaphoreCreateCounting(2, 0);
+    transfer->errors = 0;
+    transfer->items_received = 0;
+    srand(1);
+
+    uint64_t start = host_time_ns();
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(consumer_task, "consumer", 4096, transfer, 5, NULL));
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(producer_task, "producer", 4096, transfer, producer_priority, NULL));
+    TEST_ASSERT_TRUE(xSemaphoreTake(transfer->done, pdMS_TO_TICKS(60000)));
+    TEST_ASSERT_TRUE(xSemaphoreTake(transfer->done, pdMS_TO_TICKS(60000)));
+    uint64_t elapsed = host_time_ns() - start;
+
+    vSemaphoreDelete(transfer->done);
+    vTaskDelay(2);  // let the idle task free the tasks
+    TEST_ASSERT_EQUAL(0, transfer->errors);
+    return elapsed;
+}
+
+static void test_transfer(RingbufferType_t type, bool spsc, UBaseType_t max_items)
+{
+    transfer_t transfer = {
+        .type = type,
+        .total_size = 256 * 1024,
+        .max_items = max_items,
+    };
+    // the producer blocks on a full buffer, then on an empty one
+    for (UBaseType_t priority = 4; priority <= 6; priority++) {
+        transfer.buffer = spsc ? xRingbufferCreateSPSC(BUFFER_SIZE, type) : xRingbufferCreate(BUFFER_SIZE, type);
+        TEST_ASSERT_NOT_NULL(transfer.buffer);
+        run_transfer(&transfer, priority);
+
+        UBaseType_t items_waiting;
+        vRingbufferGetInfo(transfer.buffer, NULL, NULL, NULL, NULL, &items_waiting);
+        TEST_ASSERT_EQUAL(0, items_waiting);
+        vRingbufferDelete(transfer.buffer);
+    }
+}
+
+TEST_CASE("SPSC no-split ring buffer transfers random sized items", "[esp_ringbuf]")
+{
+    test_transfer(RINGBUF_TYPE_NOSPLIT, true, 1);
+}
+
+TEST_CASE("SPSC byte buffer transfers random sized items", "[esp_ringbuf]")
+{
+    test_transfer(RINGBUF_TYPE_BYTEBUF, true, 1);
+}
+
+TEST_CASE("xRingbufferReceiveMany transfers random sized items", "[esp_ringbuf]")
+{
+    test_transfer(RINGBUF_TYPE_NOSPLIT, false, MAX_ITEMS);
+    test_transfer(RINGBUF_TYPE_NOSPLIT, true, MAX_ITEMS);
+}
+
+TEST_CASE("SPSC ring buffer maximum size item fits in an empty buffer", "[esp_ringbuf]")
+{
+    static uint8_t item[BUFFER_SIZE];
+    RingbufHandle_t buffer = xRingbufferCreateSPSC(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    size_t max_size = xRingbufferGetMaxItemSize(buffer);
+    size_t size;
+
+    // move the read and write pointers around the buffer, by a different offset on each round
+    for (size_t offset = 0; offset < BUFFER_SIZE; offset += 4) {
+        TEST_ASSERT_EQUAL(max_size, xRingbufferGetCurFreeSize(buffer));
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(buffer, item, max_size, 0));
+        TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSend(buffer, item, max_size, 0));
+        void *received = xRingbufferReceive(buffer, &size, 0);
+        TEST_ASSERT_NOT_NULL(received);
+        TEST_ASSERT_EQUAL(max_size, size);
+        vRingbufferReturnItem(buffer, received);
+
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(buffer, item, 4, 0));
+        received = xRingbufferReceive(buffer, &size, 0);
+        TEST_ASSERT_NOT_NULL(received);
+        TEST_ASSERT_EQUAL(4, size);
+        vRingbufferReturnItem(buffer, received);
+    }
+    TEST_ASSERT_NULL(xRingbufferReceive(buffer, &size, 0));
+    vRingbufferDelete(buffer);
+}
+
+/* Compares the throughput of the ring buffer modes, with a producer task sending items of the
+ * same size to a consumer task of the same priority.
+ */
+TEST_CASE("ring buffer benchmark", "[esp_ringbuf][bench]")
+{
+    const struct {
+        const char *name;
+        RingbufferType_t type;
+        bool spsc;
+        UBaseType_t max_items;
+    } modes[] = {
+        { "no-split",           RINGBUF_TYPE_NOSPLIT, false, 1 },
+        { "no-split many",      RINGBUF_TYPE_NOSPLIT, false, MAX_ITEMS },
+        { "spsc no-split",      RINGBUF_TYPE_NOSPLIT, true,  1 },
+        { "spsc no-split many", RINGBUF_TYPE_NOSPLIT, true,  MAX_ITEMS },
+        { "byte buffer",        RINGBUF_TYPE_BYTEBUF, false, 1 },
+        { "spsc byte buffer",   RINGBUF_TYPE_BYTEBUF, true,  1 },
+    };
+    const size_t item_sizes[] = { 4, 32, 128 };
+
+    printf("%-20s %10s %14s\n", "mode", "item size", "items/s");
+    for (int m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        for (int s = 0; s < sizeof(item_sizes) / sizeof(item_sizes[0]); s++) {
+            transfer_t transfer = {
+                .type = modes[m].type,
+                .item_size = item_sizes[s],
+                .total_size = 200000 * item_sizes[s],
+                .max_items = modes[m].max_items,
+            };
+            transfer.buffer = modes[m].spsc ? xRingbufferCreateSPSC(BUFFER_SIZE, modes[m].type) : xRingbufferCreate(BUFFER_SIZE, modes[m].type);
+            TEST_ASSERT_NOT_NULL(transfer.buffer);
+            uint64_t elapsed_ns = run_transfer(&transfer, 5);
+            vRingbufferDelete(transfer.buffer);
+            printf("%-20s %10zu %14.0f\n", modes[m].name, item_sizes[s], 200000 * 1e9 / elapsed_ns);
+        }
+    }
+}
+
+void app_main(void)
+{
+    printf("Running esp_ringbuf linux host test app\n");
+    unity_run_menu();
+}
@@ -59,6 +59,8 @@ typedef struct xSTATIC_RINGBUFFER {
     UBaseType_t uxDummy2;
     void *pvDummy3[11];
     BaseType_t xDummy4;
+    UBaseType_t uxDummy7[2];
+    BaseType_t xDummy8[2];
     StaticList_t xDummy5[2];
     void * pvDummy6;
     portMUX_TYPE muxDummy;
@@ -111,6 +113,50 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
                                         uint8_t *pucRingbufferStorage,
                                         StaticRingbuffer_t *pxStaticRingbuffer);
 
+/**
+ * @brief       Create a single producer/single consumer ring buffer
+ *
+ * This API is similar to xRingbufferCreate(), but the ring buffer can only be
+ * used by one producer (a task or an ISR sending items) and one consumer (a task
+ * or an ISR receiving and returning items) at a time. Sending, receiving and
+ * returning items then only synchronize through atomic accesses to the read and
+ * write pointers of the ring buffer, instead of a critical section. The critical
+ * section is only entered to block, or to unblock the other side when it is blocked.
+ *
+ * @param[in]   xBufferSize Size of the buffer in bytes. Note that items require
+ *              space for a header in no-split buffers
+ * @param[in]   xBufferType Type of ring buffer, RINGBUF_TYPE_NOSPLIT or RINGBUF_TYPE_BYTEBUF.
+ *
+ * @note    xBufferSize of no-split buffers will be rounded up to the nearest 32-bit aligned size.
+ * @note    The ring buffer is never completely filled, to tell it apart from an empty one.
+ *          The maximum item size is 1 byte less than xBufferSize for byte buffers, and up
+ *          to 4 bytes less than for a no-split buffer of the same size created by xRingbufferCreate().
+ *
+ * @return  A handle to the created ring buffer, or NULL in case of error.
+ */
+RingbufHandle_t xRingbufferCreateSPSC(size_t xBufferSize, RingbufferType_t xBufferType);
+
+/**
+ * @brief       Create a single producer/single consumer ring buffer but manually provide the required memory
+ *
+ * See xRingbufferCreateSPSC() and xRingbufferCreateStatic().
+ *
+ * @param[in]   xBufferSize Size of the buffer in bytes.
+ * @param[in]   xBufferType Type of ring buffer, RINGBUF_TYPE_NOSPLIT or RINGBUF_TYPE_BYTEBUF.
+ * @param[in]   pucRingbufferStorage Pointer to the ring buffer's storage area.
+ *              Storage area must have the same size as specified by xBufferSize
+ * @param[in]   pxStaticRingbuffer Pointed to a struct of type StaticRingbuffer_t
+ *              which will be used to hold the ring buffer's data structure
+ *
+ * @note    xBufferSize of no-split buffers MUST be 32-bit aligned.
+ *
+ * @return  A handle to the created ring buffer
+ */
+RingbufHandle_t xRingbufferCreateStaticSPSC(size_t xBufferSize,
+                                            RingbufferType_t xBufferType,
+                                            uint8_t *pucRingbufferStorage,
+                                            StaticRingbuffer_t *pxStaticRingbuffer);
+
 /**
  * @brief       Insert an item into the ring buffer
  *
@@ -255,6 +301,51 @@ void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickTy
  */
 void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize);
 
+/**
+ * @brief   Retrieve multiple items from a no-split ring buffer
+ *
+ * Attempt to retrieve up to uxMaxItems items from the ring buffer. This function
+ * will block until at least one item is available or until it times out, then
+ * retrieves all the items available, up to uxMaxItems, at once.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  ppvItems        Array of uxMaxItems pointers to which the retrieved items will be written.
+ * @param[out]  pxItemSizes     Array of uxMaxItems variables to which the sizes of the retrieved items will be written.
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve.
+ * @param[in]   xTicksToWait    Ticks to wait for items in the ring buffer.
+ *
+ * @note    A call to vRingbufferReturnItem() is required for each item retrieved.
+ * @note    This function should only be called on no-split buffers
+ *
+ * @return  Number of items retrieved, 0 on timeout.
+ */
+UBaseType_t xRingbufferReceiveMany(RingbufHandle_t xRingbuffer,
+                                   void **ppvItems,
+                                   size_t *pxItemSizes,
+                                   UBaseType_t uxMaxItems,
+                                   TickType_t xTicksToWait);
+
+/**
+ * @brief   Retrieve multiple items from a no-split ring buffer in an ISR
+ *
+ * Attempt to retrieve up to uxMaxItems items from the ring buffer. This function
+ * returns immediately if there are no items available for retrieval.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  ppvItems        Array of uxMaxItems pointers to which the retrieved items will be written.
+ * @param[out]  pxItemSizes     Array of uxMaxItems variables to which the sizes of the retrieved items will be written.
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve.
+ *
+ * @note    A call to vRingbufferReturnItemFromISR() is required for each item retrieved.
+ * @note    This function should only be called on no-split buffers
+ *
+ * @return  Number of items retrieved, 0 when the ring buffer is empty.
+ */
+UBaseType_t xRingbufferReceiveManyFromISR(RingbufHandle_t xRingbuffer,
+                                          void **ppvItems,
+                                          size_t *pxItemSizes,
+                                          UBaseType_t uxMaxItems);
+
 /**
  * @brief   Retrieve a split item from an allow-split ring buffer
  *
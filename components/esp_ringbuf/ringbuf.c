@@ -26,6 +26,7 @@
 #define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
 #define rbBUFFER_STATIC_FLAG        ( ( UBaseType_t ) 8 )   //The ring buffer is statically allocated
 #define rbUSING_QUEUE_SET           ( ( UBaseType_t ) 16 )  //The ring buffer has been added to a queue set
+#define rbSPSC_FLAG                 ( ( UBaseType_t ) 32 )  //The ring buffer has a single producer and a single consumer
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
@@ -67,6 +68,10 @@ typedef struct RingbufferDefinition {
     uint8_t *pucTail;                           //Pointer to the end of the ring buffer storage area
 
     BaseType_t xItemsWaiting;                   //Number of items/bytes(for byte buffers) currently in ring buffer that have not yet been read
+    UBaseType_t uxItemsSent;                    //Single producer/single consumer only. Number of items/bytes sent, only written by the producer
+    UBaseType_t uxItemsReceived;                //Single producer/single consumer only. Number of items/bytes received, only written by the consumer
+    BaseType_t xSenderWaiting;                  //Single producer/single consumer only. The producer is blocked, or about to block, on xTasksWaitingToSend
+    BaseType_t xReceiverWaiting;                //Single producer/single consumer only. The consumer is blocked, or about to block, on xTasksWaitingToReceive
     List_t xTasksWaitingToSend;                 //List of tasks that are blocked waiting to send/acquire onto this ring buffer. Stored in priority order.
     List_t xTasksWaitingToReceive;              //List of tasks that are blocked waiting to receive from this ring buffer. Stored in priority order.
     QueueSetHandle_t xQueueSet;                 //Ring buffer's read queue set handle.
@@ -201,6 +206,23 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            size_t *xItemSize2,
                                            size_t xMaxSize);
 
+//Retrieve all available items from a no-split ring buffer, up to uxMaxItems. Returns the number of items retrieved
+static UBaseType_t prvGetItemsNoSplit(Ringbuffer_t *pxRingbuffer,
+                                      void **ppvItems,
+                                      size_t *pxItemSizes,
+                                      UBaseType_t uxMaxItems);
+
+/*
+Generic function used to retrieve multiple items from no-split ring buffers. Blocks
+until at least one item is available, then retrieves all available items up to
+uxMaxItems. Returns the number of items retrieved.
+*/
+static UBaseType_t prvReceiveManyGeneric(Ringbuffer_t *pxRingbuffer,
+                                         void **ppvItems,
+                                         size_t *pxItemSizes,
+                                         UBaseType_t uxMaxItems,
+                                         TickType_t xTicksToWait);
+
 // ------------------------------------------------ Static Functions ---------------------------------------------------
 
 static void prvInitializeNewRingbuffer(size_t xBufferSize,
@@ -614,9 +636,14 @@ static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
      * till the read pointer. When advancing the free pointer, items that have already been
      * freed or items with dummy data should be skipped over
      */
+    BaseType_t xFreeMoved = pdFALSE;
+    //If a full buffer has been read entirely, the free pointer starts at the read pointer
+    BaseType_t xReadEntirely = ((pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) && pxRingbuffer->pucFree == pxRingbuffer->pucRead) ? pdTRUE : pdFALSE;
     pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucFree;
     //Skip over Items that have already been freed or are dummy items
-    while (((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) || (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) && pxRingbuffer->pucFree != pxRingbuffer->pucRead) {
+    while (((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) || (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) && (pxRingbuffer->pucFree != pxRingbuffer->pucRead || xReadEntirely == pdTRUE)) {
+        xReadEntirely = pdFALSE;
+        xFreeMoved = pdTRUE;
         if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
             pxCurHeader->uxItemFlags |= rbITEM_FREE_FLAG;   //Mark as freed (not strictly necessary but adds redundancy)
             pxRingbuffer->pucFree = pxRingbuffer->pucHead;    //Wrap around due to dummy data
@@ -634,14 +661,10 @@ static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
         pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucFree;      //Update header to point to item
     }
 
-    //Check if the buffer full flag should be reset
-    if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
-        if (pxRingbuffer->pucFree != pxRingbuffer->pucAcquire) {
-            pxRingbuffer->uxRingbufferFlags &= ~rbBUFFER_FULL_FLAG;
-        } else if (pxRingbuffer->pucFree == pxRingbuffer->pucAcquire && pxRingbuffer->pucFree == pxRingbuffer->pucRead) {
-            //Special case where a full buffer is completely freed in one go
-            pxRingbuffer->uxRingbufferFlags &= ~rbBUFFER_FULL_FLAG;
-        }
+    //Reset the buffer full flag if the free pointer has moved. It may have moved all the way around, back to where it was,
+    //if a full buffer is completely freed in one go
+    if ((pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) && xFreeMoved) {
+        pxRingbuffer->uxRingbufferFlags &= ~rbBUFFER_FULL_FLAG;
     }
 }
 
@@ -923,6 +946,548 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
     return xReturn;
 }
 
+static UBaseType_t prvGetItemsNoSplit(Ringbuffer_t *pxRingbuffer,
+                                      void **ppvItems,
+                                      size_t *pxItemSizes,
+                                      UBaseType_t uxMaxItems)
+{
+    UBaseType_t uxCount = 0;
+    BaseType_t xIsSplit;
+    while (uxCount < uxMaxItems && prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+        ppvItems[uxCount] = prvGetItemDefault(pxRingbuffer, &xIsSplit, 0, &pxItemSizes[uxCount]);
+        uxCount++;
+    }
+    return uxCount;
+}
+
+static UBaseType_t prvReceiveManyGeneric(Ringbuffer_t *pxRingbuffer,
+                                         void **ppvItems,
+                                         size_t *pxItemSizes,
+                                         UBaseType_t uxMaxItems,
+                                         TickType_t xTicksToWait)
+{
+    UBaseType_t uxCount = 0;
+    BaseType_t xExitLoop = pdFALSE;
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+
+    while (xExitLoop == pdFALSE) {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+            //Items are available for retrieval, get as many as possible in the same critical section
+            uxCount = prvGetItemsNoSplit(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems);
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xTicksToWait == (TickType_t) 0) {
+            //No block time. Return immediately.
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Not timed out yet. Block the current task
+            vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToReceive, xTicksToWait);
+            portYIELD_WITHIN_API();
+        } else {
+            //We have timed out.
+            xExitLoop = pdTRUE;
+        }
+loop_end:
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+
+    return uxCount;
+}
+
+// ------------------------------------------ Single Producer/Single Consumer ------------------------------------------
+
+/*
+ * Ring buffers created by xRingbufferCreateSPSC() are accessed without the critical section:
+ * - pucAcquire, pucWrite and uxItemsSent are only written by the producer
+ * - pucRead, pucFree and uxItemsReceived are only written by the consumer
+ * - pucWrite is stored with release semantics once the items before it are complete, and loaded by the
+ *   consumer with acquire semantics. pucFree is passed from the consumer to the producer the same way,
+ *   once the items before it have been returned.
+ * - The acquire pointer never catches up with the free pointer, so that equal pointers always mean an
+ *   empty buffer. rbBUFFER_FULL_FLAG and xItemsWaiting are not used.
+ *
+ * The critical section is only entered to block, and by the other side to unblock a blocked task. Before
+ * blocking, a task sets xSenderWaiting/xReceiverWaiting then checks the ring buffer again. The other side
+ * publishes its pointer then checks the flag. The full barriers in between guarantee that at least one of
+ * them sees the other's update, so a wake up is never missed.
+ */
+
+#define rbSPSC_LOAD( pucPtr )               __atomic_load_n( &( pucPtr ), __ATOMIC_ACQUIRE )
+#define rbSPSC_STORE( pucPtr, pucValue )    __atomic_store_n( &( pucPtr ), ( pucValue ), __ATOMIC_RELEASE )
+#define rbSPSC_INCREMENT( uxCount, uxN )    __atomic_store_n( &( uxCount ), ( uxCount ) + ( uxN ), __ATOMIC_RELAXED )
+
+static void prvInitializeSPSC(Ringbuffer_t *pxRingbuffer)
+{
+    //Allow-split items are read in two parts, which would require a third pointer shared by both sides
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) == 0);
+
+    pxRingbuffer->uxRingbufferFlags |= rbSPSC_FLAG;
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        //One byte is always left free
+        pxRingbuffer->xMaxItemSize = pxRingbuffer->xSize - 1;
+    } else {
+        /*
+         * As the acquire pointer cannot catch up with the free pointer, an item only fits
+         * before the free pointer if there are at least 4 bytes left after it. Rounding half
+         * of the buffer size down (instead of up) guarantees that an item of the maximum
+         * size can always be sent to an empty buffer.
+         */
+        pxRingbuffer->xMaxItemSize = ((pxRingbuffer->xSize / 2) & ~rbALIGN_MASK) - rbHEADER_SIZE;
+    }
+}
+
+/*
+Get the free space in a no-split SPSC ring buffer, including headers:
+- *pxAtAcquire: contiguous space at pucAcquire
+- *pxAtHead: contiguous space at the head of the buffer, if an item is wrapped around
+*/
+static void prvSPSCGetFreeNoSplit(Ringbuffer_t *pxRingbuffer, uint8_t *pucFree, size_t *pxAtAcquire, size_t *pxAtHead)
+{
+    uint8_t *pucAcquire = pxRingbuffer->pucAcquire;
+    if (pucFree > pucAcquire) {
+        //Free space does not wrap around. Leave at least 4 bytes before the free pointer
+        *pxAtAcquire = pucFree - pucAcquire - rbALIGN_SIZE(1);
+        *pxAtHead = 0;
+    } else if (pucFree == pxRingbuffer->pucHead) {
+        //pucAcquire must not wrap around to pucFree, leave room for a header before the tail
+        *pxAtAcquire = pxRingbuffer->pucTail - pucAcquire - rbHEADER_SIZE;
+        *pxAtHead = 0;
+    } else {
+        //Free space wraps around (or the buffer is empty)
+        *pxAtAcquire = pxRingbuffer->pucTail - pucAcquire;
+        *pxAtHead = pucFree - pxRingbuffer->pucHead - rbALIGN_SIZE(1);
+    }
+}
+
+//Get the free space in a SPSC ring buffer, including headers and the space that is always left free
+static size_t prvSPSCGetFreeSize(Ringbuffer_t *pxRingbuffer)
+{
+    uint8_t *pucFree = rbSPSC_LOAD(pxRingbuffer->pucFree);
+    uint8_t *pucAcquire = __atomic_load_n(&pxRingbuffer->pucAcquire, __ATOMIC_RELAXED);
+    //pucAcquire never catches up with pucFree, so equal pointers mean that the buffer is empty
+    BaseType_t xFreeSize = pucFree - pucAcquire;
+    if (xFreeSize <= 0) {
+        xFreeSize += pxRingbuffer->xSize;
+    }
+    return xFreeSize;
+}
+
+//Get the maximum size an item can currently have if sent to a SPSC ring buffer. Called by the producer
+static size_t prvSPSCGetCurMaxSize(Ringbuffer_t *pxRingbuffer)
+{
+    uint8_t *pucFree = rbSPSC_LOAD(pxRingbuffer->pucFree);
+    size_t xFreeSize;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        //Leave one byte free
+        if (pucFree > pxRingbuffer->pucWrite) {
+            xFreeSize = pucFree - pxRingbuffer->pucWrite - 1;
+        } else {
+            xFreeSize = pxRingbuffer->xSize - (pxRingbuffer->pucWrite - pucFree) - 1;
+        }
+        return xFreeSize;
+    }
+
+    size_t xAtAcquire, xAtHead;
+    prvSPSCGetFreeNoSplit(pxRingbuffer, pucFree, &xAtAcquire, &xAtHead);
+    xFreeSize = (xAtAcquire > xAtHead) ? xAtAcquire : xAtHead;
+    //No-split ring buffer items need space for a header
+    if (xFreeSize < rbHEADER_SIZE) {
+        return 0;
+    }
+    xFreeSize -= rbHEADER_SIZE;
+    return (xFreeSize > pxRingbuffer->xMaxItemSize) ? pxRingbuffer->xMaxItemSize : xFreeSize;
+}
+
+//Acquire space for an item in a no-split SPSC ring buffer. Returns NULL if the item doesn't currently fit
+static uint8_t *prvSPSCAcquireItemNoSplit(Ringbuffer_t *pxRingbuffer, size_t xItemSize)
+{
+    size_t xTotalItemSize = rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE;  //Rounded up aligned item size with header
+    size_t xAtAcquire, xAtHead;
+    prvSPSCGetFreeNoSplit(pxRingbuffer, rbSPSC_LOAD(pxRingbuffer->pucFree), &xAtAcquire, &xAtHead);
+
+    if (xTotalItemSize > xAtAcquire) {
+        if (xTotalItemSize > xAtHead) {
+            return NULL;
+        }
+        //Set remaining length as dummy data and wrap around. The consumer can't see it until pucWrite is updated
+        ItemHeader_t *pxDummy = (ItemHeader_t *)pxRingbuffer->pucAcquire;
+        pxDummy->uxItemFlags = rbITEM_DUMMY_DATA_FLAG;
+        pxDummy->xItemLen = 0;
+        pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;
+    }
+
+    ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucAcquire;
+    pxHeader->xItemLen = xItemSize;
+    pxHeader->uxItemFlags = 0;
+    uint8_t *pucItem = pxRingbuffer->pucAcquire + rbHEADER_SIZE;
+    pxRingbuffer->pucAcquire += xTotalItemSize;
+    //If current remaining length can't fit a header, wrap around acquire pointer
+    if (pxRingbuffer->pucTail - pxRingbuffer->pucAcquire < rbHEADER_SIZE) {
+        pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;
+    }
+    return pucItem;
+}
+
+//Mark an acquired item as written, and make the items written so far available to the consumer
+static void prvSPSCSendItemDoneNoSplit(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    //Check arguments and buffer state
+    configASSERT(rbCHECK_ALIGNED(pucItem));
+    configASSERT(pucItem >= pxRingbuffer->pucHead);
+    configASSERT(pucItem <= pxRingbuffer->pucTail);     //Inclusive of pucTail in the case of zero length item at the very end
+
+    ItemHeader_t *pxCurHeader = (ItemHeader_t *)(pucItem - rbHEADER_SIZE);
+    configASSERT(pxCurHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+    configASSERT((pxCurHeader->uxItemFlags & (rbITEM_DUMMY_DATA_FLAG | rbITEM_WRITTEN_FLAG)) == 0);
+    pxCurHeader->uxItemFlags |= rbITEM_WRITTEN_FLAG;
+
+    //Advance a copy of the write pointer over the written items and dummy data, as in prvSendItemDoneNoSplit()
+    uint8_t *pucWrite = pxRingbuffer->pucWrite;
+    pxCurHeader = (ItemHeader_t *)pucWrite;
+    while ((pxCurHeader->uxItemFlags & (rbITEM_WRITTEN_FLAG | rbITEM_DUMMY_DATA_FLAG)) && pucWrite != pxRingbuffer->pucAcquire) {
+        if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pucWrite = pxRingbuffer->pucHead;
+        } else {
+            pucWrite += rbALIGN_SIZE(pxCurHeader->xItemLen) + rbHEADER_SIZE;
+        }
+        if ((pxRingbuffer->pucTail - pucWrite) < rbHEADER_SIZE) {
+            pucWrite = pxRingbuffer->pucHead;
+        }
+        pxCurHeader = (ItemHeader_t *)pucWrite;
+    }
+    rbSPSC_INCREMENT(pxRingbuffer->uxItemsSent, 1);
+    rbSPSC_STORE(pxRingbuffer->pucWrite, pucWrite);
+}
+
+//Copy data to a SPSC byte buffer. Returns pdFALSE if the data doesn't currently fit
+static BaseType_t prvSPSCCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+{
+    if (xItemSize > prvSPSCGetCurMaxSize(pxRingbuffer)) {
+        return pdFALSE;
+    }
+
+    uint8_t *pucWrite = pxRingbuffer->pucWrite;
+    size_t xRemLen = pxRingbuffer->pucTail - pucWrite;    //Length from pucWrite until end of buffer
+    size_t xCopyLen = xItemSize;
+    if (xRemLen < xCopyLen) {
+        //Copy as much as possible into remaining length, then wrap around
+        memcpy(pucWrite, pucItem, xRemLen);
+        pucItem += xRemLen;
+        xCopyLen -= xRemLen;
+        pucWrite = pxRingbuffer->pucHead;
+    }
+    memcpy(pucWrite, pucItem, xCopyLen);
+    pucWrite += xCopyLen;
+    if (pucWrite == pxRingbuffer->pucTail) {
+        pucWrite = pxRingbuffer->pucHead;
+    }
+
+    //Acquiring memory is not supported in byte mode. pucAcquire tracks pucWrite
+    pxRingbuffer->pucAcquire = pucWrite;
+    rbSPSC_INCREMENT(pxRingbuffer->uxItemsSent, xItemSize);
+    rbSPSC_STORE(pxRingbuffer->pucWrite, pucWrite);
+    return pdTRUE;
+}
+
+/*
+Send (if ppvItem is NULL) or acquire (if pvItem is NULL) an item without blocking.
+Returns pdFALSE if the item doesn't currently fit.
+*/
+static BaseType_t prvSPSCSendAcquire(Ringbuffer_t *pxRingbuffer, const void *pvItem, void **ppvItem, size_t xItemSize)
+{
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        return prvSPSCCopyItemByteBuf(pxRingbuffer, pvItem, xItemSize);
+    }
+    uint8_t *pucItem = prvSPSCAcquireItemNoSplit(pxRingbuffer, xItemSize);
+    if (pucItem == NULL) {
+        return pdFALSE;
+    }
+    if (ppvItem) {
+        *ppvItem = pucItem;
+    } else {
+        memcpy(pucItem, pvItem, xItemSize);
+        prvSPSCSendItemDoneNoSplit(pxRingbuffer, pucItem);
+    }
+    return pdTRUE;
+}
+
+//Checks if an item/data is currently available for retrieval. Called by the consumer
+static BaseType_t prvSPSCCheckItemAvail(Ringbuffer_t *pxRingbuffer)
+{
+    uint8_t *pucWrite = rbSPSC_LOAD(pxRingbuffer->pucWrite);
+    uint8_t *pucRead = pxRingbuffer->pucRead;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        //Byte buffers do not allow multiple retrievals before return
+        return (pucRead == pxRingbuffer->pucFree && pucRead != pucWrite) ? pdTRUE : pdFALSE;
+    }
+    if (pucRead != pucWrite && (((ItemHeader_t *)pucRead)->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) {
+        //The item after the dummy data may still be acquired but not sent
+        pucRead = pxRingbuffer->pucHead;
+    }
+    return (pucRead != pucWrite) ? pdTRUE : pdFALSE;
+}
+
+//Retrieve an item from a no-split SPSC ring buffer, up to the write pointer loaded by the caller. Returns NULL if empty
+static void *prvSPSCGetItemNoSplit(Ringbuffer_t *pxRingbuffer, uint8_t *pucWrite, size_t *pxItemSize)
+{
+    uint8_t *pucRead = pxRingbuffer->pucRead;
+    if (pucRead == pucWrite) {
+        return NULL;
+    }
+    ItemHeader_t *pxHeader = (ItemHeader_t *)pucRead;
+    if (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+        //Wrap around. The dummy data is freed when the item after it is returned
+        pucRead = pxRingbuffer->pucHead;
+        pxRingbuffer->pucRead = pucRead;
+        if (pucRead == pucWrite) {
+            //The item after the dummy data is acquired but not sent yet
+            return NULL;
+        }
+        pxHeader = (ItemHeader_t *)pucRead;
+    }
+    configASSERT(pxHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+
+    uint8_t *pucItem = pucRead + rbHEADER_SIZE;
+    *pxItemSize = pxHeader->xItemLen;
+    pucRead += rbHEADER_SIZE + rbALIGN_SIZE(pxHeader->xItemLen);
+    //Check if pucRead requires wrap around
+    if ((pxRingbuffer->pucTail - pucRead) < rbHEADER_SIZE) {
+        pucRead = pxRingbuffer->pucHead;
+    }
+    pxRingbuffer->pucRead = pucRead;
+    rbSPSC_INCREMENT(pxRingbuffer->uxItemsReceived, 1);
+    return pucItem;
+}
+
+//Retrieve data from a SPSC byte buffer, up to the write pointer loaded by the caller. If xMaxSize is 0, all continuous data is retrieved
+static void *prvSPSCGetItemByteBuf(Ringbuffer_t *pxRingbuffer, uint8_t *pucWrite, size_t xMaxSize, size_t *pxItemSize)
+{
+    uint8_t *pucRead = pxRingbuffer->pucRead;
+    if (pucRead != pxRingbuffer->pucFree || pucRead == pucWrite) {
+        //Byte buffers do not allow multiple retrievals before return
+        return NULL;
+    }
+    //Return contiguous data from read pointer until write pointer or buffer tail, or xMaxSize
+    size_t xSize = (pucWrite > pucRead) ? (size_t)(pucWrite - pucRead) : (size_t)(pxRingbuffer->pucTail - pucRead);
+    if (xMaxSize != 0 && xSize > xMaxSize) {
+        xSize = xMaxSize;
+    }
+    pxRingbuffer->pucRead = (pucRead + xSize == pxRingbuffer->pucTail) ? pxRingbuffer->pucHead : pucRead + xSize;
+    rbSPSC_INCREMENT(pxRingbuffer->uxItemsReceived, xSize);
+    *pxItemSize = xSize;
+    return pucRead;
+}
+
+//Retrieve up to uxMaxItems items (one for byte buffers) without blocking. Returns the number of items retrieved
+static UBaseType_t prvSPSCGetItems(Ringbuffer_t *pxRingbuffer, void **ppvItems, size_t *pxItemSizes, UBaseType_t uxMaxItems, size_t xMaxSize)
+{
+    uint8_t *pucWrite = rbSPSC_LOAD(pxRingbuffer->pucWrite);
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        ppvItems[0] = prvSPSCGetItemByteBuf(pxRingbuffer, pucWrite, xMaxSize, &pxItemSizes[0]);
+        return (ppvItems[0] != NULL) ? 1 : 0;
+    }
+    UBaseType_t uxCount = 0;
+    while (uxCount < uxMaxItems && (ppvItems[uxCount] = prvSPSCGetItemNoSplit(pxRingbuffer, pucWrite, &pxItemSizes[uxCount])) != NULL) {
+        uxCount++;
+    }
+    return uxCount;
+}
+
+//Return an item to a SPSC ring buffer, making the space available to the producer
+static void prvSPSCReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        configASSERT(pucItem >= pxRingbuffer->pucHead);
+        configASSERT(pucItem < pxRingbuffer->pucTail);
+        //Byte buffers do not allow multiple outstanding reads, free everything up to the read pointer
+        rbSPSC_STORE(pxRingbuffer->pucFree, pxRingbuffer->pucRead);
+        return;
+    }
+
+    //Check arguments and buffer state
+    configASSERT(rbCHECK_ALIGNED(pucItem));
+    configASSERT(pucItem >= pxRingbuffer->pucHead);
+    configASSERT(pucItem <= pxRingbuffer->pucTail);     //Inclusive of pucTail in the case of zero length item at the very end
+
+    ItemHeader_t *pxCurHeader = (ItemHeader_t *)(pucItem - rbHEADER_SIZE);
+    configASSERT(pxCurHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+    configASSERT((pxCurHeader->uxItemFlags & (rbITEM_DUMMY_DATA_FLAG | rbITEM_FREE_FLAG)) == 0);
+    pxCurHeader->uxItemFlags |= rbITEM_FREE_FLAG;
+
+    //Advance a copy of the free pointer over the freed items and dummy data, as in prvReturnItemDefault()
+    uint8_t *pucFree = pxRingbuffer->pucFree;
+    pxCurHeader = (ItemHeader_t *)pucFree;
+    while ((pxCurHeader->uxItemFlags & (rbITEM_FREE_FLAG | rbITEM_DUMMY_DATA_FLAG)) && pucFree != pxRingbuffer->pucRead) {
+        if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pucFree = pxRingbuffer->pucHead;
+        } else {
+            pucFree += rbALIGN_SIZE(pxCurHeader->xItemLen) + rbHEADER_SIZE;
+        }
+        if ((pxRingbuffer->pucTail - pucFree) < rbHEADER_SIZE) {
+            pucFree = pxRingbuffer->pucHead;
+        }
+        pxCurHeader = (ItemHeader_t *)pucFree;
+    }
+    rbSPSC_STORE(pxRingbuffer->pucFree, pucFree);
+}
+
+/*
+Unblock the task blocked on pxTasksWaiting, if *pxWaiting shows that it is blocked or about to block.
+Called after publishing a pointer. Returns pdTRUE if the unblocked task has a higher priority.
+*/
+static BaseType_t prvSPSCUnblock(Ringbuffer_t *pxRingbuffer, BaseType_t *pxWaiting, List_t *pxTasksWaiting, BaseType_t xFromISR)
+{
+    BaseType_t xWoken = pdFALSE;
+
+    //Pairs with the barrier in prvSPSCBlock(), between setting *pxWaiting and checking the ring buffer again
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(pxWaiting, __ATOMIC_RELAXED) == pdFALSE) {
+        return pdFALSE;
+    }
+    if (xFromISR) {
+        portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    } else {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+    }
+    if (listLIST_IS_EMPTY(pxTasksWaiting) == pdFALSE) {
+        xWoken = xTaskRemoveFromEventList(pxTasksWaiting);
+        //Don't enter the critical section again until the task blocks again
+        __atomic_store_n(pxWaiting, pdFALSE, __ATOMIC_RELAXED);
+    }
+    if (xFromISR) {
+        portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    } else {
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+    return xWoken;
+}
+
+/*
+Block the calling task on pxTasksWaiting until it is unblocked by prvSPSCUnblock() or times out, unless
+xCheck() shows the ring buffer changed after *pxWaiting was set. Returns pdFALSE on timeout.
+*/
+static BaseType_t prvSPSCBlock(Ringbuffer_t *pxRingbuffer,
+                               BaseType_t *pxWaiting,
+                               List_t *pxTasksWaiting,
+                               BaseType_t (*xCheck)(Ringbuffer_t *pxRingbuffer, size_t xItemSize),
+                               size_t xItemSize,
+                               TimeOut_t *pxTimeOut,
+                               TickType_t *pxTicksToWait)
+{
+    BaseType_t xReturn = pdFALSE;
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    if (xTaskCheckForTimeOut(pxTimeOut, pxTicksToWait) == pdFALSE) {
+        xReturn = pdTRUE;
+        __atomic_store_n(pxWaiting, pdTRUE, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (xCheck(pxRingbuffer, xItemSize) == pdFALSE) {
+            //Not timed out yet. Block the current task
+            vTaskPlaceOnEventList(pxTasksWaiting, *pxTicksToWait);
+            portYIELD_WITHIN_API();
+        }
+    }
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+    //The task is running again, the other side doesn't need to unblock it
+    __atomic_store_n(pxWaiting, pdFALSE, __ATOMIC_RELAXED);
+    return xReturn;
+}
+
+static BaseType_t prvSPSCCheckItemFits(Ringbuffer_t *pxRingbuffer, size_t xItemSize)
+{
+    return (xItemSize <= prvSPSCGetCurMaxSize(pxRingbuffer)) ? pdTRUE : pdFALSE;
+}
+
+static BaseType_t prvSPSCCheckItemAvailBlock(Ringbuffer_t *pxRingbuffer, size_t xUnusedParam)
+{
+    return prvSPSCCheckItemAvail(pxRingbuffer);
+}
+
+//Notify the consumer that an item was sent, from a task
+static void prvSPSCItemSent(Ringbuffer_t *pxRingbuffer)
+{
+    if (pxRingbuffer->xQueueSet) {
+        //If ring buffer was added to a queue set, notify the queue set
+        xQueueSend((QueueHandle_t)pxRingbuffer->xQueueSet, (QueueSetMemberHandle_t *)&pxRingbuffer, 0);
+    } else if (prvSPSCUnblock(pxRingbuffer, &pxRingbuffer->xReceiverWaiting, &pxRingbuffer->xTasksWaitingToReceive, pdFALSE) == pdTRUE) {
+        //The unblocked task will preempt us. Trigger a yield here.
+        portYIELD_WITHIN_API();
+    }
+}
+
+//SPSC version of prvSendAcquireGeneric()
+static BaseType_t prvSPSCSendAcquireGeneric(Ringbuffer_t *pxRingbuffer,
+                                            const void *pvItem,
+                                            void **ppvItem,
+                                            size_t xItemSize,
+                                            TickType_t xTicksToWait)
+{
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+
+    while (prvSPSCSendAcquire(pxRingbuffer, pvItem, ppvItem, xItemSize) == pdFALSE) {
+        if (xTicksToWait == (TickType_t) 0) {
+            //No block time. Return immediately.
+            return pdFALSE;
+        } else if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+        if (prvSPSCBlock(pxRingbuffer, &pxRingbuffer->xSenderWaiting, &pxRingbuffer->xTasksWaitingToSend,
+                         prvSPSCCheckItemFits, xItemSize, &xTimeOut, &xTicksToWait) == pdFALSE) {
+            //We have timed out
+            return pdFALSE;
+        }
+    }
+    if (ppvItem == NULL) {
+        prvSPSCItemSent(pxRingbuffer);
+    }
+    return pdTRUE;
+}
+
+//SPSC version of prvReceiveGeneric() and prvReceiveManyGeneric(). Returns the number of items retrieved
+static UBaseType_t prvSPSCReceiveGeneric(Ringbuffer_t *pxRingbuffer,
+                                         void **ppvItems,
+                                         size_t *pxItemSizes,
+                                         UBaseType_t uxMaxItems,
+                                         size_t xMaxSize,
+                                         TickType_t xTicksToWait)
+{
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+    UBaseType_t uxCount;
+
+    while ((uxCount = prvSPSCGetItems(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems, xMaxSize)) == 0) {
+        if (xTicksToWait == (TickType_t) 0) {
+            //No block time. Return immediately.
+            break;
+        } else if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+        if (prvSPSCBlock(pxRingbuffer, &pxRingbuffer->xReceiverWaiting, &pxRingbuffer->xTasksWaitingToReceive,
+                         prvSPSCCheckItemAvailBlock, 0, &xTimeOut, &xTicksToWait) == pdFALSE) {
+            //We have timed out
+            break;
+        }
+    }
+    return uxCount;
+}
+
 // ------------------------------------------------ Public Functions ---------------------------------------------------
 
 RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType)
@@ -975,6 +1540,25 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
     return (RingbufHandle_t)pxNewRingbuffer;
 }
 
+RingbufHandle_t xRingbufferCreateSPSC(size_t xBufferSize, RingbufferType_t xBufferType)
+{
+    Ringbuffer_t *pxNewRingbuffer = (Ringbuffer_t *)xRingbufferCreate(xBufferSize, xBufferType);
+    if (pxNewRingbuffer != NULL) {
+        prvInitializeSPSC(pxNewRingbuffer);
+    }
+    return (RingbufHandle_t)pxNewRingbuffer;
+}
+
+RingbufHandle_t xRingbufferCreateStaticSPSC(size_t xBufferSize,
+                                            RingbufferType_t xBufferType,
+                                            uint8_t *pucRingbufferStorage,
+                                            StaticRingbuffer_t *pxStaticRingbuffer)
+{
+    Ringbuffer_t *pxNewRingbuffer = (Ringbuffer_t *)xRingbufferCreateStatic(xBufferSize, xBufferType, pucRingbufferStorage, pxStaticRingbuffer);
+    prvInitializeSPSC(pxNewRingbuffer);
+    return (RingbufHandle_t)pxNewRingbuffer;
+}
+
 BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -992,6 +1576,9 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSPSCSendAcquireGeneric(pxRingbuffer, NULL, ppvItem, xItemSize, xTicksToWait);
+    }
     return prvSendAcquireGeneric(pxRingbuffer, NULL, ppvItem, xItemSize, xTicksToWait);
 }
 
@@ -1005,6 +1592,12 @@ BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
     configASSERT(pvItem != NULL);
     configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSPSCSendItemDoneNoSplit(pxRingbuffer, pvItem);
+        prvSPSCItemSent(pxRingbuffer);
+        return pdTRUE;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     prvSendItemDoneNoSplit(pxRingbuffer, pvItem);
     if (pxRingbuffer->xQueueSet) {
@@ -1044,6 +1637,9 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSPSCSendAcquireGeneric(pxRingbuffer, pvItem, NULL, xItemSize, xTicksToWait);
+    }
     return prvSendAcquireGeneric(pxRingbuffer, pvItem, NULL, xItemSize, xTicksToWait);
 }
 
@@ -1066,6 +1662,22 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        if (prvSPSCSendAcquire(pxRingbuffer, pvItem, NULL, xItemSize) == pdFALSE) {
+            return pdFALSE;
+        }
+        if (pxRingbuffer->xQueueSet) {
+            //If ring buffer was added to a queue set, notify the queue set
+            xQueueSendFromISR((QueueHandle_t)pxRingbuffer->xQueueSet, (QueueSetMemberHandle_t *)&pxRingbuffer, pxHigherPriorityTaskWoken);
+        } else if (prvSPSCUnblock(pxRingbuffer, &pxRingbuffer->xReceiverWaiting, &pxRingbuffer->xTasksWaitingToReceive, pdTRUE) == pdTRUE) {
+            //The unblocked task will preempt us. Record that a context switch is required.
+            if (pxHigherPriorityTaskWoken != NULL) {
+                *pxHigherPriorityTaskWoken = pdTRUE;
+            }
+        }
+        return pdTRUE;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     if (pxRingbuffer->xCheckItemFits(xRingbuffer, xItemSize) == pdTRUE) {
         pxRingbuffer->vCopyItem(xRingbuffer, pvItem, xItemSize);
@@ -1104,6 +1716,9 @@ void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickTy
 
     //Attempt to retrieve an item
     void *pvTempItem;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return (prvSPSCReceiveGeneric(pxRingbuffer, &pvTempItem, pxItemSize, 1, 0, xTicksToWait) == 1) ? pvTempItem : NULL;
+    }
     if (prvReceiveGeneric(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, 0, xTicksToWait) == pdTRUE) {
         return pvTempItem;
     } else {
@@ -1120,6 +1735,9 @@ void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
 
     //Attempt to retrieve an item
     void *pvTempItem;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return (prvSPSCGetItems(pxRingbuffer, &pvTempItem, pxItemSize, 1, 0) == 1) ? pvTempItem : NULL;
+    }
     if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, 0) == pdTRUE) {
         return pvTempItem;
     } else {
@@ -1127,6 +1745,51 @@ void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
     }
 }
 
+UBaseType_t xRingbufferReceiveMany(RingbufHandle_t xRingbuffer,
+                                   void **ppvItems,
+                                   size_t *pxItemSizes,
+                                   UBaseType_t uxMaxItems,
+                                   TickType_t xTicksToWait)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+
+    //Check arguments
+    configASSERT(pxRingbuffer && ppvItems && pxItemSizes);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);   //This function should only be called for no-split buffers
+
+    if (uxMaxItems == 0) {
+        return 0;
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSPSCReceiveGeneric(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems, 0, xTicksToWait);
+    }
+    return prvReceiveManyGeneric(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems, xTicksToWait);
+}
+
+UBaseType_t xRingbufferReceiveManyFromISR(RingbufHandle_t xRingbuffer,
+                                          void **ppvItems,
+                                          size_t *pxItemSizes,
+                                          UBaseType_t uxMaxItems)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    UBaseType_t uxCount;
+
+    //Check arguments
+    configASSERT(pxRingbuffer && ppvItems && pxItemSizes);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);   //This function should only be called for no-split buffers
+
+    if (uxMaxItems == 0) {
+        return 0;
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSPSCGetItems(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems, 0);
+    }
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    uxCount = prvGetItemsNoSplit(pxRingbuffer, ppvItems, pxItemSizes, uxMaxItems);
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    return uxCount;
+}
+
 BaseType_t xRingbufferReceiveSplit(RingbufHandle_t xRingbuffer,
                                    void **ppvHeadItem,
                                    void **ppvTailItem,
@@ -1174,6 +1837,9 @@ void *xRingbufferReceiveUpTo(RingbufHandle_t xRingbuffer,
     }
     //Attempt to retrieve up to xMaxSize bytes
     void *pvTempItem;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return (prvSPSCReceiveGeneric(pxRingbuffer, &pvTempItem, pxItemSize, 1, xMaxSize, xTicksToWait) == 1) ? pvTempItem : NULL;
+    }
     if (prvReceiveGeneric(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, xMaxSize, xTicksToWait) == pdTRUE) {
         return pvTempItem;
     } else {
@@ -1194,6 +1860,9 @@ void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemS
     }
     //Attempt to retrieve up to xMaxSize bytes
     void *pvTempItem;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return (prvSPSCGetItems(pxRingbuffer, &pvTempItem, pxItemSize, 1, xMaxSize) == 1) ? pvTempItem : NULL;
+    }
     if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, xMaxSize) == pdTRUE) {
         return pvTempItem;
     } else {
@@ -1207,6 +1876,16 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem)
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSPSCReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        //If a task was waiting for space to send, unblock it immediately.
+        if (prvSPSCUnblock(pxRingbuffer, &pxRingbuffer->xSenderWaiting, &pxRingbuffer->xTasksWaitingToSend, pdFALSE) == pdTRUE) {
+            //The unblocked task will preempt us. Trigger a yield here.
+            portYIELD_WITHIN_API();
+        }
+        return;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     //If a task was waiting for space to send, unblock it immediately.
@@ -1225,6 +1904,18 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSPSCReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        //If a task was waiting for space to send, unblock it immediately.
+        if (prvSPSCUnblock(pxRingbuffer, &pxRingbuffer->xSenderWaiting, &pxRingbuffer->xTasksWaitingToSend, pdTRUE) == pdTRUE) {
+            //The unblocked task will preempt us. Record that a context switch is required.
+            if (pxHigherPriorityTaskWoken != NULL) {
+                *pxHigherPriorityTaskWoken = pdTRUE;
+            }
+        }
+        return;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     //If a task was waiting for space to send, unblock it immediately.
@@ -1264,6 +1955,9 @@ size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer)
     configASSERT(pxRingbuffer);
 
     size_t xFreeSize;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSPSCGetCurMaxSize(pxRingbuffer);
+    }
     portENTER_CRITICAL(&pxRingbuffer->mux);
     xFreeSize = pxRingbuffer->xGetCurMaxSize(pxRingbuffer);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1278,7 +1972,8 @@ BaseType_t xRingbufferAddToQueueSetRead(RingbufHandle_t xRingbuffer, QueueSetHan
     configASSERT(pxRingbuffer && xQueueSet);
 
     portENTER_CRITICAL(&pxRingbuffer->mux);
-    if (pxRingbuffer->xQueueSet != NULL || prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+    BaseType_t xItemAvail = (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) ? prvSPSCCheckItemAvail(pxRingbuffer) : prvCheckItemAvail(pxRingbuffer);
+    if (pxRingbuffer->xQueueSet != NULL || xItemAvail == pdTRUE) {
         /*
         - Cannot add ring buffer to more than one queue set
         - It is dangerous to add a ring buffer to a queue set if the ring buffer currently has data to be read.
@@ -1302,7 +1997,8 @@ BaseType_t xRingbufferRemoveFromQueueSetRead(RingbufHandle_t xRingbuffer, QueueS
     configASSERT(pxRingbuffer && xQueueSet);
 
     portENTER_CRITICAL(&pxRingbuffer->mux);
-    if (pxRingbuffer->xQueueSet != xQueueSet || prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+    BaseType_t xItemAvail = (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) ? prvSPSCCheckItemAvail(pxRingbuffer) : prvCheckItemAvail(pxRingbuffer);
+    if (pxRingbuffer->xQueueSet != xQueueSet || xItemAvail == pdTRUE) {
         /*
         - Ring buffer was never added to this queue set
         - It is dangerous to remove a ring buffer from a queue set if the ring buffer currently has data to be read.
@@ -1342,7 +2038,11 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer,
         *uxAcquire = (UBaseType_t)(pxRingbuffer->pucAcquire - pxRingbuffer->pucHead);
     }
     if (uxItemsWaiting != NULL) {
-        *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+            *uxItemsWaiting = __atomic_load_n(&pxRingbuffer->uxItemsSent, __ATOMIC_RELAXED) - __atomic_load_n(&pxRingbuffer->uxItemsReceived, __ATOMIC_RELAXED);
+        } else {
+            *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        }
     }
     portEXIT_CRITICAL(&pxRingbuffer->mux);
 }
@@ -1351,12 +2051,13 @@ void xRingbufferPrintInfo(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
-    printf("Rb size:%d\tfree: %d\trptr: %d\tfreeptr: %d\twptr: %d, aptr: %d\n",
-           pxRingbuffer->xSize, prvGetFreeSize(pxRingbuffer),
-           pxRingbuffer->pucRead - pxRingbuffer->pucHead,
-           pxRingbuffer->pucFree - pxRingbuffer->pucHead,
-           pxRingbuffer->pucWrite - pxRingbuffer->pucHead,
-           pxRingbuffer->pucAcquire - pxRingbuffer->pucHead);
+    size_t xFreeSize = (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) ? prvSPSCGetFreeSize(pxRingbuffer) : prvGetFreeSize(pxRingbuffer);
+    printf("Rb size:%zu\tfree: %zu\trptr: %d\tfreeptr: %d\twptr: %d, aptr: %d\n",
+           pxRingbuffer->xSize, xFreeSize,
+           (int)(pxRingbuffer->pucRead - pxRingbuffer->pucHead),
+           (int)(pxRingbuffer->pucFree - pxRingbuffer->pucHead),
+           (int)(pxRingbuffer->pucWrite - pxRingbuffer->pucHead),
+           (int)(pxRingbuffer->pucAcquire - pxRingbuffer->pucHead));
 }
 
 BaseType_t xRingbufferGetStaticBuffer(RingbufHandle_t xRingbuffer, uint8_t **ppucRingbufferStorage, StaticRingbuffer_t **ppxStaticRingbuffer)
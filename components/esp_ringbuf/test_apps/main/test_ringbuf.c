@@ -1021,6 +1021,173 @@ TEST_CASE("Test static ring buffer SMP", "[esp_ringbuf]")
 }
 #endif
 
+TEST_CASE("Test SPSC ring buffer SMP", "[esp_ringbuf]")
+{
+    setup();
+    //Allow split buffers do not support SPSC mode
+    const RingbufferType_t buf_types[] = {RINGBUF_TYPE_NOSPLIT, RINGBUF_TYPE_BYTEBUF};
+    for (int i = 0; i < sizeof(buf_types) / sizeof(buf_types[0]); i++) {
+        //Create buffer
+        task_args_t task_args;
+        task_args.buffer = xRingbufferCreateSPSC(CONT_DATA_TEST_BUFF_LEN, buf_types[i]);
+        task_args.type = buf_types[i];
+        TEST_ASSERT_MESSAGE(task_args.buffer != NULL, "Failed to create ring buffer");
+
+        for (int prior_mod = -1; prior_mod < 2; prior_mod++) {  //Test different relative priorities
+            //Test every permutation of core affinity
+            for (int send_core = 0; send_core < portNUM_PROCESSORS; send_core++) {
+                for (int rec_core = 0; rec_core < portNUM_PROCESSORS; rec_core ++) {
+                    esp_rom_printf("Type: %d, PM: %d, SC: %d, RC: %d\n", buf_types[i], prior_mod, send_core, rec_core);
+                    xTaskCreatePinnedToCore(send_task, "send tsk", 2048, (void *)&task_args, 10 + prior_mod, NULL, send_core);
+                    xTaskCreatePinnedToCore(rec_task, "rec tsk", 2048, (void *)&task_args, 10, NULL, rec_core);
+                    xSemaphoreTake(tasks_done, portMAX_DELAY);
+                    vTaskDelay(5);  //Allow idle to clean up
+                }
+            }
+        }
+
+        //Delete ring buffer
+        vRingbufferDelete(task_args.buffer);
+        vTaskDelay(10);
+    }
+    cleanup();
+}
+
+/* ------------------------ Test ring buffer receive many ----------------------
+ * The following test case tests that xRingbufferReceiveMany() and
+ * xRingbufferReceiveManyFromISR() retrieve all the available items in order,
+ * up to the maximum number of items, on no-split and SPSC no-split buffers.
+ */
+
+#define RECEIVE_MANY_ITEMS      6
+
+TEST_CASE("Test ringbuffer receive many", "[esp_ringbuf]")
+{
+    RingbufHandle_t handles[] = {
+        xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT),
+        xRingbufferCreateSPSC(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT),
+    };
+    for (int i = 0; i < sizeof(handles) / sizeof(handles[0]); i++) {
+        RingbufHandle_t handle = handles[i];
+        TEST_ASSERT_MESSAGE(handle != NULL, "Failed to create ring buffer");
+        void *items[RECEIVE_MANY_ITEMS];
+        size_t item_sizes[RECEIVE_MANY_ITEMS];
+
+        //Nothing to receive
+        TEST_ASSERT_EQUAL(0, xRingbufferReceiveMany(handle, items, item_sizes, RECEIVE_MANY_ITEMS, TIMEOUT_TICKS));
+
+        //Fill the buffer several times to wrap around, the items have increasing sizes
+        for (int round = 0; round < 4; round++) {
+            for (int j = 0; j < RECEIVE_MANY_ITEMS - 2; j++) {
+                send_item_and_check(handle, large_item, (j % LARGE_ITEM_SIZE) + 1, TIMEOUT_TICKS, false);
+            }
+            //Limited by the maximum number of items
+            TEST_ASSERT_EQUAL(2, xRingbufferReceiveMany(handle, items, item_sizes, 2, 0));
+            //Limited by the items available
+            TEST_ASSERT_EQUAL(RECEIVE_MANY_ITEMS - 4, xRingbufferReceiveManyFromISR(handle, &items[2], &item_sizes[2], RECEIVE_MANY_ITEMS - 2));
+            for (int j = 0; j < RECEIVE_MANY_ITEMS - 2; j++) {
+                TEST_ASSERT_EQUAL(j % LARGE_ITEM_SIZE + 1, item_sizes[j]);
+                TEST_ASSERT_EQUAL_MEMORY(large_item, items[j], item_sizes[j]);
+            }
+            //Items can be returned in any order
+            for (int j = RECEIVE_MANY_ITEMS - 3; j >= 0; j--) {
+                vRingbufferReturnItem(handle, items[j]);
+            }
+        }
+
+        UBaseType_t items_waiting;
+        vRingbufferGetInfo(handle, NULL, NULL, NULL, NULL, &items_waiting);
+        TEST_ASSERT_EQUAL(0, items_waiting);
+        TEST_ASSERT_EQUAL(xRingbufferGetMaxItemSize(handle), xRingbufferGetCurFreeSize(handle));
+        vRingbufferDelete(handle);
+    }
+}
+
+/* --------------- Test returning the items of a full ring buffer ---------------
+ * The following test case fills no-split and allow-split buffers completely,
+ * receives every item before returning any of them, then returns them last
+ * first or interleaved. Every order must make the whole buffer available again.
+ */
+
+#define FULL_BUFFER_MAX_ITEMS   (BUFFER_SIZE / ITEM_HDR_SIZE)
+
+static int receive_item_no_return(RingbufHandle_t handle, bool allow_split, void **item)
+{
+    size_t item_size;
+    if (allow_split) {
+        void *item2;
+        size_t item_size2;
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferReceiveSplit(handle, item, &item2, &item_size, &item_size2, 0));
+        //The items are aligned and the buffer size is a multiple of their size, so they are never split
+        TEST_ASSERT_NULL(item2);
+    } else {
+        *item = xRingbufferReceive(handle, &item_size, 0);
+        TEST_ASSERT_NOT_NULL(*item);
+    }
+    TEST_ASSERT_EQUAL(SMALL_ITEM_SIZE, item_size);
+    TEST_ASSERT_EQUAL_MEMORY(small_item, *item, SMALL_ITEM_SIZE);
+    return 1;
+}
+
+TEST_CASE("Test returning the items of a full ring buffer in any order", "[esp_ringbuf]")
+{
+    const RingbufferType_t buf_types[] = {RINGBUF_TYPE_NOSPLIT, RINGBUF_TYPE_ALLOWSPLIT};
+    for (int i = 0; i < sizeof(buf_types) / sizeof(buf_types[0]); i++) {
+        RingbufHandle_t handle = xRingbufferCreate(BUFFER_SIZE, buf_types[i]);
+        TEST_ASSERT_MESSAGE(handle != NULL, "Failed to create ring buffer");
+        bool allow_split = (buf_types[i] == RINGBUF_TYPE_ALLOWSPLIT);
+        int capacity = 0;
+
+        //Start from different positions, so that the full buffer wraps around at different items
+        for (int offset = 0; offset < 4; offset++) {
+            for (int reverse = 0; reverse < 2; reverse++) {
+                void *items[FULL_BUFFER_MAX_ITEMS];
+                for (int j = 0; j < offset; j++) {
+                    send_item_and_check(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+                    receive_item_no_return(handle, allow_split, &items[0]);
+                    vRingbufferReturnItem(handle, items[0]);
+                }
+
+                //Fill the buffer
+                int count = 0;
+                while (count < FULL_BUFFER_MAX_ITEMS && xRingbufferSend(handle, small_item, SMALL_ITEM_SIZE, 0) == pdTRUE) {
+                    count++;
+                }
+                if (capacity == 0) {
+                    capacity = count;
+                }
+                TEST_ASSERT_EQUAL(capacity, count);
+                TEST_ASSERT_EQUAL(0, xRingbufferGetCurFreeSize(handle));
+
+                //Receive every item before returning any
+                for (int j = 0; j < count; j++) {
+                    receive_item_no_return(handle, allow_split, &items[j]);
+                }
+
+                if (reverse) {
+                    for (int j = count - 1; j >= 0; j--) {
+                        vRingbufferReturnItem(handle, items[j]);
+                    }
+                } else {
+                    //The odd items first, then the even ones, the first item last
+                    for (int j = 1; j < count; j += 2) {
+                        vRingbufferReturnItem(handle, items[j]);
+                    }
+                    for (int j = count - 1 - (count % 2 == 0); j >= 0; j -= 2) {
+                        vRingbufferReturnItem(handle, items[j]);
+                    }
+                }
+
+                UBaseType_t items_waiting;
+                vRingbufferGetInfo(handle, NULL, NULL, NULL, NULL, &items_waiting);
+                TEST_ASSERT_EQUAL(0, items_waiting);
+                TEST_ASSERT_EQUAL(xRingbufferGetMaxItemSize(handle), xRingbufferGetCurFreeSize(handle));
+            }
+        }
+        vRingbufferDelete(handle);
+    }
+}
+
 #if !CONFIG_RINGBUF_PLACE_FUNCTIONS_INTO_FLASH && !CONFIG_RINGBUF_PLACE_ISR_FUNCTIONS_INTO_FLASH
 /* -------------------------- Test ring buffer IRAM ------------------------- */
 
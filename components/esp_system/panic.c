@@ -23,6 +23,7 @@
 #include "esp_private/panic_internal.h"
 #include "port/panic_funcs.h"
 #include "esp_rom_sys.h"
+#include "esp_log.h"
 
 #include "sdkconfig.h"
 
@@ -244,6 +245,11 @@ void esp_panic_handler(panic_info_t *info)
         info->exception = PANIC_EXCEPTION_ABORT;
     }
 
+#if CONFIG_LOG_ASYNC
+    // Messages staged for asynchronous output tell what happened before the panic, print them first
+    esp_log_async_panic_flush(panic_print_str);
+#endif
+
     /*
       * For any supported chip, the panic handler prints the contents of panic_info_t in the following format:
       *
@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "unity.h"
+
+#define MS (1000)
+
+static int64_t host_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+TEST_CASE("esp_timer_get_time follows the host monotonic clock", "[esp_timer]")
+{
+    int64_t host_start = host_time_us();
+    int64_t start = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(100));
+    int64_t elapsed = esp_timer_get_time() - start;
+    int64_t host_elapsed = host_time_us() - host_start;
+    /* the host clock is read around esp_timer_get_time, so it can only measure a longer time */
+    TEST_ASSERT_GREATER_OR_EQUAL(90 * MS, elapsed);
+    TEST_ASSERT_LESS_OR_EQUAL(host_elapsed, elapsed);
+}
+
+typedef struct {
+    SemaphoreHandle_t done;
+    int64_t fired_at;
+    int count;
+    bool in_isr;
+} test_state_t;
+
+static void once_cb(void *arg)
+{
+    test_state_t *state = (test_state_t *) arg;
+    state->fired_at = esp_timer_get_time();
+    state->count++;
+    xSemaphoreGive(state->done);
+}
+
+TEST_CASE("one-shot timer fires once after its timeout", "[esp_timer]")
+{
+    test_state_t state = { .done = xSemaphoreCreateBinary() };
+    esp_timer_create_args_t args = {
+        .callback = &once_cb,
+        .arg = &state,
+        .name = "once",
+    };
+    esp_timer_handle_t timer;
+    TEST_ESP_OK(esp_timer_create(&args, &timer));
+
+    int64_t start = esp_timer_get_time();
+    TEST_ESP_OK(esp_timer_start_once(timer, 50 * MS));
+    TEST_ASSERT_TRUE(esp_timer_is_active(timer));
+    TEST_ASSERT_TRUE(xSemaphoreTake(state.done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_GREATER_OR_EQUAL(50 * MS, state.fired_at - start);
+    TEST_ASSERT_LESS_THAN(1000 * MS, state.fired_at - start);
+
+    vTaskDelay(pdMS_TO_TICKS(100));
+    TEST_ASSERT_EQUAL(1, state.count);
+    TEST_ASSERT_FALSE(esp_timer_is_active(timer));
+
+    TEST_ESP_OK(esp_timer_delete(timer));
+    vSemaphoreDelete(state.done);
+}
+
+static void periodic_cb(void *arg)
+{
+    test_state_t *state = (test_state_t *) arg;
+    state->count++;
+}
+
+TEST_CASE("periodic timer fires at its period", "[esp_timer]")
+{
+    test_state_t state = { 0 };
+    esp_timer_create_args_t args = {
+        .callback = &periodic_cb,
+        .arg = &state,
+        .name = "periodic",
+    };
+    esp_timer_handle_t timer;
+    TEST_ESP_OK(esp_timer_create(&args, &timer));
+
+    int64_t start = esp_timer_get_time();
+    TEST_ESP_OK(esp_timer_start_periodic(timer, 10 * MS));
+    vTaskDelay(pdMS_TO_TICKS(205));
+    TEST_ESP_OK(esp_timer_stop(timer));
+    int64_t elapsed = esp_timer_get_time() - start;
+    int count = state.count;
+    /* a busy host delays the callbacks, but never makes the timer fire more often than its period */
+    TEST_ASSERT_GREATER_OR_EQUAL(10, count);
+    TEST_ASSERT_LESS_OR_EQUAL(elapsed / (10 * MS), count);
+
+    vTaskDelay(pdMS_TO_TICKS(50));
+    TEST_ASSERT_EQUAL(count, state.count);
+    TEST_ESP_OK(esp_timer_delete(timer));
+}
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+static void isr_cb(void *arg)
+{
+    test_state_t *state = (test_state_t *) arg;
+    BaseType_t woken = pdFALSE;
+    state->in_isr = xPortInIsrContext();
+    state->count++;
+    xSemaphoreGiveFromISR(state->done, &woken);
+    if (woken) {
+        esp_timer_isr_dispatch_need_yield();
+    }
+}
+
+TEST_CASE("timer with ISR dispatch method runs in emulated interrupt context", "[esp_timer]")
+{
+    test_state_t state = { .done = xSemaphoreCreateBinary() };
+    esp_timer_create_args_t args = {
+        .callback = &isr_cb,
+        .arg = &state,
+        .dispatch_method = ESP_TIMER_ISR,
+        .name = "isr",
+    };
+    esp_timer_handle_t timer;
+    TEST_ESP_OK(esp_timer_create(&args, &timer));
+
+    TEST_ESP_OK(esp_timer_start_periodic(timer, 5 * MS));
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(xSemaphoreTake(state.done, pdMS_TO_TICKS(1000)));
+    }
+    TEST_ESP_OK(esp_timer_stop(timer));
+    TEST_ASSERT_TRUE(state.in_isr);
+    TEST_ASSERT_FALSE(xPortInIsrContext());
+
+    TEST_ESP_OK(esp_timer_delete(timer));
+    vSemaphoreDelete(state.done);
+}
+#endif // CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+
+#define LOAD_TIMERS     1000
+#define LOAD_TIME_MS    500
+
+TEST_CASE("many periodic timers fire at their periods", "[esp_timer][load]")
+{
+    esp_timer_handle_t *timers = calloc(LOAD_TIMERS, sizeof(esp_timer_handle_t));
+    test_state_t *states = calloc(LOAD_TIMERS, sizeof(test_state_t));
+    uint64_t *periods = calloc(LOAD_TIMERS, sizeof(uint64_t));
+    TEST_ASSERT_NOT_NULL(timers);
+    TEST_ASSERT_NOT_NULL(states);
+    TEST_ASSERT_NOT_NULL(periods);
+
+    srand(1);
+    for (int i = 0; i < LOAD_TIMERS; i++) {
+        esp_timer_create_args_t args = {
+            .callback = &periodic_cb,
+            .arg = &states[i],
+        };
+        TEST_ESP_OK(esp_timer_create(&args, &timers[i]));
+        periods[i] = (10 + rand() % 90) * MS;
+    }
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < LOAD_TIMERS; i++) {
+        TEST_ESP_OK(esp_timer_start_periodic(timers[i], periods[i]));
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOAD_TIME_MS));
+
+    /* all the timers are listed by esp_timer_dump, after the two header lines */
+    char *dump;
+    size_t dump_size;
+    FILE *stream = open_memstream(&dump, &dump_size);
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ESP_OK(esp_timer_dump(stream));
+    fclose(stream);
+    int lines = 0;
+    for (char *p = dump; (p = strchr(p, '\n')) != NULL; p++) {
+        lines++;
+    }
+    free(dump);
+    TEST_ASSERT_EQUAL(LOAD_TIMERS + 2, lines);
+
+    for (int i = 0; i < LOAD_TIMERS; i++) {
+        TEST_ESP_OK(esp_timer_stop(timers[i]));
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    for (int i = 0; i < LOAD_TIMERS; i++) {
+        /* the timers started at different times, and a busy host delays the callbacks */
+        TEST_ASSERT_GREATER_OR_EQUAL(LOAD_TIME_MS * MS / periods[i] / 2, states[i].count);
+        TEST_ASSERT_LESS_OR_EQUAL(elapsed / periods[i], states[i].count);
+        TEST_ESP_OK(esp_timer_delete(timers[i]));
+    }
+    free(periods);
+    free(states);
+    free(timers);
+}
+
+void app_main(void)
+{
+    printf("Running esp_timer linux host test app\n");
+    unity_run_menu();
+}
@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+/**
+ * @file esp_timer_queue.h
+ *
+ * @brief Queue of armed timers, ordered by their alarm time
+ *
+ * esp_timer keeps one queue per dispatch method. The queue is implemented by one of
+ * the backends selected in menuconfig:
+ *
+ * - esp_timer_queue_list.c: sorted linked list, O(n) insertion, O(1) removal.
+ * - esp_timer_queue_heap.c: 4-ary min-heap, O(log n) insertion and removal. Its storage
+ *   is reserved when timers are created, so that arming a timer never allocates memory.
+ *
+ * Timers with the same alarm time are returned in the order they were inserted.
+ *
+ * All functions but esp_timer_queue_reserve are called with the lock of the queue held
+ * and can be called from an ISR.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "sys/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Position of a timer in the queue, embedded into the timer
+ */
+typedef struct esp_timer_queue_node {
+    uint64_t alarm;                                 //!< alarm time, the key the queue is ordered by
+#if CONFIG_ESP_TIMER_QUEUE_HEAP
+    uint32_t index;                                 //!< index of the node in the heap array
+    uint32_t seq;                                   //!< insertion order, to keep timers with the same alarm in order
+#else
+    LIST_ENTRY(esp_timer_queue_node) list_entry;
+#endif
+} esp_timer_queue_node_t;
+
+/**
+ * @brief Queue of armed timers, zero-initialized queues are empty
+ */
+typedef struct {
+#if CONFIG_ESP_TIMER_QUEUE_HEAP
+    esp_timer_queue_node_t** nodes;                 //!< heap array, the earliest alarm first
+    uint32_t count;                                 //!< number of nodes in the heap
+    uint32_t capacity;                              //!< number of nodes the heap array has room for
+    uint32_t seq;                                   //!< insertion counter
+#else
+    LIST_HEAD(esp_timer_queue_list, esp_timer_queue_node) list;
+#endif
+} esp_timer_queue_t;
+
+/**
+ * @brief Inserts a node, its alarm must be set
+ */
+void esp_timer_queue_insert(esp_timer_queue_t* queue, esp_timer_queue_node_t* node);
+
+/**
+ * @brief Removes a node which is in the queue
+ */
+void esp_timer_queue_remove(esp_timer_queue_t* queue, esp_timer_queue_node_t* node);
+
+/**
+ * @brief Returns the node with the earliest alarm, NULL if the queue is empty
+ */
+esp_timer_queue_node_t* esp_timer_queue_first(esp_timer_queue_t* queue);
+
+/**
+ * @brief Iterates over the nodes of the queue
+ *
+ * Starting with esp_timer_queue_first, returns each node once, in an unspecified order.
+ * The queue must not change during the iteration.
+ *
+ * @return The node following 'node', NULL after the last one
+ */
+esp_timer_queue_node_t* esp_timer_queue_next(esp_timer_queue_t* queue, esp_timer_queue_node_t* node);
+
+/**
+ * @brief Makes sure the queue can hold 'count' nodes without allocating memory
+ *
+ * Called from task context without the lock held. The lock is taken to switch
+ * the queue to a larger storage.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the storage can't be allocated
+ */
+esp_err_t esp_timer_queue_reserve(esp_timer_queue_t* queue, size_t count, portMUX_TYPE* lock);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,17 +1,22 @@
 /*
- * SPDX-FileCopyrightText: 2017-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2017-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
 #include <sys/param.h>
 #include <string.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "soc/soc.h"
+#endif
 #include "esp_types.h"
 #include "esp_attr.h"
 #include "esp_err.h"
 #include "esp_task.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -19,7 +24,9 @@
 #include "esp_timer.h"
 #include "esp_timer_impl.h"
 
+#if !CONFIG_IDF_TARGET_LINUX
 #include "esp_private/startup_internal.h"
+#endif
 #include "esp_private/esp_timer_private.h"
 #include "esp_private/system_internal.h"
 
@@ -39,8 +46,6 @@
 #include "esp32h2/rtc.h"
 #endif
 
-#include "sdkconfig.h"
-
 #ifdef CONFIG_ESP_TIMER_PROFILING
 #define WITH_PROFILING 1
 #endif
@@ -50,6 +55,7 @@
 #define INVARIANTS
 #endif
 #include "sys/queue.h"
+#include "esp_timer_queue.h"
 
 #define EVENT_ID_DELETE_TIMER   0xF0DE1E1E
 
@@ -59,7 +65,7 @@ typedef enum {
 } flags_t;
 
 struct esp_timer {
-    uint64_t alarm;
+    esp_timer_queue_node_t node;    // position in the queue of armed timers, holds the alarm time
     uint64_t period:56;
     flags_t flags:8;
     union {
@@ -73,8 +79,8 @@ struct esp_timer {
     size_t times_armed;
     size_t times_skipped;
     uint64_t total_callback_run_time;
-#endif // WITH_PROFILING
     LIST_ENTRY(esp_timer) list_entry;
+#endif // WITH_PROFILING
 };
 
 static inline bool is_initialized(void);
@@ -91,10 +97,10 @@ static void timer_remove_inactive(esp_timer_handle_t timer);
 
 __attribute__((unused)) static const char* TAG = "esp_timer";
 
-// lists of currently armed timers for two dispatch methods: ISR and TASK
-static LIST_HEAD(esp_timer_list, esp_timer) s_timers[ESP_TIMER_MAX] = {
-    [0 ... (ESP_TIMER_MAX - 1)] = LIST_HEAD_INITIALIZER(s_timers)
-};
+// queues of currently armed timers for two dispatch methods: ISR and TASK
+static esp_timer_queue_t s_timers[ESP_TIMER_MAX];
+// number of created timers, each queue has room for all of them
+static size_t s_timer_count;
 #if WITH_PROFILING
 // lists of unarmed timers for two dispatch methods: ISR and TASK,
 // used only to be able to dump statistics about all the timers
@@ -105,7 +111,7 @@ static LIST_HEAD(esp_inactive_timer_list, esp_timer) s_inactive_timers[ESP_TIMER
 // task used to dispatch timer callbacks
 static TaskHandle_t s_timer_task;
 
-// lock protecting s_timers, s_inactive_timers
+// lock protecting s_timers, s_inactive_timers, s_timer_count (the one of ESP_TIMER_TASK)
 static portMUX_TYPE s_timer_lock[ESP_TIMER_MAX] = {
     [0 ... (ESP_TIMER_MAX - 1)] = portMUX_INITIALIZER_UNLOCKED
 };
@@ -115,6 +121,40 @@ static portMUX_TYPE s_timer_lock[ESP_TIMER_MAX] = {
 static volatile BaseType_t s_isr_dispatch_need_yield = pdFALSE;
 #endif // CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
 
+static inline IRAM_ATTR esp_timer_handle_t timer_from_node(esp_timer_queue_node_t* node)
+{
+    return node ? (esp_timer_handle_t)((char*) node - offsetof(struct esp_timer, node)) : NULL;
+}
+
+static inline IRAM_ATTR esp_timer_handle_t timer_first(esp_timer_dispatch_t dispatch_method)
+{
+    return timer_from_node(esp_timer_queue_first(&s_timers[dispatch_method]));
+}
+
+static inline IRAM_ATTR esp_timer_handle_t timer_next(esp_timer_dispatch_t dispatch_method, esp_timer_handle_t timer)
+{
+    return timer_from_node(esp_timer_queue_next(&s_timers[dispatch_method], &timer->node));
+}
+
+/* Makes room for one more timer in the queues, so that arming a timer never allocates memory */
+static esp_err_t timer_queues_reserve(void)
+{
+    timer_list_lock(ESP_TIMER_TASK);
+    size_t timer_count = ++s_timer_count;
+    timer_list_unlock(ESP_TIMER_TASK);
+
+    for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
+        // A timer can move from the ISR to the TASK queue when it is deleted, so each queue has room for all timers
+        if (esp_timer_queue_reserve(&s_timers[dispatch_method], timer_count, &s_timer_lock[dispatch_method]) != ESP_OK) {
+            timer_list_lock(ESP_TIMER_TASK);
+            --s_timer_count;
+            timer_list_unlock(ESP_TIMER_TASK);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
 esp_err_t esp_timer_create(const esp_timer_create_args_t* args,
                            esp_timer_handle_t* out_handle)
 {
@@ -129,6 +169,10 @@ esp_err_t esp_timer_create(const esp_timer_create_args_t* args,
     if (result == NULL) {
         return ESP_ERR_NO_MEM;
     }
+    if (timer_queues_reserve() != ESP_OK) {
+        free(result);
+        return ESP_ERR_NO_MEM;
+    }
     result->callback = args->callback;
     result->arg = args->arg;
     result->flags = (args->dispatch_method ? FL_ISR_DISPATCH_METHOD : 0) |
@@ -180,11 +224,11 @@ esp_err_t IRAM_ATTR esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout
         if (period != 0) {
             /* Remove function got rid of the alarm and period fields, restore them */
             const uint64_t new_period = MAX(timeout_us, esp_timer_impl_get_min_period_us());
-            timer->alarm = now + new_period;
+            timer->node.alarm = now + new_period;
             timer->period = new_period;
         } else {
             /* The new one-shot alarm shall be triggered timeout_us after the current time */
-            timer->alarm = now + timeout_us;
+            timer->node.alarm = now + timeout_us;
             timer->period = 0;
         }
         ret = timer_insert(timer, false);
@@ -217,7 +261,7 @@ esp_err_t IRAM_ATTR esp_timer_start_once(esp_timer_handle_t timer, uint64_t time
     if (timer_armed(timer)) {
         err = ESP_ERR_INVALID_STATE;
     } else {
-        timer->alarm = alarm;
+        timer->node.alarm = alarm;
         timer->period = 0;
 #if WITH_PROFILING
         timer->times_armed++;
@@ -246,7 +290,7 @@ esp_err_t IRAM_ATTR esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t
     if (timer_armed(timer)) {
         err = ESP_ERR_INVALID_STATE;
     } else {
-        timer->alarm = alarm;
+        timer->node.alarm = alarm;
         timer->period = period_us;
 #if WITH_PROFILING
         timer->times_armed++;
@@ -296,12 +340,12 @@ esp_err_t esp_timer_delete(esp_timer_handle_t timer)
         err = ESP_ERR_INVALID_STATE;
     } else {
         // A case for the timer with ESP_TIMER_ISR:
-        // This ISR timer was removed from the ISR list in esp_timer_stop() or in timer_process_alarm() -> LIST_REMOVE(it, list_entry)
+        // This ISR timer was removed from the ISR queue in esp_timer_stop() or in timer_process_alarm()
         // and here this timer will be added to another the TASK list, see below.
         // We do this because we want to free memory of the timer in a task context instead of an isr context.
         timer->flags &= ~FL_ISR_DISPATCH_METHOD;
         timer->event_id = EVENT_ID_DELETE_TIMER;
-        timer->alarm = alarm;
+        timer->node.alarm = alarm;
         timer->period = 0;
         err = timer_insert(timer, false);
     }
@@ -314,25 +358,10 @@ static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer, bool without_u
 #if WITH_PROFILING
     timer_remove_inactive(timer);
 #endif
-    esp_timer_handle_t it, last = NULL;
     esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
-    if (LIST_FIRST(&s_timers[dispatch_method]) == NULL) {
-        LIST_INSERT_HEAD(&s_timers[dispatch_method], timer, list_entry);
-    } else {
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
-            if (timer->alarm < it->alarm) {
-                LIST_INSERT_BEFORE(it, timer, list_entry);
-                break;
-            }
-            last = it;
-        }
-        if (it == NULL) {
-            assert(last);
-            LIST_INSERT_AFTER(last, timer, list_entry);
-        }
-    }
-    if (without_update_alarm == false && timer == LIST_FIRST(&s_timers[dispatch_method])) {
-        esp_timer_impl_set_alarm_id(timer->alarm, dispatch_method);
+    esp_timer_queue_insert(&s_timers[dispatch_method], &timer->node);
+    if (without_update_alarm == false && timer == timer_first(dispatch_method)) {
+        esp_timer_impl_set_alarm_id(timer->node.alarm, dispatch_method);
     }
     return ESP_OK;
 }
@@ -341,15 +370,15 @@ static IRAM_ATTR esp_err_t timer_remove(esp_timer_handle_t timer)
 {
     esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
     timer_list_lock(dispatch_method);
-    esp_timer_handle_t first_timer = LIST_FIRST(&s_timers[dispatch_method]);
-    LIST_REMOVE(timer, list_entry);
-    timer->alarm = 0;
+    esp_timer_handle_t first_timer = timer_first(dispatch_method);
+    esp_timer_queue_remove(&s_timers[dispatch_method], &timer->node);
+    timer->node.alarm = 0;
     timer->period = 0;
     if (timer == first_timer) { // if this timer was the first in the list.
         uint64_t next_timestamp = UINT64_MAX;
-        first_timer = LIST_FIRST(&s_timers[dispatch_method]);
-        if (first_timer) { // if after removing the timer from the list, this list is not empty.
-            next_timestamp = first_timer->alarm;
+        first_timer = timer_first(dispatch_method);
+        if (first_timer) { // if after removing the timer from the queue, this queue is not empty.
+            next_timestamp = first_timer->node.alarm;
         }
         esp_timer_impl_set_alarm_id(next_timestamp, dispatch_method);
     }
@@ -381,14 +410,20 @@ static IRAM_ATTR void timer_insert_inactive(esp_timer_handle_t timer)
 
 static IRAM_ATTR void timer_remove_inactive(esp_timer_handle_t timer)
 {
-    LIST_REMOVE(timer, list_entry);
+    /* A periodic timer is inserted into the queue again while it is still armed,
+     * it is not in the inactive list then.
+     */
+    if (timer->list_entry.le_prev != NULL) {
+        LIST_REMOVE(timer, list_entry);
+        timer->list_entry.le_prev = NULL;
+    }
 }
 
 #endif // WITH_PROFILING
 
 static IRAM_ATTR bool timer_armed(esp_timer_handle_t timer)
 {
-    return timer->alarm > 0;
+    return timer->node.alarm > 0;
 }
 
 static IRAM_ATTR void timer_list_lock(esp_timer_dispatch_t timer_type)
@@ -411,33 +446,34 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
     bool processed = false;
     esp_timer_handle_t it;
     while (1) {
-        it = LIST_FIRST(&s_timers[dispatch_method]);
+        it = timer_first(dispatch_method);
         int64_t now = esp_timer_impl_get_time();
-        if (it == NULL || it->alarm > now) {
+        if (it == NULL || it->node.alarm > now) {
             break;
         }
         processed = true;
-        LIST_REMOVE(it, list_entry);
+        esp_timer_queue_remove(&s_timers[dispatch_method], &it->node);
         if (it->event_id == EVENT_ID_DELETE_TIMER) {
             // It is handled only by ESP_TIMER_TASK (see esp_timer_delete()).
             // All the ESP_TIMER_ISR timers which should be deleted are moved by esp_timer_delete() to the ESP_TIMER_TASK list.
             // We want to free memory of the timer in a task context instead of an isr context.
             free(it);
+            --s_timer_count;
             it = NULL;
         } else {
             if (it->period > 0) {
-                int skipped = (now - it->alarm) / it->period;
+                int skipped = (now - it->node.alarm) / it->period;
                 if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) && (skipped > 1)) {
-                    it->alarm = now + it->period;
+                    it->node.alarm = now + it->period;
 #if WITH_PROFILING
                     it->times_skipped += skipped;
 #endif
                 } else {
-                    it->alarm += it->period;
+                    it->node.alarm += it->period;
                 }
                 timer_insert(it, true);
             } else {
-                it->alarm = 0;
+                it->node.alarm = 0;
 #if WITH_PROFILING
                 timer_insert_inactive(it);
 #endif
@@ -458,7 +494,7 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
     } // while(1)
     if (it) {
         if (dispatch_method == ESP_TIMER_TASK || (dispatch_method != ESP_TIMER_TASK && processed == true)) {
-            esp_timer_impl_set_alarm_id(it->alarm, dispatch_method);
+            esp_timer_impl_set_alarm_id(it->node.alarm, dispatch_method);
         }
     } else {
         if (processed) {
@@ -503,7 +539,7 @@ static void IRAM_ATTR timer_alarm_handler(void* arg)
         vTaskNotifyGiveFromISR(s_timer_task, &xHigherPriorityTaskWoken);
     }
     if (xHigherPriorityTaskWoken == pdTRUE) {
-        portYIELD_FROM_ISR();
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
     }
 }
 
@@ -572,10 +608,21 @@ esp_err_t esp_timer_init(void)
     return err;
 }
 
+#if CONFIG_IDF_TARGET_LINUX
+/* There are no system init functions on the Linux target, esp_timer is initialized before main().
+ * FreeRTOS allows creating the timer task before the scheduler is started.
+ */
+__attribute__((constructor)) static void esp_timer_startup_init(void)
+{
+    esp_timer_early_init();
+    ESP_ERROR_CHECK(esp_timer_init());
+}
+#else
 ESP_SYSTEM_INIT_FN(esp_timer_startup_init, CONFIG_ESP_TIMER_ISR_AFFINITY, 100)
 {
     return esp_timer_init();
 }
+#endif
 
 esp_err_t esp_timer_deinit(void)
 {
@@ -585,7 +632,7 @@ esp_err_t esp_timer_deinit(void)
 
     /* Check if there are any active timers */
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
-        if (!LIST_EMPTY(&s_timers[dispatch_method])) {
+        if (timer_first(dispatch_method) != NULL) {
             return ESP_ERR_INVALID_STATE;
         }
     }
@@ -616,15 +663,18 @@ static void print_timer_info(esp_timer_handle_t t, char** dst, size_t* dst_size)
     } else {
         cb = snprintf(*dst, *dst_size, "timer@%-10p  ", t);
     }
-    cb += snprintf(*dst + cb, *dst_size + cb, "%-10lld  %-12lld  %-12d  %-12d  %-12d  %-12lld\n",
-                    (uint64_t)t->period, t->alarm, t->times_armed,
+    cb = MIN(cb, *dst_size);
+    cb += snprintf(*dst + cb, *dst_size - cb, "%-10" PRIu64 "  %-12" PRIu64 "  %-12zu  %-12zu  %-12zu  %-12" PRIu64 "\n",
+                    (uint64_t)t->period, t->node.alarm, t->times_armed,
                     t->times_triggered, t->times_skipped, t->total_callback_run_time);
     /* keep this in sync with the format string, used in esp_timer_dump */
-#define TIMER_INFO_LINE_LEN 90
+#define TIMER_INFO_LINE_LEN 103
 #else
-    size_t cb = snprintf(*dst, *dst_size, "timer@%-14p  %-10lld  %-12lld\n", t, (uint64_t)t->period, t->alarm);
-#define TIMER_INFO_LINE_LEN 46
+    size_t cb = snprintf(*dst, *dst_size, "timer@%-14p  %-10" PRIu64 "  %-12" PRIu64 "\n", t, (uint64_t)t->period, t->node.alarm);
+#define TIMER_INFO_LINE_LEN 47
 #endif
+    // the output is truncated if the buffer is full
+    cb = MIN(cb, *dst_size);
     *dst += cb;
     *dst_size -= cb;
 }
@@ -644,7 +694,7 @@ esp_err_t esp_timer_dump(FILE* stream)
     size_t timer_count = 0;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        for (it = timer_first(dispatch_method); it != NULL; it = timer_next(dispatch_method, it)) {
             ++timer_count;
         }
 #if WITH_PROFILING
@@ -670,7 +720,7 @@ esp_err_t esp_timer_dump(FILE* stream)
     char* pos = print_buf;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        for (it = timer_first(dispatch_method); it != NULL; it = timer_next(dispatch_method, it)) {
             print_timer_info(it, &pos, &buf_size);
         }
 #if WITH_PROFILING
@@ -703,10 +753,10 @@ int64_t IRAM_ATTR esp_timer_get_next_alarm(void)
     int64_t next_alarm = INT64_MAX;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        esp_timer_handle_t it = LIST_FIRST(&s_timers[dispatch_method]);
+        esp_timer_handle_t it = timer_first(dispatch_method);
         if (it) {
-            if (next_alarm > it->alarm) {
-                next_alarm = it->alarm;
+            if (next_alarm > it->node.alarm) {
+                next_alarm = it->node.alarm;
             }
         }
         timer_list_unlock(dispatch_method);
@@ -720,13 +770,13 @@ int64_t IRAM_ATTR esp_timer_get_next_alarm_for_wake_up(void)
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
         esp_timer_handle_t it = NULL;
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        // The queue is not necessarily sorted, so all timers are checked
+        for (it = timer_first(dispatch_method); it != NULL; it = timer_next(dispatch_method, it)) {
             // timers with the SKIP_UNHANDLED_EVENTS flag do not want to wake up CPU from a sleep mode.
             if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) == 0) {
-                if (next_alarm > it->alarm) {
-                    next_alarm = it->alarm;
+                if (next_alarm > it->node.alarm) {
+                    next_alarm = it->node.alarm;
                 }
-                break;
             }
         }
         timer_list_unlock(dispatch_method);
@@ -763,7 +813,7 @@ esp_err_t IRAM_ATTR esp_timer_get_expiry_time(esp_timer_handle_t timer, uint64_t
     esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
 
     timer_list_lock(dispatch_method);
-    *expiry = timer->alarm;
+    *expiry = timer->node.alarm;
     timer_list_unlock(dispatch_method);
 
     return ESP_OK;
@@ -0,0 +1,257 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include "sdkconfig.h"
+#include "esp_timer_impl.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @file esp_timer_impl_linux.c
+ * @brief Implementation of esp_timer for the Linux target.
+ *
+ * The counter is CLOCK_MONOTONIC, counting from esp_timer_impl_early_init.
+ *
+ * The alarm is emulated by a host thread which sleeps until the alarm time, then raises
+ * ALARM_SIGNAL for the process. The FreeRTOS POSIX port emulates interrupts by signals:
+ * the signal is handled by the thread of the running task (all the other threads block
+ * all signals), and it is held pending while the task is in a critical section. The signal
+ * handler calls the upper layer handler like the alarm interrupt does on the chips, so timers
+ * with the ESP_TIMER_ISR dispatch method run in an emulated interrupt context.
+ *
+ * @note Threads created by the application directly with pthread_create must block ALARM_SIGNAL.
+ */
+
+static const char *TAG = "esp_timer_linux";
+
+#define ALARM_SIGNAL SIGUSR2
+
+/* Function from the upper layer to be called when the alarm fires.
+ * Registered in esp_timer_impl_init.
+ */
+static intr_handler_t s_alarm_handler = NULL;
+
+/* Spinlock used to protect access to the alarm values. */
+extern portMUX_TYPE s_time_update_lock;
+
+/* Alarm values to generate interrupt on match */
+extern uint64_t timestamp_id[2];
+
+/* CLOCK_MONOTONIC time of esp_timer_impl_early_init, in nanoseconds */
+static uint64_t s_start_ns;
+
+/* Adjustment of the counter by esp_timer_impl_set and esp_timer_impl_advance, in microseconds */
+static int64_t s_offset_us;
+
+/* State of the alarm thread, protected by s_alarm_mutex. The mutex is only taken by tasks
+ * inside the critical section, so the signal handler never interrupts a thread holding it.
+ */
+static pthread_mutex_t s_alarm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_alarm_cond;
+static pthread_t s_alarm_thread;
+static bool s_alarm_thread_running;
+static bool s_alarm_thread_stop;
+static uint64_t s_alarm_us = UINT64_MAX;    // alarm register, UINT64_MAX if no alarm is set
+static bool s_alarm_armed;                  // the alarm fires when the counter reaches s_alarm_us
+
+/* Interrupt status, set by the alarm thread and cleared by the signal handler */
+static bool s_alarm_fired;
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t IRAM_ATTR esp_timer_impl_get_counter_reg(void)
+{
+    return (monotonic_ns() - s_start_ns) / 1000 + __atomic_load_n(&s_offset_us, __ATOMIC_RELAXED);
+}
+
+int64_t IRAM_ATTR esp_timer_impl_get_time(void)
+{
+    return esp_timer_impl_get_counter_reg();
+}
+
+int64_t esp_timer_get_time(void) __attribute__((alias("esp_timer_impl_get_time")));
+
+void IRAM_ATTR esp_timer_impl_set_alarm_id(uint64_t timestamp, unsigned alarm_id)
+{
+    assert(alarm_id < sizeof(timestamp_id) / sizeof(timestamp_id[0]));
+    portENTER_CRITICAL_SAFE(&s_time_update_lock);
+    timestamp_id[alarm_id] = timestamp;
+    pthread_mutex_lock(&s_alarm_mutex);
+    s_alarm_us = MIN(timestamp_id[0], timestamp_id[1]);
+    s_alarm_armed = (s_alarm_us != UINT64_MAX);
+    pthread_cond_signal(&s_alarm_cond);
+    pthread_mutex_unlock(&s_alarm_mutex);
+    portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+}
+
+static void *alarm_thread(void *arg)
+{
+    pthread_mutex_lock(&s_alarm_mutex);
+    while (!s_alarm_thread_stop) {
+        if (!s_alarm_armed) {
+            pthread_cond_wait(&s_alarm_cond, &s_alarm_mutex);
+            continue;
+        }
+        /* The counter may have been moved by esp_timer_impl_advance since the last wait */
+        uint64_t now_us = esp_timer_impl_get_counter_reg();
+        if (now_us >= s_alarm_us) {
+            /* One-shot alarm, like on the chips the upper layer sets the next one */
+            s_alarm_armed = false;
+            __atomic_store_n(&s_alarm_fired, true, __ATOMIC_RELEASE);
+            kill(getpid(), ALARM_SIGNAL);
+            continue;
+        }
+        uint64_t wake_ns = monotonic_ns() + (s_alarm_us - now_us) * 1000;
+        struct timespec deadline = {
+            .tv_sec = wake_ns / 1000000000ULL,
+            .tv_nsec = wake_ns % 1000000000ULL,
+        };
+        pthread_cond_timedwait(&s_alarm_cond, &s_alarm_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&s_alarm_mutex);
+    return NULL;
+}
+
+static void alarm_signal_handler(int sig)
+{
+    /* ALARM_SIGNAL is not queued, one signal may be handled for several alarms
+     * and a signal may arrive after the handler has already processed its alarm.
+     */
+    if (__atomic_exchange_n(&s_alarm_fired, false, __ATOMIC_ACQUIRE) && s_alarm_handler != NULL) {
+        vPortRunInterruptHandler(s_alarm_handler, NULL);
+    }
+}
+
+void IRAM_ATTR esp_timer_impl_update_apb_freq(uint32_t apb_ticks_per_us)
+{
+    /* The host clock doesn't depend on the APB frequency */
+}
+
+/* Called in the critical section */
+static void set_offset(int64_t offset_us)
+{
+    pthread_mutex_lock(&s_alarm_mutex);
+    __atomic_store_n(&s_offset_us, offset_us, __ATOMIC_RELAXED);
+    /* wake the alarm thread up to recalculate the wait time */
+    pthread_cond_signal(&s_alarm_cond);
+    pthread_mutex_unlock(&s_alarm_mutex);
+}
+
+void esp_timer_impl_set(uint64_t new_us)
+{
+    portENTER_CRITICAL_SAFE(&s_time_update_lock);
+    set_offset(s_offset_us + (int64_t) new_us - esp_timer_impl_get_time());
+    portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+}
+
+void esp_timer_impl_advance(int64_t time_diff_us)
+{
+    portENTER_CRITICAL_SAFE(&s_time_update_lock);
+    set_offset(s_offset_us + time_diff_us);
+    portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+}
+
+esp_err_t esp_timer_impl_early_init(void)
+{
+    s_start_ns = monotonic_ns();
+
+    /* the alarm thread waits for the alarm time on the same clock as the counter */
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_alarm_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_impl_init(intr_handler_t alarm_handler)
+{
+    if (s_alarm_thread_running) {
+        ESP_EARLY_LOGE(TAG, "timer ISR is already initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct sigaction sigalarm = {
+        .sa_handler = alarm_signal_handler,
+    };
+    /* Like the other interrupts of the POSIX port, the handler runs with all signals blocked */
+    sigfillset(&sigalarm.sa_mask);
+    if (sigaction(ALARM_SIGNAL, &sigalarm, NULL) != 0) {
+        ESP_EARLY_LOGE(TAG, "sigaction failed");
+        return ESP_FAIL;
+    }
+
+    s_alarm_handler = alarm_handler;
+    s_alarm_thread_stop = false;
+
+    /* The alarm thread is not a task, it must never handle the signals emulating interrupts.
+     * It inherits the signal mask of the calling thread.
+     */
+    sigset_t all_signals, prev_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &prev_signals);
+    int ret = pthread_create(&s_alarm_thread, NULL, alarm_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &prev_signals, NULL);
+    if (ret != 0) {
+        ESP_EARLY_LOGE(TAG, "pthread_create failed (%s)", strerror(ret));
+        s_alarm_handler = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    s_alarm_thread_running = true;
+    return ESP_OK;
+}
+
+void esp_timer_impl_deinit(void)
+{
+    if (s_alarm_thread_running) {
+        portENTER_CRITICAL_SAFE(&s_time_update_lock);
+        pthread_mutex_lock(&s_alarm_mutex);
+        s_alarm_thread_stop = true;
+        pthread_cond_signal(&s_alarm_cond);
+        pthread_mutex_unlock(&s_alarm_mutex);
+        portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+        pthread_join(s_alarm_thread, NULL);
+        s_alarm_thread_running = false;
+    }
+    s_alarm_armed = false;
+    __atomic_store_n(&s_alarm_fired, false, __ATOMIC_RELAXED);
+    s_alarm_handler = NULL;
+}
+
+uint64_t esp_timer_impl_get_alarm_reg(void)
+{
+    portENTER_CRITICAL_SAFE(&s_time_update_lock);
+    uint64_t val = s_alarm_us;
+    portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+    return val;
+}
+
+#if CONFIG_ESP_TIME_FUNCS_USE_ESP_TIMER
+void esp_timer_impl_init_system_time(void)
+{
+    /* The system time is provided by the host */
+}
+#endif
+
+void esp_timer_private_update_apb_freq(uint32_t apb_ticks_per_us) __attribute__((alias("esp_timer_impl_update_apb_freq")));
+void esp_timer_private_set(uint64_t new_us) __attribute__((alias("esp_timer_impl_set")));
+void esp_timer_private_advance(int64_t time_diff_us) __attribute__((alias("esp_timer_impl_advance")));
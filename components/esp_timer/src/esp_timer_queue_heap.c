@@ -0,0 +1,140 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * 4-ary min-heap of armed timers.
+ *
+ * The children of the node at index i are at 4 * i + 1 ... 4 * i + 4. A wider heap is
+ * shallower than a binary one, so inserting a timer, which sifts it up, touches fewer
+ * nodes, at the cost of more comparisons when sifting down after the first timer expires.
+ * Each node keeps its index, so that a timer can be removed without searching for it.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer_queue.h"
+
+#define HEAP_ARITY          4
+#define HEAP_MIN_CAPACITY   8
+
+static inline IRAM_ATTR bool node_before(const esp_timer_queue_node_t* a, const esp_timer_queue_node_t* b)
+{
+    return a->alarm < b->alarm || (a->alarm == b->alarm && (int32_t)(a->seq - b->seq) < 0);
+}
+
+static inline IRAM_ATTR void node_place(esp_timer_queue_t* queue, esp_timer_queue_node_t* node, uint32_t index)
+{
+    queue->nodes[index] = node;
+    node->index = index;
+}
+
+static IRAM_ATTR void sift_up(esp_timer_queue_t* queue, esp_timer_queue_node_t* node, uint32_t index)
+{
+    while (index > 0) {
+        uint32_t parent = (index - 1) / HEAP_ARITY;
+        if (!node_before(node, queue->nodes[parent])) {
+            break;
+        }
+        node_place(queue, queue->nodes[parent], index);
+        index = parent;
+    }
+    node_place(queue, node, index);
+}
+
+static IRAM_ATTR void sift_down(esp_timer_queue_t* queue, esp_timer_queue_node_t* node, uint32_t index)
+{
+    while (true) {
+        uint32_t first_child = HEAP_ARITY * index + 1;
+        if (first_child >= queue->count) {
+            break;
+        }
+        uint32_t last_child = MIN(first_child + HEAP_ARITY, queue->count);
+        uint32_t min_child = first_child;
+        for (uint32_t child = first_child + 1; child < last_child; child++) {
+            if (node_before(queue->nodes[child], queue->nodes[min_child])) {
+                min_child = child;
+            }
+        }
+        if (!node_before(queue->nodes[min_child], node)) {
+            break;
+        }
+        node_place(queue, queue->nodes[min_child], index);
+        index = min_child;
+    }
+    node_place(queue, node, index);
+}
+
+void IRAM_ATTR esp_timer_queue_insert(esp_timer_queue_t* queue, esp_timer_queue_node_t* node)
+{
+    // esp_timer_create reserves a node for each timer
+    assert(queue->count < queue->capacity);
+    node->seq = queue->seq++;
+    sift_up(queue, node, queue->count++);
+}
+
+void IRAM_ATTR esp_timer_queue_remove(esp_timer_queue_t* queue, esp_timer_queue_node_t* node)
+{
+    uint32_t index = node->index;
+    assert(index < queue->count && queue->nodes[index] == node);
+    esp_timer_queue_node_t* last = queue->nodes[--queue->count];
+    if (last == node) {
+        return;
+    }
+    // Move the last node into the hole, then restore the heap order in the direction it is violated
+    if (index > 0 && node_before(last, queue->nodes[(index - 1) / HEAP_ARITY])) {
+        sift_up(queue, last, index);
+    } else {
+        sift_down(queue, last, index);
+    }
+}
+
+esp_timer_queue_node_t* IRAM_ATTR esp_timer_queue_first(esp_timer_queue_t* queue)
+{
+    return queue->count ? queue->nodes[0] : NULL;
+}
+
+esp_timer_queue_node_t* IRAM_ATTR esp_timer_queue_next(esp_timer_queue_t* queue, esp_timer_queue_node_t* node)
+{
+    uint32_t index = node->index + 1;
+    return index < queue->count ? queue->nodes[index] : NULL;
+}
+
+esp_err_t esp_timer_queue_reserve(esp_timer_queue_t* queue, size_t count, portMUX_TYPE* lock)
+{
+    portENTER_CRITICAL_SAFE(lock);
+    uint32_t capacity = queue->capacity;
+    portEXIT_CRITICAL_SAFE(lock);
+
+    while (capacity < count) {
+        uint32_t new_capacity = MAX(MAX(capacity * 2, HEAP_MIN_CAPACITY), count);
+        // The heap is accessed from the timer ISR, so it has to be in internal memory
+        esp_timer_queue_node_t** nodes = heap_caps_malloc(new_capacity * sizeof(*nodes), MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+        if (nodes == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        esp_timer_queue_node_t** old_nodes = nodes;
+        portENTER_CRITICAL_SAFE(lock);
+        // Another task may have grown the heap in the meantime
+        if (queue->capacity < new_capacity) {
+            if (queue->count) {
+                memcpy(nodes, queue->nodes, queue->count * sizeof(*nodes));
+            }
+            old_nodes = queue->nodes;
+            queue->nodes = nodes;
+            queue->capacity = new_capacity;
+        }
+        capacity = queue->capacity;
+        portEXIT_CRITICAL_SAFE(lock);
+
+        free(old_nodes);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2017-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include "esp_attr.h"
+
+#ifndef NDEBUG
+// Enable built-in checks in queue.h in debug builds
+#define INVARIANTS
+#endif
+#include "esp_timer_queue.h"
+
+void IRAM_ATTR esp_timer_queue_insert(esp_timer_queue_t* queue, esp_timer_queue_node_t* node)
+{
+    esp_timer_queue_node_t *it, *last = NULL;
+    if (LIST_FIRST(&queue->list) == NULL) {
+        LIST_INSERT_HEAD(&queue->list, node, list_entry);
+    } else {
+        LIST_FOREACH(it, &queue->list, list_entry) {
+            if (node->alarm < it->alarm) {
+                LIST_INSERT_BEFORE(it, node, list_entry);
+                break;
+            }
+            last = it;
+        }
+        if (it == NULL) {
+            assert(last);
+            LIST_INSERT_AFTER(last, node, list_entry);
+        }
+    }
+}
+
+void IRAM_ATTR esp_timer_queue_remove(esp_timer_queue_t* queue, esp_timer_queue_node_t* node)
+{
+    LIST_REMOVE(node, list_entry);
+}
+
+esp_timer_queue_node_t* IRAM_ATTR esp_timer_queue_first(esp_timer_queue_t* queue)
+{
+    return LIST_FIRST(&queue->list);
+}
+
+esp_timer_queue_node_t* IRAM_ATTR esp_timer_queue_next(esp_timer_queue_t* queue, esp_timer_queue_node_t* node)
+{
+    return LIST_NEXT(node, list_entry);
+}
+
+esp_err_t esp_timer_queue_reserve(esp_timer_queue_t* queue, size_t count, portMUX_TYPE* lock)
+{
+    // The nodes are linked, nothing to reserve
+    return ESP_OK;
+}
@@ -0,0 +1,12 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+// The tests run on a single thread, the queue locks do nothing
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define portENTER_CRITICAL_SAFE(mux)    ((void) (mux))
+#define portEXIT_CRITICAL_SAFE(mux)     ((void) (mux))
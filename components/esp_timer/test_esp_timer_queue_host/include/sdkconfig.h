@@ -0,0 +1,8 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+// The queue backend is selected by test_all_configs.sh, CONFIG_ESP_TIMER_QUEUE_LIST or CONFIG_ESP_TIMER_QUEUE_HEAP
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+#
+# Run the test suite with each timer queue backend
+#
+
+FAIL=0
+
+for FLAGS in "CONFIG_ESP_TIMER_QUEUE_LIST" "CONFIG_ESP_TIMER_QUEUE_HEAP" ; do
+    echo "==== Testing with config: ${FLAGS} ===="
+    CPPFLAGS="-D${FLAGS}" make clean test || FAIL=1
+done
+
+make clean
+
+if [ $FAIL == 0 ]; then
+    echo "All configurations passed"
+else
+    echo "Some configurations failed, see log."
+    exit 1
+fi
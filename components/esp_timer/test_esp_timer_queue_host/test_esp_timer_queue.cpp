@@ -0,0 +1,171 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "catch.hpp"
+
+extern "C" {
+#include "esp_heap_caps.h"
+#include "esp_timer_queue.h"
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+} // extern "C"
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void queue_clear(esp_timer_queue_t *queue)
+{
+#if CONFIG_ESP_TIMER_QUEUE_HEAP
+    free(queue->nodes);
+#endif
+    *queue = esp_timer_queue_t();
+}
+
+static size_t queue_size(esp_timer_queue_t *queue)
+{
+    size_t count = 0;
+    for (esp_timer_queue_node_t *it = esp_timer_queue_first(queue); it != NULL; it = esp_timer_queue_next(queue, it)) {
+        count++;
+    }
+    return count;
+}
+
+TEST_CASE("empty queue has no first node", "[esp_timer_queue]")
+{
+    esp_timer_queue_t queue = {};
+    CHECK(esp_timer_queue_first(&queue) == NULL);
+    CHECK(esp_timer_queue_reserve(&queue, 1, &s_lock) == ESP_OK);
+    CHECK(esp_timer_queue_first(&queue) == NULL);
+    queue_clear(&queue);
+}
+
+TEST_CASE("nodes with the same alarm keep the insertion order", "[esp_timer_queue]")
+{
+    const int count = 50;
+    esp_timer_queue_t queue = {};
+    std::vector<esp_timer_queue_node_t> nodes(count);
+
+    REQUIRE(esp_timer_queue_reserve(&queue, count, &s_lock) == ESP_OK);
+    for (int i = 0; i < count; i++) {
+        nodes[i].alarm = 1000 + (i % 2) * 10;
+        esp_timer_queue_insert(&queue, &nodes[i]);
+    }
+    // all nodes with alarm 1000 (even indexes) first, then the ones with 1010, each in insertion order
+    for (int i = 0; i < count; i++) {
+        esp_timer_queue_node_t *first = esp_timer_queue_first(&queue);
+        int expected = (i < count / 2) ? 2 * i : 2 * (i - count / 2) + 1;
+        CHECK(first == &nodes[expected]);
+        esp_timer_queue_remove(&queue, first);
+    }
+    CHECK(esp_timer_queue_first(&queue) == NULL);
+    queue_clear(&queue);
+}
+
+TEST_CASE("queue returns the earliest alarm after random inserts and removals", "[esp_timer_queue]")
+{
+    const int count = 300;
+    esp_timer_queue_t queue = {};
+    std::vector<esp_timer_queue_node_t> nodes(count);
+    std::vector<bool> armed(count, false);
+    std::set<std::pair<uint64_t, int>> reference;
+    std::mt19937 rng(1);
+
+    for (int step = 0; step < 20000; step++) {
+        int i = rng() % count;
+        // grow the queue while it is in use
+        size_t limit = step / 50 + 1;
+        REQUIRE(esp_timer_queue_reserve(&queue, limit, &s_lock) == ESP_OK);
+        if (armed[i]) {
+            esp_timer_queue_remove(&queue, &nodes[i]);
+            reference.erase({nodes[i].alarm, i});
+            armed[i] = false;
+        } else if (reference.size() < limit) {
+            nodes[i].alarm = 1 + rng() % 1000;
+            esp_timer_queue_insert(&queue, &nodes[i]);
+            reference.insert({nodes[i].alarm, i});
+            armed[i] = true;
+        }
+
+        esp_timer_queue_node_t *first = esp_timer_queue_first(&queue);
+        if (reference.empty()) {
+            REQUIRE(first == NULL);
+        } else {
+            REQUIRE(first != NULL);
+            REQUIRE(first->alarm == reference.begin()->first);
+        }
+        if (step % 1000 == 0) {
+            REQUIRE(queue_size(&queue) == reference.size());
+        }
+    }
+    queue_clear(&queue);
+}
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Arms 'count' periodic timers and measures the two operations of esp_timer which update the queue:
+ * - rearm: esp_timer_restart or esp_timer_stop followed by a start, a random timer gets a new alarm
+ * - expiry: timer_process_alarm takes the first timer and inserts it again with the next period
+ */
+TEST_CASE("timer queue benchmark", "[esp_timer_queue][bench]")
+{
+    const int ops = 200000;
+    printf("%-10s %8s %14s %14s\n", "backend", "timers", "rearm ns/op", "expiry ns/op");
+
+    for (int count = 16; count <= 4096; count *= 4) {
+        esp_timer_queue_t queue = {};
+        std::vector<esp_timer_queue_node_t> nodes(count);
+        std::vector<uint64_t> periods(count);
+        std::mt19937 rng(count);
+        uint64_t now = 0;
+
+        REQUIRE(esp_timer_queue_reserve(&queue, count, &s_lock) == ESP_OK);
+        for (int i = 0; i < count; i++) {
+            periods[i] = 1000 + rng() % 100000;
+            nodes[i].alarm = periods[i];
+            esp_timer_queue_insert(&queue, &nodes[i]);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int op = 0; op < ops; op++) {
+            esp_timer_queue_node_t *node = &nodes[rng() % count];
+            esp_timer_queue_remove(&queue, node);
+            node->alarm = now + periods[node - nodes.data()];
+            esp_timer_queue_insert(&queue, node);
+        }
+        uint64_t rearm_ns = elapsed_ns(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int op = 0; op < ops; op++) {
+            esp_timer_queue_node_t *node = esp_timer_queue_first(&queue);
+            esp_timer_queue_remove(&queue, node);
+            now = node->alarm;
+            node->alarm += periods[node - nodes.data()];
+            esp_timer_queue_insert(&queue, node);
+        }
+        uint64_t expiry_ns = elapsed_ns(start);
+
+        CHECK(queue_size(&queue) == (size_t) count);
+        printf("%-10s %8d %14.1f %14.1f\n",
+#if CONFIG_ESP_TIMER_QUEUE_HEAP
+               "heap",
+#else
+               "list",
+#endif
+               count, (double) rearm_ns / ops, (double) expiry_ns / ops);
+        queue_clear(&queue);
+    }
+}
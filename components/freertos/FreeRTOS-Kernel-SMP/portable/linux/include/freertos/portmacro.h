@@ -252,6 +252,17 @@ static inline BaseType_t xPortInIsrContext(void)
     return xPortCheckIfInISR();
 }
 
+/**
+ * @brief Runs the handler of an emulated interrupt
+ *
+ * Interrupts are emulated by signals on the POSIX simulator. Signal handlers emulating a peripheral interrupt
+ * call the interrupt handler through this function, so that xPortInIsrContext() returns pdTRUE while it runs.
+ *
+ * @param pxHandler Interrupt handler
+ * @param pvArg Argument of the handler
+ */
+void vPortRunInterruptHandler(void (*pxHandler)(void *), void *pvArg);
+
 // xPortInterruptedFromISRContext() is only used in panic handler and core dump,
 // both probably not relevant on POSIX sim.
 //BaseType_t xPortInterruptedFromISRContext(void);
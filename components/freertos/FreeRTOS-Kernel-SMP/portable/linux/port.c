@@ -106,7 +106,10 @@ static pthread_t hMainThread = ( pthread_t )NULL;
 
 // These are saved as part of a thread's state in prvSwitchThread()
 static volatile portBASE_TYPE uxCriticalNestingIDF = 0; /* Track nesting calls for IDF style critical sections. FreeRTOS critical section nesting is maintained in the TCB. */
-static volatile UBaseType_t uxInterruptNesting = 0;     /* Tracks if we are currently in an interrupt. */
+static __thread volatile UBaseType_t uxInterruptNesting = 0;     /* Tracks if we are currently in an interrupt.
+                                                                  * Per thread, as in the non-SMP port, so that host
+                                                                  * threads which emulate peripherals never see the
+                                                                  * interrupt nesting of the running task. */
 static volatile portBASE_TYPE uxInterruptLevel = 0;              /* Tracks the current level (i.e., interrupt mask) */
 /*-----------------------------------------------------------*/
 
@@ -629,6 +632,13 @@ BaseType_t xPortCheckIfInISR(void)
     return (uxInterruptNesting == 0) ? pdFALSE : pdTRUE;
 }
 
+void vPortRunInterruptHandler(void (*pxHandler)(void *), void *pvArg)
+{
+    uxInterruptNesting++;
+    pxHandler(pvArg);
+    uxInterruptNesting--;
+}
+
 void app_main(void);
 
 static void main_task(void* args)
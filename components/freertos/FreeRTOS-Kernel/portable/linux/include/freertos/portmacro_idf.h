@@ -78,6 +78,17 @@ bool xPortcheckValidStackMem(const void *ptr);
 
 BaseType_t xPortCheckIfInISR(void);
 
+/**
+ * @brief Runs the handler of an emulated interrupt
+ *
+ * Interrupts are emulated by signals on the POSIX simulator. Signal handlers emulating a peripheral interrupt
+ * call the interrupt handler through this function, so that xPortInIsrContext() returns pdTRUE while it runs.
+ *
+ * @param pxHandler Interrupt handler
+ * @param pvArg Argument of the handler
+ */
+void vPortRunInterruptHandler(void (*pxHandler)(void *), void *pvArg);
+
 /**
  * @brief Checks if the current core is in an ISR context
  *
@@ -95,6 +106,11 @@ static inline BaseType_t xPortInIsrContext(void)
     return xPortCheckIfInISR();
 }
 
+/* Critical sections which can be entered both from tasks and interrupt handlers. The POSIX simulator
+ * only has one kind of critical section. */
+#define portENTER_CRITICAL_SAFE(mux)        portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_SAFE(mux)         portEXIT_CRITICAL(mux)
+
 #if CONFIG_FREERTOS_ENABLE_STATIC_TASK_CLEAN_UP
 /* If enabled, users must provide an implementation of vPortCleanUpTCB() */
 extern void vPortCleanUpTCB ( void *pxTCB );
@@ -26,7 +26,9 @@
 
 static const char *TAG = "port";
 
-static volatile UBaseType_t uxInterruptNesting = 0;
+/* Per thread: a task can be switched out in the middle of an emulated interrupt handler
+ * (portYIELD_FROM_ISR), then the next task must not run in interrupt context. */
+static __thread volatile UBaseType_t uxInterruptNesting = 0;
 
 /* When configSUPPORT_STATIC_ALLOCATION is set to 1 the application writer can
  * use a callback function to optionally provide the memory required by the idle
@@ -40,6 +42,13 @@ BaseType_t xPortCheckIfInISR(void)
     return uxInterruptNesting;
 }
 
+void vPortRunInterruptHandler(void (*pxHandler)(void *), void *pvArg)
+{
+    uxInterruptNesting++;
+    pxHandler(pvArg);
+    uxInterruptNesting--;
+}
+
 void app_main(void);
 
 static void main_task(void* args)
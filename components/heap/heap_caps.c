@@ -563,7 +563,8 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
     heap_t *heap;
     SLIST_FOREACH(heap, &registered_heaps, next) {
         if (heap_caps_match(heap, caps)) {
-            multi_heap_info_t hinfo;
+            /* The multi_heap_get_info of the ROM does not know about the cache fields */
+            multi_heap_info_t hinfo = { 0 };
             multi_heap_get_info(heap->heap, &hinfo);
 
             info->total_free_bytes += hinfo.total_free_bytes;
@@ -574,6 +575,9 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
             info->allocated_blocks += hinfo.allocated_blocks;
             info->free_blocks += hinfo.free_blocks;
             info->total_blocks += hinfo.total_blocks;
+            info->cached_free_bytes += hinfo.cached_free_bytes;
+            info->cache_hits += hinfo.cache_hits;
+            info->cache_misses += hinfo.cache_misses;
         }
     }
 }
@@ -592,12 +596,19 @@ void heap_caps_print_heap_info( uint32_t caps )
             printf("    largest_free_block %d alloc_blocks %d free_blocks %d total_blocks %d\n",
                    info.largest_free_block, info.allocated_blocks,
                    info.free_blocks, info.total_blocks);
+#if CONFIG_HEAP_CACHE
+            printf("    cached_free %d cache_hits %d cache_misses %d\n",
+                   info.cached_free_bytes, info.cache_hits, info.cache_misses);
+#endif
         }
     }
     printf("  Totals:\n");
     heap_caps_get_info(&info, caps);
 
     printf("    free %d allocated %d min_free %d largest_free_block %d\n", info.total_free_bytes, info.total_allocated_bytes, info.minimum_free_bytes, info.largest_free_block);
+#if CONFIG_HEAP_CACHE
+    printf("    cached_free %d cache_hits %d cache_misses %d\n", info.cached_free_bytes, info.cache_hits, info.cache_misses);
+#endif
 }
 
 bool heap_caps_check_integrity(uint32_t caps, bool print_errors)
@@ -168,6 +168,9 @@ typedef struct {
     size_t allocated_blocks;      ///<  Number of (variable size) blocks allocated in the heap.
     size_t free_blocks;           ///<  Number of (variable size) free blocks in the heap.
     size_t total_blocks;          ///<  Total number of (variable size) blocks in the heap.
+    size_t cached_free_bytes;     ///<  Free bytes held in the per-core caches of small blocks, included in total_free_bytes. 0 if CONFIG_HEAP_CACHE is disabled.
+    size_t cache_hits;            ///<  Number of allocations served from the per-core caches.
+    size_t cache_misses;          ///<  Number of allocations which had to refill a per-core cache from the heap.
 } multi_heap_info_t;
 
 /** @brief Return metadata about a given heap
@@ -73,12 +73,40 @@ void *multi_heap_get_block_owner(multi_heap_block_handle_t block)
 #define ALIGN_UP_BY(num, align) (((num) + ((align) - 1)) & ~((align) - 1))
 
 
+#ifdef MULTI_HEAP_CACHE
+/* Size classes of the per-core caches: 16, 32, 64 and 128 bytes. A class holds free
+   blocks of at least its size and less than twice its size. */
+#define CACHE_MIN_SIZE 16
+#define CACHE_NUM_CLASSES 4
+#define CACHE_MAX_SIZE (CACHE_MIN_SIZE << (CACHE_NUM_CLASSES - 1))
+
+/* Blocks are moved between a cache and the heap by batches of half a cache class */
+#define CACHE_BATCH_BLOCKS (MULTI_HEAP_CACHE_BLOCKS / 2)
+
+typedef struct cache_block {
+    struct cache_block *next;
+} cache_block_t;
+
+/* Free blocks of one core, still allocated from the point of view of TLSF */
+typedef struct {
+    multi_heap_lock_t lock;
+    cache_block_t *blocks[CACHE_NUM_CLASSES];
+    size_t num_blocks[CACHE_NUM_CLASSES];
+    size_t free_bytes;  // Bytes of the cached blocks, overhead included like in heap_t. Read without the lock by multi_heap_free_size()
+    size_t hits;        // Allocations served from the cache
+    size_t misses;      // Allocations which refilled the cache from the heap
+} heap_cache_t;
+#endif
+
 typedef struct multi_heap_info {
     void *lock;
     size_t free_bytes;
     size_t minimum_free_bytes;
     size_t pool_size;
     void* heap_data;
+#ifdef MULTI_HEAP_CACHE
+    heap_cache_t cache[MULTI_HEAP_NUM_CORES];
+#endif
 } heap_t;
 
 #if CONFIG_HEAP_TLSF_USE_ROM_IMPL
@@ -149,6 +177,12 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
     result->free_bytes = size - tlsf_size(result->heap_data);
     result->pool_size = size;
     result->minimum_free_bytes = result->free_bytes;
+#ifdef MULTI_HEAP_CACHE
+    memset(result->cache, 0, sizeof(result->cache));
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        MULTI_HEAP_LOCK_INIT(&result->cache[core].lock);
+    }
+#endif
     return result;
 }
 
@@ -196,13 +230,158 @@ bool multi_heap_is_free(multi_heap_block_handle_t block)
     return block_is_free(block);
 }
 
+#ifdef MULTI_HEAP_CACHE
+/* Move up to 'count' blocks from the heap to a cache class, returns the number of blocks moved.
+   Called with the lock of the cache held. */
+static size_t cache_refill(heap_t *heap, heap_cache_t *cache, int class, size_t count)
+{
+    const size_t size = CACHE_MIN_SIZE << class;
+    size_t moved = 0;
+    /* The blocks are handed out in the order TLSF allocated them */
+    cache_block_t *first = NULL;
+    cache_block_t **tail = &first;
+
+    multi_heap_internal_lock(heap);
+    while (moved < count) {
+        cache_block_t *block = tlsf_malloc(heap->heap_data, size);
+        if (block == NULL) {
+            break;
+        }
+        const size_t block_bytes = tlsf_block_size(block) + tlsf_alloc_overhead();
+        heap->free_bytes -= block_bytes;
+        cache->free_bytes += block_bytes;
+        *tail = block;
+        tail = &block->next;
+        moved++;
+    }
+    *tail = cache->blocks[class];
+    cache->blocks[class] = first;
+    /* The cached blocks are counted as allocated by the lifetime minimum */
+    if (heap->free_bytes < heap->minimum_free_bytes) {
+        heap->minimum_free_bytes = heap->free_bytes;
+    }
+    multi_heap_internal_unlock(heap);
+
+    cache->num_blocks[class] += moved;
+    return moved;
+}
+
+/* Move up to 'count' blocks from a cache class back to the heap. Called with the lock of the cache held. */
+static void cache_flush(heap_t *heap, heap_cache_t *cache, int class, size_t count)
+{
+    multi_heap_internal_lock(heap);
+    while (count > 0 && cache->blocks[class] != NULL) {
+        cache_block_t *block = cache->blocks[class];
+        cache->blocks[class] = block->next;
+        cache->num_blocks[class]--;
+        const size_t block_bytes = tlsf_block_size(block) + tlsf_alloc_overhead();
+        cache->free_bytes -= block_bytes;
+        heap->free_bytes += block_bytes;
+        tlsf_free(heap->heap_data, block);
+        count--;
+    }
+    multi_heap_internal_unlock(heap);
+}
+
+static void *cache_malloc(heap_t *heap, size_t size)
+{
+    /* Smallest class holding blocks of at least 'size' bytes */
+    int class = 0;
+    while ((CACHE_MIN_SIZE << class) < size) {
+        class++;
+    }
+
+    heap_cache_t *cache = &heap->cache[MULTI_HEAP_CORE_ID()];
+    multi_heap_lock_t *lock = &cache->lock;
+    MULTI_HEAP_LOCK(lock);
+    if (cache->blocks[class] != NULL) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+        cache_refill(heap, cache, class, CACHE_BATCH_BLOCKS);
+    }
+    cache_block_t *block = cache->blocks[class];
+    if (block != NULL) {
+        cache->blocks[class] = block->next;
+        cache->num_blocks[class]--;
+        cache->free_bytes -= tlsf_block_size(block) + tlsf_alloc_overhead();
+    }
+    MULTI_HEAP_UNLOCK(lock);
+    return block;
+}
+
+/* Put a block into the cache of the current core, returns false if it is not of a cached size */
+static bool cache_free(heap_t *heap, void *p)
+{
+    const size_t size = tlsf_block_size(p);
+    if (size < CACHE_MIN_SIZE || size >= 2 * CACHE_MAX_SIZE) {
+        return false;
+    }
+    /* Largest class not larger than the block */
+    int class = CACHE_NUM_CLASSES - 1;
+    while ((CACHE_MIN_SIZE << class) > size) {
+        class--;
+    }
+
+    heap_cache_t *cache = &heap->cache[MULTI_HEAP_CORE_ID()];
+    multi_heap_lock_t *lock = &cache->lock;
+    MULTI_HEAP_LOCK(lock);
+    if (cache->num_blocks[class] == MULTI_HEAP_CACHE_BLOCKS) {
+        cache_flush(heap, cache, class, CACHE_BATCH_BLOCKS);
+    }
+    cache_block_t *block = p;
+    block->next = cache->blocks[class];
+    cache->blocks[class] = block;
+    cache->num_blocks[class]++;
+    cache->free_bytes += size + tlsf_alloc_overhead();
+    MULTI_HEAP_UNLOCK(lock);
+    return true;
+}
+
+/* Sum of the free bytes of the caches, may be slightly out of date when read without the locks */
+static size_t cache_free_bytes(heap_t *heap)
+{
+    size_t free_bytes = 0;
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        free_bytes += heap->cache[core].free_bytes;
+    }
+    return free_bytes;
+}
+
+/* Return the blocks of all the caches to the heap, so that they can be merged into larger blocks.
+   Returns false if the caches were empty. Must be called without the lock of the heap held. */
+static bool cache_flush_all(heap_t *heap)
+{
+    if (cache_free_bytes(heap) == 0) {
+        return false;
+    }
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        multi_heap_lock_t *lock = &heap->cache[core].lock;
+        MULTI_HEAP_LOCK(lock);
+        for (int class = 0; class < CACHE_NUM_CLASSES; class++) {
+            cache_flush(heap, &heap->cache[core], class, MULTI_HEAP_CACHE_BLOCKS);
+        }
+        MULTI_HEAP_UNLOCK(lock);
+    }
+    return true;
+}
+#endif // MULTI_HEAP_CACHE
+
 void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
 {
     if (size == 0 || heap == NULL) {
         return NULL;
     }
 
-
+#ifdef MULTI_HEAP_CACHE
+    if (size <= CACHE_MAX_SIZE) {
+        void *result = cache_malloc(heap, size);
+        if (result) {
+            return result;
+        }
+    }
+retry:
+#endif
     multi_heap_internal_lock(heap);
     void *result = tlsf_malloc(heap->heap_data, size);
     if(result) {
@@ -214,6 +393,11 @@ void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
     }
     multi_heap_internal_unlock(heap);
 
+#ifdef MULTI_HEAP_CACHE
+    if (result == NULL && cache_flush_all(heap)) {
+        goto retry;
+    }
+#endif
     return result;
 }
 
@@ -225,6 +409,12 @@ void multi_heap_free_impl(multi_heap_handle_t heap, void *p)
 
     assert_valid_block(heap, block_from_ptr(p));
 
+#ifdef MULTI_HEAP_CACHE
+    if (cache_free(heap, p)) {
+        return;
+    }
+#endif
+
     multi_heap_internal_lock(heap);
     heap->free_bytes += tlsf_block_size(p);
     heap->free_bytes += tlsf_alloc_overhead();
@@ -246,6 +436,9 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
         return NULL;
     }
 
+#ifdef MULTI_HEAP_CACHE
+retry:
+#endif
     multi_heap_internal_lock(heap);
     size_t previous_block_size =  tlsf_block_size(p);
     void *result = tlsf_realloc(heap->heap_data, p, size);
@@ -261,6 +454,11 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
 
     multi_heap_internal_unlock(heap);
 
+#ifdef MULTI_HEAP_CACHE
+    if (result == NULL && size > 0 && cache_flush_all(heap)) {
+        goto retry;
+    }
+#endif
     return result;
 }
 
@@ -279,6 +477,9 @@ void *multi_heap_aligned_alloc_impl_offs(multi_heap_handle_t heap, size_t size,
         return NULL;
     }
 
+#ifdef MULTI_HEAP_CACHE
+retry:
+#endif
     multi_heap_internal_lock(heap);
     void *result = tlsf_memalign_offs(heap->heap_data, alignment, size, offset);
     if(result) {
@@ -290,6 +491,11 @@ void *multi_heap_aligned_alloc_impl_offs(multi_heap_handle_t heap, size_t size,
     }
     multi_heap_internal_unlock(heap);
 
+#ifdef MULTI_HEAP_CACHE
+    if (result == NULL && cache_flush_all(heap)) {
+        goto retry;
+    }
+#endif
     return result;
 }
 
@@ -376,7 +582,11 @@ size_t multi_heap_free_size_impl(multi_heap_handle_t heap)
         return 0;
     }
 
+#ifdef MULTI_HEAP_CACHE
+    return heap->free_bytes + cache_free_bytes(heap);
+#else
     return heap->free_bytes;
+#endif
 }
 
 size_t multi_heap_minimum_free_size_impl(multi_heap_handle_t heap)
@@ -415,6 +625,22 @@ void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
         return;
     }
 
+#ifdef MULTI_HEAP_CACHE
+    /* The caches are locked first, like when they are refilled */
+    size_t cached_blocks = 0;
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        heap_cache_t *cache = &heap->cache[core];
+        multi_heap_lock_t *lock = &cache->lock;
+        MULTI_HEAP_LOCK(lock);
+        for (int class = 0; class < CACHE_NUM_CLASSES; class++) {
+            cached_blocks += cache->num_blocks[class];
+        }
+        info->cached_free_bytes += cache->free_bytes;
+        info->cache_hits += cache->hits;
+        info->cache_misses += cache->misses;
+    }
+#endif
+
     multi_heap_internal_lock(heap);
     tlsf_walk_pool(tlsf_get_pool(heap->heap_data), multi_heap_get_info_tlsf, info);
     /* TLSF has an overhead per block. Calculate the total amount of overhead, it shall not be
@@ -425,5 +651,17 @@ void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
     info->total_free_bytes = heap->free_bytes;
     info->largest_free_block = tlsf_fit_size(heap->heap_data, info->largest_free_block);
     multi_heap_internal_unlock(heap);
+
+#ifdef MULTI_HEAP_CACHE
+    /* The cached blocks are allocated for TLSF, but free for the users of the heap */
+    info->total_allocated_bytes -= info->cached_free_bytes - cached_blocks * tlsf_alloc_overhead();
+    info->total_free_bytes += info->cached_free_bytes;
+    info->allocated_blocks -= cached_blocks;
+    info->free_blocks += cached_blocks;
+    for (int core = MULTI_HEAP_NUM_CORES - 1; core >= 0; core--) {
+        multi_heap_lock_t *lock = &heap->cache[core].lock;
+        MULTI_HEAP_UNLOCK(lock);
+    }
+#endif
 }
 #endif
@@ -21,3 +21,10 @@
 #define MULTI_HEAP_POISONING
 #define MULTI_HEAP_POISONING_SLOW
 #endif
+
+/* The per-core caches of small free blocks keep blocks allocated from the point of view of TLSF,
+   which would defeat heap poisoning */
+#if defined(CONFIG_HEAP_CACHE) && !defined(MULTI_HEAP_POISONING)
+#define MULTI_HEAP_CACHE
+#define MULTI_HEAP_CACHE_BLOCKS CONFIG_HEAP_CACHE_BLOCKS
+#endif
@@ -64,6 +64,11 @@ inline static void multi_heap_assert(bool condition, const char *format, int lin
     multi_heap_assert((CONDITION), "CORRUPT HEAP: multi_heap.c:%d detected at 0x%08x\n", \
                       __LINE__, (intptr_t)(ADDRESS))
 
+/* Number of per-core caches, and index of the cache to use from the current task or ISR.
+   Tasks can be moved to another core at any time, the caches are locked anyway. */
+#define MULTI_HEAP_NUM_CORES portNUM_PROCESSORS
+#define MULTI_HEAP_CORE_ID() xPortGetCoreID()
+
 #ifdef CONFIG_HEAP_TASK_TRACKING
 #include <freertos/task.h>
 #define MULTI_HEAP_BLOCK_OWNER TaskHandle_t task;
@@ -81,11 +86,70 @@ inline static void multi_heap_assert(bool condition, const char *format, int lin
 
 #define MULTI_HEAP_PRINTF printf
 #define MULTI_HEAP_STDERR_PRINTF(MSG, ...) fprintf(stderr, MSG, __VA_ARGS__)
+
+#ifdef ESP_PLATFORM
+
+/* No locking without an RTOS */
+typedef int multi_heap_lock_t;
+
 #define MULTI_HEAP_LOCK(PLOCK)  (void) (PLOCK)
 #define MULTI_HEAP_UNLOCK(PLOCK)  (void) (PLOCK)
 #define MULTI_HEAP_LOCK_INIT(PLOCK)  (void) (PLOCK)
 #define MULTI_HEAP_LOCK_STATIC_INITIALIZER  0
 
+#define MULTI_HEAP_NUM_CORES 1
+#define MULTI_HEAP_CORE_ID() 0
+
+#else // ESP_PLATFORM
+
+#include <pthread.h>
+
+/* On the host, a heap can be used by several threads once a recursive mutex is set as its lock */
+typedef pthread_mutex_t multi_heap_lock_t;
+
+#define MULTI_HEAP_LOCK(PLOCK) do {                         \
+        if ((PLOCK) != NULL) {                              \
+            pthread_mutex_lock((PLOCK));                    \
+        }                                                   \
+    } while(0)
+
+#define MULTI_HEAP_UNLOCK(PLOCK) do {                       \
+        if ((PLOCK) != NULL) {                              \
+            pthread_mutex_unlock((PLOCK));                  \
+        }                                                   \
+    } while(0)
+
+inline static void multi_heap_lock_init(multi_heap_lock_t *lock)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+#define MULTI_HEAP_LOCK_INIT(PLOCK) multi_heap_lock_init((PLOCK))
+#define MULTI_HEAP_LOCK_STATIC_INITIALIZER  PTHREAD_MUTEX_INITIALIZER
+
+/* Threads are assigned to the emulated cores in turn */
+#ifndef MULTI_HEAP_NUM_CORES
+#define MULTI_HEAP_NUM_CORES 2
+#endif
+
+inline static int multi_heap_host_core_id(void)
+{
+    static __thread int core_id = -1;
+    static int next_core_id;
+    if (core_id < 0) {
+        core_id = __atomic_fetch_add(&next_core_id, 1, __ATOMIC_RELAXED) % MULTI_HEAP_NUM_CORES;
+    }
+    return core_id;
+}
+
+#define MULTI_HEAP_CORE_ID() multi_heap_host_core_id()
+
+#endif // ESP_PLATFORM
+
 #define MULTI_HEAP_ASSERT(CONDITION, ADDRESS) assert((CONDITION) && "Heap corrupt")
 
 #define MULTI_HEAP_BLOCK_OWNER
@@ -171,6 +171,31 @@ TEST_CASE("heap_caps metadata test", "[heap]")
     TEST_ASSERT(after.minimum_free_bytes < original.total_free_bytes);
 }
 
+#if CONFIG_HEAP_CACHE
+TEST_CASE("heap_caps_get_info reports the per-core caches", "[heap]")
+{
+    void *p[8];
+    multi_heap_info_t before, info;
+    heap_caps_get_info(&before, MALLOC_CAP_INTERNAL);
+
+    for (int i = 0; i < 8; i++) {
+        p[i] = heap_caps_malloc(32, MALLOC_CAP_INTERNAL);
+        TEST_ASSERT_NOT_NULL(p[i]);
+    }
+    for (int i = 0; i < 8; i++) {
+        heap_caps_free(p[i]);
+    }
+    heap_caps_get_info(&info, MALLOC_CAP_INTERNAL);
+    heap_caps_print_heap_info(MALLOC_CAP_INTERNAL);
+
+    TEST_ASSERT_GREATER_THAN(before.cache_hits, info.cache_hits);
+    TEST_ASSERT_NOT_EQUAL(0, info.cached_free_bytes);
+    TEST_ASSERT(info.cached_free_bytes <= info.total_free_bytes);
+    /* the freed blocks are counted as free while they are cached */
+    TEST_ASSERT_INT32_WITHIN(200, before.total_free_bytes, info.total_free_bytes);
+}
+#endif // CONFIG_HEAP_CACHE
+
 /* Small function runs from IRAM to check that malloc/free/realloc
    all work OK when cache is disabled...
 */
@@ -51,6 +51,18 @@ def test_heap_in_flash(dut: Dut) -> None:
     dut.run_all_single_board_cases()
 
 
+@pytest.mark.generic
+@pytest.mark.supported_targets
+@pytest.mark.parametrize(
+    'config',
+    [
+        'heap_cache'
+    ]
+)
+def test_heap_cache(dut: Dut) -> None:
+    dut.run_all_single_board_cases()
+
+
 @pytest.mark.generic
 @pytest.mark.esp32
 @pytest.mark.esp32s2
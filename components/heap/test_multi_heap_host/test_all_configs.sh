@@ -5,7 +5,8 @@
 
 FAIL=0
 
-for FLAGS in "CONFIG_HEAP_POISONING_NONE" "CONFIG_HEAP_POISONING_LIGHT" "CONFIG_HEAP_POISONING_COMPREHENSIVE" ; do
+for FLAGS in "CONFIG_HEAP_POISONING_NONE" "CONFIG_HEAP_POISONING_LIGHT" "CONFIG_HEAP_POISONING_COMPREHENSIVE" \
+             "CONFIG_HEAP_POISONING_NONE -DCONFIG_HEAP_CACHE -DCONFIG_HEAP_CACHE_BLOCKS=16" ; do
     echo "==== Testing with config: ${FLAGS} ===="
     CPPFLAGS="-D${FLAGS}" make clean test || FAIL=1
 done
@@ -8,6 +8,11 @@
 
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 /* The functions __malloc__ and __free__ are used to call the libc
  * malloc and free and allocate memory from the host heap. Since the test
@@ -126,6 +131,10 @@ TEST_CASE("multi_heap fragmentation", "[multi_heap]")
     multi_heap_free(heap, big);
 }
 
+/* The per-core caches keep small freed blocks away from TLSF, the tests checking where TLSF
+   places the blocks don't apply with CONFIG_HEAP_CACHE */
+#ifndef MULTI_HEAP_CACHE
+
 /* Test that malloc/free does not leave free space fragmented */
 TEST_CASE("multi_heap defrag", "[multi_heap]")
 {
@@ -222,6 +231,8 @@ TEST_CASE("multi_heap defrag realloc", "[multi_heap]")
 }
 #endif
 
+#endif // MULTI_HEAP_CACHE
+
 
 void multi_heap_allocation_impl(int heap_size)
 {
@@ -439,9 +450,9 @@ TEST_CASE("multi_heap_realloc()", "[multi_heap]")
     REQUIRE( c > b ); /* 'a' moves, 'c' takes the block after 'b' */
     REQUIRE( *c == PATTERN );
 
-#ifndef MULTI_HEAP_POISONING_SLOW
+#if !defined(MULTI_HEAP_POISONING_SLOW) && !defined(MULTI_HEAP_CACHE)
     // "Slow" poisoning implementation doesn't reallocate in place, so these
-    // test will fail...
+    // test will fail... The per-core caches change which blocks are returned by malloc.
     uint32_t *d = (uint32_t *)multi_heap_realloc(heap, c, 36);
     REQUIRE( multi_heap_check(heap, true) );
     REQUIRE( c == d ); /* 'c' block should be shrunk in-place */
@@ -467,7 +478,7 @@ TEST_CASE("multi_heap_realloc()", "[multi_heap]")
     REQUIRE( multi_heap_check(heap, true) );
     REQUIRE( e == g ); /* 'g' extends 'e' in place, into the space formerly held by 'f' */
 
-#endif // MULTI_HEAP_POISONING_SLOW
+#endif // !MULTI_HEAP_POISONING_SLOW && !MULTI_HEAP_CACHE
 }
 
 // TLSF only accepts heaps aligned to 4-byte boundary so
@@ -555,6 +566,7 @@ TEST_CASE("multi_heap allocation overhead", "[multi_heap]")
  * by multi_heap_check(). For light poisoning and no poisoning, the test will
  * check that multi_heap_check() does not report the corruption.
  */
+#ifndef MULTI_HEAP_CACHE // the offsets below assume the layout of heap_t without the caches
 TEST_CASE("multi_heap poisoning detection", "[multi_heap]")
 {
     const size_t HEAP_SIZE = 4 * 1024;
@@ -615,3 +627,151 @@ TEST_CASE("multi_heap poisoning detection", "[multi_heap]")
         REQUIRE(is_heap_ok == true);
     }
 }
+#endif // MULTI_HEAP_CACHE
+
+#ifdef MULTI_HEAP_CACHE
+TEST_CASE("multi_heap cache serves small allocations", "[multi_heap][cache]")
+{
+    uint8_t heapdata[4 * 1024];
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    multi_heap_info_t before, info;
+    multi_heap_get_info(heap, &before);
+    REQUIRE( 0 == before.cached_free_bytes );
+
+    /* the first allocation refills the cache, the next ones are served from it */
+    void *p[4];
+    for (int i = 0; i < 4; i++) {
+        p[i] = multi_heap_malloc(heap, 24);
+        REQUIRE( p[i] != NULL );
+        REQUIRE( multi_heap_get_allocated_size(heap, p[i]) >= 24 );
+    }
+    multi_heap_get_info(heap, &info);
+    REQUIRE( 1 == info.cache_misses );
+    REQUIRE( 3 == info.cache_hits );
+    REQUIRE( info.cached_free_bytes > 0 );
+    REQUIRE( 4 == info.allocated_blocks );
+    REQUIRE( info.total_free_bytes == multi_heap_free_size(heap) );
+    REQUIRE( info.total_allocated_bytes == 4 * multi_heap_get_allocated_size(heap, p[0]) );
+
+    for (int i = 0; i < 4; i++) {
+        multi_heap_free(heap, p[i]);
+    }
+    REQUIRE( multi_heap_check(heap, true) );
+    multi_heap_get_info(heap, &info);
+    REQUIRE( 0 == info.allocated_blocks );
+    REQUIRE( 0 == info.total_allocated_bytes );
+    REQUIRE( before.total_free_bytes == info.total_free_bytes );
+    REQUIRE( before.total_free_bytes == multi_heap_free_size(heap) );
+    /* the cached blocks are counted as allocated by the lifetime minimum */
+    REQUIRE( info.minimum_free_bytes <= before.total_free_bytes - info.cached_free_bytes );
+}
+
+TEST_CASE("multi_heap cache is flushed when the heap runs out of memory", "[multi_heap][cache]")
+{
+    uint8_t heapdata[4 * 1024];
+    void *p[sizeof(heapdata) / 32];
+    const size_t NUM_P = sizeof(p) / sizeof(void *);
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    size_t before_free = multi_heap_free_size(heap);
+    size_t largest_size = before_free / 2;
+
+    /* fill the heap with small blocks of different size classes, then free them to the cache */
+    size_t i;
+    for (i = 0; i < NUM_P; i++) {
+        p[i] = multi_heap_malloc(heap, 16 << (i % 4));
+        if (p[i] == NULL) {
+            break;
+        }
+    }
+    REQUIRE( i < NUM_P );
+    for (size_t j = 0; j < i; j++) {
+        multi_heap_free(heap, p[j]);
+    }
+    REQUIRE( before_free == multi_heap_free_size(heap) );
+
+    /* a large allocation needs the cached blocks to be merged back */
+    void *large = multi_heap_malloc(heap, largest_size);
+    REQUIRE( large != NULL );
+    multi_heap_info_t info;
+    multi_heap_get_info(heap, &info);
+    REQUIRE( 0 == info.cached_free_bytes );
+    REQUIRE( multi_heap_check(heap, true) );
+
+    multi_heap_free(heap, large);
+    REQUIRE( before_free == multi_heap_free_size(heap) );
+}
+#endif // MULTI_HEAP_CACHE
+
+/* Measures the throughput of malloc and free of mostly small blocks by several threads sharing one heap.
+ * Each thread is assigned a different per-core cache when CONFIG_HEAP_CACHE is enabled.
+ */
+TEST_CASE("multi_heap multithreaded allocation benchmark", "[multi_heap][bench]")
+{
+    const size_t HEAP_SIZE = 256 * 1024;
+    const int NUM_THREADS = 2;
+    const int OPS_PER_THREAD = 500000;
+    const int SLOTS = 64;
+    uint8_t *heapdata = (uint8_t *)__malloc__(HEAP_SIZE);
+    multi_heap_handle_t heap = multi_heap_register(heapdata, HEAP_SIZE);
+    size_t before_free = multi_heap_free_size(heap);
+
+    pthread_mutexattr_t attr;
+    pthread_mutex_t lock;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&lock, &attr);
+    multi_heap_set_lock(heap, &lock);
+
+    std::atomic<int> failures(0);
+    auto worker = [&](unsigned seed) {
+        void *slots[SLOTS] = { NULL };
+        for (int op = 0; op < OPS_PER_THREAD; op++) {
+            int i = rand_r(&seed) % SLOTS;
+            if (slots[i] != NULL) {
+                multi_heap_free(heap, slots[i]);
+                slots[i] = NULL;
+            } else {
+                /* 7 allocations out of 8 are small enough to be cached */
+                size_t size = (rand_r(&seed) % 8) ? 1 + rand_r(&seed) % 128 : 256 + rand_r(&seed) % 1024;
+                slots[i] = multi_heap_malloc(heap, size);
+                if (slots[i] == NULL) {
+                    failures++;
+                } else {
+                    memset(slots[i], 0xA5, size);
+                }
+            }
+        }
+        for (int i = 0; i < SLOTS; i++) {
+            multi_heap_free(heap, slots[i]);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        threads.push_back(std::thread(worker, t + 1));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    multi_heap_info_t info;
+    multi_heap_get_info(heap, &info);
+    printf("%d threads, cache %s: %.0f ops/s, cache hits %zu misses %zu\n", NUM_THREADS,
+#ifdef MULTI_HEAP_CACHE
+           "on",
+#else
+           "off",
+#endif
+           NUM_THREADS * OPS_PER_THREAD / elapsed_s, info.cache_hits, info.cache_misses);
+
+    REQUIRE( 0 == failures );
+    REQUIRE( multi_heap_check(heap, true) );
+    REQUIRE( 0 == info.allocated_blocks );
+    REQUIRE( before_free == multi_heap_free_size(heap) );
+
+    pthread_mutex_destroy(&lock);
+    pthread_mutexattr_destroy(&attr);
+    __free__(heapdata);
+}
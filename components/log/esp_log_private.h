@@ -1,6 +1,32 @@
 #pragma once
 #include <stdbool.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
 
 void esp_log_impl_lock(void);
 bool esp_log_impl_lock_timeout(void);
 void esp_log_impl_unlock(void);
+
+// Returns true if a message of the given level and tag is to be printed
+bool esp_log_check_level(esp_log_level_t level, const char *tag);
+
+// Prints a message which passed esp_log_check_level(), staging it if asynchronous output is running
+void esp_log_print(const char *format, ...);
+
+// Prints with the function set by esp_log_set_vprintf()
+int esp_log_output(const char *format, ...);
+
+#if CONFIG_LOG_ASYNC
+// Stages a message if asynchronous output is running, returns false if the message has to be printed directly
+bool esp_log_async_stage(const char *format, va_list args);
+
+// Platform specific part of the asynchronous output, see log_async.c
+bool esp_log_impl_async_start(void (*drain_task)(void));
+void esp_log_impl_async_join(void);
+void esp_log_impl_async_wait(uint32_t timeout_ms);
+void esp_log_impl_async_wake(void);
+void esp_log_impl_async_delay(uint32_t ms);
+uint32_t esp_log_impl_async_producer_id(void);
+#endif // CONFIG_LOG_ASYNC
@@ -8,8 +8,16 @@
 */
 #define CATCH_CONFIG_MAIN
 #include <cstdio>
+#include <cstring>
 #include <regex>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 #include "esp_log.h"
 
 #include "catch.hpp"
@@ -279,3 +287,470 @@ TEST_CASE("changing early log level")
     ESP_EARLY_LOGI(TEST_TAG, "must indeed be printed");
     CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
 }
+
+#if CONFIG_LOG_ASYNC
+struct AsyncFixture {
+    AsyncFixture()
+    {
+        if (instance != nullptr) {
+            throw exception();
+        }
+        instance = this;
+        esp_log_level_set("*", ESP_LOG_INFO);
+        old_vprintf = esp_log_set_vprintf(print_callback);
+        esp_log_async_get_stats(&start_stats);
+        REQUIRE(esp_log_async_start());
+    }
+
+    ~AsyncFixture()
+    {
+        esp_log_async_stop();
+        esp_log_set_vprintf(old_vprintf);
+        instance = nullptr;
+    }
+
+    esp_log_async_stats_t get_stats() const
+    {
+        esp_log_async_stats_t stats;
+        esp_log_async_get_stats(&stats);
+        stats.staged -= start_stats.staged;
+        stats.dropped -= start_stats.dropped;
+        stats.batches -= start_stats.batches;
+        return stats;
+    }
+
+    std::mutex output_mutex;
+    string output;
+    std::atomic<bool> stalled {false};
+
+private:
+    static int print_callback(const char *format, va_list args)
+    {
+        while (instance->stalled) {
+            std::this_thread::yield();
+        }
+        char buffer[2048];
+        int ret = vsnprintf(buffer, sizeof(buffer), format, args);
+        std::lock_guard<std::mutex> lock(instance->output_mutex);
+        instance->output += buffer;
+        return ret;
+    }
+
+    static AsyncFixture *instance;
+
+    vprintf_like_t old_vprintf;
+    esp_log_async_stats_t start_stats;
+};
+
+AsyncFixture *AsyncFixture::instance = nullptr;
+
+TEST_CASE("asynchronous output keeps the order of each thread", "[async]")
+{
+    AsyncFixture fix;
+    const int threads = 4;
+    const int messages = 200;
+
+    vector<thread> producers;
+    for (int t = 0; t < threads; t++) {
+        producers.emplace_back([t] {
+            for (int i = 0; i < messages; i++) {
+                ESP_LOGI(TEST_TAG, "thread %d message %d", t, i);
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    esp_log_async_flush();
+
+    esp_log_async_stats_t stats = fix.get_stats();
+    CHECK(stats.staged + stats.dropped == threads * messages);
+
+    // every printed line is complete, and the messages of one thread are printed in order
+    const std::regex line_regex("I \\([0-9]*\\) test: thread ([0-9]+) message ([0-9]+)\n", std::regex::ECMAScript);
+    std::lock_guard<std::mutex> lock(fix.output_mutex);
+    int last[threads] = {-1, -1, -1, -1};
+    size_t printed = 0;
+    for (auto it = sregex_iterator(fix.output.begin(), fix.output.end(), line_regex); it != sregex_iterator(); ++it) {
+        int t = stoi((*it)[1]);
+        int i = stoi((*it)[2]);
+        CHECK(i > last[t]);
+        last[t] = i;
+        printed++;
+    }
+    CHECK(printed == stats.staged);
+    CHECK(stats.batches <= stats.staged);
+}
+
+TEST_CASE("asynchronous output counts dropped messages", "[async]")
+{
+    AsyncFixture fix;
+
+    // Let the drain task block in the output function, so that the rings fill up
+    fix.stalled = true;
+    const int messages = CONFIG_LOG_ASYNC_RING_SIZE * CONFIG_LOG_ASYNC_RING_COUNT / 16;
+    for (int i = 0; i < messages; i++) {
+        ESP_LOGI(TEST_TAG, "message %d", i);
+    }
+    esp_log_async_stats_t stats = fix.get_stats();
+    CHECK(stats.dropped > 0);
+    CHECK(stats.staged + stats.dropped == messages);
+
+    fix.stalled = false;
+    esp_log_async_flush();
+    std::lock_guard<std::mutex> lock(fix.output_mutex);
+    CHECK(fix.output.find("message 0\n") != string::npos);
+}
+
+static int s_bench_sink = -1;
+
+static int bench_vprintf(const char *format, va_list args)
+{
+    // Like an unbuffered console, every call of the output function is one write
+    char buffer[1024];
+    int ret = vsnprintf(buffer, sizeof(buffer), format, args);
+    if (ret > 0) {
+        ret = write(s_bench_sink, buffer, (ret < (int) sizeof(buffer)) ? ret : sizeof(buffer) - 1);
+    }
+    return ret;
+}
+
+TEST_CASE("logging throughput with 1 to 16 threads", "[async][bench]")
+{
+    // Compares the time the logging threads spend in ESP_LOGI with synchronous and asynchronous output
+    // to /dev/null. The asynchronous time doesn't include printing, which happens on the drain thread.
+    const int messages = 20000;
+    s_bench_sink = open("/dev/null", O_WRONLY);
+    REQUIRE(s_bench_sink >= 0);
+    esp_log_level_set("*", ESP_LOG_INFO);
+    vprintf_like_t old_vprintf = esp_log_set_vprintf(bench_vprintf);
+
+    for (int threads = 1; threads <= 16; threads *= 2) {
+        double seconds[2];
+        esp_log_async_stats_t before, after;
+        for (int async = 0; async < 2; async++) {
+            if (async) {
+                REQUIRE(esp_log_async_start());
+                esp_log_async_get_stats(&before);
+            }
+            auto start = chrono::steady_clock::now();
+            vector<thread> producers;
+            for (int t = 0; t < threads; t++) {
+                producers.emplace_back([t] {
+                    for (int i = 0; i < messages; i++) {
+                        ESP_LOGI(TEST_TAG, "thread %d message %d value 0x%08x", t, i, i * 2654435761u);
+                    }
+                });
+            }
+            for (auto &producer : producers) {
+                producer.join();
+            }
+            seconds[async] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (async) {
+                esp_log_async_get_stats(&after);
+                esp_log_async_stop();
+            }
+        }
+        uint32_t total = threads * messages;
+        uint32_t dropped = after.dropped - before.dropped;
+        printf("%2d threads: sync %6.2f Mmsg/s, async %6.2f Mmsg/s, %u of %u dropped, %u batches\n",
+               threads, total / seconds[0] / 1e6, total / seconds[1] / 1e6,
+               dropped, total, after.batches - before.batches);
+        CHECK(after.staged - before.staged + dropped == total);
+    }
+
+    esp_log_set_vprintf(old_vprintf);
+    close(s_bench_sink);
+}
+#endif // CONFIG_LOG_ASYNC
+
+// The format of a record is relative to the start of the executable on Linux
+extern "C" const char __executable_start[];
+static const uint8_t BINARY_FORMAT_RELATIVE = 0x40;
+
+struct BinaryRecord {
+    // Decodes the Base64 encoded record printed by esp_log_write_binary
+    BinaryRecord(const string &line)
+    {
+        REQUIRE(line.compare(0, 2, "#L") == 0);
+        REQUIRE(line.back() == '\n');
+        uint32_t group = 0;
+        int bits = 0;
+        for (char c : line.substr(2, line.size() - 3)) {
+            const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            if (c == '=') {
+                break;
+            }
+            const char *p = strchr(alphabet, c);
+            REQUIRE(p != nullptr);
+            group = (group << 6) | (p - alphabet);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                data.push_back((group >> bits) & 0xff);
+            }
+        }
+    }
+
+    uint8_t byte()
+    {
+        REQUIRE(pos < data.size());
+        return data[pos++];
+    }
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t b = byte();
+            value |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                return value;
+            }
+        }
+    }
+
+    int64_t zigzag()
+    {
+        uint64_t value = varint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    double float64()
+    {
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; i++) {
+            bits |= (uint64_t) byte() << (8 * i);
+        }
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    string str()
+    {
+        string value;
+        for (uint8_t c = byte(); c != 0; c = byte()) {
+            value += (char) c;
+        }
+        return value;
+    }
+
+    vector<uint8_t> data;
+    size_t pos = 0;
+};
+
+TEST_CASE("binary record", "[binary]")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    static const char format[] = "%d %5u %s %.2f %lld %c %.*s %zx %hhd %%";
+    esp_log_write_binary(ESP_LOG_WARN, TEST_TAG, format, -5, 300u, "str", 1.5, -1LL, 'x', 3, "precision", (size_t) 0xabcdef, -2);
+
+    BinaryRecord record(fix.get_print_buffer_string());
+    CHECK(record.byte() == (ESP_LOG_WARN | BINARY_FORMAT_RELATIVE));
+    record.varint();    // timestamp
+    CHECK(record.varint() == (uintptr_t) format - (uintptr_t) __executable_start);
+    CHECK(record.str() == TEST_TAG);
+    CHECK(record.zigzag() == -5);
+    CHECK(record.varint() == 300);
+    CHECK(record.str() == "str");
+    CHECK(record.float64() == 1.5);
+    CHECK(record.zigzag() == -1);
+    CHECK(record.varint() == 'x');
+    CHECK(record.zigzag() == 3);
+    CHECK(record.str() == "pre");
+    CHECK(record.varint() == 0xabcdef);
+    CHECK(record.zigzag() == -2);
+    CHECK(record.pos == record.data.size());
+}
+
+TEST_CASE("binary record is filtered by log level", "[binary]")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    esp_log_level_set(TEST_TAG, ESP_LOG_WARN);
+    esp_log_write_binary(ESP_LOG_INFO, TEST_TAG, "must not be printed %d", 1);
+    CHECK(fix.get_print_buffer_string().empty());
+
+    esp_log_write_binary(ESP_LOG_ERROR, TEST_TAG, "must indeed be printed %d", 1);
+    BinaryRecord record(fix.get_print_buffer_string());
+    CHECK(record.byte() == (ESP_LOG_ERROR | BINARY_FORMAT_RELATIVE));
+}
+
+TEST_CASE("binary record is truncated to the maximum length", "[binary]")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    string long_string(CONFIG_LOG_BINARY_MAX_RECORD_LEN * 2, 'a');
+    esp_log_write_binary(ESP_LOG_INFO, TEST_TAG, "%s %d", long_string.c_str(), 42);
+
+    BinaryRecord record(fix.get_print_buffer_string());
+    CHECK(record.data.size() == CONFIG_LOG_BINARY_MAX_RECORD_LEN);
+    CHECK(record.byte() == (ESP_LOG_INFO | BINARY_FORMAT_RELATIVE | 0x80));
+    record.varint();
+    record.varint();
+    CHECK(record.str() == TEST_TAG);
+    string truncated = record.str();
+    CHECK(truncated.size() < long_string.size());
+    CHECK(long_string.compare(0, truncated.size(), truncated) == 0);
+    CHECK(record.pos == record.data.size());
+}
+
+static int s_binary_bench_sink = -1;
+
+static int binary_bench_vprintf(const char *format, va_list args)
+{
+    char buffer[512];
+    int ret = vsnprintf(buffer, sizeof(buffer), format, args);
+    if (ret > 0) {
+        ret = write(s_binary_bench_sink, buffer, min(ret, (int) sizeof(buffer) - 1));
+    }
+    return ret;
+}
+
+TEST_CASE("text and binary logging cost", "[binary][bench]")
+{
+    // Compares the time spent in the log call and the number of bytes printed per message
+    const int messages = 100000;
+    s_binary_bench_sink = open("/dev/null", O_WRONLY);
+    REQUIRE(s_binary_bench_sink >= 0);
+    vprintf_like_t old_vprintf = esp_log_set_vprintf(binary_bench_vprintf);
+    esp_log_level_set("*", ESP_LOG_INFO);
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < messages; i++) {
+        esp_log_write(ESP_LOG_INFO, TEST_TAG, LOG_FORMAT(I, "message %d value 0x%08x temperature %.2f state %s"),
+                      esp_log_timestamp(), TEST_TAG, i, i * 2654435761u, i * 0.01, "running");
+    }
+    double text = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < messages; i++) {
+        esp_log_write_binary(ESP_LOG_INFO, TEST_TAG, "message %d value 0x%08x temperature %.2f state %s",
+                             i, i * 2654435761u, i * 0.01, "running");
+    }
+    double binary = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    char line[256];
+    int text_len = snprintf(line, sizeof(line), LOG_FORMAT(I, "message %d value 0x%08x temperature %.2f state %s"),
+                            esp_log_timestamp(), TEST_TAG, messages, messages * 2654435761u, messages * 0.01, "running");
+    PrintFixture fix(ESP_LOG_INFO);
+    esp_log_write_binary(ESP_LOG_INFO, TEST_TAG, "message %d value 0x%08x temperature %.2f state %s",
+                         messages, messages * 2654435761u, messages * 0.01, "running");
+    size_t binary_len = fix.get_print_buffer_string().size();
+    printf("text %.0f ns %d bytes, binary %.0f ns %zu bytes per message\n",
+           text / messages * 1e9, text_len, binary / messages * 1e9, binary_len);
+
+    esp_log_set_vprintf(old_vprintf);
+    close(s_binary_bench_sink);
+}
+
+TEST_CASE("levels of more tags than the cache holds", "[tags]")
+{
+    // Tags which don't get a cache slot are looked up in the list of all tags
+    const int tag_count = 300;
+    vector<string> tags;
+    for (int i = 0; i < tag_count; i++) {
+        tags.push_back("tag" + to_string(i));
+    }
+    esp_log_level_set("*", ESP_LOG_INFO);
+    for (int i = 0; i < tag_count; i++) {
+        CHECK(esp_log_level_get(tags[i].c_str()) == ESP_LOG_INFO);
+    }
+    for (int i = 0; i < tag_count; i += 3) {
+        esp_log_level_set(tags[i].c_str(), ESP_LOG_ERROR);
+    }
+    for (int i = 0; i < tag_count; i++) {
+        CHECK(esp_log_level_get(tags[i].c_str()) == ((i % 3 == 0) ? ESP_LOG_ERROR : ESP_LOG_INFO));
+    }
+
+    // A copy of a tag at another address has the same level
+    string copy = tags[3];
+    CHECK(esp_log_level_get(copy.c_str()) == ESP_LOG_ERROR);
+    esp_log_level_set(copy.c_str(), ESP_LOG_DEBUG);
+    CHECK(esp_log_level_get(tags[3].c_str()) == ESP_LOG_DEBUG);
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+    for (int i = 0; i < tag_count; i++) {
+        CHECK(esp_log_level_get(tags[i].c_str()) == ESP_LOG_WARN);
+    }
+    esp_log_level_set("*", ESP_LOG_INFO);
+}
+
+TEST_CASE("tag levels are not kept for the address of a tag after \"*\"", "[tags]")
+{
+    // A tag at a reused address, such as a freed and reallocated string, must not inherit the old level
+    char tag[8] = "old";
+    esp_log_level_set("*", ESP_LOG_INFO);
+    esp_log_level_set("old", ESP_LOG_ERROR);
+    CHECK(esp_log_level_get(tag) == ESP_LOG_ERROR);
+    esp_log_level_set("*", ESP_LOG_WARN);
+    esp_log_level_set("new", ESP_LOG_DEBUG);
+    strcpy(tag, "new");
+    CHECK(esp_log_level_get(tag) == ESP_LOG_DEBUG);
+    esp_log_level_set("*", ESP_LOG_INFO);
+}
+
+TEST_CASE("cached tag levels stay consistent while slots are replaced", "[tags]")
+{
+    // One thread reads the levels of a few tags while another one uses enough tags to replace cache slots
+    const int tag_count = 300;
+    vector<string> tags;
+    for (int i = 0; i < tag_count; i++) {
+        tags.push_back("churn" + to_string(i));
+    }
+    esp_log_level_set("*", ESP_LOG_INFO);
+    for (int i = 0; i < tag_count; i += 2) {
+        esp_log_level_set(tags[i].c_str(), ESP_LOG_ERROR);
+    }
+    atomic<bool> done(false);
+    thread churn([&] {
+        for (int round = 0; round < 200; round++) {
+            for (int i = 0; i < tag_count; i++) {
+                esp_log_level_get(tags[i].c_str());
+            }
+        }
+        done = true;
+    });
+    int wrong = 0;
+    while (!done) {
+        for (int i = 0; i < 16; i++) {
+            if (esp_log_level_get(tags[i].c_str()) != ((i % 2 == 0) ? ESP_LOG_ERROR : ESP_LOG_INFO)) {
+                wrong++;
+            }
+        }
+    }
+    churn.join();
+    CHECK(wrong == 0);
+    esp_log_level_set("*", ESP_LOG_INFO);
+}
+
+TEST_CASE("cost of suppressed messages", "[tags][bench]")
+{
+    // Messages below the level of their tag should cost a few nanoseconds, from any number of threads
+    const int messages = 1000000;
+    esp_log_level_set("*", ESP_LOG_INFO);
+    for (int threads : {1, 4}) {
+        auto start = chrono::steady_clock::now();
+        vector<thread> loggers;
+        for (int t = 0; t < threads; t++) {
+            loggers.emplace_back([] {
+                for (int i = 0; i < messages; i++) {
+                    ESP_LOGD(TEST_TAG, "suppressed %d", i);
+                }
+            });
+        }
+        for (auto &logger : loggers) {
+            logger.join();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printf("%d threads: %.1f ns per suppressed message\n", threads, seconds / messages / threads * 1e9);
+    }
+
+    // The same without the timestamp, which is read before the level is checked
+    volatile int level_sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < messages; i++) {
+        level_sum = level_sum + esp_log_level_get(TEST_TAG);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%.1f ns per esp_log_level_get\n", seconds / messages * 1e9);
+}
@@ -8,6 +8,7 @@
 #define __ESP_LOG_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdarg.h>
 #include <inttypes.h>
 #include "sdkconfig.h"
@@ -170,6 +171,80 @@ void esp_log_write(esp_log_level_t level, const char* tag, const char* format, .
  */
 void esp_log_writev(esp_log_level_t level, const char* tag, const char* format, va_list args);
 
+/**
+ * @brief Write message into the log as a binary record
+ *
+ * This function is not intended to be used directly. ESP_LOGx macros call it instead of
+ * esp_log_write when binary output is enabled, see CONFIG_LOG_BINARY.
+ *
+ * The message is not formatted. Its level, timestamp, tag, the address of the format string
+ * and the raw arguments are packed into a compact record, which is printed Base64 encoded
+ * as a single line with the function set by esp_log_set_vprintf. The log_binary_decode.py
+ * tool of this component reconstructs the messages using the application ELF file.
+ *
+ * @param level Level of the message
+ * @param tag Tag of the message
+ * @param format Format string. Must be stored in the application ELF file, i.e. a string literal.
+ */
+void esp_log_write_binary(esp_log_level_t level, const char* tag, const char* format, ...) __attribute__ ((format (printf, 3, 4)));
+
+#if defined(CONFIG_LOG_ASYNC) || __DOXYGEN__
+
+/**
+ * @brief Counters of the asynchronous log output
+ */
+typedef struct {
+    uint32_t staged;    /*!< Messages staged for the drain task */
+    uint32_t dropped;   /*!< Messages dropped because their staging ring was full */
+    uint32_t batches;   /*!< Calls of the log output function made by the drain task */
+} esp_log_async_stats_t;
+
+/**
+ * @brief Start asynchronous log output
+ *
+ * Allocates the staging rings on the first call and starts the drain task. From then on,
+ * esp_log_write formats messages on the calling task and stages them without taking a lock,
+ * and the drain task prints them in batches with the function set by esp_log_set_vprintf.
+ * If a staging ring is full, the message is dropped.
+ *
+ * @return true if asynchronous output is running, false if the rings or the task could not be allocated
+ */
+bool esp_log_async_start(void);
+
+/**
+ * @brief Stop asynchronous log output
+ *
+ * Prints the staged messages and stops the drain task. Log messages are printed by the
+ * logging task again afterwards.
+ */
+void esp_log_async_stop(void);
+
+/**
+ * @brief Wait until all staged messages are printed
+ *
+ * Must not be called from the log output function.
+ */
+void esp_log_async_flush(void);
+
+/**
+ * @brief Print the staged messages from the panic handler
+ *
+ * Consumes the staging rings without locking or waiting and stops staging.
+ * Only to be called when all other tasks are stopped.
+ *
+ * @param print_str Function printing a zero-terminated string
+ */
+void esp_log_async_panic_flush(void (*print_str)(const char *str));
+
+/**
+ * @brief Get the counters of the asynchronous log output
+ *
+ * @param[out] stats Counters since boot
+ */
+void esp_log_async_get_stats(esp_log_async_stats_t *stats);
+
+#endif // CONFIG_LOG_ASYNC
+
 /** @cond */
 
 #include "esp_log_internal.h"
@@ -182,6 +257,14 @@ void esp_log_writev(esp_log_level_t level, const char* tag, const char* format,
 #endif
 #endif
 
+#ifndef LOG_LOCAL_BINARY
+#if CONFIG_LOG_BINARY && !BOOTLOADER_BUILD
+#define LOG_LOCAL_BINARY 1
+#else
+#define LOG_LOCAL_BINARY 0
+#endif
+#endif
+
 /** @endcond */
 
 /**
@@ -412,7 +495,18 @@ void esp_log_writev(esp_log_level_t level, const char* tag, const char* format,
  *
  * @see ``printf``
  */
+#if LOG_LOCAL_BINARY
+// The empty string makes sure that the format is a literal
 #if defined(__cplusplus) && (__cplusplus >  201703L)
+#define ESP_LOG_LEVEL(level, tag, format, ...) do {                     \
+        esp_log_write_binary(level, tag, "" format "" __VA_OPT__(,) __VA_ARGS__); \
+    } while(0)
+#else // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#define ESP_LOG_LEVEL(level, tag, format, ...) do {                     \
+        esp_log_write_binary(level, tag, "" format "", ##__VA_ARGS__); \
+    } while(0)
+#endif // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#elif defined(__cplusplus) && (__cplusplus >  201703L)
 #if CONFIG_LOG_TIMESTAMP_SOURCE_RTOS
 #define ESP_LOG_LEVEL(level, tag, format, ...) do {                     \
         if (level==ESP_LOG_ERROR )          { esp_log_write(ESP_LOG_ERROR,      tag, LOG_FORMAT(E, format), esp_log_timestamp(), tag __VA_OPT__(,) __VA_ARGS__); } \
@@ -448,7 +542,7 @@ void esp_log_writev(esp_log_level_t level, const char* tag, const char* format,
         else                                { esp_log_write(ESP_LOG_INFO,       tag, LOG_SYSTEM_TIME_FORMAT(I, format), esp_log_system_timestamp(), tag, ##__VA_ARGS__); } \
     } while(0)
 #endif //CONFIG_LOG_TIMESTAMP_SOURCE_xxx
-#endif // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#endif // LOG_LOCAL_BINARY
 
 /** runtime macro to output logs at a specified level. Also check the level with ``LOG_LOCAL_LEVEL``.
  * If ``CONFIG_LOG_MASTER_LEVEL`` set, also check first against ``esp_log_get_level_master()``.
@@ -13,21 +13,28 @@
  * To avoid looking up log level for given tag each time message is
  * printed, this library caches pointers to tags. Because the suggested
  * way of creating tags uses one 'TAG' constant per file, this caching
- * should be effective. Cache is a binary min-heap of cached_tag_entry_t
- * items, ordering is done on 'generation' member. In this context,
- * generation is an integer which is incremented each time an operation
- * with cache is performed. When cache is full, new item is inserted in
- * place of an oldest item (that is, with smallest 'generation' value).
- * After that, bubble-down operation is performed to fix ordering in the
- * min-heap.
+ * should be effective. Cache is an open addressing hash table of
+ * cached_tag_entry_t items, indexed by the tag pointer. Each entry holds
+ * the level slot of one tag pointer, so checking the level of a cached
+ * tag takes a few atomic loads and no lock. This is what makes messages
+ * of suppressed levels cheap.
+ *
+ * Entries are only changed with the lock taken. An entry is published
+ * by storing its level after clearing its tag pointer, then storing the
+ * new tag pointer. Readers load the tag pointer, the level and the tag
+ * pointer again, and only use the level if both tag loads matched, so a
+ * level is never paired with the tag of a previous or next occupant of
+ * the slot. esp_log_level_set updates the level slot of each entry whose
+ * tag matches, and "*" empties the cache. When none of the
+ * TAG_CACHE_MAX_PROBES slots for a tag is free, the slot holding the
+ * oldest entry (that is, with smallest 'generation' value) is replaced.
  *
  * The potential problem with wrap-around of cache generation counter is
- * ignored for now. This will happen if someone happens to output more
- * than 4 billion log entries, at which point wrap-around will not be
- * the biggest problem.
+ * ignored for now, as it only counts cache insertions.
  *
  */
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stddef.h>
@@ -47,13 +54,15 @@
 
 #include "sys/queue.h"
 
-// Number of tags to be cached. Must be 2**n - 1, n >= 2.
-#define TAG_CACHE_SIZE 31
+// Number of tags to be cached. Must be 2**n.
+#define TAG_CACHE_SIZE 64
+// Number of slots checked for a tag before giving up
+#define TAG_CACHE_MAX_PROBES 8
 
 typedef struct {
-    const char *tag;
-    uint32_t level : 3;
-    uint32_t generation : 29;
+    _Atomic(const char *) tag;
+    _Atomic uint8_t level;  // esp_log_level_t as uint8_t
+    uint32_t generation;    // only accessed with the lock taken
 } cached_tag_entry_t;
 
 typedef struct uncached_tag_entry_ {
@@ -69,7 +78,6 @@ esp_log_level_t esp_log_default_level = CONFIG_LOG_DEFAULT_LEVEL;
 static SLIST_HEAD(log_tags_head, uncached_tag_entry_) s_log_tags = SLIST_HEAD_INITIALIZER(s_log_tags);
 static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
 static uint32_t s_log_cache_max_generation = 0;
-static uint32_t s_log_cache_entry_count = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
 
 #ifdef LOG_BUILTIN_CHECKS
@@ -80,8 +88,7 @@ static uint32_t s_log_cache_misses = 0;
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level);
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level);
 static inline void add_to_cache(const char *tag, esp_log_level_t level);
-static void heap_bubble_down(int index);
-static inline void heap_swap(int i, int j);
+static inline void set_cached_log_level(const char *tag, esp_log_level_t level);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list(void);
 
@@ -143,28 +150,21 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
         SLIST_INSERT_HEAD(&s_log_tags, new_entry, entries);
     }
 
-    // search in the cache and update the entry it if exists
-    for (uint32_t i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (strcmp(s_log_cache[i].tag, tag) == 0) {
-            s_log_cache[i].level = level;
-            break;
-        }
-    }
+    // update the level slots of the tag
+    set_cached_log_level(tag, level);
     esp_log_impl_unlock();
 }
 
 
-/* Common code for getting the log level from cache, esp_log_impl_lock()
-   should be called before calling this function. The function unlocks,
-   as indicated in the name.
+/* Common code for getting the log level of a tag which isn't cached yet,
+   esp_log_impl_lock() should be called before calling this function.
+   The function unlocks, as indicated in the name.
 */
 static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
 {
     esp_log_level_t level_for_tag;
-    // Look for the tag in cache first, then in the linked list of all tags
+    // Another task could have added the tag meanwhile, look for it in cache first,
+    // then in the linked list of all tags
     if (!get_cached_log_level(tag, &level_for_tag)) {
         if (!get_uncached_log_level(tag, &level_for_tag)) {
             level_for_tag = esp_log_default_level;
@@ -181,6 +181,10 @@ static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
 
 esp_log_level_t esp_log_level_get(const char *tag)
 {
+    esp_log_level_t level_for_tag;
+    if (get_cached_log_level(tag, &level_for_tag)) {
+        return level_for_tag;
+    }
     esp_log_impl_lock();
     return s_log_level_get_and_unlock(tag);
 }
@@ -192,28 +196,63 @@ void clear_log_level_list(void)
         SLIST_REMOVE_HEAD(&s_log_tags, entries);
         free(it);
     }
-    s_log_cache_entry_count = 0;
+    for (uint32_t i = 0; i < TAG_CACHE_SIZE; ++i) {
+        atomic_store_explicit(&s_log_cache[i].tag, NULL, memory_order_relaxed);
+    }
     s_log_cache_max_generation = 0;
 #ifdef LOG_BUILTIN_CHECKS
     s_log_cache_misses = 0;
 #endif
 }
 
+bool esp_log_check_level(esp_log_level_t level, const char *tag)
+{
+    esp_log_level_t level_for_tag;
+    if (!get_cached_log_level(tag, &level_for_tag)) {
+        if (!esp_log_impl_lock_timeout()) {
+            return false;
+        }
+        level_for_tag = s_log_level_get_and_unlock(tag);
+    }
+    return should_output(level, level_for_tag);
+}
+
+static void log_vprint(const char *format, va_list args)
+{
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+    if (esp_log_async_stage(format, args)) {
+        return;
+    }
+#endif
+    (*s_log_print_func)(format, args);
+}
+
 void esp_log_writev(esp_log_level_t level,
                    const char *tag,
                    const char *format,
                    va_list args)
 {
-    if (!esp_log_impl_lock_timeout()) {
-        return;
-    }
-    esp_log_level_t level_for_tag = s_log_level_get_and_unlock(tag);
-    if (!should_output(level, level_for_tag)) {
+    if (!esp_log_check_level(level, tag)) {
         return;
     }
+    log_vprint(format, args);
+}
 
-    (*s_log_print_func)(format, args);
+void esp_log_print(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    log_vprint(format, list);
+    va_end(list);
+}
 
+int esp_log_output(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    int ret = (*s_log_print_func)(format, list);
+    va_end(list);
+    return ret;
 }
 
 void esp_log_write(esp_log_level_t level,
@@ -226,62 +265,68 @@ void esp_log_write(esp_log_level_t level,
     va_end(list);
 }
 
+static inline uint32_t tag_cache_index(const char *tag)
+{
+    // Fibonacci hashing of the pointer
+    return ((uint32_t)(uintptr_t) tag * 2654435761u) >> (32 - __builtin_ctz(TAG_CACHE_SIZE));
+}
+
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level)
 {
-    // Look for `tag` in cache
-    uint32_t i;
-    for (i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (s_log_cache[i].tag == tag) {
-            break;
+    // Look for `tag` in cache, without taking the lock
+    uint32_t index = tag_cache_index(tag);
+    for (int i = 0; i < TAG_CACHE_MAX_PROBES; i++) {
+        cached_tag_entry_t *entry = &s_log_cache[(index + i) & (TAG_CACHE_SIZE - 1)];
+        const char *cached_tag = atomic_load_explicit(&entry->tag, memory_order_acquire);
+        if (cached_tag == tag) {
+            uint8_t cached_level = atomic_load_explicit(&entry->level, memory_order_acquire);
+            // the slot may have been given to another tag meanwhile
+            if (atomic_load_explicit(&entry->tag, memory_order_relaxed) != tag) {
+                return false;
+            }
+            *level = (esp_log_level_t) cached_level;
+            return true;
+        }
+        if (cached_tag == NULL) {
+            // entries are only removed all at once, so the tag can't be in a later slot
+            return false;
         }
     }
-    if (i == s_log_cache_entry_count) { // Not found in cache
-        return false;
-    }
-    // Return level from cache
-    *level = (esp_log_level_t) s_log_cache[i].level;
-    // If cache has been filled, start taking ordering into account
-    // (other options are: dynamically resize cache, add "dummy" entries
-    //  to the cache; this option was chosen because code is much simpler,
-    //  and the unfair behavior of cache will show it self at most once, when
-    //  it has just been filled)
-    if (s_log_cache_entry_count == TAG_CACHE_SIZE) {
-        // Update item generation
-        s_log_cache[i].generation = s_log_cache_max_generation++;
-        // Restore heap ordering
-        heap_bubble_down(i);
-    }
-    return true;
+    return false;
 }
 
 static inline void add_to_cache(const char *tag, esp_log_level_t level)
 {
-    uint32_t generation = s_log_cache_max_generation++;
-    // First consider the case when cache is not filled yet.
-    // In this case, just add new entry at the end.
-    // This happens to satisfy binary min-heap ordering.
-    if (s_log_cache_entry_count < TAG_CACHE_SIZE) {
-        s_log_cache[s_log_cache_entry_count] = (cached_tag_entry_t) {
-            .generation = generation,
-            .level = level,
-            .tag = tag
-        };
-        ++s_log_cache_entry_count;
-        return;
+    uint32_t index = tag_cache_index(tag);
+    cached_tag_entry_t *oldest = NULL;
+    for (int i = 0; i < TAG_CACHE_MAX_PROBES; i++) {
+        cached_tag_entry_t *entry = &s_log_cache[(index + i) & (TAG_CACHE_SIZE - 1)];
+        if (atomic_load_explicit(&entry->tag, memory_order_relaxed) == NULL) {
+            oldest = entry;
+            break;
+        }
+        if (oldest == NULL || entry->generation < oldest->generation) {
+            oldest = entry;
+        }
     }
+    // Unpublish the slot before its level changes, then publish it with the new tag
+    atomic_store_explicit(&oldest->tag, NULL, memory_order_relaxed);
+    atomic_store_explicit(&oldest->level, level, memory_order_release);
+    oldest->generation = s_log_cache_max_generation++;
+    atomic_store_explicit(&oldest->tag, tag, memory_order_release);
+}
 
-    // Cache is full, so we replace the oldest entry (which is at index 0
-    // because this is a min-heap) with the new one, and do bubble-down
-    // operation to restore min-heap ordering.
-    s_log_cache[0] = (cached_tag_entry_t) {
-        .tag = tag,
-        .level = level,
-        .generation = generation
-    };
-    heap_bubble_down(0);
+/* Sets the level slots of all cached entries matching `tag`.
+   esp_log_impl_lock() should be called before calling this function.
+*/
+static inline void set_cached_log_level(const char *tag, esp_log_level_t level)
+{
+    for (uint32_t i = 0; i < TAG_CACHE_SIZE; ++i) {
+        const char *cached_tag = atomic_load_explicit(&s_log_cache[i].tag, memory_order_relaxed);
+        if (cached_tag != NULL && strcmp(cached_tag, tag) == 0) {
+            atomic_store_explicit(&s_log_cache[i].level, level, memory_order_relaxed);
+        }
+    }
 }
 
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level)
@@ -302,21 +347,3 @@ static inline bool should_output(esp_log_level_t level_for_message, esp_log_leve
 {
     return level_for_message <= level_for_tag;
 }
-
-static void heap_bubble_down(int index)
-{
-    while (index < TAG_CACHE_SIZE / 2) {
-        int left_index = index * 2 + 1;
-        int right_index = left_index + 1;
-        int next = (s_log_cache[left_index].generation < s_log_cache[right_index].generation) ? left_index : right_index;
-        heap_swap(index, next);
-        index = next;
-    }
-}
-
-static inline void heap_swap(int i, int j)
-{
-    cached_tag_entry_t tmp = s_log_cache[i];
-    s_log_cache[i] = s_log_cache[j];
-    s_log_cache[j] = tmp;
-}
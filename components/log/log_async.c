@@ -0,0 +1,273 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Asynchronous log output.
+ *
+ * While asynchronous output is running, esp_log_writev formats each message
+ * on the calling task and stages it in one of CONFIG_LOG_ASYNC_RING_COUNT
+ * rings. A drain task prints the staged messages in batches through the
+ * function set with esp_log_set_vprintf, so logging tasks don't wait for
+ * the console.
+ *
+ * Each ring is a multi-producer, single-consumer byte ring. Each task (each
+ * thread on Linux) always uses the same ring, so its messages are printed in
+ * the order it logged them even if it runs on several cores, and tasks are
+ * spread over the rings so that producers rarely compete for the same ring. A producer reserves space by
+ * advancing 'head' with compare-and-swap, copies the message and publishes
+ * it by storing the record header. The drain task consumes records in order
+ * and stops at the first one which isn't published yet. It clears consumed
+ * records, so that the header of a reserved record reads as unpublished
+ * until its producer stores it, and then advances 'tail'.
+ *
+ * A record never wraps around the end of the ring. If it doesn't fit, the
+ * rest of the ring is reserved as a padding record. If the ring doesn't have
+ * enough free space, the message is dropped and counted.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_log_private.h"
+
+_Static_assert((CONFIG_LOG_ASYNC_RING_SIZE & (CONFIG_LOG_ASYNC_RING_SIZE - 1)) == 0, "CONFIG_LOG_ASYNC_RING_SIZE must be a power of two");
+_Static_assert(CONFIG_LOG_ASYNC_MAX_LINE_LEN + 8 <= CONFIG_LOG_ASYNC_RING_SIZE / 2, "CONFIG_LOG_ASYNC_MAX_LINE_LEN is too large for the ring size");
+
+#define RING_MASK           (CONFIG_LOG_ASYNC_RING_SIZE - 1)
+#define RECORD_PUBLISHED    0x80000000
+#define RECORD_PADDING      0x40000000
+#define RECORD_LEN_MASK     0x0000ffff
+#define RECORD_HEADER_SIZE  sizeof(uint32_t)
+#define BATCH_SIZE          (CONFIG_LOG_ASYNC_MAX_LINE_LEN * 2)
+
+typedef struct {
+    _Atomic uint32_t head;  // first byte not reserved by a producer
+    _Atomic uint32_t tail;  // first byte not consumed by the drain task
+    uint8_t *data;
+} log_async_ring_t;
+
+static log_async_ring_t s_rings[CONFIG_LOG_ASYNC_RING_COUNT];
+static _Atomic bool s_running;
+static _Atomic bool s_stop;
+static _Atomic bool s_wake_pending;
+static _Atomic uint32_t s_staged;
+static _Atomic uint32_t s_dropped;
+static _Atomic uint32_t s_batches;
+
+// used by the drain task only
+static char s_batch[BATCH_SIZE + 1];
+static size_t s_batch_len;
+
+static inline _Atomic uint32_t *record_header(log_async_ring_t *ring, uint32_t pos)
+{
+    return (_Atomic uint32_t *) &ring->data[pos & RING_MASK];
+}
+
+static inline uint32_t record_size(size_t len)
+{
+    // message, terminating zero and header, rounded up so that headers stay aligned
+    return (RECORD_HEADER_SIZE + len + 1 + 3) & ~3;
+}
+
+bool esp_log_async_stage(const char *format, va_list args)
+{
+    if (!atomic_load_explicit(&s_running, memory_order_acquire)) {
+        return false;
+    }
+
+    char line[CONFIG_LOG_ASYNC_MAX_LINE_LEN];
+    int ret = vsnprintf(line, sizeof(line), format, args);
+    if (ret <= 0) {
+        return true;
+    }
+    size_t len = (ret < sizeof(line)) ? ret : sizeof(line) - 1;
+
+    log_async_ring_t *ring = &s_rings[esp_log_impl_async_producer_id() % CONFIG_LOG_ASYNC_RING_COUNT];
+    uint32_t size = record_size(len);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t padding;
+    uint32_t used;
+    do {
+        uint32_t to_end = CONFIG_LOG_ASYNC_RING_SIZE - (head & RING_MASK);
+        padding = (size <= to_end) ? 0 : to_end;
+        used = head + padding + size - atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (used > CONFIG_LOG_ASYNC_RING_SIZE) {
+            atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+            return true;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&ring->head, &head, head + padding + size,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+
+    if (padding) {
+        atomic_store_explicit(record_header(ring, head), RECORD_PUBLISHED | RECORD_PADDING | padding, memory_order_release);
+        head += padding;
+    }
+    uint8_t *record = &ring->data[head & RING_MASK];
+    memcpy(record + RECORD_HEADER_SIZE, line, len);
+    record[RECORD_HEADER_SIZE + len] = 0;
+    atomic_store_explicit(record_header(ring, head), RECORD_PUBLISHED | len, memory_order_release);
+    atomic_fetch_add_explicit(&s_staged, 1, memory_order_relaxed);
+
+    // Wake the drain task early once a ring is half full instead of waiting for the drain period
+    if (used >= CONFIG_LOG_ASYNC_RING_SIZE / 2 && !atomic_exchange_explicit(&s_wake_pending, true, memory_order_relaxed)) {
+        esp_log_impl_async_wake();
+    }
+    return true;
+}
+
+static void batch_flush(void)
+{
+    if (s_batch_len > 0) {
+        esp_log_output("%.*s", (int) s_batch_len, s_batch);
+        atomic_fetch_add_explicit(&s_batches, 1, memory_order_relaxed);
+        s_batch_len = 0;
+    }
+}
+
+/* Consumes the published records of all rings, passing each message to the output function.
+   Returns true if anything was consumed.
+*/
+static bool drain_rings(void (*output)(const char *message, size_t len))
+{
+    bool consumed = false;
+    for (int i = 0; i < CONFIG_LOG_ASYNC_RING_COUNT; i++) {
+        log_async_ring_t *ring = &s_rings[i];
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        while (tail != atomic_load_explicit(&ring->head, memory_order_acquire)) {
+            uint32_t header = atomic_load_explicit(record_header(ring, tail), memory_order_acquire);
+            if (!(header & RECORD_PUBLISHED)) {
+                // the producer of this record hasn't finished yet, the rest of the ring has to wait
+                break;
+            }
+            uint32_t size;
+            if (header & RECORD_PADDING) {
+                size = header & RECORD_LEN_MASK;
+            } else {
+                size_t len = header & RECORD_LEN_MASK;
+                output((const char *) &ring->data[(tail & RING_MASK) + RECORD_HEADER_SIZE], len);
+                size = record_size(len);
+            }
+            memset(&ring->data[tail & RING_MASK], 0, size);
+            tail += size;
+            consumed = true;
+        }
+        // released once per pass, so that producers don't have to reload the cache line for every record
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    return consumed;
+}
+
+static void batch_append(const char *message, size_t len)
+{
+    if (s_batch_len + len > BATCH_SIZE) {
+        batch_flush();
+    }
+    memcpy(&s_batch[s_batch_len], message, len);
+    s_batch_len += len;
+}
+
+static void drain_task(void)
+{
+    while (!atomic_load_explicit(&s_stop, memory_order_acquire)) {
+        atomic_store_explicit(&s_wake_pending, false, memory_order_relaxed);
+        bool consumed = drain_rings(batch_append);
+        batch_flush();
+        if (!consumed) {
+            esp_log_impl_async_wait(CONFIG_LOG_ASYNC_DRAIN_PERIOD_MS);
+        }
+    }
+    drain_rings(batch_append);
+    batch_flush();
+}
+
+static bool rings_empty(void)
+{
+    for (int i = 0; i < CONFIG_LOG_ASYNC_RING_COUNT; i++) {
+        if (atomic_load_explicit(&s_rings[i].tail, memory_order_acquire) != atomic_load_explicit(&s_rings[i].head, memory_order_acquire)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool esp_log_async_start(void)
+{
+    if (atomic_load(&s_running)) {
+        return true;
+    }
+    for (int i = 0; i < CONFIG_LOG_ASYNC_RING_COUNT; i++) {
+        if (s_rings[i].data == NULL) {
+            s_rings[i].data = calloc(1, CONFIG_LOG_ASYNC_RING_SIZE);
+            if (s_rings[i].data == NULL) {
+                return false;
+            }
+        }
+    }
+    atomic_store(&s_stop, false);
+    if (!esp_log_impl_async_start(drain_task)) {
+        return false;
+    }
+    atomic_store(&s_running, true);
+    return true;
+}
+
+void esp_log_async_stop(void)
+{
+    if (!atomic_load(&s_running)) {
+        return;
+    }
+    // New messages are printed synchronously from here on. A message staged by a task which was already
+    // past the check when s_running was cleared is printed by the final drain or, if it is late for it,
+    // after the next start. The ring memory is kept for that start.
+    atomic_store(&s_running, false);
+    atomic_store(&s_stop, true);
+    esp_log_impl_async_wake();
+    esp_log_impl_async_join();
+}
+
+void esp_log_async_flush(void)
+{
+    while (atomic_load(&s_running) && !rings_empty()) {
+        esp_log_impl_async_wake();
+        esp_log_impl_async_delay(1);
+    }
+}
+
+static void (*s_panic_print_str)(const char *str);
+
+static void panic_output(const char *message, size_t len)
+{
+    (void) len;
+    s_panic_print_str(message);
+}
+
+void esp_log_async_panic_flush(void (*print_str)(const char *str))
+{
+    // Other tasks are stopped, the drain task included, so the rings can be consumed from here without locking.
+    // A message which is being staged by an interrupted task stays in its ring.
+    if (!atomic_load(&s_running)) {
+        return;
+    }
+    atomic_store(&s_running, false);
+    if (s_batch_len > 0) {
+        s_batch[s_batch_len] = 0;
+        print_str(s_batch);
+        s_batch_len = 0;
+    }
+    s_panic_print_str = print_str;
+    drain_rings(panic_output);
+}
+
+void esp_log_async_get_stats(esp_log_async_stats_t *stats)
+{
+    stats->staged = atomic_load_explicit(&s_staged, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&s_dropped, memory_order_relaxed);
+    stats->batches = atomic_load_explicit(&s_batches, memory_order_relaxed);
+}
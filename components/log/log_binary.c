@@ -0,0 +1,347 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Binary log output.
+ *
+ * esp_log_write_binary doesn't format the message. It packs the message into a record:
+ *
+ *   level      1 byte, bits 0-2 hold the level, bit 6 is set if the format is relative to the
+ *              start of the executable, bit 7 is set if the record was truncated
+ *   timestamp  varint, milliseconds
+ *   format     varint, address of the format string
+ *   tag        zero-terminated string
+ *   arguments  in the order of the conversions in the format string:
+ *              - signed integers (d, i and '*' width or precision) as zigzag encoded varints
+ *              - unsigned integers (u, o, x, X, c, p) as varints
+ *              - floating point numbers as 8 byte little endian doubles
+ *              - strings as zero-terminated strings, cut to the precision of the conversion
+ *
+ * Varints are unsigned LEB128 numbers: 7 bits per byte, least significant group first,
+ * bit 7 set in all bytes but the last one.
+ *
+ * The record is printed Base64 encoded as a single line starting with BINARY_LINE_PREFIX, so
+ * it passes through any output function set by esp_log_set_vprintf and can be mixed with text
+ * output. log_binary_decode.py reads the format strings from the ELF file and prints the lines
+ * as esp_log_write would have formatted them.
+ *
+ * On Linux, the executable is loaded at a random address (PIE and ASLR), so the record holds the
+ * offset of the format string from __executable_start instead of its address. The decoder adds
+ * the address of __executable_start in the ELF file.
+ */
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_log_private.h"
+
+#define BINARY_LINE_PREFIX      "#L"
+#define BINARY_LEVEL_MASK       0x07
+#define BINARY_FORMAT_RELATIVE  0x40
+#define BINARY_TRUNCATED        0x80
+#define MAX_VARINT_SIZE         10
+#define BASE64_LEN(len)         (((len) + 2) / 3 * 4)
+
+#define LINE_SIZE               (sizeof(BINARY_LINE_PREFIX) - 1 + BASE64_LEN(CONFIG_LOG_BINARY_MAX_RECORD_LEN) + 2)
+
+#if defined(__linux__)
+extern const char __executable_start[];
+#define FORMAT_BASE             ((uintptr_t) __executable_start)
+#define FORMAT_FLAGS            BINARY_FORMAT_RELATIVE
+#else
+#define FORMAT_BASE             0
+#define FORMAT_FLAGS            0
+#endif
+
+#if CONFIG_LOG_ASYNC
+_Static_assert(LINE_SIZE <= CONFIG_LOG_ASYNC_MAX_LINE_LEN, "CONFIG_LOG_BINARY_MAX_RECORD_LEN is too large for CONFIG_LOG_ASYNC_MAX_LINE_LEN");
+#endif
+
+typedef struct {
+    uint8_t *pos;
+    uint8_t *end;
+    bool truncated;
+} binary_record_t;
+
+static bool put_varint(binary_record_t *record, uint64_t value)
+{
+    uint8_t buf[MAX_VARINT_SIZE];
+    size_t len = 0;
+    do {
+        buf[len] = value & 0x7f;
+        value >>= 7;
+        if (value) {
+            buf[len] |= 0x80;
+        }
+        len++;
+    } while (value);
+    if (record->end - record->pos < len) {
+        record->truncated = true;
+        return false;
+    }
+    memcpy(record->pos, buf, len);
+    record->pos += len;
+    return true;
+}
+
+static inline bool put_signed(binary_record_t *record, int64_t value)
+{
+    return put_varint(record, ((uint64_t) value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static bool put_double(binary_record_t *record, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (record->end - record->pos < sizeof(bits)) {
+        record->truncated = true;
+        return false;
+    }
+    for (int i = 0; i < sizeof(bits); i++) {
+        *record->pos++ = bits >> (8 * i);
+    }
+    return true;
+}
+
+static bool put_string(binary_record_t *record, const char *str, size_t max_len)
+{
+    size_t len = strnlen(str, max_len);
+    size_t room = record->end - record->pos;
+    if (room == 0) {
+        record->truncated = true;
+        return false;
+    }
+    if (len >= room) {
+        len = room - 1;
+        record->truncated = true;
+    }
+    memcpy(record->pos, str, len);
+    record->pos[len] = 0;
+    record->pos += len + 1;
+    return !record->truncated;
+}
+
+typedef enum {
+    LENGTH_NONE,
+    LENGTH_CHAR,
+    LENGTH_SHORT,
+    LENGTH_LONG,
+    LENGTH_LONG_LONG,
+    LENGTH_SIZE,
+    LENGTH_INTMAX,
+    LENGTH_PTRDIFF,
+    LENGTH_LONG_DOUBLE,
+} arg_length_t;
+
+static int64_t get_signed(arg_length_t length, va_list *args)
+{
+    switch (length) {
+    case LENGTH_LONG:       return va_arg(*args, long);
+    case LENGTH_LONG_LONG:  return va_arg(*args, long long);
+    case LENGTH_SIZE:       return va_arg(*args, ptrdiff_t);    // signed type of the same size as size_t
+    case LENGTH_INTMAX:     return va_arg(*args, intmax_t);
+    case LENGTH_PTRDIFF:    return va_arg(*args, ptrdiff_t);
+    case LENGTH_CHAR:       return (signed char) va_arg(*args, int);
+    case LENGTH_SHORT:      return (short) va_arg(*args, int);
+    default:                return va_arg(*args, int);
+    }
+}
+
+static uint64_t get_unsigned(arg_length_t length, va_list *args)
+{
+    switch (length) {
+    case LENGTH_LONG:       return va_arg(*args, unsigned long);
+    case LENGTH_LONG_LONG:  return va_arg(*args, unsigned long long);
+    case LENGTH_SIZE:       return va_arg(*args, size_t);
+    case LENGTH_INTMAX:     return va_arg(*args, uintmax_t);
+    case LENGTH_PTRDIFF:    return va_arg(*args, size_t);       // unsigned type of the same size as ptrdiff_t
+    case LENGTH_CHAR:       return (unsigned char) va_arg(*args, unsigned);
+    case LENGTH_SHORT:      return (unsigned short) va_arg(*args, unsigned);
+    default:                return va_arg(*args, unsigned);
+    }
+}
+
+/* Packs the arguments in the order of the conversions of the format string.
+   Stops at the first argument which doesn't fit into the record.
+*/
+static void put_args(binary_record_t *record, const char *format, va_list *args)
+{
+    for (const char *p = format; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            continue;
+        }
+        while (*p && strchr("-+ #0", *p)) {
+            p++;
+        }
+        if (*p == '*') {
+            if (!put_signed(record, va_arg(*args, int))) {
+                return;
+            }
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+        size_t precision = SIZE_MAX;
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                int value = va_arg(*args, int);
+                if (!put_signed(record, value)) {
+                    return;
+                }
+                precision = (value >= 0) ? value : SIZE_MAX;
+                p++;
+            } else {
+                precision = 0;
+                while (*p >= '0' && *p <= '9') {
+                    precision = precision * 10 + (*p++ - '0');
+                }
+            }
+        }
+
+        arg_length_t length = LENGTH_NONE;
+        switch (*p) {
+        case 'h':
+            length = (p[1] == 'h') ? LENGTH_CHAR : LENGTH_SHORT;
+            break;
+        case 'l':
+            length = (p[1] == 'l') ? LENGTH_LONG_LONG : LENGTH_LONG;
+            break;
+        case 'z':
+            length = LENGTH_SIZE;
+            break;
+        case 'j':
+            length = LENGTH_INTMAX;
+            break;
+        case 't':
+            length = LENGTH_PTRDIFF;
+            break;
+        case 'L':
+            length = LENGTH_LONG_DOUBLE;
+            break;
+        }
+        if (length != LENGTH_NONE) {
+            p += (length == LENGTH_CHAR || length == LENGTH_LONG_LONG) ? 2 : 1;
+        }
+
+        bool ok;
+        switch (*p) {
+        case 'd':
+        case 'i':
+            ok = put_signed(record, get_signed(length, args));
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+        case 'c':
+            ok = put_varint(record, get_unsigned(length, args));
+            break;
+        case 'p':
+            ok = put_varint(record, (uintptr_t) va_arg(*args, void *));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            ok = put_double(record, (length == LENGTH_LONG_DOUBLE) ? (double) va_arg(*args, long double) : va_arg(*args, double));
+            break;
+        case 's': {
+            const char *str = va_arg(*args, const char *);
+            ok = put_string(record, str ? str : "(null)", precision);
+            break;
+        }
+        case 'n':
+            // nothing is written back, the argument is only skipped
+            (void) va_arg(*args, void *);
+            ok = true;
+            break;
+        case '\0':
+            return;
+        default:
+            // unknown conversion, the decoder prints it as it is
+            ok = true;
+            break;
+        }
+        if (!ok) {
+            return;
+        }
+    }
+}
+
+static size_t base64_encode(char *dest, const uint8_t *src, size_t len)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *out = dest;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t group = src[i] << 16;
+        if (i + 1 < len) {
+            group |= src[i + 1] << 8;
+        }
+        if (i + 2 < len) {
+            group |= src[i + 2];
+        }
+        *out++ = alphabet[(group >> 18) & 0x3f];
+        *out++ = alphabet[(group >> 12) & 0x3f];
+        *out++ = (i + 1 < len) ? alphabet[(group >> 6) & 0x3f] : '=';
+        *out++ = (i + 2 < len) ? alphabet[group & 0x3f] : '=';
+    }
+    return out - dest;
+}
+
+static size_t encode_record(uint8_t *buf, size_t size, esp_log_level_t level, const char *tag, const char *format, va_list args)
+{
+    binary_record_t record = {
+        .pos = buf + 1,
+        .end = buf + size,
+        .truncated = false,
+    };
+    if (level == ESP_LOG_NONE || level > ESP_LOG_VERBOSE) {
+        // ESP_LOG_LEVEL prints these as info messages
+        level = ESP_LOG_INFO;
+    }
+    if (put_varint(&record, esp_log_timestamp()) &&
+            put_varint(&record, (uintptr_t) format - FORMAT_BASE) &&
+            put_string(&record, tag, SIZE_MAX)) {
+        va_list list;
+        va_copy(list, args);
+        put_args(&record, format, &list);
+        va_end(list);
+    }
+    buf[0] = level | FORMAT_FLAGS | (record.truncated ? BINARY_TRUNCATED : 0);
+    return record.pos - buf;
+}
+
+void esp_log_write_binary(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (!esp_log_check_level(level, tag)) {
+        return;
+    }
+    uint8_t record[CONFIG_LOG_BINARY_MAX_RECORD_LEN];
+    va_list list;
+    va_start(list, format);
+    size_t len = encode_record(record, sizeof(record), level, tag, format, list);
+    va_end(list);
+
+    char line[LINE_SIZE];
+    memcpy(line, BINARY_LINE_PREFIX, sizeof(BINARY_LINE_PREFIX) - 1);
+    len = sizeof(BINARY_LINE_PREFIX) - 1 + base64_encode(&line[sizeof(BINARY_LINE_PREFIX) - 1], record, len);
+    line[len++] = '\n';
+    line[len] = 0;
+    esp_log_print("%s", line);
+}
@@ -0,0 +1,216 @@
+#!/usr/bin/env python
+#
+# Decoder of the binary log output (CONFIG_LOG_BINARY)
+#
+# Reads the log output from a file or stdin, replaces the binary records with the text
+# esp_log_write would have printed and passes all other lines through. The format strings
+# are read from the application ELF file. See log_binary.c for the record layout.
+#
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import argparse
+import base64
+import binascii
+import re
+import struct
+import sys
+from typing import Callable, List, Optional, Tuple
+
+LINE_PREFIX = b'#L'
+LEVEL_MASK = 0x07
+FORMAT_RELATIVE = 0x40
+TRUNCATED = 0x80
+LEVEL_LETTERS = {1: 'E', 2: 'W', 3: 'I', 4: 'D', 5: 'V'}
+LEVEL_COLORS = {1: '\033[0;31m', 2: '\033[0;33m', 3: '\033[0;32m'}
+RESET_COLOR = '\033[0m'
+
+CONVERSION_RE = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|z|j|t|L)?([diuoxXcpfFeEgGaAsn%])')
+
+
+class LogBinaryDecodeError(RuntimeError):
+    pass
+
+
+class RecordReader(object):
+    def __init__(self, data: bytearray) -> None:
+        self.data = data
+        self.pos = 0
+
+    def byte(self) -> int:
+        if self.pos >= len(self.data):
+            raise LogBinaryDecodeError('record too short')
+        self.pos += 1
+        return self.data[self.pos - 1]
+
+    def varint(self) -> int:
+        value = 0
+        shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7f) << shift
+            shift += 7
+            if not b & 0x80:
+                return value
+
+    def signed(self) -> int:
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def double(self) -> float:
+        if self.pos + 8 > len(self.data):
+            raise LogBinaryDecodeError('record too short')
+        self.pos += 8
+        return struct.unpack('<d', self.data[self.pos - 8:self.pos])[0]
+
+    def string(self) -> str:
+        end = self.data.find(b'\0', self.pos)
+        if end < 0:
+            raise LogBinaryDecodeError('record too short')
+        value = self.data[self.pos:end].decode('utf-8', errors='replace')
+        self.pos = end + 1
+        return value
+
+
+class ElfStrings(object):
+    """ Looks up zero-terminated strings by their address in the allocated sections of an ELF file """
+
+    def __init__(self, elf_path: str) -> None:
+        import elftools.elf.constants as elfconst
+        import elftools.elf.elffile as elffile
+        import elftools.elf.sections as elfsections
+        self.sections = []  # type: List[Tuple[int, bytes]]
+        # Address of the start of the executable, to which the formats of the Linux target are relative
+        self.image_start = None  # type: Optional[int]
+        with open(elf_path, 'rb') as f:
+            felf = elffile.ELFFile(f)
+            for sect in felf.iter_sections():
+                if isinstance(sect, elfsections.SymbolTableSection) and self.image_start is None:
+                    symbols = sect.get_symbol_by_name('__executable_start')
+                    if symbols:
+                        self.image_start = symbols[0]['st_value']
+                if sect['sh_addr'] == 0 or (sect['sh_flags'] & elfconst.SH_FLAGS.SHF_ALLOC) == 0 or sect['sh_type'] == 'SHT_NOBITS':
+                    continue
+                self.sections.append((sect['sh_addr'], sect.data()))
+
+    def __call__(self, addr: int) -> Optional[str]:
+        for start, data in self.sections:
+            if start <= addr < start + len(data):
+                end = data.find(b'\0', addr - start)
+                return data[addr - start:end if end >= 0 else len(data)].decode('utf-8', errors='replace')
+        return None
+
+
+def format_message(fmt: str, reader: RecordReader) -> Tuple[str, bool]:
+    """ Formats the arguments read from the record like printf would. Returns the message and
+        False if the record ended before all arguments were read. """
+    out = []
+    pos = 0
+    for m in CONVERSION_RE.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, _, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        try:
+            if width == '*':
+                value = reader.signed()
+                if value < 0:
+                    flags += '-'
+                width = str(abs(value))
+            if precision == '*':
+                value = reader.signed()
+                precision = str(value) if value >= 0 else None
+            spec = '%' + flags + (width or '')
+            if precision is not None:
+                spec += '.' + (precision or '0')
+
+            if conv in 'di':
+                out.append((spec + 'd') % reader.signed())
+            elif conv == 'u':
+                out.append((spec + 'd') % reader.varint())
+            elif conv in 'oxX':
+                out.append((spec + conv) % reader.varint())
+            elif conv == 'c':
+                out.append((spec + 'c') % chr(reader.varint() & 0xff))
+            elif conv == 'p':
+                out.append('0x%x' % reader.varint())
+            elif conv in 'aA':
+                hex_value = float.hex(reader.double())
+                out.append(hex_value.upper() if conv == 'A' else hex_value)
+            elif conv in 'fFeEgG':
+                out.append((spec + conv) % reader.double())
+            elif conv == 's':
+                out.append((spec + 's') % reader.string())
+        except LogBinaryDecodeError:
+            out.append(fmt[m.start():])
+            return ''.join(out), False
+    out.append(fmt[pos:])
+    return ''.join(out), True
+
+
+def decode_record(data: bytearray, get_string: Callable[[int], Optional[str]], colors: bool = False,
+                  image_start: Optional[int] = None) -> str:
+    """ Decodes a binary record. get_string returns the string at the given address, image_start is
+        the address the formats relative to the start of the executable are added to. """
+    reader = RecordReader(data)
+    header = reader.byte()
+    level = header & LEVEL_MASK
+    timestamp = reader.varint()
+    fmt_addr = reader.varint()
+    tag = reader.string()
+    if header & FORMAT_RELATIVE:
+        if image_start is None:
+            raise LogBinaryDecodeError('format relative to __executable_start, which is not in the ELF file')
+        fmt_addr += image_start
+    fmt = get_string(fmt_addr)
+    if fmt is None:
+        raise LogBinaryDecodeError('format string at 0x%x not found' % fmt_addr)
+    message, complete = format_message(fmt, reader)
+    if header & TRUNCATED or not complete:
+        message += ' <truncated>'
+    text = '%s (%d) %s: %s' % (LEVEL_LETTERS.get(level, '?'), timestamp, tag, message)
+    if colors and level in LEVEL_COLORS:
+        text = LEVEL_COLORS[level] + text + RESET_COLOR
+    return text
+
+
+def decode_line(line: bytes, get_string: Callable[[int], Optional[str]], colors: bool = False,
+                image_start: Optional[int] = None) -> str:
+    """ Returns the text of a binary record line, or the line itself if it is not a record """
+    stripped = line.rstrip(b'\r\n')
+    if not stripped.startswith(LINE_PREFIX):
+        return line.decode('utf-8', errors='replace')
+    try:
+        data = bytearray(base64.b64decode(stripped[len(LINE_PREFIX):]))
+        return decode_record(data, get_string, colors, image_start) + '\n'
+    except (binascii.Error, LogBinaryDecodeError) as e:
+        return '%s <%s>\n' % (stripped.decode('utf-8', errors='replace'), e)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='ESP-IDF binary log decoder')
+    parser.add_argument('elf_file', help='Path to the application ELF file')
+    parser.add_argument('input', help='Path to the log output, stdin if not given', nargs='?')
+    parser.add_argument('--colors', help='Color the messages like CONFIG_LOG_COLORS does', action='store_true')
+    args = parser.parse_args()
+
+    try:
+        get_string = ElfStrings(args.elf_file)
+    except (IOError, OSError) as e:
+        print('Failed to open ELF file (%s)!' % e, file=sys.stderr)
+        sys.exit(2)
+
+    stream = open(args.input, 'rb') if args.input else getattr(sys.stdin, 'buffer', sys.stdin)
+    try:
+        for line in iter(stream.readline, b''):
+            sys.stdout.write(decode_line(line, get_string, args.colors, get_string.image_start))
+            sys.stdout.flush()
+    finally:
+        if args.input:
+            stream.close()
+
+
+if __name__ == '__main__':
+    main()
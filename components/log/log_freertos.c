@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <time.h>
 #include <sys/time.h>
@@ -120,3 +121,76 @@ uint32_t esp_log_early_timestamp(void)
     return esp_cpu_get_cycle_count() / (esp_rom_get_cpu_ticks_per_us() * 1000);
 #endif
 }
+
+#if CONFIG_LOG_ASYNC
+static _Atomic(TaskHandle_t) s_async_task;  // cleared by esp_log_impl_async_join() before the task is deleted
+static _Atomic uint32_t s_async_wakers;     // producers between reading s_async_task and notifying it
+static TaskHandle_t s_async_task_to_delete;
+static SemaphoreHandle_t s_async_done;
+static void (*s_async_drain_task)(void);
+
+static void async_task_func(void *arg)
+{
+    s_async_drain_task();
+    xSemaphoreGive(s_async_done);
+    // Producers may still hold the handle of this task, it is deleted by esp_log_impl_async_join() once they don't
+    vTaskSuspend(NULL);
+}
+
+bool esp_log_impl_async_start(void (*drain_task)(void))
+{
+    s_async_drain_task = drain_task;
+    if (s_async_done == NULL) {
+        s_async_done = xSemaphoreCreateBinary();
+        if (s_async_done == NULL) {
+            return false;
+        }
+    }
+    if (xTaskCreate(async_task_func, "log_async", CONFIG_LOG_ASYNC_TASK_STACK_SIZE, NULL,
+                    CONFIG_LOG_ASYNC_TASK_PRIORITY, &s_async_task_to_delete) != pdPASS) {
+        return false;
+    }
+    atomic_store(&s_async_task, s_async_task_to_delete);
+    return true;
+}
+
+void esp_log_impl_async_join(void)
+{
+    // No producer can read the handle after it is cleared, wait for those which read it before
+    atomic_store(&s_async_task, NULL);
+    while (atomic_load(&s_async_wakers) != 0) {
+        vTaskDelay(1);
+    }
+    xSemaphoreTake(s_async_done, portMAX_DELAY);
+    vTaskDelete(s_async_task_to_delete);
+    s_async_task_to_delete = NULL;
+}
+
+void esp_log_impl_async_wait(uint32_t timeout_ms)
+{
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms));
+}
+
+void esp_log_impl_async_wake(void)
+{
+    atomic_fetch_add(&s_async_wakers, 1);
+    TaskHandle_t task = atomic_load(&s_async_task);
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+    atomic_fetch_sub(&s_async_wakers, 1);
+}
+
+void esp_log_impl_async_delay(uint32_t ms)
+{
+    vTaskDelay((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+uint32_t esp_log_impl_async_producer_id(void)
+{
+    // A task always stages in the same ring, even when it moves to another core, so that its messages stay in
+    // order. The task handle is hashed to spread the tasks over the rings.
+    uintptr_t task = (uintptr_t) xTaskGetCurrentTaskHandle();
+    return ((uint32_t) (task >> 2) * 2654435761u) >> 16;
+}
+#endif // CONFIG_LOG_ASYNC
@@ -13,7 +13,10 @@
 // limitations under the License.
 
 #include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
 #include <time.h>
+#include <unistd.h>
 #include <assert.h>
 #include <stdint.h>
 #include "esp_log_private.h"
@@ -44,3 +47,67 @@ uint32_t esp_log_timestamp(void)
     uint32_t milliseconds = current_time.tv_sec * 1000 + current_time.tv_nsec / 1000000;
     return milliseconds;
 }
+
+#if CONFIG_LOG_ASYNC
+static pthread_t s_async_thread;
+static sem_t s_async_wake;      // never destroyed, as producers may post it while asynchronous output stops
+static bool s_async_wake_init;
+static void (*s_async_drain_task)(void);
+
+static void *async_thread_func(void *arg)
+{
+    s_async_drain_task();
+    return NULL;
+}
+
+bool esp_log_impl_async_start(void (*drain_task)(void))
+{
+    s_async_drain_task = drain_task;
+    if (!s_async_wake_init) {
+        if (sem_init(&s_async_wake, 0, 0) != 0) {
+            return false;
+        }
+        s_async_wake_init = true;
+    }
+    return pthread_create(&s_async_thread, NULL, async_thread_func, NULL) == 0;
+}
+
+void esp_log_impl_async_join(void)
+{
+    pthread_join(s_async_thread, NULL);
+}
+
+void esp_log_impl_async_wait(uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    sem_timedwait(&s_async_wake, &deadline);
+}
+
+void esp_log_impl_async_wake(void)
+{
+    sem_post(&s_async_wake);
+}
+
+void esp_log_impl_async_delay(uint32_t ms)
+{
+    usleep(ms * 1000);
+}
+
+uint32_t esp_log_impl_async_producer_id(void)
+{
+    // threads aren't bound to cores on Linux, so they are spread over the rings in the order they first log
+    static _Atomic uint32_t s_next_id;
+    static __thread uint32_t s_id;
+    if (s_id == 0) {
+        s_id = atomic_fetch_add(&s_next_id, 1) + 1;
+    }
+    return s_id;
+}
+#endif // CONFIG_LOG_ASYNC
@@ -44,14 +44,14 @@ TEST_CASE("test master logging level performance", "[log]")
     TEST_ASSERT_INT_WITHIN(100, 150, calc_time_of_logging(ITERATIONS));
 #else
     esp_log_level_set("*", ESP_LOG_NONE);
-    TEST_ASSERT_INT_WITHIN(5, 11, calc_time_of_logging(ITERATIONS) / ITERATIONS);
+    TEST_ASSERT_LESS_OR_EQUAL(16, calc_time_of_logging(ITERATIONS) / ITERATIONS);
 #endif
 
     esp_log_level_set("*", ESP_LOG_NONE);
 #ifdef CONFIG_LOG_MASTER_LEVEL
     esp_log_set_level_master(ESP_LOG_DEBUG);
 #endif
-    TEST_ASSERT_INT_WITHIN(5, 11, calc_time_of_logging(ITERATIONS) / ITERATIONS);
+    TEST_ASSERT_LESS_OR_EQUAL(16, calc_time_of_logging(ITERATIONS) / ITERATIONS);
 
     esp_log_level_set("*", ESP_LOG_INFO);
     ESP_LOGI(TAG, "End");
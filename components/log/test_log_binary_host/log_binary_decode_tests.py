@@ -0,0 +1,154 @@
+#!/usr/bin/env python
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+import base64
+import struct
+import sys
+import unittest
+from typing import Dict, Optional
+
+try:
+    import log_binary_decode
+except ImportError:
+    sys.path.append('..')
+    import log_binary_decode
+
+LOG_WARN = 2
+LOG_INFO = 3
+FORMAT_ADDR = 0x3f400100
+
+
+def varint(value):  # type: (int) -> bytes
+    out = bytearray()
+    while True:
+        b = value & 0x7f
+        value >>= 7
+        if value:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def signed(value):  # type: (int) -> bytes
+    return varint((value << 1) ^ (value >> 63))
+
+
+def double(value):  # type: (float) -> bytes
+    return struct.pack('<d', value)
+
+
+def string(value):  # type: (str) -> bytes
+    return value.encode() + b'\0'
+
+
+def record(args, level=LOG_INFO, timestamp=1234, fmt_addr=FORMAT_ADDR, tag='tag', flags=0):
+    # type: (bytes, int, int, int, str, int) -> bytearray
+    """ Packs a record like esp_log_write_binary does """
+    return bytearray(bytes([level | flags]) + varint(timestamp) + varint(fmt_addr) + string(tag) + args)
+
+
+class Strings(object):
+    """ Stands for the strings of an ELF file """
+
+    def __init__(self, strings):  # type: (Dict[int, str]) -> None
+        self.strings = strings
+
+    def __call__(self, addr):  # type: (int) -> Optional[str]
+        return self.strings.get(addr)
+
+
+def decode(fmt, args, **kwargs):  # type: (str, bytes, int) -> str
+    return log_binary_decode.decode_record(record(args, **kwargs), Strings({FORMAT_ADDR: fmt}))
+
+
+class DecodeRecordTests(unittest.TestCase):
+
+    def test_integers(self):  # type: () -> None
+        self.assertEqual(decode('%d %i %u', signed(-5) + signed(7) + varint(300)), 'I (1234) tag: -5 7 300')
+        self.assertEqual(decode('%lld %llu', signed(-(1 << 62)) + varint((1 << 64) - 1)),
+                         'I (1234) tag: %d %d' % (-(1 << 62), (1 << 64) - 1))
+        self.assertEqual(decode('%x %X %08x %o', varint(0xabc) + varint(0xabc) + varint(0x12) + varint(8)),
+                         'I (1234) tag: abc ABC 00000012 10')
+        self.assertEqual(decode('%5d|%-5d|%+d', signed(42) + signed(42) + signed(42)), 'I (1234) tag:    42|42   |+42')
+
+    def test_characters_and_strings(self):  # type: () -> None
+        self.assertEqual(decode('%c%c', varint(ord('o')) + varint(ord('k'))), 'I (1234) tag: ok')
+        self.assertEqual(decode('[%s] [%6s] [%-4s]', string('abc') + string('abc') + string('ab')),
+                         'I (1234) tag: [abc] [   abc] [ab  ]')
+        # strings are cut to their precision on the device
+        self.assertEqual(decode('%.3s', string('pre')), 'I (1234) tag: pre')
+
+    def test_floating_point(self):  # type: () -> None
+        self.assertEqual(decode('%.2f %e %g', double(1.5) + double(1000.0) + double(0.25)),
+                         'I (1234) tag: 1.50 1.000000e+03 0.25')
+        self.assertEqual(decode('%a', double(1.0)), 'I (1234) tag: 0x1.0000000000000p+0')
+
+    def test_star_width_and_precision(self):  # type: () -> None
+        self.assertEqual(decode('[%*d]', signed(4) + signed(7)), 'I (1234) tag: [   7]')
+        self.assertEqual(decode('[%*d]', signed(-4) + signed(7)), 'I (1234) tag: [7   ]')
+        self.assertEqual(decode('[%.*f]', signed(1) + double(2.25)), 'I (1234) tag: [2.2]')
+
+    def test_pointer_and_percent(self):  # type: () -> None
+        self.assertEqual(decode('%p 100%%', varint(0x3ffb0000)), 'I (1234) tag: 0x3ffb0000 100%')
+
+    def test_no_arguments(self):  # type: () -> None
+        self.assertEqual(decode('plain text', b''), 'I (1234) tag: plain text')
+
+    def test_level_timestamp_and_tag(self):  # type: () -> None
+        self.assertEqual(decode('%d', signed(1), level=LOG_WARN, timestamp=99999, tag='wifi'), 'W (99999) wifi: 1')
+        self.assertEqual(decode('%d', signed(1), level=6), '? (1234) tag: 1')
+
+    def test_colors(self):  # type: () -> None
+        text = log_binary_decode.decode_record(record(b'', level=LOG_WARN), Strings({FORMAT_ADDR: 'x'}), colors=True)
+        self.assertEqual(text, '\033[0;33mW (1234) tag: x\033[0m')
+
+    def test_truncated_arguments(self):  # type: () -> None
+        # the record ends in the middle of the arguments: the rest of the format is printed as is
+        self.assertEqual(decode('%d %s %d', signed(1)), 'I (1234) tag: 1 %s %d <truncated>')
+        self.assertEqual(decode('%d %s', signed(1) + b'unterminated'), 'I (1234) tag: 1 %s <truncated>')
+        self.assertEqual(decode('%f', double(1.0)[:5]), 'I (1234) tag: %f <truncated>')
+        self.assertEqual(decode('%u', b'\x80\x80'), 'I (1234) tag: %u <truncated>')
+
+    def test_truncated_flag(self):  # type: () -> None
+        self.assertEqual(decode('%s', string('abc'), flags=log_binary_decode.TRUNCATED), 'I (1234) tag: abc <truncated>')
+
+    def test_missing_format(self):  # type: () -> None
+        with self.assertRaises(log_binary_decode.LogBinaryDecodeError):
+            log_binary_decode.decode_record(record(b''), Strings({}))
+
+    def test_truncated_header(self):  # type: () -> None
+        full = record(b'')
+        for length in range(len(full)):
+            with self.assertRaises(log_binary_decode.LogBinaryDecodeError):
+                log_binary_decode.decode_record(full[:length], Strings({FORMAT_ADDR: 'x'}))
+
+    def test_relative_format(self):  # type: () -> None
+        # on Linux, the format is an offset from __executable_start
+        data = record(signed(3), fmt_addr=0x100, flags=log_binary_decode.FORMAT_RELATIVE)
+        strings = Strings({0x400100: 'relative %d'})
+        self.assertEqual(log_binary_decode.decode_record(data, strings, image_start=0x400000), 'I (1234) tag: relative 3')
+        with self.assertRaises(log_binary_decode.LogBinaryDecodeError):
+            log_binary_decode.decode_record(data, strings)
+
+
+class DecodeLineTests(unittest.TestCase):
+
+    def line(self, data):  # type: (bytearray) -> bytes
+        return b'#L' + base64.b64encode(bytes(data)) + b'\r\n'
+
+    def test_record_line(self):  # type: () -> None
+        line = self.line(record(signed(-1)))
+        self.assertEqual(log_binary_decode.decode_line(line, Strings({FORMAT_ADDR: 'value %d'})), 'I (1234) tag: value -1\n')
+
+    def test_text_line(self):  # type: () -> None
+        self.assertEqual(log_binary_decode.decode_line(b'I (10) boot: text\n', Strings({})), 'I (10) boot: text\n')
+
+    def test_invalid_lines(self):  # type: () -> None
+        self.assertTrue(log_binary_decode.decode_line(b'#L!!!\n', Strings({})).startswith('#L!!! <'))
+        line = log_binary_decode.decode_line(self.line(record(b'')), Strings({}))
+        self.assertIn('format string at 0x%x not found' % FORMAT_ADDR, line)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -282,17 +282,7 @@ struct NVSValidStorageFixture : public PartitionMockFixture {
         esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
         esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
 
-        // storage finally actually reads namespace
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
-
-        // storage looks for blob index entries
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
-
-        // Storage::eraseOrphanDataBlobs() also wants to take it's turn...
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
+        // namespaces and blob entries are collected while the pages are loaded, storage doesn't read them again
 
         if (storage.init(start_sector, sector_size) != ESP_OK) throw FixtureException("couldn't setup page");
     }
@@ -1329,6 +1329,7 @@ public:
             if (len > smallBlobLen) {
                 return ESP_FAIL;
             }
+            memset(v10, 0, smallBlobLen);
             memcpy(v10, value, len);
             written[index] = true;
             return ESP_OK;
@@ -2055,3 +2056,586 @@ TEST_CASE("Recovery from power-off during modification of blob present in old-fo
 
     TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
 }
+
+TEST_CASE("nvs batch api writes all staged values on commit", "[nvs][batch]")
+{
+    PartitionEmulationFixture f(0, 5);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 5));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "existing", 1));
+
+    TEST_ESP_ERR(nvs_batch_set_i32(handle, "foo", 1), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_batch_commit(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_batch_abort(handle), ESP_ERR_NVS_INVALID_STATE);
+
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_ERR(nvs_batch_begin(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_batch_set_u8(handle, "key_is_too_long_", 1), ESP_ERR_NVS_KEY_TOO_LONG);
+    TEST_ESP_OK(nvs_batch_set_i32(handle, "existing", 2));
+    TEST_ESP_OK(nvs_batch_set_u8(handle, "u8", 0xab));
+    TEST_ESP_OK(nvs_batch_set_u64(handle, "u64", 0x123456789abcdefULL));
+    TEST_ESP_OK(nvs_batch_set_str(handle, "str", "value 0123456789abcdef0123456789abcdef"));
+    // staging a key again replaces the value
+    TEST_ESP_OK(nvs_batch_set_u8(handle, "u8", 0xcd));
+
+    // nothing is written before the commit
+    uint8_t u8;
+    int32_t i32;
+    TEST_ESP_ERR(nvs_get_u8(handle, "u8", &u8), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_get_i32(handle, "existing", &i32));
+    CHECK(i32 == 1);
+
+    TEST_ESP_OK(nvs_batch_commit(handle));
+    TEST_ESP_ERR(nvs_batch_commit(handle), ESP_ERR_NVS_INVALID_STATE);
+
+    uint64_t u64;
+    char buf[64];
+    size_t buf_len = sizeof(buf);
+    TEST_ESP_OK(nvs_get_i32(handle, "existing", &i32));
+    CHECK(i32 == 2);
+    TEST_ESP_OK(nvs_get_u8(handle, "u8", &u8));
+    CHECK(u8 == 0xcd);
+    TEST_ESP_OK(nvs_get_u64(handle, "u64", &u64));
+    CHECK(u64 == 0x123456789abcdefULL);
+    TEST_ESP_OK(nvs_get_str(handle, "str", buf, &buf_len));
+    CHECK(strcmp(buf, "value 0123456789abcdef0123456789abcdef") == 0);
+
+    // aborted batches don't change anything
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_OK(nvs_batch_set_i32(handle, "existing", 3));
+    TEST_ESP_OK(nvs_batch_abort(handle));
+    TEST_ESP_OK(nvs_get_i32(handle, "existing", &i32));
+    CHECK(i32 == 2);
+
+    size_t used_entries;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries));
+    CHECK(used_entries == 1 + 1 + 1 + 3);
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 5));
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    TEST_ESP_ERR(nvs_batch_begin(handle), ESP_ERR_NVS_READ_ONLY);
+    TEST_ESP_OK(nvs_get_u8(handle, "u8", &u8));
+    CHECK(u8 == 0xcd);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("nvs batch spanning pages and replacing values on older pages", "[nvs][batch]")
+{
+    const size_t KEY_COUNT = 60;
+    PartitionEmulationFixture f(0, 5);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 5));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    char key[16];
+    for (uint32_t round = 0; round < 20; ++round) {
+        TEST_ESP_OK(nvs_batch_begin(handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            // every third key keeps its value to mix replaced and unchanged items
+            uint32_t value = (i % 3 == 0) ? i : i + round;
+            TEST_ESP_OK(nvs_batch_set_u32(handle, key, value));
+        }
+        TEST_ESP_OK(nvs_batch_commit(handle));
+
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == ((i % 3 == 0) ? i : i + round));
+        }
+        size_t used_entries;
+        TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries));
+        CHECK(used_entries == KEY_COUNT);
+    }
+
+    // a batch has to fit into one page
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    for (size_t i = 0; i < nvs::Page::ENTRY_COUNT + 1; ++i) {
+        snprintf(key, sizeof(key), "big%u", static_cast<unsigned>(i));
+        TEST_ESP_OK(nvs_batch_set_u8(handle, key, 1));
+    }
+    TEST_ESP_ERR(nvs_batch_commit(handle), ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    uint8_t u8;
+    TEST_ESP_ERR(nvs_get_u8(handle, "big0", &u8), ESP_ERR_NVS_NOT_FOUND);
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("Recovery from power-off while a batch was written", "[nvs][batch]")
+{
+    PartitionEmulationFixture f(0, 3);
+
+    nvs::Page p;
+    p.load(f.part(), 0);
+    TEST_ESP_OK(p.writeItem(1, "key0", static_cast<uint32_t>(1)));
+    TEST_ESP_OK(p.writeItem(1, "key1", static_cast<uint32_t>(2)));
+
+    /* The headers of the batch made it to flash, but only the state of the last entry was updated before
+     * power went off. Entry states are updated back to front, hence this is the only possible partial state.*/
+    nvs::Item items[2] = {
+        nvs::Item(1, nvs::ItemType::U32, 1, "key0"),
+        nvs::Item(1, nvs::ItemType::U32, 1, "key1"),
+    };
+    for (size_t i = 0; i < 2; ++i) {
+        uint32_t value = 10 + i;
+        memcpy(items[i].data, &value, sizeof(value));
+        items[i].crc32 = items[i].calculateCrc32();
+    }
+    const uint32_t ENTRY_TABLE_OFFSET = 32;
+    const uint32_t ENTRY_DATA_OFFSET = 64;
+    TEST_ESP_OK(f.part()->write_raw(ENTRY_DATA_OFFSET + 2 * nvs::Page::ENTRY_SIZE, items, sizeof(items)));
+    uint32_t state_word = ~(1u << 6); // entry 3 WRITTEN
+    TEST_ESP_OK(f.part()->write_raw(ENTRY_TABLE_OFFSET, &state_word, sizeof(state_word)));
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 3));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    uint32_t value;
+    TEST_ESP_OK(nvs_get_u32(handle, "key0", &value));
+    CHECK(value == 1);
+    TEST_ESP_OK(nvs_get_u32(handle, "key1", &value));
+    CHECK(value == 2);
+    size_t used_entries;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries));
+    CHECK(used_entries == 2);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+}
+
+TEST_CASE("Recovery from power-off while the values replaced by a batch were erased", "[nvs][batch]")
+{
+    const size_t KEY_COUNT = 6;
+    PartitionEmulationFixture f(0, 3);
+    char key[16];
+
+    nvs::Page p;
+    p.load(f.part(), 0);
+    p.setSeqNumber(0);
+    TEST_ESP_OK(p.writeItem(nvs::Page::NS_INDEX, "namespace1", static_cast<uint8_t>(1)));
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        TEST_ESP_OK(p.writeItem(1, key, static_cast<uint32_t>(i)));
+    }
+    TEST_ESP_OK(p.markFull());
+
+    /* The batch was written completely to the next page. Storage::writeBatch puts the items replacing adjacent
+     * entries in back to front order and erases them the same way, so the first two old values are still present.*/
+    nvs::Page p2;
+    p2.load(f.part(), 1);
+    p2.setSeqNumber(1);
+    TEST_ESP_OK(p2.writeItem(1, "new", static_cast<uint32_t>(100)));
+    for (size_t i = KEY_COUNT; i > 0; --i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i - 1));
+        TEST_ESP_OK(p2.writeItem(1, key, static_cast<uint32_t>(100 + i - 1)));
+    }
+    for (size_t i = KEY_COUNT; i > 2; --i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i - 1));
+        TEST_ESP_OK(p.eraseItem(1, nvs::itemTypeOf<uint32_t>(), key));
+    }
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 3));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    uint32_t value;
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+        CHECK(value == 100 + i);
+    }
+    size_t used_entries;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries));
+    CHECK(used_entries == KEY_COUNT + 1);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+
+    nvs::Page p3;
+    p3.load(f.part(), 0);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        TEST_ESP_ERR(p3.findItem(1, nvs::ItemType::U32, key), ESP_ERR_NVS_NOT_FOUND);
+    }
+}
+
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+TEST_CASE("nvs batch needs fewer flash writes than single writes", "[nvs][batch][benchmark]")
+{
+    const size_t KEY_COUNT = 30;
+    const size_t ROUNDS = 10;
+    size_t write_ops[2];
+    char key[16];
+
+    for (int batch = 0; batch < 2; ++batch) {
+        PartitionEmulationFixture f(0, 5);
+        TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 5));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+        esp_partition_clear_stats();
+        for (uint32_t round = 0; round < ROUNDS; ++round) {
+            if (batch) {
+                TEST_ESP_OK(nvs_batch_begin(handle));
+            }
+            for (size_t i = 0; i < KEY_COUNT; ++i) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                if (batch) {
+                    TEST_ESP_OK(nvs_batch_set_u32(handle, key, round));
+                } else {
+                    TEST_ESP_OK(nvs_set_u32(handle, key, round));
+                }
+            }
+            if (batch) {
+                TEST_ESP_OK(nvs_batch_commit(handle));
+            }
+        }
+        write_ops[batch] = esp_partition_get_write_ops();
+
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    }
+
+    printf("%u keys x %u updates: %u flash writes with nvs_set_u32, %u with a batch\n",
+            static_cast<unsigned>(KEY_COUNT), static_cast<unsigned>(ROUNDS),
+            static_cast<unsigned>(write_ops[0]), static_cast<unsigned>(write_ops[1]));
+    CHECK(write_ops[1] < write_ops[0]);
+}
+#endif // CONFIG_ESP_PARTITION_ENABLE_STATS
+
+TEST_CASE("nvs blob write in parts and partial reads", "[nvs][blob_stream]")
+{
+    const size_t BLOB_SIZE = 48 * 1024;
+    const size_t PAGE_COUNT = 32;
+    uint8_t *blob = (uint8_t *) malloc(BLOB_SIZE);
+    uint8_t *blob_read = (uint8_t *) malloc(BLOB_SIZE);
+    for (size_t i = 0; i < BLOB_SIZE; ++i) {
+        blob[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+    }
+    PartitionEmulationFixture f(0, PAGE_COUNT);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, PAGE_COUNT));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_ERR(nvs_blob_write_append(handle, blob, 1), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_blob_write_commit(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_blob_write_abort(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_blob_write_begin(handle, "key_is_too_long_"), ESP_ERR_NVS_KEY_TOO_LONG);
+
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", blob, 100));
+    TEST_ESP_OK(nvs_blob_write_begin(handle, "blob"));
+    TEST_ESP_ERR(nvs_blob_write_begin(handle, "blob"), ESP_ERR_NVS_INVALID_STATE);
+    // small pieces which are buffered and a large one which is written directly
+    size_t offset = 0;
+    const size_t piece_sizes[] = {1000, 3, 10000, 777};
+    for (size_t i = 0; offset < BLOB_SIZE; ++i) {
+        size_t piece = piece_sizes[i % (sizeof(piece_sizes) / sizeof(piece_sizes[0]))];
+        piece = (piece < BLOB_SIZE - offset) ? piece : BLOB_SIZE - offset;
+        TEST_ESP_OK(nvs_blob_write_append(handle, blob + offset, piece));
+        offset += piece;
+
+        // the previous value stays readable until the commit
+        size_t size = 0;
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", NULL, &size));
+        CHECK(size == 100);
+    }
+    TEST_ESP_OK(nvs_blob_write_commit(handle));
+
+    size_t read_size = BLOB_SIZE;
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", blob_read, &read_size));
+    CHECK(read_size == BLOB_SIZE);
+    CHECK(memcmp(blob, blob_read, BLOB_SIZE) == 0);
+
+    // ranges inside a chunk, across chunk boundaries and at both ends
+    const size_t ranges[][2] = {
+        {0, 1}, {0, 5000}, {3999, 2}, {nvs::Page::CHUNK_MAX_SIZE * 3 - 10, 8020},
+        {BLOB_SIZE - 1, 1}, {BLOB_SIZE - 4096, 4096}, {BLOB_SIZE, 0}, {0, BLOB_SIZE},
+    };
+    for (auto &range : ranges) {
+        memset(blob_read, 0xee, BLOB_SIZE);
+        TEST_ESP_OK(nvs_get_blob_range(handle, "blob", range[0], blob_read, range[1]));
+        CHECK(memcmp(blob + range[0], blob_read, range[1]) == 0);
+        if (range[1] < BLOB_SIZE) {
+            CHECK(blob_read[range[1]] == 0xee);
+        }
+    }
+    TEST_ESP_ERR(nvs_get_blob_range(handle, "blob", BLOB_SIZE - 1, blob_read, 2), ESP_ERR_NVS_INVALID_LENGTH);
+    TEST_ESP_ERR(nvs_get_blob_range(handle, "blob", BLOB_SIZE + 1, blob_read, 0), ESP_ERR_NVS_INVALID_LENGTH);
+    TEST_ESP_ERR(nvs_get_blob_range(handle, "missing", 0, blob_read, 1), ESP_ERR_NVS_NOT_FOUND);
+
+    // an empty blob
+    TEST_ESP_OK(nvs_blob_write_begin(handle, "empty"));
+    TEST_ESP_OK(nvs_blob_write_commit(handle));
+    read_size = BLOB_SIZE;
+    TEST_ESP_OK(nvs_get_blob(handle, "empty", blob_read, &read_size));
+    CHECK(read_size == 0);
+
+    // an aborted write keeps the previous value and leaves no chunks behind
+    size_t used_entries;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries));
+    TEST_ESP_OK(nvs_blob_write_begin(handle, "blob"));
+    TEST_ESP_OK(nvs_blob_write_append(handle, blob_read, 10000));
+    TEST_ESP_OK(nvs_blob_write_abort(handle));
+    size_t used_entries_after;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries_after));
+    CHECK(used_entries_after == used_entries);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, PAGE_COUNT));
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    TEST_ESP_ERR(nvs_blob_write_begin(handle, "blob"), ESP_ERR_NVS_READ_ONLY);
+    TEST_ESP_OK(nvs_get_blob_range(handle, "blob", 12345, blob_read, 20000));
+    CHECK(memcmp(blob + 12345, blob_read, 20000) == 0);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+    free(blob);
+    free(blob_read);
+}
+
+TEST_CASE("nvs blob write in parts rejects oversized blobs and survives power-off", "[nvs][blob_stream]")
+{
+    const size_t PAGE_COUNT = 5;
+    const size_t MAX_BLOB_SIZE = (PAGE_COUNT - 1) * nvs::Page::CHUNK_MAX_SIZE;
+    uint8_t *blob = (uint8_t *) malloc(MAX_BLOB_SIZE + 1);
+    memset(blob, 0x5a, MAX_BLOB_SIZE + 1);
+    PartitionEmulationFixture f(0, PAGE_COUNT);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, PAGE_COUNT));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", blob, 100));
+    TEST_ESP_OK(nvs_blob_write_begin(handle, "blob"));
+    // the rejected append leaves the write open
+    TEST_ESP_ERR(nvs_blob_write_append(handle, blob, MAX_BLOB_SIZE + 1), ESP_ERR_NVS_VALUE_TOO_LONG);
+    TEST_ESP_OK(nvs_blob_write_append(handle, blob, nvs::Page::CHUNK_MAX_SIZE));
+    TEST_ESP_ERR(nvs_blob_write_append(handle, blob, MAX_BLOB_SIZE - nvs::Page::CHUNK_MAX_SIZE + 1), ESP_ERR_NVS_VALUE_TOO_LONG);
+    TEST_ESP_OK(nvs_blob_write_abort(handle));
+
+    size_t used_entries;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries));
+    TEST_ESP_OK(nvs_blob_write_begin(handle, "blob"));
+    TEST_ESP_OK(nvs_blob_write_append(handle, blob, nvs::Page::CHUNK_MAX_SIZE + 100));
+
+    // power goes off before the commit, the chunks written so far are orphans
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    nvs_close(handle);
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, PAGE_COUNT));
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    size_t used_entries_after;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries_after));
+    CHECK(used_entries_after == used_entries);
+    uint8_t blob_read[100];
+    size_t read_size = sizeof(blob_read);
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", blob_read, &read_size));
+    CHECK(read_size == 100);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    free(blob);
+}
+
+TEST_CASE("nvs blob write in parts rejects other writes of the key while it is open", "[nvs][blob_stream]")
+{
+    const size_t PAGE_COUNT = 8;
+    const size_t BLOB_SIZE = nvs::Page::CHUNK_MAX_SIZE + 100;
+    uint8_t *blob = (uint8_t *) malloc(BLOB_SIZE);
+    uint8_t *blob_read = (uint8_t *) malloc(BLOB_SIZE);
+    memset(blob, 0xa5, BLOB_SIZE);
+    PartitionEmulationFixture f(0, PAGE_COUNT);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, PAGE_COUNT));
+
+    nvs_handle_t handle, other, other_ns;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &other));
+    TEST_ESP_OK(nvs_open("namespace2", NVS_READWRITE, &other_ns));
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", blob_read, 100));
+    size_t used_entries;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries));
+
+    TEST_ESP_OK(nvs_blob_write_begin(handle, "blob"));
+    TEST_ESP_OK(nvs_blob_write_append(handle, blob, BLOB_SIZE));
+    TEST_ESP_ERR(nvs_blob_write_begin(other, "blob"), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_set_blob(other, "blob", blob, 10), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_set_blob(handle, "blob", blob, 10), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_key(other, "blob"), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_all(other), ESP_ERR_NVS_INVALID_STATE);
+    // other keys and namespaces are not affected
+    TEST_ESP_OK(nvs_set_blob(other, "blob2", blob, 10));
+    TEST_ESP_OK(nvs_erase_key(other, "blob2"));
+    TEST_ESP_OK(nvs_set_blob(other_ns, "blob", blob, 10));
+    TEST_ESP_OK(nvs_erase_all(other_ns));
+    TEST_ESP_OK(nvs_blob_write_commit(handle));
+
+    size_t read_size = BLOB_SIZE;
+    TEST_ESP_OK(nvs_get_blob(other, "blob", blob_read, &read_size));
+    CHECK(read_size == BLOB_SIZE);
+    CHECK(memcmp(blob, blob_read, BLOB_SIZE) == 0);
+
+    // once the write is closed, the key can be written and erased again
+    TEST_ESP_OK(nvs_blob_write_begin(handle, "blob"));
+    TEST_ESP_OK(nvs_blob_write_append(handle, blob, 10));
+    TEST_ESP_OK(nvs_blob_write_abort(handle));
+    TEST_ESP_OK(nvs_set_blob(other, "blob", blob, 100));
+    size_t used_entries_after;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used_entries_after));
+    CHECK(used_entries_after == used_entries);
+    TEST_ESP_OK(nvs_erase_key(other, "blob"));
+    TEST_ESP_ERR(nvs_get_blob(handle, "blob", NULL, &read_size), ESP_ERR_NVS_NOT_FOUND);
+
+    nvs_close(other_ns);
+    nvs_close(other);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    free(blob);
+    free(blob_read);
+}
+
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+TEST_CASE("nvs partial blob read only reads the chunks of the range", "[nvs][blob_stream][benchmark]")
+{
+    const size_t BLOB_SIZE = 48 * 1024;
+    const size_t PAGE_COUNT = 32;
+    const size_t RANGE_SIZE = 256;
+    uint8_t *blob = (uint8_t *) malloc(BLOB_SIZE);
+    memset(blob, 0xa5, BLOB_SIZE);
+    PartitionEmulationFixture f(0, PAGE_COUNT);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, PAGE_COUNT));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", blob, BLOB_SIZE));
+
+    size_t read_size = BLOB_SIZE;
+    esp_partition_clear_stats();
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", blob, &read_size));
+    size_t full_read_bytes = esp_partition_get_read_bytes();
+
+    esp_partition_clear_stats();
+    TEST_ESP_OK(nvs_get_blob_range(handle, "blob", BLOB_SIZE - RANGE_SIZE, blob, RANGE_SIZE));
+    size_t range_read_bytes = esp_partition_get_read_bytes();
+
+    printf("%u byte blob: %u bytes read from flash for the whole blob, %u for the last %u bytes\n",
+            static_cast<unsigned>(BLOB_SIZE), static_cast<unsigned>(full_read_bytes),
+            static_cast<unsigned>(range_read_bytes), static_cast<unsigned>(RANGE_SIZE));
+    CHECK(range_read_bytes * 4 < full_read_bytes);
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    free(blob);
+}
+#endif // CONFIG_ESP_PARTITION_ENABLE_STATS
+
+TEST_CASE("nvs op stats count values, items and relocations per namespace", "[nvs][op_stats]")
+{
+    PartitionEmulationFixture f(0, 4);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 4));
+    nvs_handle_t handle1, handle2;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle1));
+    TEST_ESP_OK(nvs_open("namespace2", NVS_READWRITE, &handle2));
+    TEST_ESP_OK(nvs_reset_op_stats(NULL));
+
+    uint8_t blob[100];
+    memset(blob, 0x5a, sizeof(blob));
+    TEST_ESP_OK(nvs_set_u32(handle1, "u32", 1));
+    TEST_ESP_OK(nvs_set_u32(handle1, "u32", 1)); // unchanged, not written again
+    TEST_ESP_OK(nvs_set_blob(handle2, "blob", blob, sizeof(blob)));
+    TEST_ESP_OK(nvs_set_str(handle2, "str", "hello"));
+
+    nvs_namespace_op_stats_t ns1, ns2;
+    TEST_ESP_OK(nvs_get_namespace_op_stats(handle1, &ns1));
+    TEST_ESP_OK(nvs_get_namespace_op_stats(handle2, &ns2));
+    CHECK(ns1.value_bytes == 8);
+    CHECK(ns1.items_written == 1);
+    CHECK(ns1.entries_written == 1);
+    CHECK(ns2.value_bytes == sizeof(blob) + 6);
+    CHECK(ns2.items_written == 3);          // blob chunk, blob index, string
+    CHECK(ns2.entries_written == 5 + 1 + 2);
+
+    nvs_op_stats_t stats;
+    TEST_ESP_OK(nvs_get_op_stats(NULL, &stats));
+    CHECK(stats.items_written == 4);
+    CHECK(stats.entries_written == 9);
+    CHECK(stats.items_relocated == 0);
+    CHECK(stats.crc_computations > 0);
+    CHECK(stats.flash_write_bytes >= stats.entries_written * 32);
+
+    // fill most of the partition with values which stay, so that reclaimed pages still hold live items
+    char key[16];
+    char str[64];
+    memset(str, 'x', sizeof(str) - 1);
+    str[sizeof(str) - 1] = 0;
+    for (int i = 0; i < 90; ++i) {
+        snprintf(key, sizeof(key), "cold%d", i);
+        TEST_ESP_OK(nvs_set_str(handle1, key, str));
+    }
+    for (int i = 0; i < 300; ++i) {
+        snprintf(key, sizeof(key), "hot%d", i % 3);
+        str[0] = 'a' + i % 26;
+        TEST_ESP_OK(nvs_set_str(handle1, key, str));
+    }
+    TEST_ESP_OK(nvs_get_namespace_op_stats(handle1, &ns1));
+    TEST_ESP_OK(nvs_get_namespace_op_stats(handle2, &ns2));
+    TEST_ESP_OK(nvs_get_op_stats(NULL, &stats));
+    CHECK(stats.pages_erased > 0);
+    CHECK(ns1.items_relocated > 0);
+    CHECK(ns1.entries_relocated >= ns1.items_relocated);
+    CHECK(stats.items_relocated >= ns1.items_relocated + ns2.items_relocated);
+    CHECK(stats.flash_erase_bytes == stats.pages_erased * SPI_FLASH_SEC_SIZE);
+
+    TEST_ESP_OK(nvs_reset_op_stats(NULL));
+    TEST_ESP_OK(nvs_get_op_stats(NULL, &stats));
+    TEST_ESP_OK(nvs_get_namespace_op_stats(handle2, &ns2));
+    CHECK(stats.items_written == 0);
+    CHECK(stats.flash_write_bytes == 0);
+    CHECK(ns2.items_relocated == 0);
+
+    nvs_close(handle2);
+    TEST_ESP_ERR(nvs_get_namespace_op_stats(handle2, &ns2), ESP_ERR_NVS_INVALID_HANDLE);
+    TEST_ESP_ERR(nvs_get_op_stats(NULL, NULL), ESP_ERR_INVALID_ARG);
+    nvs_close(handle1);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    TEST_ESP_ERR(nvs_get_op_stats(NULL, &stats), ESP_ERR_NVS_NOT_INITIALIZED);
+}
+
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+TEST_CASE("nvs op stats match the flash operations of the partition", "[nvs][op_stats]")
+{
+    PartitionEmulationFixture f(0, 4);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 4));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+    TEST_ESP_OK(nvs_reset_op_stats(NULL));
+    esp_partition_clear_stats();
+    uint8_t blob[300];
+    for (int i = 0; i < 100; ++i) {
+        memset(blob, i, sizeof(blob));
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", blob, sizeof(blob)));
+        TEST_ESP_OK(nvs_set_u32(handle, "u32", i));
+    }
+    size_t size = sizeof(blob);
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", blob, &size));
+
+    nvs_op_stats_t stats;
+    TEST_ESP_OK(nvs_get_op_stats(NULL, &stats));
+    CHECK(stats.flash_read_ops == esp_partition_get_read_ops());
+    CHECK(stats.flash_read_bytes == esp_partition_get_read_bytes());
+    CHECK(stats.flash_write_ops == esp_partition_get_write_ops());
+    CHECK(stats.flash_write_bytes == esp_partition_get_write_bytes());
+    CHECK(stats.flash_erase_bytes / SPI_FLASH_SEC_SIZE == esp_partition_get_erase_ops());
+
+    printf("%u value bytes: %u entries written, %u relocated, %u bytes written to flash, %u pages erased\n",
+            static_cast<unsigned>(stats.value_bytes), static_cast<unsigned>(stats.entries_written),
+            static_cast<unsigned>(stats.entries_relocated), static_cast<unsigned>(stats.flash_write_bytes),
+            static_cast<unsigned>(stats.pages_erased));
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+#endif // CONFIG_ESP_PARTITION_ENABLE_STATS
@@ -0,0 +1,304 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "catch.hpp"
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include "nvs_storage.hpp"
+#include "nvs_partition_manager.hpp"
+#include "test_fixtures.hpp"
+
+#define TEST_ESP_ERR(rc, res) CHECK((rc) == (res))
+#define TEST_ESP_OK(rc) CHECK((rc) == ESP_OK)
+
+/**
+ * NVS partition followed by its checkpoint partition.
+ */
+class CheckpointFixture : public PartitionEmulationFixture {
+public:
+    CheckpointFixture(uint32_t sector_count, uint32_t checkpoint_sector_count)
+        : PartitionEmulationFixture(0, sector_count), checkpoint_esp_partition()
+    {
+        checkpoint_esp_partition.address = sector_count * SPI_FLASH_SEC_SIZE;
+        checkpoint_esp_partition.size = checkpoint_sector_count * SPI_FLASH_SEC_SIZE;
+        checkpoint_esp_partition.erase_size = ESP_PARTITION_EMULATED_SECTOR_SIZE;
+        strcpy(checkpoint_esp_partition.label, "nvs_ckpt");
+        checkpoint = new (std::nothrow) nvs::NVSPartition(&checkpoint_esp_partition);
+        CHECK(checkpoint != nullptr);
+    }
+
+    ~CheckpointFixture()
+    {
+        delete checkpoint;
+    }
+
+    esp_partition_t checkpoint_esp_partition;
+    nvs::NVSPartition *checkpoint;
+};
+
+static void make_key(char *key, size_t size, size_t i)
+{
+    snprintf(key, size, "key%05u", static_cast<unsigned>(i));
+}
+
+static size_t read_ops()
+{
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+    return esp_partition_get_read_ops();
+#else
+    return 0;
+#endif
+}
+
+static void clear_stats()
+{
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+    esp_partition_clear_stats();
+#endif
+}
+
+static void fill_storage(nvs::Storage &storage, size_t key_count)
+{
+    uint8_t ns1, ns2;
+    REQUIRE(storage.createOrOpenNamespace("first", true, ns1) == ESP_OK);
+    REQUIRE(storage.createOrOpenNamespace("second", true, ns2) == ESP_OK);
+    char key[16];
+    for (size_t i = 0; i < key_count; ++i) {
+        make_key(key, sizeof(key), i);
+        REQUIRE(storage.writeItem((i % 2) ? ns1 : ns2, key, static_cast<uint32_t>(i)) == ESP_OK);
+    }
+    static uint8_t blob[nvs::Page::CHUNK_MAX_SIZE + 100];
+    memset(blob, 0xa5, sizeof(blob));
+    REQUIRE(storage.writeItem(ns1, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+    REQUIRE(storage.writeItem(ns2, nvs::ItemType::SZ, "str", "checkpoint", 11) == ESP_OK);
+    make_key(key, sizeof(key), 0);
+    REQUIRE(storage.eraseItem(ns2, key) == ESP_OK);
+}
+
+static void check_storage(nvs::Storage &storage, size_t key_count, size_t namespace_count = 2)
+{
+    uint8_t ns1, ns2;
+    REQUIRE(storage.createOrOpenNamespace("first", false, ns1) == ESP_OK);
+    REQUIRE(storage.createOrOpenNamespace("second", false, ns2) == ESP_OK);
+    char key[16];
+    uint32_t value;
+    make_key(key, sizeof(key), 0);
+    TEST_ESP_ERR(storage.readItem(ns2, key, value), ESP_ERR_NVS_NOT_FOUND);
+    for (size_t i = 1; i < key_count; ++i) {
+        make_key(key, sizeof(key), i);
+        REQUIRE(storage.readItem((i % 2) ? ns1 : ns2, key, value) == ESP_OK);
+        CHECK(value == i);
+    }
+    size_t size;
+    TEST_ESP_OK(storage.getItemDataSize(ns1, nvs::ItemType::BLOB, "blob", size));
+    CHECK(size == nvs::Page::CHUNK_MAX_SIZE + 100);
+    char str[16];
+    TEST_ESP_OK(storage.readItem(ns2, nvs::ItemType::SZ, "str", str, sizeof(str)));
+    CHECK(strcmp(str, "checkpoint") == 0);
+
+    nvs_stats_t stats;
+    TEST_ESP_OK(storage.fillStats(stats));
+    CHECK(stats.namespace_count == namespace_count);
+}
+
+TEST_CASE("storage is restored from an index checkpoint", "[nvs][checkpoint]")
+{
+    const uint32_t PAGE_COUNT = 8;
+    const size_t KEY_COUNT = 300;
+    CheckpointFixture f(PAGE_COUNT, 4);
+
+    {
+        nvs::Storage storage(f.part());
+        TEST_ESP_ERR(storage.saveCheckpoint(), ESP_ERR_NVS_PART_NOT_FOUND);
+        storage.setCheckpointPartition(f.checkpoint);
+        TEST_ESP_ERR(storage.saveCheckpoint(), ESP_ERR_NVS_NOT_INITIALIZED);
+        REQUIRE(storage.init(0, PAGE_COUNT) == ESP_OK);
+        fill_storage(storage, KEY_COUNT);
+        TEST_ESP_OK(storage.saveCheckpoint());
+    }
+
+    size_t ops_full;
+    {
+        nvs::Storage storage(f.part());
+        clear_stats();
+        REQUIRE(storage.init(0, PAGE_COUNT) == ESP_OK);
+        ops_full = read_ops();
+        check_storage(storage, KEY_COUNT);
+    }
+
+    nvs::Storage storage(f.part());
+    storage.setCheckpointPartition(f.checkpoint);
+    clear_stats();
+    REQUIRE(storage.init(0, PAGE_COUNT) == ESP_OK);
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+    CHECK(read_ops() * 10 < ops_full);
+#endif
+    check_storage(storage, KEY_COUNT);
+
+    // the restored storage keeps working, and its changes make the checkpoint stale
+    uint8_t ns;
+    REQUIRE(storage.createOrOpenNamespace("third", true, ns) == ESP_OK);
+    TEST_ESP_OK(storage.writeItem(ns, "new", static_cast<uint8_t>(1)));
+
+    nvs::Storage reloaded(f.part());
+    reloaded.setCheckpointPartition(f.checkpoint);
+    clear_stats();
+    REQUIRE(reloaded.init(0, PAGE_COUNT) == ESP_OK);
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+    CHECK(read_ops() >= ops_full);
+#endif
+    check_storage(reloaded, KEY_COUNT, 3);
+    REQUIRE(reloaded.createOrOpenNamespace("third", false, ns) == ESP_OK);
+    uint8_t value;
+    TEST_ESP_OK(reloaded.readItem(ns, "new", value));
+    CHECK(value == 1);
+}
+
+TEST_CASE("index checkpoint is not used for a partition which was written again", "[nvs][checkpoint]")
+{
+    const uint32_t PAGE_COUNT = 4;
+    CheckpointFixture f(PAGE_COUNT, 2);
+
+    for (uint32_t pass = 0; pass < 2; ++pass) {
+        nvs::Storage storage(f.part());
+        storage.setCheckpointPartition(f.checkpoint);
+        REQUIRE(storage.init(0, PAGE_COUNT) == ESP_OK);
+        uint8_t ns;
+        REQUIRE(storage.createOrOpenNamespace("ns", true, ns) == ESP_OK);
+        // same layout of entries in both passes, only the values differ
+        TEST_ESP_OK(storage.writeItem(ns, "value", pass));
+        if (pass == 0) {
+            TEST_ESP_OK(storage.saveCheckpoint());
+            REQUIRE(f.part()->erase_range(0, PAGE_COUNT * SPI_FLASH_SEC_SIZE) == ESP_OK);
+        }
+    }
+
+    nvs::Storage storage(f.part());
+    storage.setCheckpointPartition(f.checkpoint);
+    REQUIRE(storage.init(0, PAGE_COUNT) == ESP_OK);
+    uint8_t ns;
+    REQUIRE(storage.createOrOpenNamespace("ns", false, ns) == ESP_OK);
+    uint32_t value;
+    TEST_ESP_OK(storage.readItem(ns, "value", value));
+    CHECK(value == 1);
+}
+
+TEST_CASE("incomplete index checkpoint is not used", "[nvs][checkpoint]")
+{
+    const uint32_t PAGE_COUNT = 4;
+    CheckpointFixture f(PAGE_COUNT, 1);
+
+    {
+        nvs::Storage storage(f.part());
+        storage.setCheckpointPartition(f.checkpoint);
+        REQUIRE(storage.init(0, PAGE_COUNT) == ESP_OK);
+        uint8_t ns;
+        REQUIRE(storage.createOrOpenNamespace("ns", true, ns) == ESP_OK);
+        TEST_ESP_OK(storage.writeItem(ns, "value", 42));
+        TEST_ESP_OK(storage.saveCheckpoint());
+    }
+
+    // corrupt the data following the checkpoint header
+    const uint32_t zero = 0;
+    REQUIRE(f.checkpoint->write_raw(sizeof(nvs::CheckpointHeader) + 100, &zero, sizeof(zero)) == ESP_OK);
+
+    nvs::Storage storage(f.part());
+    storage.setCheckpointPartition(f.checkpoint);
+    REQUIRE(storage.init(0, PAGE_COUNT) == ESP_OK);
+    uint8_t ns;
+    REQUIRE(storage.createOrOpenNamespace("ns", false, ns) == ESP_OK);
+    int value;
+    TEST_ESP_OK(storage.readItem(ns, "value", value));
+    CHECK(value == 42);
+
+    // too many pages for the checkpoint partition
+    CheckpointFixture large(64, 1);
+    nvs::Storage large_storage(large.part());
+    large_storage.setCheckpointPartition(large.checkpoint);
+    REQUIRE(large_storage.init(0, 64) == ESP_OK);
+    char key[16];
+    for (size_t i = 0; i < 2000; ++i) {
+        make_key(key, sizeof(key), i);
+        REQUIRE(large_storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+    }
+    TEST_ESP_ERR(large_storage.saveCheckpoint(), ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+}
+
+TEST_CASE("deinit saves the index checkpoint", "[nvs][checkpoint]")
+{
+    const uint32_t PAGE_COUNT = 5;
+    CheckpointFixture f(PAGE_COUNT, 2);
+    nvs::NVSPartitionManager *manager = nvs::NVSPartitionManager::get_instance();
+
+    TEST_ESP_OK(manager->init_custom(f.part(), 0, PAGE_COUNT, f.checkpoint));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "value", 42));
+    nvs_close(handle);
+    TEST_ESP_ERR(nvs_flash_save_checkpoint("missing"), ESP_ERR_NVS_NOT_INITIALIZED);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+    clear_stats();
+    TEST_ESP_OK(manager->init_custom(f.part(), 0, PAGE_COUNT, f.checkpoint));
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+    // header and snapshot of each page plus the item checks
+    CHECK(read_ops() < 4 * PAGE_COUNT + 10);
+#endif
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    int32_t value;
+    TEST_ESP_OK(nvs_get_i32(handle, "value", &value));
+    CHECK(value == 42);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_save_checkpoint(NVS_DEFAULT_PART_NAME));
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+static void bench_checkpoint(uint32_t page_count)
+{
+    const int RUNS = 5;
+    const size_t key_count = page_count * nvs::Page::ENTRY_COUNT / 2;
+    CheckpointFixture f(page_count, page_count / 8 + 2);
+    char key[16];
+
+    {
+        nvs::Storage storage(f.part());
+        storage.setCheckpointPartition(f.checkpoint);
+        REQUIRE(storage.init(0, page_count) == ESP_OK);
+        for (size_t i = 0; i < key_count; ++i) {
+            make_key(key, sizeof(key), i);
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+        }
+        REQUIRE(storage.saveCheckpoint() == ESP_OK);
+    }
+
+    double init_us[2];
+    size_t ops[2];
+    for (int use_checkpoint = 0; use_checkpoint <= 1; ++use_checkpoint) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < RUNS; ++i) {
+            nvs::Storage storage(f.part());
+            if (use_checkpoint) {
+                storage.setCheckpointPartition(f.checkpoint);
+            }
+            clear_stats();
+            REQUIRE(storage.init(0, page_count) == ESP_OK);
+            ops[use_checkpoint] = read_ops();
+        }
+        auto end = std::chrono::steady_clock::now();
+        init_us[use_checkpoint] = std::chrono::duration<double, std::micro>(end - start).count() / RUNS;
+    }
+
+    printf("index checkpoint, %3u pages, %5u keys: init %7.0f us -> %6.0f us, read ops %6u -> %4u\n",
+            static_cast<unsigned>(page_count), static_cast<unsigned>(key_count),
+            init_us[0], init_us[1], static_cast<unsigned>(ops[0]), static_cast<unsigned>(ops[1]));
+}
+
+TEST_CASE("benchmark init with index checkpoint on 8, 64 and 256 pages", "[nvs][checkpoint][benchmark]")
+{
+    bench_checkpoint(8);
+    bench_checkpoint(64);
+    bench_checkpoint(256);
+}
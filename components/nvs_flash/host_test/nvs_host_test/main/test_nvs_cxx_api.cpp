@@ -179,3 +179,131 @@ TEST_CASE("NVSHandleSimple CXX api read/write blob", "[nvs cxx]")
 
     nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
 }
+
+TEST_CASE("NVSHandleSimple CXX api write batch", "[nvs cxx]")
+{
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 3;
+    PartitionEmulationFixture f(0, 10);
+    char read_buffer [256];
+    esp_err_t result;
+    shared_ptr<nvs::NVSHandle> handle;
+
+    REQUIRE(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT_MIN)
+            == ESP_OK);
+
+    handle = nvs::open_nvs_handle("test_ns", NVS_READWRITE, &result);
+    CHECK(result == ESP_OK);
+    REQUIRE(handle);
+
+    CHECK(handle->set_item("int", int16_t(-1)) == ESP_OK);
+    CHECK(handle->batch_begin() == ESP_OK);
+    CHECK(handle->batch_set_item("int", int16_t(-2)) == ESP_OK);
+    CHECK(handle->batch_set_item("uint", uint32_t(47)) == ESP_OK);
+    CHECK(handle->batch_set_string("test", "test string") == ESP_OK);
+    CHECK(handle->batch_commit() == ESP_OK);
+
+    int16_t i16;
+    uint32_t u32;
+    CHECK(handle->get_item("int", i16) == ESP_OK);
+    CHECK(i16 == -2);
+    CHECK(handle->get_item("uint", u32) == ESP_OK);
+    CHECK(u32 == 47);
+    CHECK(handle->get_string("test", read_buffer, sizeof(read_buffer)) == ESP_OK);
+    CHECK(string(read_buffer) == "test string");
+
+    // a batch which is left open is discarded when the handle is closed
+    CHECK(handle->batch_begin() == ESP_OK);
+    CHECK(handle->batch_set_item("uint", uint32_t(48)) == ESP_OK);
+    handle.reset();
+
+    handle = nvs::open_nvs_handle("test_ns", NVS_READWRITE, &result);
+    REQUIRE(handle);
+    CHECK(handle->get_item("uint", u32) == ESP_OK);
+    CHECK(u32 == 47);
+    handle.reset();
+
+    nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
+}
+
+TEST_CASE("NVSHandleSimple CXX api blob write in parts", "[nvs cxx]")
+{
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 3;
+    PartitionEmulationFixture f(0, 10);
+    char blob [] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9};
+    char read_blob [4] = {0};
+    esp_err_t result;
+    shared_ptr<nvs::NVSHandle> handle;
+
+    REQUIRE(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT_MIN)
+            == ESP_OK);
+
+    handle = nvs::open_nvs_handle("test_ns", NVS_READWRITE, &result);
+    CHECK(result == ESP_OK);
+    REQUIRE(handle);
+
+    CHECK(handle->blob_write_begin("blob") == ESP_OK);
+    CHECK(handle->blob_write_append(blob, 3) == ESP_OK);
+    CHECK(handle->blob_write_append(blob + 3, sizeof(blob) - 3) == ESP_OK);
+    CHECK(handle->blob_write_commit() == ESP_OK);
+
+    CHECK(handle->get_blob_range("blob", 5, read_blob, sizeof(read_blob)) == ESP_OK);
+    CHECK(vector<char>(blob + 5, blob + 5 + sizeof(read_blob)) == vector<char>(read_blob, read_blob + sizeof(read_blob)));
+
+    // a blob write which is left open is discarded when the handle is closed
+    CHECK(handle->blob_write_begin("blob") == ESP_OK);
+    CHECK(handle->blob_write_append(blob, 2) == ESP_OK);
+    handle.reset();
+
+    handle = nvs::open_nvs_handle("test_ns", NVS_READWRITE, &result);
+    REQUIRE(handle);
+    size_t size;
+    CHECK(handle->get_item_size(nvs::ItemType::BLOB, "blob", size) == ESP_OK);
+    CHECK(size == sizeof(blob));
+    handle.reset();
+
+    nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
+}
+
+namespace {
+
+/**
+ * Implements only the operations which NVSHandle had before the partial blob read, write batches and blob writes.
+ */
+class MinimalHandle : public nvs::NVSHandle {
+public:
+    esp_err_t set_string(const char *key, const char* value) override { return ESP_OK; }
+    esp_err_t set_blob(const char *key, const void* blob, size_t len) override { return ESP_OK; }
+    esp_err_t get_string(const char *key, char* out_str, size_t len) override { return ESP_ERR_NVS_NOT_FOUND; }
+    esp_err_t get_blob(const char *key, void* out_blob, size_t len) override { return ESP_ERR_NVS_NOT_FOUND; }
+    esp_err_t get_item_size(nvs::ItemType datatype, const char *key, size_t &size) override { return ESP_ERR_NVS_NOT_FOUND; }
+    esp_err_t erase_item(const char* key) override { return ESP_OK; }
+    esp_err_t erase_all() override { return ESP_OK; }
+    esp_err_t commit() override { return ESP_OK; }
+    esp_err_t get_used_entry_count(size_t& usedEntries) override { usedEntries = 0; return ESP_OK; }
+
+protected:
+    esp_err_t set_typed_item(nvs::ItemType datatype, const char *key, const void* data, size_t dataSize) override { return ESP_OK; }
+    esp_err_t get_typed_item(nvs::ItemType datatype, const char *key, void* data, size_t dataSize) override { return ESP_ERR_NVS_NOT_FOUND; }
+};
+
+} // namespace
+
+TEST_CASE("NVSHandle operations not implemented by a subclass are reported as not supported", "[nvs cxx]")
+{
+    MinimalHandle minimal;
+    nvs::NVSHandle &handle = minimal;
+    char buf[4];
+
+    CHECK(handle.get_blob_range("blob", 0, buf, sizeof(buf)) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.batch_begin() == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.batch_set_item("key", static_cast<uint8_t>(1)) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.batch_set_string("key", "value") == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.batch_commit() == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.batch_abort() == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.blob_write_begin("blob") == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.blob_write_append(buf, sizeof(buf)) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.blob_write_commit() == ESP_ERR_NOT_SUPPORTED);
+    CHECK(handle.blob_write_abort() == ESP_ERR_NOT_SUPPORTED);
+}
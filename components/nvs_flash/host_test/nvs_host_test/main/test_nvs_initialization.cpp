@@ -7,8 +7,11 @@
 #include "nvs.hpp"
 #include "nvs_partition_manager.hpp"
 #include "nvs_partition.hpp"
+#include "nvs_pagemanager.hpp"
 #include "test_fixtures.hpp"
 #include <string.h>
+#include <stdio.h>
+#include <chrono>
 
 TEST_CASE("nvs_flash_init_partition_ptr fails due to nullptr arg", "[nvs_custom_part]")
 {
@@ -36,3 +39,96 @@ TEST_CASE("nvs_flash_init_partition_ptr inits one partition", "[nvs_custom_part]
     CHECK(nvs::NVSPartitionManager::get_instance()->lookup_storage_from_name("test") != nullptr);
     CHECK(nvs::NVSPartitionManager::get_instance()->deinit_partition("test") == ESP_OK);
 }
+
+TEST_CASE("lazy page load checks free pages when they are activated", "[nvs][init]")
+{
+    const uint32_t PAGE_COUNT = 4;
+    PartitionEmulationFixture f(0, PAGE_COUNT);
+    const uint32_t junk = 0x12345678;
+    const uint32_t junkOffset = nvs::Page::SEC_SIZE + 100;
+    REQUIRE(f.part()->write_raw(junkOffset, &junk, sizeof(junk)) == ESP_OK);
+
+    size_t readOps[2] = {};
+    for (int lazy = 0; lazy <= 1; ++lazy) {
+        nvs::PageManager pm;
+        pm.setLazyLoad(lazy != 0);
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+        esp_partition_clear_stats();
+#endif
+        REQUIRE(pm.load(f.part(), 0, PAGE_COUNT) == ESP_OK);
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+        readOps[lazy] = esp_partition_get_read_ops();
+#endif
+
+        // page 0 was activated during load, the junk is on page 1
+        REQUIRE(pm.requestNewPage() == ESP_OK);
+        uint32_t value;
+        REQUIRE(f.part()->read_raw(junkOffset, &value, sizeof(value)) == ESP_OK);
+        CHECK(value == 0xffffffff);
+
+        REQUIRE(f.part()->erase_range(0, PAGE_COUNT * nvs::Page::SEC_SIZE) == ESP_OK);
+        REQUIRE(f.part()->write_raw(junkOffset, &junk, sizeof(junk)) == ESP_OK);
+    }
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+    CHECK(readOps[1] < readOps[0]);
+#endif
+}
+
+static void bench_init(uint32_t page_count)
+{
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const int RUNS = 5;
+    uint8_t *p_part_desc_addr_start;
+    REQUIRE(esp_partition_file_mmap((const uint8_t **)&p_part_desc_addr_start) == ESP_OK);
+
+    esp_partition_t partition = {};
+    strcpy(partition.label, "bench");
+    partition.address = NVS_FLASH_SECTOR * SPI_FLASH_SEC_SIZE;
+    partition.size = page_count * SPI_FLASH_SEC_SIZE;
+    partition.erase_size = ESP_PARTITION_EMULATED_SECTOR_SIZE;
+
+    // fill half of the pages with values and a few blobs
+    REQUIRE(nvs_flash_init_partition_ptr(&partition) == ESP_OK);
+    nvs_handle_t handle;
+    REQUIRE(nvs_open_from_partition("bench", "bench", NVS_READWRITE, &handle) == ESP_OK);
+    const size_t key_count = page_count * nvs::Page::ENTRY_COUNT / 2;
+    char key[16];
+    for (size_t i = 0; i < key_count; ++i) {
+        snprintf(key, sizeof(key), "key%05u", static_cast<unsigned>(i));
+        REQUIRE(nvs_set_u32(handle, key, i) == ESP_OK);
+    }
+    static uint8_t blob[3000];
+    memset(blob, 0x5a, sizeof(blob));
+    for (size_t i = 0; i < page_count / 8; ++i) {
+        snprintf(key, sizeof(key), "blob%03u", static_cast<unsigned>(i));
+        REQUIRE(nvs_set_blob(handle, key, blob, sizeof(blob)) == ESP_OK);
+    }
+    nvs_close(handle);
+    REQUIRE(nvs_flash_deinit_partition("bench") == ESP_OK);
+
+    size_t read_ops = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RUNS; ++i) {
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+        esp_partition_clear_stats();
+#endif
+        REQUIRE(nvs_flash_init_partition_ptr(&partition) == ESP_OK);
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+        read_ops = esp_partition_get_read_ops();
+#endif
+        REQUIRE(nvs_flash_deinit_partition("bench") == ESP_OK);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    printf("nvs_flash_init_partition, %3u pages, %5u keys: %8.0f us, %6u read ops\n",
+            static_cast<unsigned>(page_count), static_cast<unsigned>(key_count),
+            std::chrono::duration<double, std::micro>(end - start).count() / RUNS,
+            static_cast<unsigned>(read_ops));
+}
+
+TEST_CASE("benchmark nvs_flash_init_partition on 8, 64 and 256 pages", "[nvs][init][benchmark][.]")
+{
+    bench_init(8);
+    bench_init(64);
+    bench_init(256);
+}
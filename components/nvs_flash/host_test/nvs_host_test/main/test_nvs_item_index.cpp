@@ -0,0 +1,162 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "catch.hpp"
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "nvs_storage.hpp"
+#include "nvs_item_index.hpp"
+#include "test_fixtures.hpp"
+
+#define TEST_ESP_ERR(rc, res) CHECK((rc) == (res))
+#define TEST_ESP_OK(rc) CHECK((rc) == ESP_OK)
+
+static void make_key(char *key, size_t size, size_t i)
+{
+    snprintf(key, size, "key%05u", static_cast<unsigned>(i));
+}
+
+TEST_CASE("item index insert, find and erase", "[nvs][item_index]")
+{
+    nvs::ItemIndex index;
+    nvs::Page *pages[2];
+    nvs::Page *page_a = reinterpret_cast<nvs::Page *>(0x1000);
+    nvs::Page *page_b = reinterpret_cast<nvs::Page *>(0x2000);
+
+    index.insert(1, page_a, 0);
+    CHECK(index.find(1, pages, 2) == 0);
+
+    index.setEnabled(true);
+    for (size_t i = 0; i < 1000; ++i) {
+        index.insert(i & 0xffffff, (i % 2) ? page_a : page_b, i % 126);
+    }
+    CHECK(index.size() == 1000);
+    CHECK(index.getByteSize() > 0);
+
+    // same hash on two pages, e.g. while an item is overwritten
+    index.insert(5, page_b, 7);
+    CHECK(index.find(5, pages, 2) == 2);
+
+    for (size_t i = 0; i < 1000; i += 2) {
+        index.erase(i & 0xffffff, page_b, i % 126);
+    }
+    CHECK(index.size() == 501);
+    CHECK(index.find(4, pages, 2) == 0);
+    CHECK(index.find(5, pages, 2) == 2);
+    index.erase(5, page_b, 7);
+    REQUIRE(index.find(5, pages, 2) == 1);
+    CHECK(pages[0] == page_a);
+
+    // every odd hash is still reachable after the backward shifts
+    for (size_t i = 1; i < 1000; i += 2) {
+        REQUIRE(index.find(i & 0xffffff, pages, 2) == 1);
+    }
+
+    index.setEnabled(false);
+    CHECK(index.getByteSize() == 0);
+    CHECK(!index.isValid());
+}
+
+TEST_CASE("storage with item index finds the same items as without it", "[nvs][item_index]")
+{
+    const size_t PAGE_COUNT = 5;
+    const size_t KEY_COUNT = 64;
+    PartitionEmulationFixture f(0, PAGE_COUNT);
+    char key[16];
+    std::mt19937 gen(42);
+
+    {
+        nvs::Storage storage(f.part(), true);
+        TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+
+        // overwrite keys often enough to trigger page reclamation a couple of times
+        for (size_t i = 0; i < nvs::Page::ENTRY_COUNT * PAGE_COUNT * 4; ++i) {
+            make_key(key, sizeof(key), gen() % KEY_COUNT);
+            uint32_t value = static_cast<uint32_t>(i);
+            REQUIRE(storage.writeItem(1, key, value) == ESP_OK);
+            uint32_t read_value = 0;
+            REQUIRE(storage.readItem(1, key, read_value) == ESP_OK);
+            CHECK(read_value == value);
+        }
+        CHECK(storage.getItemIndexByteSize() > 0);
+
+        make_key(key, sizeof(key), 0);
+        TEST_ESP_OK(storage.writeItem(1, nvs::ItemType::SZ, key, "string", 7));
+        make_key(key, sizeof(key), 1);
+        TEST_ESP_OK(storage.eraseItem(1, key));
+        uint32_t value;
+        TEST_ESP_ERR(storage.readItem(1, key, value), ESP_ERR_NVS_NOT_FOUND);
+    }
+
+    nvs::Storage indexed(f.part(), true);
+    TEST_ESP_OK(indexed.init(0, PAGE_COUNT));
+    std::vector<esp_err_t> indexed_results;
+    std::vector<uint32_t> indexed_values;
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        make_key(key, sizeof(key), i);
+        uint32_t value = 0;
+        indexed_results.push_back(indexed.readItem(1, key, value));
+        indexed_values.push_back(value);
+    }
+
+    nvs::Storage plain(f.part(), false);
+    TEST_ESP_OK(plain.init(0, PAGE_COUNT));
+    CHECK(plain.getItemIndexByteSize() == 0);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        make_key(key, sizeof(key), i);
+        uint32_t value = 0;
+        CHECK(plain.readItem(1, key, value) == indexed_results[i]);
+        CHECK(value == indexed_values[i]);
+    }
+    CHECK(indexed_results[1] == ESP_ERR_NVS_NOT_FOUND);
+}
+
+static void bench_item_index(size_t page_count)
+{
+    const size_t LOOKUPS = 2000;
+    const size_t key_count = (page_count - 2) * 100;
+    PartitionEmulationFixture f(0, page_count);
+    char key[16];
+    double lookup_ns[2];
+    size_t index_bytes = 0;
+
+    for (int use_index = 1; use_index >= 0; --use_index) {
+        nvs::Storage storage(f.part(), use_index != 0);
+        REQUIRE(storage.init(0, page_count) == ESP_OK);
+        if (use_index) {
+            for (size_t i = 0; i < key_count; ++i) {
+                make_key(key, sizeof(key), i);
+                REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+            }
+            index_bytes = storage.getItemIndexByteSize();
+        }
+
+        std::mt19937 gen(page_count);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < LOOKUPS; ++i) {
+            size_t k = gen() % key_count;
+            make_key(key, sizeof(key), k);
+            uint32_t value;
+            REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+            REQUIRE(value == k);
+        }
+        auto end = std::chrono::steady_clock::now();
+        lookup_ns[use_index] = std::chrono::duration<double, std::nano>(end - start).count() / LOOKUPS;
+    }
+
+    printf("item index, %3u pages, %5u keys: lookup %9.0f ns -> %7.0f ns, index RAM %u bytes\n",
+            static_cast<unsigned>(page_count), static_cast<unsigned>(key_count),
+            lookup_ns[0], lookup_ns[1], static_cast<unsigned>(index_bytes));
+    CHECK(index_bytes > 0);
+}
+
+TEST_CASE("benchmark item index lookups on 8, 64 and 256 pages", "[nvs][item_index][benchmark]")
+{
+    bench_item_index(8);
+    bench_item_index(64);
+    bench_item_index(256);
+}
@@ -0,0 +1,267 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "catch.hpp"
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include "nvs_storage.hpp"
+#include "test_fixtures.hpp"
+
+#define TEST_ESP_OK(rc) CHECK((rc) == ESP_OK)
+
+using ReclaimPolicy = nvs::PageManager::ReclaimPolicy;
+
+namespace {
+
+const ReclaimPolicy POLICIES[] = {ReclaimPolicy::GREEDY, ReclaimPolicy::COST_BENEFIT, ReclaimPolicy::HOT_COLD};
+const char* const POLICY_NAMES[] = {"greedy", "cost-benefit", "hot/cold"};
+
+/**
+ * One write of a recorded workload. Values are derived from the key and the position in the trace,
+ * so that the final state can be checked without storing it.
+ */
+struct TraceWrite {
+    uint16_t key;
+    uint32_t value;
+};
+
+/**
+ * Key space of the simulated workload: a few counters which are updated all the time, some status strings
+ * which are updated now and then and many configuration strings which hardly ever change.
+ */
+const size_t HOT_KEYS = 8;
+const size_t WARM_KEYS = 40;
+const size_t COLD_KEYS = 400;
+const size_t KEY_COUNT = HOT_KEYS + WARM_KEYS + COLD_KEYS;
+
+bool isStringKey(size_t key)
+{
+    return key >= HOT_KEYS;
+}
+
+size_t stringLength(size_t key)
+{
+    // warm keys take 2 entries, cold keys 3 entries
+    return (key < HOT_KEYS + WARM_KEYS) ? 24 : 48;
+}
+
+void makeKey(size_t key, char* name)
+{
+    snprintf(name, nvs::Item::MAX_KEY_LENGTH + 1, "k%u", static_cast<unsigned>(key));
+}
+
+void makeString(size_t key, uint32_t value, char* str)
+{
+    size_t len = stringLength(key);
+    for (size_t i = 0; i < len - 1; ++i) {
+        str[i] = 'a' + (key + value + i) % 26;
+    }
+    str[len - 1] = 0;
+}
+
+std::vector<TraceWrite> recordWorkload(size_t writeCount)
+{
+    std::vector<TraceWrite> trace;
+    uint32_t lcg = 12345;
+    auto next = [&lcg]() -> uint32_t {
+        lcg = lcg * 1103515245 + 12345;
+        return (lcg >> 8) & 0xffff;
+    };
+
+    // every key is written once first
+    for (size_t key = 0; key < KEY_COUNT; ++key) {
+        trace.push_back({static_cast<uint16_t>(key), 0});
+    }
+    for (size_t i = 0; i < writeCount; ++i) {
+        uint32_t r = next() % 1000;
+        size_t key;
+        if (r < 800) {
+            key = next() % HOT_KEYS;
+        } else if (r < 990) {
+            key = HOT_KEYS + next() % WARM_KEYS;
+        } else {
+            key = HOT_KEYS + WARM_KEYS + next() % COLD_KEYS;
+        }
+        trace.push_back({static_cast<uint16_t>(key), static_cast<uint32_t>(trace.size())});
+    }
+    return trace;
+}
+
+esp_err_t replayWrite(nvs::Storage& storage, const TraceWrite& write, size_t& entries)
+{
+    char name[nvs::Item::MAX_KEY_LENGTH + 1];
+    makeKey(write.key, name);
+    if (!isStringKey(write.key)) {
+        entries += 1;
+        return storage.writeItem(1, name, write.value);
+    }
+    char str[64];
+    makeString(write.key, write.value, str);
+    size_t len = stringLength(write.key);
+    entries += 1 + (len + nvs::Page::ENTRY_SIZE - 1) / nvs::Page::ENTRY_SIZE;
+    return storage.writeItem(1, nvs::ItemType::SZ, name, str, len);
+}
+
+void checkFinalState(nvs::Storage& storage, const std::vector<TraceWrite>& trace)
+{
+    std::vector<uint32_t> expected(KEY_COUNT);
+    for (auto& write : trace) {
+        expected[write.key] = write.value;
+    }
+    char name[nvs::Item::MAX_KEY_LENGTH + 1];
+    char str[64];
+    char readStr[64];
+    for (size_t key = 0; key < KEY_COUNT; ++key) {
+        makeKey(key, name);
+        if (isStringKey(key)) {
+            makeString(key, expected[key], str);
+            TEST_ESP_OK(storage.readItem(1, nvs::ItemType::SZ, name, readStr, sizeof(readStr)));
+            CHECK(strcmp(str, readStr) == 0);
+        } else {
+            uint32_t value;
+            TEST_ESP_OK(storage.readItem(1, name, value));
+            CHECK(value == expected[key]);
+        }
+    }
+}
+
+void writeKeys(nvs::Storage& storage, char prefix, size_t first, size_t last, uint32_t value)
+{
+    char name[nvs::Item::MAX_KEY_LENGTH + 1];
+    for (size_t i = first; i < last; ++i) {
+        snprintf(name, sizeof(name), "%c%u", prefix, static_cast<unsigned>(i));
+        TEST_ESP_OK(storage.writeItem(1, name, value));
+    }
+}
+
+void checkPage(nvs::Partition* partition, uint32_t sector, nvs::Page::PageState state, size_t usedEntries)
+{
+    nvs::Page page;
+    TEST_ESP_OK(page.load(partition, sector));
+    CHECK(page.state() == state);
+    CHECK(page.getUsedEntryCount() == usedEntries);
+}
+
+} // namespace
+
+TEST_CASE("hot/cold reclamation closes the page receiving the copied items", "[nvs][reclaim]")
+{
+    const uint32_t PAGE_COUNT = 4;
+    const size_t N = nvs::Page::ENTRY_COUNT;
+
+    for (auto policy : {ReclaimPolicy::COST_BENEFIT, ReclaimPolicy::HOT_COLD}) {
+        PartitionEmulationFixture f(0, PAGE_COUNT);
+        nvs::Storage storage(f.part());
+        storage.setReclaimPolicy(policy);
+        TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+
+        // sector 0: N - 8 live entries, sector 1: N - 9 live entries, sector 2: full of live entries but still
+        // active until the next write
+        writeKeys(storage, 'a', 0, N, 0);
+        writeKeys(storage, 'a', 0, 8, 1);
+        writeKeys(storage, 'b', 0, N - 8, 0);
+        writeKeys(storage, 'b', 0, 9, 1);
+        writeKeys(storage, 'c', 0, N - 9, 0);
+        checkPage(f.part(), 0, nvs::Page::PageState::FULL, N - 8);
+        checkPage(f.part(), 1, nvs::Page::PageState::FULL, N - 9);
+        checkPage(f.part(), 2, nvs::Page::PageState::ACTIVE, N);
+
+        // the next write reclaims sector 0, the oldest page, into sector 3, the last free page
+        writeKeys(storage, 'd', 0, 1, 0);
+
+        if (policy == ReclaimPolicy::HOT_COLD) {
+            // the copied items fill sector 3, it is closed and sector 1 is reclaimed into sector 0 as well
+            checkPage(f.part(), 3, nvs::Page::PageState::FULL, N - 8);
+            checkPage(f.part(), 1, nvs::Page::PageState::UNINITIALIZED, 0);
+            checkPage(f.part(), 0, nvs::Page::PageState::ACTIVE, N - 9 + 1);
+        } else {
+            checkPage(f.part(), 3, nvs::Page::PageState::ACTIVE, N - 8 + 1);
+            checkPage(f.part(), 1, nvs::Page::PageState::FULL, N - 9);
+            checkPage(f.part(), 0, nvs::Page::PageState::UNINITIALIZED, 0);
+        }
+
+        uint32_t value;
+        TEST_ESP_OK(storage.readItem(1, "a0", value));
+        CHECK(value == 1);
+        TEST_ESP_OK(storage.readItem(1, "b8", value));
+        CHECK(value == 1);
+        TEST_ESP_OK(storage.readItem(1, "b9", value));
+        CHECK(value == 0);
+        TEST_ESP_OK(storage.readItem(1, "d0", value));
+        CHECK(value == 0);
+    }
+}
+
+TEST_CASE("every reclamation policy keeps all values", "[nvs][reclaim]")
+{
+    const uint32_t PAGE_COUNT = 16;
+    std::vector<TraceWrite> trace = recordWorkload(5000);
+
+    for (auto policy : POLICIES) {
+        PartitionEmulationFixture f(0, PAGE_COUNT);
+        nvs::Storage storage(f.part());
+        storage.setReclaimPolicy(policy);
+        TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+
+        size_t entries = 0;
+        for (auto& write : trace) {
+            TEST_ESP_OK(replayWrite(storage, write, entries));
+        }
+        checkFinalState(storage, trace);
+
+        // the state on flash doesn't depend on the policy
+        nvs::Storage reloaded(f.part());
+        TEST_ESP_OK(reloaded.init(0, PAGE_COUNT));
+        checkFinalState(reloaded, trace);
+    }
+}
+
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+/**
+ * Replays the same recorded workload with each reclamation policy and reports the write amplification,
+ * i.e. the bytes written to flash per byte of items written by the application, and the sector erases.
+ */
+TEST_CASE("reclamation policy simulator", "[nvs][reclaim][benchmark][.]")
+{
+    const uint32_t PAGE_COUNT = 16;
+    const size_t WRITE_COUNT = 40000;
+    std::vector<TraceWrite> trace = recordWorkload(WRITE_COUNT);
+
+    printf("%u pages, %u keys, %u writes\n", static_cast<unsigned>(PAGE_COUNT),
+            static_cast<unsigned>(KEY_COUNT), static_cast<unsigned>(trace.size()));
+    printf("%-14s %10s %10s %10s %10s\n", "policy", "write amp.", "erases", "max/page", "min/page");
+
+    size_t erases[sizeof(POLICIES) / sizeof(POLICIES[0])];
+    for (size_t i = 0; i < sizeof(POLICIES) / sizeof(POLICIES[0]); ++i) {
+        PartitionEmulationFixture f(0, PAGE_COUNT);
+        nvs::Storage storage(f.part());
+        storage.setReclaimPolicy(POLICIES[i]);
+        TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+
+        esp_partition_clear_stats();
+        size_t entries = 0;
+        for (auto& write : trace) {
+            TEST_ESP_OK(replayWrite(storage, write, entries));
+        }
+        size_t writeBytes = esp_partition_get_write_bytes();
+        erases[i] = esp_partition_get_erase_ops();
+
+        size_t maxErases = 0;
+        size_t minErases = SIZE_MAX;
+        for (uint32_t sector = 0; sector < PAGE_COUNT; ++sector) {
+            size_t count = esp_partition_get_sector_erase_count(sector);
+            maxErases = std::max(maxErases, count);
+            minErases = std::min(minErases, count);
+        }
+        printf("%-14s %10.2f %10u %10u %10u\n", POLICY_NAMES[i],
+                static_cast<double>(writeBytes) / (entries * nvs::Page::ENTRY_SIZE),
+                static_cast<unsigned>(erases[i]), static_cast<unsigned>(maxErases), static_cast<unsigned>(minErases));
+
+        checkFinalState(storage, trace);
+    }
+}
+#endif // CONFIG_ESP_PARTITION_ENABLE_STATS
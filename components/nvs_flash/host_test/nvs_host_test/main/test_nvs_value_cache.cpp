@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "catch.hpp"
+#include <cstdio>
+#include <cstring>
+#include "nvs_storage.hpp"
+#include "nvs_value_cache.hpp"
+#include "nvs_partition_manager.hpp"
+#include "test_fixtures.hpp"
+
+#define TEST_ESP_ERR(rc, res) CHECK((rc) == (res))
+#define TEST_ESP_OK(rc) CHECK((rc) == ESP_OK)
+
+TEST_CASE("value cache replaces the least recently used value", "[nvs][value_cache]")
+{
+    nvs::ValueCache cache;
+    const uint8_t *data;
+    size_t size;
+    uint32_t value = 1;
+
+    cache.insert(1, nvs::ItemType::U32, "key0", &value, sizeof(value));
+    CHECK(!cache.find(1, nvs::ItemType::U32, "key0", data, size));
+    CHECK(cache.getMisses() == 0);
+    TEST_ESP_ERR(cache.setCapacity(nvs::ValueCache::MAX_CAPACITY + 1), ESP_ERR_INVALID_ARG);
+
+    TEST_ESP_OK(cache.setCapacity(3));
+    char key[16];
+    for (uint32_t i = 0; i < 3; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        cache.insert(1, nvs::ItemType::U32, key, &i, sizeof(i));
+    }
+    CHECK(cache.size() == 3);
+
+    // key0 becomes the most recently used value, so key1 is replaced next
+    REQUIRE(cache.find(1, nvs::ItemType::U32, "key0", data, size));
+    CHECK(size == sizeof(uint32_t));
+    CHECK(memcmp(data, "\0\0\0\0", size) == 0);
+    value = 3;
+    cache.insert(1, nvs::ItemType::U32, "key3", &value, sizeof(value));
+    CHECK(cache.size() == 3);
+    CHECK(!cache.find(1, nvs::ItemType::U32, "key1", data, size));
+    CHECK(cache.find(1, nvs::ItemType::U32, "key0", data, size));
+    CHECK(cache.find(1, nvs::ItemType::U32, "key2", data, size));
+    CHECK(cache.find(1, nvs::ItemType::U32, "key3", data, size));
+
+    // keys are distinguished by namespace and type
+    CHECK(!cache.find(2, nvs::ItemType::U32, "key0", data, size));
+    CHECK(!cache.find(1, nvs::ItemType::I32, "key0", data, size));
+
+    cache.insert(1, nvs::ItemType::SZ, "str", "a string which is too long to be cached", 40);
+    CHECK(!cache.find(1, nvs::ItemType::SZ, "str", data, size));
+    cache.insert(1, nvs::ItemType::SZ, "str", "short", 6);
+    REQUIRE(cache.find(1, nvs::ItemType::SZ, "str", data, size));
+    CHECK(strcmp(reinterpret_cast<const char *>(data), "short") == 0);
+
+    cache.invalidate(1, "str");
+    CHECK(!cache.find(1, nvs::ItemType::SZ, "str", data, size));
+    CHECK(cache.size() == 2);
+    cache.invalidateNamespace(1);
+    CHECK(cache.size() == 0);
+    CHECK(!cache.find(1, nvs::ItemType::U32, "key3", data, size));
+
+    CHECK(cache.getHits() == 5);
+    CHECK(cache.getMisses() == 6);
+}
+
+TEST_CASE("storage serves cached values without reading the partition", "[nvs][value_cache]")
+{
+    PartitionEmulationFixture f(0, 5);
+    nvs::Storage storage(f.part());
+    TEST_ESP_OK(storage.setValueCacheCapacity(4));
+    TEST_ESP_OK(storage.init(0, 5));
+
+    TEST_ESP_OK(storage.writeItem(1, "flag", static_cast<uint8_t>(1)));
+    TEST_ESP_OK(storage.writeItem(1, nvs::ItemType::SZ, "str", "calibration", 12));
+
+    uint8_t flag;
+    char buf[16];
+    TEST_ESP_OK(storage.readItem(1, "flag", flag));
+    TEST_ESP_OK(storage.readItem(1, nvs::ItemType::SZ, "str", buf, sizeof(buf)));
+
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+    esp_partition_clear_stats();
+#endif
+    for (int i = 0; i < 100; ++i) {
+        flag = 0;
+        TEST_ESP_OK(storage.readItem(1, "flag", flag));
+        CHECK(flag == 1);
+        size_t size;
+        TEST_ESP_OK(storage.getItemDataSize(1, nvs::ItemType::SZ, "str", size));
+        CHECK(size == 12);
+        TEST_ESP_OK(storage.readItem(1, nvs::ItemType::SZ, "str", buf, size));
+        CHECK(strcmp(buf, "calibration") == 0);
+    }
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+    CHECK(esp_partition_get_read_ops() == 0);
+#endif
+
+    // same errors as for uncached values
+    uint16_t wrong_size;
+    TEST_ESP_ERR(storage.readItem(1, nvs::ItemType::U8, "flag", &wrong_size, sizeof(wrong_size)), ESP_ERR_NVS_TYPE_MISMATCH);
+    TEST_ESP_ERR(storage.readItem(1, nvs::ItemType::SZ, "str", buf, 4), ESP_ERR_NVS_INVALID_LENGTH);
+
+    // writes and erasures are visible right away
+    TEST_ESP_OK(storage.writeItem(1, "flag", static_cast<uint8_t>(2)));
+    TEST_ESP_OK(storage.readItem(1, "flag", flag));
+    CHECK(flag == 2);
+    TEST_ESP_OK(storage.eraseItem(1, "str"));
+    TEST_ESP_ERR(storage.readItem(1, nvs::ItemType::SZ, "str", buf, sizeof(buf)), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(storage.eraseNamespace(1));
+    TEST_ESP_ERR(storage.readItem(1, "flag", flag), ESP_ERR_NVS_NOT_FOUND);
+
+    nvs::Storage::TBatchList batch;
+    nvs::Storage::BatchItem *item = new (std::nothrow) nvs::Storage::BatchItem();
+    REQUIRE(item != nullptr);
+    item->datatype = nvs::ItemType::U8;
+    strcpy(item->key, "flag");
+    item->value[0] = 3;
+    item->dataSize = 1;
+    batch.push_back(item);
+    TEST_ESP_OK(storage.writeItem(1, "flag", static_cast<uint8_t>(2)));
+    TEST_ESP_OK(storage.readItem(1, "flag", flag));
+    TEST_ESP_OK(storage.writeBatch(1, batch));
+    batch.clearAndFreeNodes();
+    TEST_ESP_OK(storage.readItem(1, "flag", flag));
+    CHECK(flag == 3);
+
+    nvs_value_cache_stats_t stats;
+    TEST_ESP_OK(storage.fillValueCacheStats(stats));
+    CHECK(stats.capacity == 4);
+    CHECK(stats.hits >= 300);
+    CHECK(stats.misses > 0);
+}
+
+TEST_CASE("nvs_get_value_cache_stats reports hits and misses", "[nvs][value_cache]")
+{
+    PartitionEmulationFixture f(0, 5);
+    nvs_value_cache_stats_t stats;
+    TEST_ESP_ERR(nvs_get_value_cache_stats(NULL, NULL), ESP_ERR_INVALID_ARG);
+    TEST_ESP_ERR(nvs_get_value_cache_stats(NULL, &stats), ESP_ERR_NVS_NOT_INITIALIZED);
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 5));
+    nvs::Storage *storage = nvs::NVSPartitionManager::get_instance()->lookup_storage_from_name(NVS_DEFAULT_PART_NAME);
+    REQUIRE(storage != nullptr);
+    TEST_ESP_OK(storage->setValueCacheCapacity(8));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "value", 42));
+    int32_t value;
+    for (int i = 0; i < 10; ++i) {
+        TEST_ESP_OK(nvs_get_i32(handle, "value", &value));
+        CHECK(value == 42);
+    }
+    nvs_close(handle);
+
+    TEST_ESP_OK(nvs_get_value_cache_stats(NULL, &stats));
+    CHECK(stats.capacity == 8);
+    CHECK(stats.entries == 1);
+    CHECK(stats.hits == 9);
+    CHECK(stats.misses == 1);
+
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
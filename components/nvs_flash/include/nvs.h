@@ -462,6 +462,28 @@ esp_err_t nvs_get_str (nvs_handle_t handle, const char* key, char* out_value, si
  * This function behaves the same as \c nvs_get_str, except for the data type.
  */
 esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length);
+
+/**
+ * @brief      get a part of the blob value for given key
+ *
+ * Reads \c length bytes starting at \c offset within the blob. Blobs are stored in chunks
+ * of up to one page; only the chunks overlapping the requested range are read, so a range
+ * at the end of a large blob can be read without reading the data before it.
+ *
+ * @param[in]     handle     Handle obtained from nvs_open function.
+ * @param[in]     key        Key name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ * @param[in]     offset     Offset of the first byte to read within the blob.
+ * @param[out]    out_value  Pointer to the output buffer, at least \c length bytes long.
+ * @param[in]     length     Number of bytes to read.
+ *
+ * @return
+ *             - ESP_OK if the range was read successfully
+ *             - ESP_ERR_NVS_NOT_FOUND if the requested key doesn't exist
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_LENGTH if the range exceeds the size of the blob
+ *             - ESP_ERR_INVALID_ARG if key or out_value is NULL
+ */
+esp_err_t nvs_get_blob_range(nvs_handle_t handle, const char* key, size_t offset, void* out_value, size_t length);
 /**@}*/
 
 /**
@@ -520,6 +542,230 @@ esp_err_t nvs_erase_all(nvs_handle_t handle);
  */
 esp_err_t nvs_commit(nvs_handle_t handle);
 
+/**
+ * @brief      Start a write batch on the handle
+ *
+ * After this call, values set with the nvs_batch_set_* functions are only staged in RAM.
+ * \c nvs_batch_commit writes all staged values to flash in one step: if power is lost during the commit,
+ * either all or none of the values are stored. All values of a batch together must fit into one NVS page,
+ * i.e. 126 entries. Blobs can't be part of a batch. Only one batch can be open per handle.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ *
+ * @return
+ *             - ESP_OK if the batch was started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+ *             - ESP_ERR_NVS_INVALID_STATE if a batch is already open on this handle
+ */
+esp_err_t nvs_batch_begin(nvs_handle_t handle);
+
+/**@{*/
+/**
+ * @brief      stage int8_t value for given key in the open write batch
+ *
+ * Setting the same key again replaces the staged value. Nothing is written to flash
+ * until \c nvs_batch_commit is called.
+ *
+ * @param[in]  handle  Handle on which \c nvs_batch_begin has been called.
+ * @param[in]  key     Key name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ * @param[in]  value   The value to set.
+ *
+ * @return
+ *             - ESP_OK if value was staged successfully
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no batch is open on this handle
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+ *             - ESP_ERR_NO_MEM if memory for staging the value could not be allocated
+ */
+esp_err_t nvs_batch_set_i8 (nvs_handle_t handle, const char* key, int8_t value);
+
+/**
+ * @brief      stage uint8_t value for given key in the open write batch
+ *
+ * This function is the same as \c nvs_batch_set_i8 except for the data type.
+ */
+esp_err_t nvs_batch_set_u8 (nvs_handle_t handle, const char* key, uint8_t value);
+
+/**
+ * @brief      stage int16_t value for given key in the open write batch
+ *
+ * This function is the same as \c nvs_batch_set_i8 except for the data type.
+ */
+esp_err_t nvs_batch_set_i16 (nvs_handle_t handle, const char* key, int16_t value);
+
+/**
+ * @brief      stage uint16_t value for given key in the open write batch
+ *
+ * This function is the same as \c nvs_batch_set_i8 except for the data type.
+ */
+esp_err_t nvs_batch_set_u16 (nvs_handle_t handle, const char* key, uint16_t value);
+
+/**
+ * @brief      stage int32_t value for given key in the open write batch
+ *
+ * This function is the same as \c nvs_batch_set_i8 except for the data type.
+ */
+esp_err_t nvs_batch_set_i32 (nvs_handle_t handle, const char* key, int32_t value);
+
+/**
+ * @brief      stage uint32_t value for given key in the open write batch
+ *
+ * This function is the same as \c nvs_batch_set_i8 except for the data type.
+ */
+esp_err_t nvs_batch_set_u32 (nvs_handle_t handle, const char* key, uint32_t value);
+
+/**
+ * @brief      stage int64_t value for given key in the open write batch
+ *
+ * This function is the same as \c nvs_batch_set_i8 except for the data type.
+ */
+esp_err_t nvs_batch_set_i64 (nvs_handle_t handle, const char* key, int64_t value);
+
+/**
+ * @brief      stage uint64_t value for given key in the open write batch
+ *
+ * This function is the same as \c nvs_batch_set_i8 except for the data type.
+ */
+esp_err_t nvs_batch_set_u64 (nvs_handle_t handle, const char* key, uint64_t value);
+
+/**
+ * @brief      stage string for given key in the open write batch
+ *
+ * This function is the same as \c nvs_batch_set_i8 except for the data type.
+ * The string is copied, so the caller's buffer may be reused right away.
+ *
+ * @return
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the string value is too long
+ *             - other error codes as in \c nvs_batch_set_i8
+ */
+esp_err_t nvs_batch_set_str (nvs_handle_t handle, const char* key, const char* value);
+/**@}*/
+
+/**
+ * @brief      Write all values of the open write batch and close the batch
+ *
+ * The values are written as one contiguous run of entries. Values which replace existing ones
+ * are erased after the whole run has been written. The batch is closed even if the commit fails.
+ *
+ * @param[in]  handle  Handle on which \c nvs_batch_begin has been called.
+ *
+ * @return
+ *             - ESP_OK if all values were written successfully
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no batch is open on this handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if the values don't fit into one page.
+ *               None of the values have been written in this case.
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the values were written but the old values
+ *               couldn't be erased because a flash operation has failed. The update will be
+ *               finished after re-initialization of nvs, provided that flash operation doesn't fail again.
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_batch_commit(nvs_handle_t handle);
+
+/**
+ * @brief      Discard all values of the open write batch and close the batch
+ *
+ * @param[in]  handle  Handle on which \c nvs_batch_begin has been called.
+ *
+ * @return
+ *             - ESP_OK if the batch was discarded
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no batch is open on this handle
+ */
+esp_err_t nvs_batch_abort(nvs_handle_t handle);
+
+/**
+ * @brief      Start writing a blob value in parts
+ *
+ * The data passed to \c nvs_blob_write_append is written to flash chunk by chunk, so at most
+ * one chunk (about 4 kB) of it is held in RAM, regardless of the size of the blob.
+ * Readers still get the previous value of the key until \c nvs_blob_write_commit replaces it;
+ * if power is lost before that, the previous value is kept.
+ *
+ * While the blob write is open, setting or erasing the key by other functions, as well as erasing
+ * its namespace, fails with ESP_ERR_NVS_INVALID_STATE.
+ * Only one blob write can be open per handle, and only one per key.
+ *
+ * \code{c}
+ * // Example (without error checking) of writing a blob received in parts
+ * nvs_blob_write_begin(my_handle, "cert_bundle");
+ * while ((len = receive(buf, sizeof(buf))) > 0) {
+ *     nvs_blob_write_append(my_handle, buf, len);
+ * }
+ * nvs_blob_write_commit(my_handle);
+ * \endcode
+ *
+ * @param[in]  handle  Handle obtained from nvs_open function.
+ *                     Handles that were opened read only cannot be used.
+ * @param[in]  key     Key name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ *
+ * @return
+ *             - ESP_OK if the blob write was started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+ *             - ESP_ERR_NVS_INVALID_STATE if a blob write is already open on this handle or for this key
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+ *             - ESP_ERR_NO_MEM if memory for the chunk buffer could not be allocated
+ */
+esp_err_t nvs_blob_write_begin(nvs_handle_t handle, const char* key);
+
+/**
+ * @brief      Append data to the open blob write
+ *
+ * If writing fails, the data written so far is erased and the blob write is closed.
+ *
+ * @param[in]  handle  Handle on which \c nvs_blob_write_begin has been called.
+ * @param[in]  data    Data to append.
+ * @param[in]  length  Length of the data in bytes.
+ *
+ * @return
+ *             - ESP_OK if the data was appended
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no blob write is open on this handle
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the blob would not fit into the partition.
+ *               The blob write stays open in this case.
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_write_append(nvs_handle_t handle, const void* data, size_t length);
+
+/**
+ * @brief      Finish the open blob write and close it
+ *
+ * Writes the remaining data and the blob index, then erases the previous value of the key.
+ * The blob write is closed even if this function fails.
+ *
+ * @param[in]  handle  Handle on which \c nvs_blob_write_begin has been called.
+ *
+ * @return
+ *             - ESP_OK if the blob was written
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no blob write is open on this handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space.
+ *               The previous value has been kept in this case.
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the blob was written but the previous value
+ *               couldn't be erased because a flash operation has failed. The update will be
+ *               finished after re-initialization of nvs, provided that flash operation doesn't fail again.
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_write_commit(nvs_handle_t handle);
+
+/**
+ * @brief      Erase the data of the open blob write and close it
+ *
+ * The previous value of the key is kept.
+ *
+ * @param[in]  handle  Handle on which \c nvs_blob_write_begin has been called.
+ *
+ * @return
+ *             - ESP_OK if the blob write was aborted
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no blob write is open on this handle
+ */
+esp_err_t nvs_blob_write_abort(nvs_handle_t handle);
+
 /**
  * @brief      Close the storage handle and free any allocated resources
  *
@@ -578,6 +824,114 @@ typedef struct {
  */
 esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats);
 
+/**
+ * @note Statistics of the RAM value cache of an NVS partition.
+ */
+typedef struct {
+    size_t hits;              /**< Number of reads which were served from the cache. */
+    size_t misses;            /**< Number of reads of cacheable types which had to access the flash. */
+    size_t entries;           /**< Number of values currently cached. */
+    size_t capacity;          /**< Maximum number of cached values, 0 if the cache is disabled. */
+} nvs_value_cache_stats_t;
+
+/**
+ * @brief      Fill structure nvs_value_cache_stats_t with the statistics of the value cache of a partition.
+ *
+ * The value cache is configured with CONFIG_NVS_VALUE_CACHE_ENTRIES. It keeps recently read primitive
+ * values and short strings in RAM, so that reading them again doesn't access the flash.
+ *
+ * @param[in]   part_name   Partition name NVS in the partition table.
+ *                          If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @param[out]  cache_stats Returns filled structure nvs_value_cache_stats_t.
+ *
+ * @return
+ *             - ESP_OK if cache_stats has been filled.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *               Return param cache_stats will be filled 0.
+ *             - ESP_ERR_INVALID_ARG if cache_stats equal to NULL.
+ */
+esp_err_t nvs_get_value_cache_stats(const char *part_name, nvs_value_cache_stats_t *cache_stats);
+
+/**
+ * @note Counters of the operations on an NVS partition, see nvs_get_op_stats().
+ *
+ * The first group counts what NVS does logically, the second group the flash operations this results in.
+ */
+typedef struct {
+    uint64_t value_bytes;       /**< Bytes of values passed to the set functions, including unchanged values which were not written. */
+    size_t items_written;       /**< Items written for new values. Every blob chunk and blob index is an item. */
+    size_t entries_written;     /**< Entries occupied by the written items. */
+    size_t items_relocated;     /**< Items copied to another page while a page was reclaimed. */
+    size_t entries_relocated;   /**< Entries occupied by the relocated items. */
+    size_t pages_erased;        /**< Pages erased, mostly after they have been reclaimed. */
+    size_t crc_computations;    /**< CRC32 checksums computed to write or verify items, item data and page headers. */
+    uint64_t flash_read_bytes;  /**< Bytes read from flash. */
+    size_t flash_read_ops;      /**< Number of flash read operations. */
+    uint64_t flash_write_bytes; /**< Bytes written to flash, including entry state and page state updates. */
+    size_t flash_write_ops;     /**< Number of flash write operations. */
+    uint64_t flash_erase_bytes; /**< Bytes erased in flash. */
+    size_t flash_erase_ops;     /**< Number of flash erase operations. */
+} nvs_op_stats_t;
+
+/**
+ * @note Counters of the operations on a single namespace, see nvs_get_namespace_op_stats().
+ */
+typedef struct {
+    uint64_t value_bytes;       /**< Bytes of values passed to the set functions. */
+    size_t items_written;       /**< Items written for new values. */
+    size_t entries_written;     /**< Entries occupied by the written items. */
+    size_t items_relocated;     /**< Items copied to another page while a page was reclaimed. */
+    size_t entries_relocated;   /**< Entries occupied by the relocated items. */
+} nvs_namespace_op_stats_t;
+
+/**
+ * @brief      Fill structure nvs_op_stats_t with the operation counters of a partition.
+ *
+ * The counters start at zero when the partition is initialized and can be reset with nvs_reset_op_stats().
+ * Comparing entries_written * 32 or value_bytes with flash_write_bytes shows the write amplification
+ * caused by item headers, entry state updates and page reclamation.
+ *
+ * @param[in]   part_name   Partition name NVS in the partition table.
+ *                          If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @param[out]  op_stats    Returns filled structure nvs_op_stats_t.
+ *
+ * @return
+ *             - ESP_OK if op_stats has been filled.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *               Return param op_stats will be filled 0.
+ *             - ESP_ERR_INVALID_ARG if op_stats equal to NULL.
+ */
+esp_err_t nvs_get_op_stats(const char *part_name, nvs_op_stats_t *op_stats);
+
+/**
+ * @brief      Fill structure nvs_namespace_op_stats_t with the operation counters of the namespace of a handle.
+ *
+ * @param[in]   handle      Handle obtained from nvs_open function.
+ *
+ * @param[out]  op_stats    Returns filled structure nvs_namespace_op_stats_t.
+ *
+ * @return
+ *             - ESP_OK if op_stats has been filled.
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL.
+ *               Return param op_stats will be filled 0.
+ *             - ESP_ERR_INVALID_ARG if op_stats equal to NULL.
+ */
+esp_err_t nvs_get_namespace_op_stats(nvs_handle_t handle, nvs_namespace_op_stats_t *op_stats);
+
+/**
+ * @brief      Reset the operation counters of a partition, including those of its namespaces.
+ *
+ * @param[in]   part_name   Partition name NVS in the partition table.
+ *                          If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @return
+ *             - ESP_OK if the counters have been reset.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ */
+esp_err_t nvs_reset_op_stats(const char *part_name);
+
 /**
  * @brief      Calculate all entries in a namespace.
  *
@@ -130,6 +130,29 @@ esp_err_t nvs_flash_deinit(void);
  */
 esp_err_t nvs_flash_deinit_partition(const char* partition_label);
 
+/**
+ * @brief Save the index checkpoint of an NVS partition
+ *
+ * With CONFIG_NVS_INDEX_CHECKPOINT enabled, an NVS partition can have a companion data partition labelled
+ * "<partition_label>_ckpt". The checkpoint stores the state of all pages, their hash lists and the namespace table,
+ * so that the next initialization can restore them instead of reading every entry of the partition.
+ * The checkpoint is only used if none of the pages has changed since it was saved, hence it is best saved
+ * right before a planned shutdown. nvs_flash_deinit_partition() also saves the checkpoint.
+ *
+ * Checkpoints are not supported for encrypted NVS partitions.
+ *
+ * @param[in]  partition_label   Label of the NVS partition
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NVS_NOT_INITIALIZED if the partition is not initialized
+ *      - ESP_ERR_NVS_PART_NOT_FOUND if the partition has no checkpoint partition
+ *      - ESP_ERR_NVS_INVALID_STATE if an earlier write failed and the partition has to be initialized again
+ *      - ESP_ERR_NVS_NOT_ENOUGH_SPACE if the checkpoint partition is too small
+ *      - one of the error codes from the underlying flash storage driver
+ */
+esp_err_t nvs_flash_save_checkpoint(const char *partition_label);
+
 /**
  * @brief Erase the default NVS partition
  *
@@ -34,6 +34,10 @@ enum class ItemType : uint8_t {
  *
  * @note The scope of this handle may vary depending on the implementation, but normally would be the namespace of
  * a particular partition. Outside that scope, nvs entries can't be accessed/altered.
+ *
+ * @note The partial blob read, write batch and blob write operations return ESP_ERR_NOT_SUPPORTED unless the
+ * implementation overrides them, so that implementations written against earlier versions of this class,
+ * e.g. mocks, keep compiling.
  */
 class NVSHandle {
 public:
@@ -150,6 +154,28 @@ public:
     virtual esp_err_t get_string(const char *key, char* out_str, size_t len) = 0;
     virtual esp_err_t get_blob(const char *key, void* out_blob, size_t len) = 0;
 
+    /**
+     * @brief      Read a part of a blob.
+     *
+     * Only the parts of the blob overlapping the requested range are read from flash.
+     *
+     * @param[in]     key        Key name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+     * @param[in]     offset     Offset of the first byte to read within the blob.
+     * @param[out]    out_blob   Pointer to the output buffer, at least len bytes long.
+     * @param[in]     len        Number of bytes to read.
+     *
+     * @return
+     *             - ESP_OK if the range was read successfully
+     *             - ESP_ERR_NVS_NOT_FOUND if the requested key doesn't exist
+     *             - ESP_ERR_NVS_INVALID_LENGTH if the range exceeds the size of the blob
+     *
+     * @note compare to \ref nvs_get_blob_range in nvs.h
+     */
+    virtual esp_err_t get_blob_range(const char *key, size_t offset, void* out_blob, size_t len)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
     /**
      * @brief Look up the size of an entry's data.
      *
@@ -200,10 +226,162 @@ public:
      */
     virtual esp_err_t get_used_entry_count(size_t& usedEntries) = 0;
 
+    /**
+     * @brief      Start a write batch.
+     *
+     * Values set with \c batch_set_item and \c batch_set_string are only staged in RAM until \c batch_commit
+     * is called. The commit writes either all of them or, if power is lost during the commit, none of them.
+     * Only one batch can be open per handle.
+     *
+     * @return
+     *             - ESP_OK if the batch was started
+     *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+     *             - ESP_ERR_NVS_INVALID_STATE if a batch is already open on this handle
+     *
+     * @note compare to \ref nvs_batch_begin in nvs.h
+     */
+    virtual esp_err_t batch_begin()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief      Stage a value for the key in the open write batch.
+     *
+     * Setting the same key again replaces the staged value. Blobs can't be part of a batch.
+     *
+     * @return
+     *             - ESP_OK if the value was staged
+     *             - ESP_ERR_NVS_INVALID_STATE if no batch is open on this handle
+     *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+     *             - ESP_ERR_NVS_VALUE_TOO_LONG if the string value is too long
+     *             - ESP_ERR_NO_MEM if memory for staging the value could not be allocated
+     */
+    template<typename T>
+    esp_err_t batch_set_item(const char *key, T value);
+    virtual esp_err_t batch_set_string(const char *key, const char* value)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief      Write all values of the open write batch and close it.
+     *
+     * The batch is closed even if the commit fails.
+     *
+     * @return
+     *             - ESP_OK if all values were written
+     *             - ESP_ERR_NVS_INVALID_STATE if no batch is open on this handle
+     *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if the values don't fit into one page of the partition.
+     *               Nothing has been written in this case.
+     *             - ESP_ERR_NVS_REMOVE_FAILED if the values were written but the old values couldn't be erased.
+     *               The update will be finished after re-initialization of nvs.
+     *             - other error codes from the underlying storage driver
+     *
+     * @note compare to \ref nvs_batch_commit in nvs.h
+     */
+    virtual esp_err_t batch_commit()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief      Discard all values of the open write batch and close it.
+     *
+     * @return
+     *             - ESP_OK if the batch was discarded
+     *             - ESP_ERR_NVS_INVALID_STATE if no batch is open on this handle
+     */
+    virtual esp_err_t batch_abort()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief      Start writing a blob in parts.
+     *
+     * The data passed to \c blob_write_append is written to flash in chunks, at most one chunk of it is held in RAM.
+     * The previous value of the key stays readable until \c blob_write_commit replaces it.
+     * While the blob write is open, writing or erasing the key by other means, as well as erasing all keys of the
+     * namespace, fails with ESP_ERR_NVS_INVALID_STATE.
+     * Only one blob write can be open per handle, and only one per key.
+     *
+     * @param[in]  key   Key name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+     *
+     * @return
+     *             - ESP_OK if the blob write was started
+     *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+     *             - ESP_ERR_NVS_INVALID_STATE if a blob write is already open on this handle or for this key
+     *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+     *             - ESP_ERR_NO_MEM if memory for the chunk buffer could not be allocated
+     *
+     * @note compare to \ref nvs_blob_write_begin in nvs.h
+     */
+    virtual esp_err_t blob_write_begin(const char *key)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief      Append data to the open blob write.
+     *
+     * If writing fails, the data written so far is erased and the blob write is closed.
+     *
+     * @return
+     *             - ESP_OK if the data was appended
+     *             - ESP_ERR_NVS_INVALID_STATE if no blob write is open on this handle
+     *             - ESP_ERR_NVS_VALUE_TOO_LONG if the blob would not fit into the partition
+     *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space
+     *             - other error codes from the underlying storage driver
+     *
+     * @note compare to \ref nvs_blob_write_append in nvs.h
+     */
+    virtual esp_err_t blob_write_append(const void* data, size_t len)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief      Finish the open blob write, replacing the previous value of the key.
+     *
+     * The blob write is closed even if the commit fails.
+     *
+     * @return
+     *             - ESP_OK if the blob was written
+     *             - ESP_ERR_NVS_INVALID_STATE if no blob write is open on this handle
+     *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space. Nothing has been written in this case.
+     *             - ESP_ERR_NVS_REMOVE_FAILED if the blob was written but the old value couldn't be erased.
+     *               The update will be finished after re-initialization of nvs.
+     *             - other error codes from the underlying storage driver
+     *
+     * @note compare to \ref nvs_blob_write_commit in nvs.h
+     */
+    virtual esp_err_t blob_write_commit()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief      Erase the data written by the open blob write and close it.
+     *
+     * @return
+     *             - ESP_OK if the blob write was aborted
+     *             - ESP_ERR_NVS_INVALID_STATE if no blob write is open on this handle
+     */
+    virtual esp_err_t blob_write_abort()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
 protected:
     virtual esp_err_t set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) = 0;
 
     virtual esp_err_t get_typed_item(ItemType datatype, const char *key, void* data, size_t dataSize) = 0;
+
+    virtual esp_err_t batch_set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 };
 
 /**
@@ -275,6 +453,11 @@ esp_err_t NVSHandle::get_item(const char *key, T &value) {
     return get_typed_item(itemTypeOf(value), key, &value, sizeof(value));
 }
 
+template<typename T>
+esp_err_t NVSHandle::batch_set_item(const char *key, T value) {
+    return batch_set_typed_item(itemTypeOf(value), key, &value, sizeof(value));
+}
+
 } // nvs
 
 #endif // NVS_HANDLE_HPP_
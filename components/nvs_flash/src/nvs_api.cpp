@@ -254,6 +254,18 @@ extern "C" esp_err_t nvs_flash_deinit(void)
     return nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME);
 }
 
+extern "C" esp_err_t nvs_flash_save_checkpoint(const char *partition_label)
+{
+    Lock lock;
+
+    nvs::Storage* storage = lookup_storage_from_name(partition_label);
+    if (storage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    return storage->saveCheckpoint();
+}
+
 static esp_err_t nvs_find_ns_handle(nvs_handle_t c_handle, NVSHandleSimple** handle)
 {
     auto it = find_if(begin(s_nvs_handles), end(s_nvs_handles), [=](NVSHandleEntry& e) -> bool {
@@ -398,6 +410,156 @@ extern "C" esp_err_t nvs_commit(nvs_handle_t c_handle)
     return handle->commit();
 }
 
+extern "C" esp_err_t nvs_batch_begin(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->batch_begin();
+}
+
+template<typename T>
+static esp_err_t nvs_batch_set(nvs_handle_t c_handle, const char* key, T value)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s %d %ld", __func__, key, static_cast<int>(sizeof(T)), static_cast<long int>(value));
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    return handle->batch_set_item(key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_i8  (nvs_handle_t handle, const char* key, int8_t value)
+{
+    return nvs_batch_set(handle, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_u8  (nvs_handle_t handle, const char* key, uint8_t value)
+{
+    return nvs_batch_set(handle, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_i16 (nvs_handle_t handle, const char* key, int16_t value)
+{
+    return nvs_batch_set(handle, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_u16 (nvs_handle_t handle, const char* key, uint16_t value)
+{
+    return nvs_batch_set(handle, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_i32 (nvs_handle_t handle, const char* key, int32_t value)
+{
+    return nvs_batch_set(handle, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_u32 (nvs_handle_t handle, const char* key, uint32_t value)
+{
+    return nvs_batch_set(handle, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_i64 (nvs_handle_t handle, const char* key, int64_t value)
+{
+    return nvs_batch_set(handle, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_u64 (nvs_handle_t handle, const char* key, uint64_t value)
+{
+    return nvs_batch_set(handle, key, value);
+}
+
+extern "C" esp_err_t nvs_batch_set_str(nvs_handle_t c_handle, const char* key, const char* value)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s %s", __func__, key, value);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->batch_set_string(key, value);
+}
+
+extern "C" esp_err_t nvs_batch_commit(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->batch_commit();
+}
+
+extern "C" esp_err_t nvs_batch_abort(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->batch_abort();
+}
+
+extern "C" esp_err_t nvs_blob_write_begin(nvs_handle_t c_handle, const char* key)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s", __func__, key);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_write_begin(key);
+}
+
+extern "C" esp_err_t nvs_blob_write_append(nvs_handle_t c_handle, const void* data, size_t length)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d", __func__, static_cast<int>(length));
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_write_append(data, length);
+}
+
+extern "C" esp_err_t nvs_blob_write_commit(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_write_commit();
+}
+
+extern "C" esp_err_t nvs_blob_write_abort(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_write_abort();
+}
+
 extern "C" esp_err_t nvs_set_str(nvs_handle_t c_handle, const char* key, const char* value)
 {
     Lock lock;
@@ -516,6 +678,21 @@ extern "C" esp_err_t nvs_get_blob(nvs_handle_t c_handle, const char* key, void*
     return nvs_get_str_or_blob(c_handle, nvs::ItemType::BLOB, key, out_value, length);
 }
 
+extern "C" esp_err_t nvs_get_blob_range(nvs_handle_t c_handle, const char* key, size_t offset, void* out_value, size_t length)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s %d %d", __func__, key, static_cast<int>(offset), static_cast<int>(length));
+    if (key == nullptr || (out_value == nullptr && length > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->get_blob_range(key, offset, out_value, length);
+}
+
 extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats)
 {
     Lock lock;
@@ -541,6 +718,76 @@ extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats
     return pStorage->fillStats(*nvs_stats);
 }
 
+extern "C" esp_err_t nvs_get_value_cache_stats(const char* part_name, nvs_value_cache_stats_t* cache_stats)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    if (cache_stats == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cache_stats->hits     = 0;
+    cache_stats->misses   = 0;
+    cache_stats->entries  = 0;
+    cache_stats->capacity = 0;
+
+    pStorage = lookup_storage_from_name((part_name == nullptr) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    return pStorage->fillValueCacheStats(*cache_stats);
+}
+
+extern "C" esp_err_t nvs_get_op_stats(const char* part_name, nvs_op_stats_t* op_stats)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    if (op_stats == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *op_stats = {};
+
+    pStorage = lookup_storage_from_name((part_name == nullptr) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    return pStorage->fillOpStats(*op_stats);
+}
+
+extern "C" esp_err_t nvs_get_namespace_op_stats(nvs_handle_t c_handle, nvs_namespace_op_stats_t* op_stats)
+{
+    Lock lock;
+    if (op_stats == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *op_stats = {};
+
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    return handle->fillOpStats(*op_stats);
+}
+
+extern "C" esp_err_t nvs_reset_op_stats(const char* part_name)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    pStorage = lookup_storage_from_name((part_name == nullptr) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    pStorage->resetOpStats();
+    return ESP_OK;
+}
+
 extern "C" esp_err_t nvs_get_used_entry_count(nvs_handle_t c_handle, size_t* used_entries)
 {
     Lock lock;
@@ -0,0 +1,126 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstring>
+#include "nvs_checkpoint.hpp"
+#include "nvs.h"
+#include "spi_flash_mmap.h"
+#include "esp_rom_crc.h"
+
+namespace nvs
+{
+
+uint32_t CheckpointHeader::calculateCrc32() const
+{
+    return esp_rom_crc32_le(0xffffffff, reinterpret_cast<const uint8_t*>(this), offsetof(CheckpointHeader, mCrc32));
+}
+
+CheckpointWriter::CheckpointWriter(Partition* partition)
+    : mPartition(partition), mOffset(sizeof(CheckpointHeader)), mErasedEnd(0), mDataCrc32(0xffffffff)
+{
+}
+
+esp_err_t CheckpointWriter::eraseUpTo(size_t end)
+{
+    while (mErasedEnd < end) {
+        if (mErasedEnd + SPI_FLASH_SEC_SIZE > mPartition->get_size()) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        auto err = mPartition->erase_range(mErasedEnd, SPI_FLASH_SEC_SIZE);
+        if (err != ESP_OK) {
+            return err;
+        }
+        mErasedEnd += SPI_FLASH_SEC_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t CheckpointWriter::write(const void* data, size_t size)
+{
+    // pages without entries have no hashes to save
+    if (size == 0) {
+        return ESP_OK;
+    }
+    auto err = eraseUpTo(mOffset + size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = mPartition->write_raw(mOffset, data, size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mDataCrc32 = esp_rom_crc32_le(mDataCrc32, static_cast<const uint8_t*>(data), size);
+    mOffset += size;
+    return ESP_OK;
+}
+
+esp_err_t CheckpointWriter::finish(uint32_t baseSector, uint32_t sectorCount, uint32_t namespaceCount)
+{
+    auto err = eraseUpTo(sizeof(CheckpointHeader));
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    CheckpointHeader header;
+    header.mMagic = CheckpointHeader::MAGIC;
+    header.mVersion = CheckpointHeader::VERSION;
+    header.mBaseSector = baseSector;
+    header.mSectorCount = sectorCount;
+    header.mNamespaceCount = namespaceCount;
+    header.mDataSize = mOffset - sizeof(CheckpointHeader);
+    header.mDataCrc32 = mDataCrc32;
+    header.mCrc32 = header.calculateCrc32();
+    return mPartition->write_raw(0, &header, sizeof(header));
+}
+
+CheckpointReader::CheckpointReader(Partition* partition)
+    : mPartition(partition), mHeader(), mOffset(sizeof(CheckpointHeader)), mDataCrc32(0xffffffff)
+{
+}
+
+esp_err_t CheckpointReader::begin(uint32_t baseSector, uint32_t sectorCount)
+{
+    auto err = mPartition->read_raw(0, &mHeader, sizeof(mHeader));
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (mHeader.mMagic != CheckpointHeader::MAGIC ||
+            mHeader.mVersion != CheckpointHeader::VERSION ||
+            mHeader.mCrc32 != mHeader.calculateCrc32() ||
+            mHeader.mBaseSector != baseSector ||
+            mHeader.mSectorCount != sectorCount ||
+            mHeader.mDataSize > mPartition->get_size() - sizeof(CheckpointHeader)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t CheckpointReader::read(void* data, size_t size)
+{
+    if (size == 0) {
+        return ESP_OK;
+    }
+    if (mOffset + size > sizeof(CheckpointHeader) + mHeader.mDataSize) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    auto err = mPartition->read_raw(mOffset, data, size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mDataCrc32 = esp_rom_crc32_le(mDataCrc32, static_cast<const uint8_t*>(data), size);
+    mOffset += size;
+    return ESP_OK;
+}
+
+esp_err_t CheckpointReader::finish()
+{
+    if (mOffset != sizeof(CheckpointHeader) + mHeader.mDataSize || mDataCrc32 != mHeader.mDataCrc32) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+} // namespace nvs
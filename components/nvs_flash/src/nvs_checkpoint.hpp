@@ -0,0 +1,100 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_checkpoint_hpp
+#define nvs_checkpoint_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include "esp_err.h"
+#include "partition.hpp"
+
+namespace nvs
+{
+
+/**
+ * Header at the beginning of the checkpoint partition.
+ *
+ * The checkpoint data following the header consists of one Page::Snapshot and its hash list entries for each
+ * page in sector order, followed by the namespace table.
+ */
+struct CheckpointHeader {
+    static const uint32_t MAGIC = 0x4b43564e; // "NVCK"
+    static const uint32_t VERSION = 1;
+
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mBaseSector;
+    uint32_t mSectorCount;
+    uint32_t mNamespaceCount;
+    uint32_t mDataSize;
+    uint32_t mDataCrc32;
+    uint32_t mCrc32;        // crc of the fields above
+
+    uint32_t calculateCrc32() const;
+};
+
+static_assert(sizeof(CheckpointHeader) == 32, "checkpoint header size must be 32 bytes");
+
+/**
+ * Sequential writer of an index checkpoint.
+ *
+ * Sectors of the checkpoint partition are erased as they are reached. The header is only written by finish(),
+ * so a checkpoint which was interrupted by a power loss is never considered valid.
+ */
+class CheckpointWriter
+{
+public:
+    CheckpointWriter(Partition* partition);
+
+    esp_err_t write(const void* data, size_t size);
+
+    esp_err_t finish(uint32_t baseSector, uint32_t sectorCount, uint32_t namespaceCount);
+
+private:
+    esp_err_t eraseUpTo(size_t end);
+
+    Partition* mPartition;
+    size_t mOffset;
+    size_t mErasedEnd;
+    uint32_t mDataCrc32;
+};
+
+/**
+ * Sequential reader of an index checkpoint written by CheckpointWriter.
+ */
+class CheckpointReader
+{
+public:
+    CheckpointReader(Partition* partition);
+
+    /**
+     * Reads the header. Returns ESP_ERR_NVS_NOT_FOUND if there is no valid checkpoint for the given sectors.
+     */
+    esp_err_t begin(uint32_t baseSector, uint32_t sectorCount);
+
+    esp_err_t read(void* data, size_t size);
+
+    /**
+     * Checks that all data was read and that its crc matches.
+     */
+    esp_err_t finish();
+
+    uint32_t getNamespaceCount() const
+    {
+        return mHeader.mNamespaceCount;
+    }
+
+private:
+    Partition* mPartition;
+    CheckpointHeader mHeader;
+    size_t mOffset;
+    uint32_t mDataCrc32;
+};
+
+} // namespace nvs
+
+#endif /* nvs_checkpoint_hpp */
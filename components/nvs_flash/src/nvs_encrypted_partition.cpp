@@ -38,6 +38,7 @@ esp_err_t NVSEncryptedPartition::read(size_t src_offset, void* dst, size_t size)
     if (size != sizeof(Item)) return ESP_ERR_INVALID_SIZE;
 
     // read data
+    mOpStats.countRead(size);
     esp_err_t read_result = esp_partition_read(mESPPartition, src_offset, dst, size);
     if (read_result != ESP_OK) {
         return read_result;
@@ -103,6 +104,7 @@ esp_err_t NVSEncryptedPartition::write(size_t addr, const void* src, size_t size
     }
 
     // write data
+    mOpStats.countWrite(size);
     esp_err_t result = esp_partition_write(mESPPartition, addr, buf, size);
 
     delete [] buf;
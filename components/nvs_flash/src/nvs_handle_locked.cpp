@@ -67,6 +67,56 @@ esp_err_t NVSHandleLocked::get_used_entry_count(size_t& usedEntries) {
     return handle->get_used_entry_count(usedEntries);
 }
 
+esp_err_t NVSHandleLocked::batch_begin() {
+    Lock lock;
+    return handle->batch_begin();
+}
+
+esp_err_t NVSHandleLocked::batch_set_string(const char *key, const char* str) {
+    Lock lock;
+    return handle->batch_set_string(key, str);
+}
+
+esp_err_t NVSHandleLocked::batch_commit() {
+    Lock lock;
+    return handle->batch_commit();
+}
+
+esp_err_t NVSHandleLocked::batch_abort() {
+    Lock lock;
+    return handle->batch_abort();
+}
+
+esp_err_t NVSHandleLocked::get_blob_range(const char *key, size_t offset, void* out_blob, size_t len) {
+    Lock lock;
+    return handle->get_blob_range(key, offset, out_blob, len);
+}
+
+esp_err_t NVSHandleLocked::blob_write_begin(const char *key) {
+    Lock lock;
+    return handle->blob_write_begin(key);
+}
+
+esp_err_t NVSHandleLocked::blob_write_append(const void* data, size_t len) {
+    Lock lock;
+    return handle->blob_write_append(data, len);
+}
+
+esp_err_t NVSHandleLocked::blob_write_commit() {
+    Lock lock;
+    return handle->blob_write_commit();
+}
+
+esp_err_t NVSHandleLocked::blob_write_abort() {
+    Lock lock;
+    return handle->blob_write_abort();
+}
+
+esp_err_t NVSHandleLocked::batch_set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) {
+    Lock lock;
+    return handle->batch_set_typed_item(datatype, key, data, dataSize);
+}
+
 esp_err_t NVSHandleLocked::set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) {
     Lock lock;
     return handle->set_typed_item(datatype, key, data, dataSize);
@@ -57,11 +57,31 @@ public:
 
     esp_err_t get_used_entry_count(size_t& usedEntries) override;
 
+    esp_err_t batch_begin() override;
+
+    esp_err_t batch_set_string(const char *key, const char* str) override;
+
+    esp_err_t batch_commit() override;
+
+    esp_err_t batch_abort() override;
+
+    esp_err_t get_blob_range(const char *key, size_t offset, void* out_blob, size_t len) override;
+
+    esp_err_t blob_write_begin(const char *key) override;
+
+    esp_err_t blob_write_append(const void* data, size_t len) override;
+
+    esp_err_t blob_write_commit() override;
+
+    esp_err_t blob_write_abort() override;
+
 protected:
     esp_err_t set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) override;
 
     esp_err_t get_typed_item(ItemType datatype, const char *key, void* data, size_t dataSize) override;
 
+    esp_err_t batch_set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) override;
+
 private:
     NVSHandleSimple *handle;
 };
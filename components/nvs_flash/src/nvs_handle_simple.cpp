@@ -12,12 +12,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include <cstdlib>
+#include <cstring>
 #include "nvs_handle.hpp"
 #include "nvs_partition_manager.hpp"
 
 namespace nvs {
 
 NVSHandleSimple::~NVSHandleSimple() {
+    mBatch.clearAndFreeNodes();
+    if (mBlobWriter) {
+        // the storage is gone if the handle has been invalidated, the chunks are erased as orphans on the next init
+        if (valid) {
+            mBlobWriter->abort();
+        }
+        delete mBlobWriter;
+    }
     NVSPartitionManager::get_instance()->close_handle(this);
 }
 
@@ -110,6 +119,154 @@ esp_err_t NVSHandleSimple::get_used_entry_count(size_t& used_entries)
     return err;
 }
 
+esp_err_t NVSHandleSimple::batch_begin()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mBatchOpen) return ESP_ERR_NVS_INVALID_STATE;
+
+    mBatchOpen = true;
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::batch_stage(ItemType datatype, const char *key, const void* data, size_t dataSize)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBatchOpen) return ESP_ERR_NVS_INVALID_STATE;
+    if (key == nullptr) return ESP_ERR_INVALID_ARG;
+    if (strlen(key) > Item::MAX_KEY_LENGTH) return ESP_ERR_NVS_KEY_TOO_LONG;
+    if (dataSize > Page::CHUNK_MAX_SIZE) return ESP_ERR_NVS_VALUE_TOO_LONG;
+
+    Storage::BatchItem* item = new (std::nothrow) Storage::BatchItem();
+    if (!item) return ESP_ERR_NO_MEM;
+
+    if (isVariableLengthType(datatype)) {
+        item->strData = new (std::nothrow) char[dataSize];
+        if (!item->strData) {
+            delete item;
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(item->strData, data, dataSize);
+    } else {
+        if (dataSize > sizeof(item->value)) {
+            delete item;
+            return ESP_ERR_INVALID_ARG;
+        }
+        memcpy(item->value, data, dataSize);
+    }
+    item->datatype = datatype;
+    strncpy(item->key, key, sizeof(item->key) - 1);
+    item->key[sizeof(item->key) - 1] = 0;
+    item->dataSize = dataSize;
+
+    // a value staged again for the same key replaces the previous one
+    for (auto it = mBatch.begin(); it != mBatch.end(); ++it) {
+        if (it->datatype == datatype && strcmp(it->key, key) == 0) {
+            Storage::BatchItem* old = &(*it);
+            mBatch.insert(it, item);
+            mBatch.erase(old);
+            delete old;
+            return ESP_OK;
+        }
+    }
+    mBatch.push_back(item);
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::batch_set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize)
+{
+    return batch_stage(datatype, key, data, dataSize);
+}
+
+esp_err_t NVSHandleSimple::batch_set_string(const char *key, const char* str)
+{
+    if (str == nullptr) return ESP_ERR_INVALID_ARG;
+
+    return batch_stage(nvs::ItemType::SZ, key, str, strlen(str) + 1);
+}
+
+esp_err_t NVSHandleSimple::batch_commit()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBatchOpen) return ESP_ERR_NVS_INVALID_STATE;
+
+    esp_err_t err = mStoragePtr->writeBatch(mNsIndex, mBatch);
+    mBatch.clearAndFreeNodes();
+    mBatchOpen = false;
+    return err;
+}
+
+esp_err_t NVSHandleSimple::batch_abort()
+{
+    if (!mBatchOpen) return ESP_ERR_NVS_INVALID_STATE;
+
+    mBatch.clearAndFreeNodes();
+    mBatchOpen = false;
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::get_blob_range(const char *key, size_t offset, void* out_blob, size_t len)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    return mStoragePtr->readBlobRange(mNsIndex, key, offset, out_blob, len);
+}
+
+esp_err_t NVSHandleSimple::blob_write_begin(const char *key)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+    if (key == nullptr) return ESP_ERR_INVALID_ARG;
+
+    Storage::BlobWriter* writer = new (std::nothrow) Storage::BlobWriter(mStoragePtr);
+    if (!writer) return ESP_ERR_NO_MEM;
+
+    esp_err_t err = writer->begin(mNsIndex, key);
+    if (err != ESP_OK) {
+        delete writer;
+        return err;
+    }
+    mBlobWriter = writer;
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::blob_write_append(const void* data, size_t len)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+    if (data == nullptr && len > 0) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = mBlobWriter->append(data, len);
+    if (!mBlobWriter->isOpen()) {
+        delete mBlobWriter;
+        mBlobWriter = nullptr;
+    }
+    return err;
+}
+
+esp_err_t NVSHandleSimple::blob_write_commit()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+
+    esp_err_t err = mBlobWriter->commit();
+    delete mBlobWriter;
+    mBlobWriter = nullptr;
+    return err;
+}
+
+esp_err_t NVSHandleSimple::blob_write_abort()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobWriter) return ESP_ERR_NVS_INVALID_STATE;
+
+    mBlobWriter->abort();
+    delete mBlobWriter;
+    mBlobWriter = nullptr;
+    return ESP_OK;
+}
+
 void NVSHandleSimple::debugDump() {
     return mStoragePtr->debugDump();
 }
@@ -122,6 +279,12 @@ esp_err_t NVSHandleSimple::calcEntriesInNamespace(size_t& usedEntries) {
     return mStoragePtr->calcEntriesInNamespace(mNsIndex, usedEntries);
 }
 
+esp_err_t NVSHandleSimple::fillOpStats(nvs_namespace_op_stats_t& opStats) {
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    return mStoragePtr->fillNamespaceOpStats(mNsIndex, opStats);
+}
+
 bool NVSHandleSimple::findEntry(nvs_opaque_iterator_t* it, const char* name) {
     return mStoragePtr->findEntry(it, name);
 }
@@ -32,7 +32,9 @@ public:
         mStoragePtr(StoragePtr),
         mNsIndex(nsIndex),
         mReadOnly(readOnly),
-        valid(1)
+        valid(1),
+        mBatchOpen(false),
+        mBlobWriter(nullptr)
     { }
 
     ~NVSHandleSimple();
@@ -59,6 +61,26 @@ public:
 
     esp_err_t get_used_entry_count(size_t &usedEntries) override;
 
+    esp_err_t batch_begin() override;
+
+    esp_err_t batch_set_typed_item(ItemType datatype, const char *key, const void *data, size_t dataSize) override;
+
+    esp_err_t batch_set_string(const char *key, const char *str) override;
+
+    esp_err_t batch_commit() override;
+
+    esp_err_t batch_abort() override;
+
+    esp_err_t get_blob_range(const char *key, size_t offset, void* out_blob, size_t len) override;
+
+    esp_err_t blob_write_begin(const char *key) override;
+
+    esp_err_t blob_write_append(const void* data, size_t len) override;
+
+    esp_err_t blob_write_commit() override;
+
+    esp_err_t blob_write_abort() override;
+
     esp_err_t getItemDataSize(ItemType datatype, const char *key, size_t &dataSize);
 
     void debugDump();
@@ -67,6 +89,8 @@ public:
 
     esp_err_t calcEntriesInNamespace(size_t &usedEntries);
 
+    esp_err_t fillOpStats(nvs_namespace_op_stats_t &opStats);
+
     bool findEntry(nvs_opaque_iterator_t *it, const char *name);
 
     bool nextEntry(nvs_opaque_iterator_t *it);
@@ -74,6 +98,8 @@ public:
     const char *get_partition_name() const;
 
 private:
+    esp_err_t batch_stage(ItemType datatype, const char *key, const void *data, size_t dataSize);
+
     /**
      * The underlying storage's object.
      */
@@ -95,6 +121,21 @@ private:
      * Upon opening, a handle is valid. It becomes invalid if the underlying storage is de-initialized.
      */
     uint8_t valid;
+
+    /**
+     * Whether a write batch is open on this handle.
+     */
+    bool mBatchOpen;
+
+    /**
+     * Values staged in the open write batch.
+     */
+    Storage::TBatchList mBatch;
+
+    /**
+     * The open blob write, nullptr if there is none.
+     */
+    Storage::BlobWriter *mBlobWriter;
 };
 
 } // nvs
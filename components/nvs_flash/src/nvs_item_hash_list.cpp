@@ -21,9 +21,22 @@ HashList::HashList()
 {
 }
 
+void HashList::setItemIndex(ItemIndex* itemIndex, Page* page)
+{
+    mItemIndex = itemIndex;
+    mPage = page;
+}
+
 void HashList::clear()
 {
     for (auto it = mBlockList.begin(); it != mBlockList.end();) {
+        if (mItemIndex) {
+            for (size_t i = 0; i < it->mCount; ++i) {
+                if (it->mNodes[i].mIndex != 0xff) {
+                    mItemIndex->erase(it->mNodes[i].mHash, mPage, it->mNodes[i].mIndex);
+                }
+            }
+        }
         auto tmp = it;
         ++it;
         mBlockList.erase(tmp);
@@ -44,12 +57,19 @@ HashList::HashListBlock::HashListBlock()
 
 esp_err_t HashList::insert(const Item& item, size_t index)
 {
-    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    return insertHash(item.calculateCrc32WithoutValue() & 0xffffff, index);
+}
+
+esp_err_t HashList::insertHash(uint32_t hash_24, size_t index)
+{
     // add entry to the end of last block if possible
     if (mBlockList.size()) {
         auto& block = mBlockList.back();
         if (block.mCount < HashListBlock::ENTRY_COUNT) {
             block.mNodes[block.mCount++] = HashListNode(hash_24, index);
+            if (mItemIndex) {
+                mItemIndex->insert(hash_24, mPage, index);
+            }
             return ESP_OK;
         }
     }
@@ -62,6 +82,10 @@ esp_err_t HashList::insert(const Item& item, size_t index)
     newBlock->mNodes[0] = HashListNode(hash_24, index);
     newBlock->mCount++;
 
+    if (mItemIndex) {
+        mItemIndex->insert(hash_24, mPage, index);
+    }
+
     return ESP_OK;
 }
 
@@ -72,6 +96,9 @@ bool HashList::erase(size_t index)
         bool foundIndex = false;
         for (size_t i = 0; i < it->mCount; ++i) {
             if (it->mNodes[i].mIndex == index) {
+                if (mItemIndex) {
+                    mItemIndex->erase(it->mNodes[i].mHash, mPage, index);
+                }
                 it->mNodes[i].mIndex = 0xff;
                 foundIndex = true;
                 /* found the item and removed it */
@@ -119,5 +146,33 @@ size_t HashList::find(size_t start, const Item& item)
     return SIZE_MAX;
 }
 
+size_t HashList::save(uint32_t* dst, size_t maxCount)
+{
+    size_t count = 0;
+    for (auto it = mBlockList.begin(); it != mBlockList.end(); ++it) {
+        for (size_t index = 0; index < it->mCount; ++index) {
+            const HashListNode& e = it->mNodes[index];
+            if (e.mIndex == 0xff) {
+                continue;
+            }
+            if (count == maxCount) {
+                return count;
+            }
+            dst[count++] = (static_cast<uint32_t>(e.mIndex) << 24) | e.mHash;
+        }
+    }
+    return count;
+}
+
+esp_err_t HashList::restore(const uint32_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        auto err = insertHash(src[i] & 0xffffff, src[i] >> 24);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
 
 } // namespace nvs
@@ -11,27 +11,49 @@
 #include "nvs_types.hpp"
 #include "nvs_memory_management.hpp"
 #include "intrusive_list.h"
+#include "nvs_item_index.hpp"
 
 namespace nvs
 {
 
+class Page;
+
 class HashList
 {
 public:
     HashList();
     ~HashList();
 
+    /**
+     * Mirror all insertions and removals of this list into the partition-wide item index.
+     * The page is the one owning this list.
+     */
+    void setItemIndex(ItemIndex* itemIndex, Page* page);
+
     esp_err_t insert(const Item& item, size_t index);
     bool erase(const size_t index);
     size_t find(size_t start, const Item& item);
     void clear();
 
+    /**
+     * Stores the entries in list order as (index << 24 | hash) words, dst must have room for maxCount words.
+     * Returns the number of stored entries.
+     */
+    size_t save(uint32_t* dst, size_t maxCount);
+
+    /**
+     * Appends entries stored by save().
+     */
+    esp_err_t restore(const uint32_t* src, size_t count);
+
 private:
     HashList(const HashList& other);
     const HashList& operator= (const HashList& rhs);
 
 protected:
 
+    esp_err_t insertHash(uint32_t hash_24, size_t index);
+
     struct HashListNode {
         HashListNode() :
             mIndex(0xff), mHash(0)
@@ -59,6 +81,9 @@ protected:
 
     typedef intrusive_list<HashListBlock> TBlockList;
     TBlockList mBlockList;
+
+    ItemIndex* mItemIndex = nullptr;
+    Page* mPage = nullptr;
 }; // class HashList
 
 } // namespace nvs
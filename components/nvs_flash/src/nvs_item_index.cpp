@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <new>
+#include "nvs_item_index.hpp"
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    delete[] mNodes;
+}
+
+void ItemIndex::setEnabled(bool enabled)
+{
+    mEnabled = enabled;
+    clear();
+}
+
+void ItemIndex::clear()
+{
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mCount = 0;
+    mOverflow = false;
+}
+
+size_t ItemIndex::getByteSize() const
+{
+    return mCapacity * sizeof(Node);
+}
+
+esp_err_t ItemIndex::grow()
+{
+    size_t newCapacity = (mCapacity == 0) ? MIN_CAPACITY : mCapacity * 2;
+    Node* newNodes = new (std::nothrow) Node[newCapacity];
+    if (!newNodes) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    Node* oldNodes = mNodes;
+    size_t oldCapacity = mCapacity;
+    mNodes = newNodes;
+    mCapacity = newCapacity;
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldNodes[i].mPage == nullptr) {
+            continue;
+        }
+        size_t pos = home(oldNodes[i].mHash);
+        while (mNodes[pos].mPage != nullptr) {
+            pos = (pos + 1) & (mCapacity - 1);
+        }
+        mNodes[pos] = oldNodes[i];
+    }
+    delete[] oldNodes;
+    return ESP_OK;
+}
+
+void ItemIndex::insert(uint32_t hash, Page* page, size_t index)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    // keep the load factor below 3/4 so that probe sequences stay short
+    if ((mCount + 1) * 4 > mCapacity * 3) {
+        if (grow() != ESP_OK) {
+            // An incomplete index must not be used for lookups, drop it entirely.
+            clear();
+            mOverflow = true;
+            return;
+        }
+    }
+
+    size_t pos = home(hash);
+    while (mNodes[pos].mPage != nullptr) {
+        pos = (pos + 1) & (mCapacity - 1);
+    }
+    mNodes[pos].mPage = page;
+    mNodes[pos].mIndex = index;
+    mNodes[pos].mHash = hash;
+    ++mCount;
+}
+
+void ItemIndex::erase(uint32_t hash, const Page* page, size_t index)
+{
+    if (!isValid() || mCount == 0) {
+        return;
+    }
+
+    const size_t mask = mCapacity - 1;
+    size_t pos = home(hash);
+    while (true) {
+        Node& node = mNodes[pos];
+        if (node.mPage == nullptr) {
+            // item hasn't been present in the index
+            return;
+        }
+        if (node.mPage == page && node.mIndex == index && node.mHash == hash) {
+            break;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    // Backward shift deletion: move following nodes of the probe sequence into the gap,
+    // so that lookups never need tombstones.
+    size_t gap = pos;
+    size_t next = pos;
+    while (true) {
+        next = (next + 1) & mask;
+        if (mNodes[next].mPage == nullptr) {
+            break;
+        }
+        size_t nextHome = home(mNodes[next].mHash);
+        bool canMove = (gap <= next) ? (nextHome <= gap || nextHome > next)
+                                     : (nextHome <= gap && nextHome > next);
+        if (canMove) {
+            mNodes[gap] = mNodes[next];
+            gap = next;
+        }
+    }
+    mNodes[gap] = Node();
+    --mCount;
+}
+
+size_t ItemIndex::find(uint32_t hash, Page** pages, size_t maxPages) const
+{
+    if (!isValid() || mCount == 0) {
+        return 0;
+    }
+
+    size_t found = 0;
+    size_t pos = home(hash);
+    while (mNodes[pos].mPage != nullptr) {
+        const Node& node = mNodes[pos];
+        if (node.mHash == hash) {
+            bool known = false;
+            for (size_t i = 0; i < found && i < maxPages; ++i) {
+                if (pages[i] == node.mPage) {
+                    known = true;
+                    break;
+                }
+            }
+            if (!known) {
+                if (found < maxPages) {
+                    pages[found] = node.mPage;
+                }
+                ++found;
+            }
+        }
+        pos = (pos + 1) & (mCapacity - 1);
+    }
+    return found;
+}
+
+} // namespace nvs
@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_item_index_hpp
+#define nvs_item_index_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include "esp_err.h"
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Partition-wide index of all items stored in the pages of one Storage.
+ *
+ * The index maps the same 24-bit hash of namespace index, key and chunk index that is used by the per-page HashList
+ * to the page holding the item and its entry index within that page. It is kept in sync by the HashList of each page,
+ * so every insertion and removal done on page level (write, erase, copy during page reclamation, page erase) is
+ * mirrored here.
+ *
+ * The index is implemented as an open addressing hash table with linear probing which grows on demand.
+ * If memory for growing the table can't be allocated, the index marks itself as invalid and the Storage
+ * falls back to searching the pages one by one until the index is rebuilt on the next initialization.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    /**
+     * Enables or disables the index. Disabling it releases all memory. Enabling it starts with an empty, valid index.
+     */
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const
+    {
+        return mEnabled;
+    }
+
+    /**
+     * The index can be used for lookups only if it is enabled and no insertion failed since the last clear().
+     */
+    bool isValid() const
+    {
+        return mEnabled && !mOverflow;
+    }
+
+    void insert(uint32_t hash, Page* page, size_t index);
+
+    void erase(uint32_t hash, const Page* page, size_t index);
+
+    /**
+     * Collects the distinct pages which hold an item with the given hash.
+     *
+     * @return number of distinct pages found. If the return value is larger than maxPages,
+     *         only the first maxPages pages were stored in pages.
+     */
+    size_t find(uint32_t hash, Page** pages, size_t maxPages) const;
+
+    void clear();
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    /**
+     * Heap memory in bytes currently used by the index.
+     */
+    size_t getByteSize() const;
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+
+    struct Node {
+        Node() : mPage(nullptr), mIndex(0), mHash(0)
+        {
+        }
+
+        Page* mPage;
+        uint32_t mIndex : 8;
+        uint32_t mHash  : 24;
+    };
+
+    size_t home(uint32_t hash) const
+    {
+        return hash & (mCapacity - 1);
+    }
+
+    esp_err_t grow();
+
+    static const size_t MIN_CAPACITY = 64;
+
+    Node* mNodes = nullptr;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    bool mEnabled = false;
+    bool mOverflow = false;
+}; // class ItemIndex
+
+} // namespace nvs
+
+#endif /* nvs_item_index_hpp */
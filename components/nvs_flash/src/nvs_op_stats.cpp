@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <new>
+#include "nvs_op_stats.hpp"
+
+namespace nvs
+{
+
+OpStats::~OpStats()
+{
+    mNamespaces.clearAndFreeNodes();
+}
+
+nvs_namespace_op_stats_t* OpStats::getNamespaceStats(uint8_t nsIndex)
+{
+    for (auto it = mNamespaces.begin(); it != mNamespaces.end(); ++it) {
+        if (it->mNsIndex == nsIndex) {
+            return &it->mStats;
+        }
+    }
+
+    NamespaceNode* node = new (std::nothrow) NamespaceNode;
+    if (!node) {
+        return nullptr;
+    }
+    node->mNsIndex = nsIndex;
+    node->mStats = {};
+    mNamespaces.push_back(node);
+    return &node->mStats;
+}
+
+void OpStats::countValue(uint8_t nsIndex, size_t dataSize)
+{
+    mTotals.value_bytes += dataSize;
+    nvs_namespace_op_stats_t* stats = getNamespaceStats(nsIndex);
+    if (stats) {
+        stats->value_bytes += dataSize;
+    }
+}
+
+void OpStats::countItemWritten(uint8_t nsIndex, size_t span)
+{
+    ++mTotals.items_written;
+    mTotals.entries_written += span;
+    nvs_namespace_op_stats_t* stats = getNamespaceStats(nsIndex);
+    if (stats) {
+        ++stats->items_written;
+        stats->entries_written += span;
+    }
+}
+
+void OpStats::countItemRelocated(uint8_t nsIndex, size_t span)
+{
+    ++mTotals.items_relocated;
+    mTotals.entries_relocated += span;
+    nvs_namespace_op_stats_t* stats = getNamespaceStats(nsIndex);
+    if (stats) {
+        ++stats->items_relocated;
+        stats->entries_relocated += span;
+    }
+}
+
+void OpStats::fillNamespace(uint8_t nsIndex, nvs_namespace_op_stats_t& stats)
+{
+    stats = {};
+    for (auto it = mNamespaces.begin(); it != mNamespaces.end(); ++it) {
+        if (it->mNsIndex == nsIndex) {
+            stats = it->mStats;
+            return;
+        }
+    }
+}
+
+void OpStats::reset()
+{
+    mTotals = {};
+    mNamespaces.clearAndFreeNodes();
+}
+
+} // namespace nvs
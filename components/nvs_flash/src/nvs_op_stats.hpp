@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_op_stats_hpp
+#define nvs_op_stats_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include "nvs.h"
+#include "intrusive_list.h"
+#include "nvs_memory_management.hpp"
+
+namespace nvs
+{
+
+/**
+ * Counters of the logical NVS operations on a partition and of the flash operations they cause,
+ * see nvs_get_op_stats().
+ *
+ * The counters of values, items and relocations are also kept per namespace. The per-namespace counters are
+ * allocated when a namespace is counted for the first time; if that fails, only the totals are counted.
+ */
+class OpStats
+{
+public:
+    ~OpStats();
+
+    void countRead(size_t size)
+    {
+        ++mTotals.flash_read_ops;
+        mTotals.flash_read_bytes += size;
+    }
+
+    void countWrite(size_t size)
+    {
+        ++mTotals.flash_write_ops;
+        mTotals.flash_write_bytes += size;
+    }
+
+    void countErase(size_t size)
+    {
+        ++mTotals.flash_erase_ops;
+        mTotals.flash_erase_bytes += size;
+    }
+
+    void countPageErased()
+    {
+        ++mTotals.pages_erased;
+    }
+
+    void countCrc()
+    {
+        ++mTotals.crc_computations;
+    }
+
+    /**
+     * Counts a value passed to one of the write functions, no matter if it had to be written or not.
+     */
+    void countValue(uint8_t nsIndex, size_t dataSize);
+
+    /**
+     * Counts an item written to a page for a new value, span is the number of entries it occupies.
+     */
+    void countItemWritten(uint8_t nsIndex, size_t span);
+
+    /**
+     * Counts an item copied to another page while a page is reclaimed.
+     */
+    void countItemRelocated(uint8_t nsIndex, size_t span);
+
+    void fill(nvs_op_stats_t& stats) const
+    {
+        stats = mTotals;
+    }
+
+    /**
+     * Fills the counters of the given namespace, all zero if nothing was counted for it.
+     */
+    void fillNamespace(uint8_t nsIndex, nvs_namespace_op_stats_t& stats);
+
+    /**
+     * Sets all counters to zero.
+     */
+    void reset();
+
+protected:
+    struct NamespaceNode : public intrusive_list_node<NamespaceNode>, public ExceptionlessAllocatable {
+    public:
+        uint8_t mNsIndex;
+        nvs_namespace_op_stats_t mStats;
+    };
+
+    nvs_namespace_op_stats_t* getNamespaceStats(uint8_t nsIndex);
+
+    nvs_op_stats_t mTotals = {};
+    intrusive_list<NamespaceNode> mNamespaces;
+};
+
+} // namespace nvs
+
+#endif /* nvs_op_stats_hpp */
@@ -21,7 +21,13 @@ uint32_t Page::Header::calculateCrc32()
                     offsetof(Header, mCrc32) - offsetof(Header, mSeqNumber));
 }
 
-esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
+uint32_t Page::calculateHeaderCrc32(Header& header)
+{
+    countCrc();
+    return header.calculateCrc32();
+}
+
+esp_err_t Page::load(Partition *partition, uint32_t sectorNumber, ItemVisitor* visitor, bool deferEmptyCheck)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
@@ -31,6 +37,7 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     mBaseAddress = sectorNumber * SEC_SIZE;
     mUsedEntryCount = 0;
     mErasedEntryCount = 0;
+    mEmptyCheckPending = false;
 
     Header header;
     auto rc = mPartition->read_raw(mBaseAddress, &header, sizeof(header));
@@ -40,28 +47,14 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     }
     if (header.mState == PageState::UNINITIALIZED) {
         mState = header.mState;
-        // check if the whole page is really empty
-        // reading the whole page takes ~40 times less than erasing it
-        const int BLOCK_SIZE = 128;
-        uint32_t* block = new (std::nothrow) uint32_t[BLOCK_SIZE];
-
-        if (!block) return ESP_ERR_NO_MEM;
-
-        for (uint32_t i = 0; i < SPI_FLASH_SEC_SIZE; i += 4 * BLOCK_SIZE) {
-            rc = mPartition->read_raw(mBaseAddress + i, block, 4 * BLOCK_SIZE);
+        mEmptyCheckPending = true;
+        if (!deferEmptyCheck) {
+            rc = verifyEmpty();
             if (rc != ESP_OK) {
-                mState = PageState::INVALID;
-                delete[] block;
                 return rc;
             }
-            if (std::any_of(block, block + BLOCK_SIZE, [](uint32_t val) -> bool { return val != 0xffffffff; })) {
-                // page isn't as empty after all, mark it as corrupted
-                mState = PageState::CORRUPT;
-                break;
-            }
         }
-        delete[] block;
-    } else if (header.mCrc32 != header.calculateCrc32()) {
+    } else if (header.mCrc32 != calculateHeaderCrc32(header)) {
         header.mState = PageState::CORRUPT;
     } else {
         mState = header.mState;
@@ -80,7 +73,7 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     case PageState::FULL:
     case PageState::ACTIVE:
     case PageState::FREEING:
-        return mLoadEntryTable();
+        return mLoadEntryTable(visitor);
         break;
 
     default:
@@ -91,6 +84,143 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     return ESP_OK;
 }
 
+esp_err_t Page::verifyEmpty()
+{
+    if (!mEmptyCheckPending || mState != PageState::UNINITIALIZED) {
+        return ESP_OK;
+    }
+    mEmptyCheckPending = false;
+
+    // check if the whole page is really empty
+    // reading the whole page takes ~40 times less than erasing it
+    const int BLOCK_SIZE = 128;
+    uint32_t* block = new (std::nothrow) uint32_t[BLOCK_SIZE];
+
+    if (!block) return ESP_ERR_NO_MEM;
+
+    for (uint32_t i = 0; i < SPI_FLASH_SEC_SIZE; i += 4 * BLOCK_SIZE) {
+        auto rc = mPartition->read_raw(mBaseAddress + i, block, 4 * BLOCK_SIZE);
+        if (rc != ESP_OK) {
+            mState = PageState::INVALID;
+            delete[] block;
+            return rc;
+        }
+        if (std::any_of(block, block + BLOCK_SIZE, [](uint32_t val) -> bool { return val != 0xffffffff; })) {
+            // page isn't as empty after all, mark it as corrupted
+            mState = PageState::CORRUPT;
+            break;
+        }
+    }
+    delete[] block;
+    return ESP_OK;
+}
+
+static uint8_t snapshotEntry(size_t index)
+{
+    return (index == Page::INVALID_ENTRY) ? UINT8_MAX : static_cast<uint8_t>(index);
+}
+
+static size_t restoredEntry(uint8_t index)
+{
+    return (index == UINT8_MAX) ? Page::INVALID_ENTRY : index;
+}
+
+esp_err_t Page::takeSnapshot(Snapshot& snapshot, uint32_t* hashes)
+{
+    if (mState == PageState::INVALID || mState == PageState::FREEING) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    auto rc = mPartition->read_raw(mBaseAddress, snapshot.mRawHeader, sizeof(snapshot.mRawHeader));
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
+    snapshot.mFirstItemCrc32 = 0;
+    if ((mState == PageState::ACTIVE || mState == PageState::FULL) && mFirstUsedEntry != INVALID_ENTRY) {
+        Item item;
+        rc = readEntry(mFirstUsedEntry, item);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        snapshot.mFirstItemCrc32 = item.crc32;
+    }
+
+    snapshot.mState = static_cast<uint32_t>(mState);
+    snapshot.mSeqNumber = mSeqNumber;
+    snapshot.mUsedEntryCount = mUsedEntryCount;
+    snapshot.mErasedEntryCount = mErasedEntryCount;
+    snapshot.mVersion = mVersion;
+    snapshot.mFirstUsedEntry = snapshotEntry(mFirstUsedEntry);
+    snapshot.mNextFreeEntry = snapshotEntry(mNextFreeEntry);
+    snapshot.mHashCount = mHashList.save(hashes, ENTRY_COUNT);
+    return ESP_OK;
+}
+
+esp_err_t Page::loadSnapshot(Partition *partition, uint32_t sectorNumber, const Snapshot& snapshot, const uint32_t* hashes)
+{
+    if (partition == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mPartition = partition;
+    mBaseAddress = sectorNumber * SEC_SIZE;
+
+    uint8_t rawHeader[sizeof(snapshot.mRawHeader)];
+    auto rc = mPartition->read_raw(mBaseAddress, rawHeader, sizeof(rawHeader));
+    if (rc != ESP_OK) {
+        return rc;
+    }
+    if (memcmp(rawHeader, snapshot.mRawHeader, sizeof(rawHeader)) != 0) {
+        return ESP_ERR_NVS_CONTENT_DIFFERS;
+    }
+
+    const PageState state = static_cast<PageState>(snapshot.mState);
+    const size_t nextFreeEntry = restoredEntry(snapshot.mNextFreeEntry);
+    const size_t firstUsedEntry = restoredEntry(snapshot.mFirstUsedEntry);
+
+    // data written after the snapshot without altering the entry state table yet
+    if (state == PageState::ACTIVE && nextFreeEntry < ENTRY_COUNT) {
+        uint32_t entryAddress;
+        rc = getEntryAddress(nextFreeEntry, &entryAddress);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        uint32_t header;
+        rc = mPartition->read_raw(entryAddress, &header, sizeof(header));
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        if (header != 0xffffffff) {
+            return ESP_ERR_NVS_CONTENT_DIFFERS;
+        }
+    }
+
+    // the header and entry state table alone don't tell apart a partition which was erased and written again
+    if ((state == PageState::ACTIVE || state == PageState::FULL) && firstUsedEntry != INVALID_ENTRY) {
+        Item item;
+        rc = readEntry(firstUsedEntry, item);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        if (item.crc32 != snapshot.mFirstItemCrc32) {
+            return ESP_ERR_NVS_CONTENT_DIFFERS;
+        }
+    }
+
+    mState = state;
+    mSeqNumber = snapshot.mSeqNumber;
+    mVersion = snapshot.mVersion;
+    mUsedEntryCount = snapshot.mUsedEntryCount;
+    mErasedEntryCount = snapshot.mErasedEntryCount;
+    mFirstUsedEntry = firstUsedEntry;
+    mNextFreeEntry = nextFreeEntry;
+    mEmptyCheckPending = (state == PageState::UNINITIALIZED);
+    memcpy(mEntryTable.data(), rawHeader + ENTRY_TABLE_OFFSET, mEntryTable.byteSize());
+    mHashList.clear();
+    return mHashList.restore(hashes, snapshot.mHashCount);
+}
+
 esp_err_t Page::writeEntry(const Item& item)
 {
     uint32_t phyAddr;
@@ -207,6 +337,7 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
 
     if (!isVariableLengthType(datatype)) {
         memcpy(item.data, data, dataSize);
+        countCrc();
         item.crc32 = item.calculateCrc32();
         err = writeEntry(item);
         if (err != ESP_OK) {
@@ -214,9 +345,11 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
         }
     } else {
         const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+        countCrc();
         item.varLength.dataCrc32 = Item::calculateCrc32(src, dataSize);
         item.varLength.dataSize = dataSize;
         item.varLength.reserved = 0xffff;
+        countCrc();
         item.crc32 = item.calculateCrc32();
         err = writeEntry(item);
         if (err != ESP_OK) {
@@ -243,6 +376,72 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
         }
 
     }
+    mPartition->get_op_stats().countItemWritten(nsIndex, span);
+    return ESP_OK;
+}
+
+esp_err_t Page::writeItems(const Item* entries, size_t count)
+{
+    esp_err_t err;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    NVS_ASSERT_OR_RETURN(count > 0, ESP_ERR_INVALID_ARG);
+
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + count > ENTRY_COUNT) {
+        // page will not fit this amount of data
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    for (size_t i = 0; i < count; i += entries[i].span) {
+        NVS_ASSERT_OR_RETURN(entries[i].span > 0 && i + entries[i].span <= count, ESP_ERR_INVALID_ARG);
+        err = mHashList.insert(entries[i], mNextFreeEntry + i);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    uint32_t phyAddr;
+    err = getEntryAddress(mNextFreeEntry, &phyAddr);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = mPartition->write(phyAddr, entries, count * ENTRY_SIZE);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    // The entry states are written back to front, so if power goes off in between, the first entry of the run
+    // is still empty and load() will discard the whole run.
+    err = alterEntryRangeState(mNextFreeEntry, mNextFreeEntry + count, EntryState::WRITTEN);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        mFirstUsedEntry = mNextFreeEntry;
+    }
+    mUsedEntryCount += count;
+    mNextFreeEntry += count;
+
+    for (size_t i = 0; i < count; i += entries[i].span) {
+        mPartition->get_op_stats().countItemWritten(entries[i].nsIndex, entries[i].span);
+    }
     return ESP_OK;
 }
 
@@ -287,6 +486,7 @@ esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, vo
         left -= willCopy;
         dst += willCopy;
     }
+    countCrc();
     if (Item::calculateCrc32(reinterpret_cast<uint8_t*>(data), item.varLength.dataSize) != item.varLength.dataCrc32) {
         rc = eraseEntryAndSpan(index);
         if (rc != ESP_OK) {
@@ -297,6 +497,61 @@ esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, vo
     return ESP_OK;
 }
 
+esp_err_t Page::readItemRange(uint8_t nsIndex, ItemType datatype, const char* key, size_t offset, void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    size_t index = 0;
+    Item item;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (!isVariableLengthType(datatype)) {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+
+    esp_err_t rc = findItem(nsIndex, datatype, key, index, item, chunkIdx, chunkStart);
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
+    size_t itemSize = item.varLength.dataSize;
+    if (offset > itemSize || dataSize > itemSize - offset) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    uint8_t* dst = reinterpret_cast<uint8_t*>(data);
+    uint32_t crc32 = 0xffffffff;
+    size_t pos = 0;
+    for (size_t i = index + 1; i < index + item.span; ++i) {
+        Item ditem;
+        rc = readEntry(i, ditem);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        size_t willCopy = ENTRY_SIZE;
+        willCopy = (itemSize - pos < willCopy) ? itemSize - pos : willCopy;
+        crc32 = esp_rom_crc32_le(crc32, ditem.rawData, willCopy);
+
+        // copy the part of this entry which overlaps with [offset, offset + dataSize)
+        size_t begin = (offset > pos) ? offset : pos;
+        size_t end = (offset + dataSize < pos + willCopy) ? offset + dataSize : pos + willCopy;
+        if (begin < end) {
+            memcpy(dst + (begin - offset), ditem.rawData + (begin - pos), end - begin);
+        }
+        pos += willCopy;
+    }
+    countCrc();
+    if (crc32 != item.varLength.dataCrc32) {
+        rc = eraseEntryAndSpan(index);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -342,6 +597,7 @@ esp_err_t Page::cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, con
         left -= willCopy;
         dst += willCopy;
     }
+    countCrc();
     if (Item::calculateCrc32(reinterpret_cast<const uint8_t*>(data), item.varLength.dataSize) != item.varLength.dataCrc32) {
         return ESP_ERR_NVS_NOT_FOUND;
     }
@@ -385,6 +641,7 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
         if (rc != ESP_OK) {
             return rc;
         }
+        countCrc();
         if (item.calculateCrc32() != item.crc32) {
             mHashList.erase(index);
             rc = alterEntryState(index, EntryState::ERASED);
@@ -436,6 +693,51 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
     return ESP_OK;
 }
 
+esp_err_t Page::eraseEntryRange(size_t begin, size_t end)
+{
+    NVS_ASSERT_OR_RETURN(end <= ENTRY_COUNT, ESP_FAIL);
+    NVS_ASSERT_OR_RETURN(end > begin, ESP_FAIL);
+
+    EntryState state;
+    esp_err_t err;
+    size_t span;
+    for (size_t i = begin; i < end; i += span) {
+        span = 1;
+        err = mEntryTable.get(i, &state);
+        if (err != ESP_OK) {
+            return err;
+        }
+        NVS_ASSERT_OR_RETURN(state == EntryState::WRITTEN, ESP_FAIL);
+
+        Item item;
+        err = readEntry(i, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        countCrc();
+        if (item.calculateCrc32() == item.crc32) {
+            span = item.span;
+        }
+        NVS_ASSERT_OR_RETURN(span > 0 && i + span <= end, ESP_FAIL);
+        mHashList.erase(i);
+    }
+
+    err = alterEntryRangeState(begin, end, EntryState::ERASED);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mUsedEntryCount -= end - begin;
+    mErasedEntryCount += end - begin;
+
+    if (begin == mFirstUsedEntry) {
+        err = updateFirstUsedEntry(begin, end - begin);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::updateFirstUsedEntry(size_t index, size_t span)
 {
     NVS_ASSERT_OR_RETURN(index == mFirstUsedEntry, ESP_FAIL);
@@ -501,6 +803,7 @@ esp_err_t Page::copyItems(Page& other)
         if (err != ESP_OK) {
             return err;
         }
+        uint8_t nsIndex = entry.nsIndex;
         size_t span = entry.span;
         size_t end = readEntryIndex + span;
 
@@ -513,13 +816,14 @@ esp_err_t Page::copyItems(Page& other)
                 return err;
             }
         }
+        mPartition->get_op_stats().countItemRelocated(nsIndex, span);
         readEntryIndex = end;
 
     }
     return ESP_OK;
 }
 
-esp_err_t Page::mLoadEntryTable()
+esp_err_t Page::mLoadEntryTable(ItemVisitor* visitor)
 {
     // for states where we actually care about data in the page, read entry state table
     if (mState == PageState::ACTIVE ||
@@ -641,6 +945,7 @@ esp_err_t Page::mLoadEntryTable()
                 return err;
             }
 
+            countCrc();
             if (item.crc32 != item.calculateCrc32()) {
                 err = eraseEntryAndSpan(i);
                 if (err != ESP_OK) {
@@ -679,6 +984,13 @@ esp_err_t Page::mLoadEntryTable()
                 }
             }
 
+            if (visitor) {
+                err = visitor->visit(item);
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+
             /* Note that logic for duplicate detections works fine even
              * when old-format blob is present along with new-format blob-index
              * for same key on active page. Since datatype is not used in hash calculation,
@@ -721,6 +1033,7 @@ esp_err_t Page::mLoadEntryTable()
                 return err;
             }
 
+            countCrc();
             if (item.crc32 != item.calculateCrc32()) {
                 err = eraseEntryAndSpan(i);
                 if (err != ESP_OK) {
@@ -739,6 +1052,7 @@ esp_err_t Page::mLoadEntryTable()
             }
 
             size_t span = item.span;
+            bool complete = true;
 
             if (isVariableLengthType(item.datatype)) {
                 for (size_t j = i + 1; j < i + span; ++j) {
@@ -748,11 +1062,19 @@ esp_err_t Page::mLoadEntryTable()
                     }
                     if (state != EntryState::WRITTEN) {
                         eraseEntryAndSpan(i);
+                        complete = false;
                         break;
                     }
                 }
             }
 
+            if (complete && visitor) {
+                err = visitor->visit(item);
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+
             i += span - 1;
         }
 
@@ -770,7 +1092,7 @@ esp_err_t Page::initialize()
     header.mState = mState;
     header.mSeqNumber = mSeqNumber;
     header.mVersion = mVersion;
-    header.mCrc32 = header.calculateCrc32();
+    header.mCrc32 = calculateHeaderCrc32(header);
 
     auto rc = mPartition->write_raw(mBaseAddress, &header, sizeof(header));
     if (rc != ESP_OK) {
@@ -906,6 +1228,7 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, si
             return rc;
         }
 
+        countCrc();
         auto crc32 = item.calculateCrc32();
         if (item.crc32 != crc32) {
             rc = eraseEntryAndSpan(i);
@@ -998,11 +1321,13 @@ esp_err_t Page::erase()
         mState = PageState::INVALID;
         return rc;
     }
+    mPartition->get_op_stats().countPageErased();
     mUsedEntryCount = 0;
     mErasedEntryCount = 0;
     mFirstUsedEntry = INVALID_ENTRY;
     mNextFreeEntry = INVALID_ENTRY;
     mState = PageState::UNINITIALIZED;
+    mEmptyCheckPending = false;
     mHashList.clear();
     return ESP_OK;
 }
@@ -1034,6 +1359,16 @@ size_t Page::getVarDataTailroom() const
     return ((mNextFreeEntry < (ENTRY_COUNT-1)) ? ((ENTRY_COUNT - mNextFreeEntry - 1) * ENTRY_SIZE): 0);
 }
 
+size_t Page::getFreeEntryCount() const
+{
+    if (mState == PageState::UNINITIALIZED) {
+        return ENTRY_COUNT;
+    } else if (mState != PageState::ACTIVE || mNextFreeEntry >= ENTRY_COUNT) {
+        return 0;
+    }
+    return ENTRY_COUNT - mNextFreeEntry;
+}
+
 const char* Page::pageStateToName(PageState ps)
 {
     switch (ps) {
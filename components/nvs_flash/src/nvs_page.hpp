@@ -71,6 +71,17 @@ public:
         INVALID       = 0
     };
 
+    /**
+     * Receives the valid items of a page while it is loaded, see load().
+     */
+    class ItemVisitor
+    {
+    public:
+        virtual ~ItemVisitor() {}
+
+        virtual esp_err_t visit(const Item& item) = 0;
+    };
+
     Page();
 
     PageState state() const
@@ -78,7 +89,47 @@ public:
         return mState;
     }
 
-    esp_err_t load(Partition *partition, uint32_t sectorNumber);
+    /**
+     * Loads the page from flash. If a visitor is given, it is called for every valid item while the entry table
+     * is checked. Items of an active page may still be erased as duplicates after they have been visited.
+     * If deferEmptyCheck is set, an uninitialized page isn't checked for stray data until verifyEmpty() is called.
+     */
+    esp_err_t load(Partition *partition, uint32_t sectorNumber, ItemVisitor* visitor = nullptr, bool deferEmptyCheck = false);
+
+    /**
+     * Checks that an uninitialized page whose check was deferred by load() is really empty,
+     * otherwise the page is marked as corrupt.
+     */
+    esp_err_t verifyEmpty();
+
+    /**
+     * State of a loaded page as stored in an index checkpoint, see Storage::saveCheckpoint().
+     * The page header and the entry state table are kept as found in flash, so that any change of the page since
+     * the snapshot was taken is detected.
+     */
+    struct Snapshot {
+        uint8_t mRawHeader[64];
+        uint32_t mState;
+        uint32_t mSeqNumber;
+        uint32_t mFirstItemCrc32;
+        uint16_t mUsedEntryCount;
+        uint16_t mErasedEntryCount;
+        uint8_t mVersion;
+        uint8_t mFirstUsedEntry;
+        uint8_t mNextFreeEntry;
+        uint8_t mHashCount;
+    };
+
+    /**
+     * Fills the snapshot of the page, hashes must have room for ENTRY_COUNT hash list entries.
+     */
+    esp_err_t takeSnapshot(Snapshot& snapshot, uint32_t* hashes);
+
+    /**
+     * Restores the page from a snapshot instead of loading it. Returns ESP_ERR_NVS_CONTENT_DIFFERS if the page
+     * in flash doesn't match the snapshot, in which case the page has to be loaded with load().
+     */
+    esp_err_t loadSnapshot(Partition *partition, uint32_t sectorNumber, const Snapshot& snapshot, const uint32_t* hashes);
 
     esp_err_t getSeqNumber(uint32_t& seqNumber) const;
 
@@ -90,6 +141,12 @@ public:
 
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Reads dataSize bytes starting at offset of a variable length item. The whole item is still read from flash
+     * to verify its checksum, but only the requested range is copied to data.
+     */
+    esp_err_t readItemRange(uint8_t nsIndex, ItemType datatype, const char* key, size_t offset, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
+
     esp_err_t cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
@@ -133,6 +190,12 @@ public:
     }
     size_t getVarDataTailroom() const ;
 
+    size_t getFreeEntryCount() const;
+
+    esp_err_t writeItems(const Item* entries, size_t count);
+
+    esp_err_t eraseEntryRange(size_t begin, size_t end);
+
     esp_err_t markFull();
 
     esp_err_t markFreeing();
@@ -145,6 +208,11 @@ public:
 
     esp_err_t calcEntries(nvs_stats_t &nvsStats);
 
+    void setItemIndex(ItemIndex* itemIndex)
+    {
+        mHashList.setItemIndex(itemIndex, this);
+    }
+
 protected:
 
     class Header
@@ -172,7 +240,7 @@ protected:
         INVALID = 0x4 // entry is in inconsistent state (write started but ESB_WRITTEN has not been set yet)
     };
 
-    esp_err_t mLoadEntryTable();
+    esp_err_t mLoadEntryTable(ItemVisitor* visitor);
 
     esp_err_t initialize();
 
@@ -192,6 +260,16 @@ protected:
 
     esp_err_t updateFirstUsedEntry(size_t index, size_t span);
 
+    /**
+     * Counts a checksum computation in the operation counters of the partition.
+     */
+    void countCrc()
+    {
+        mPartition->get_op_stats().countCrc();
+    }
+
+    uint32_t calculateHeaderCrc32(Header& header);
+
     static constexpr size_t getAlignmentForType(ItemType type)
     {
         return static_cast<uint8_t>(type) & 0x0f;
@@ -218,6 +296,7 @@ protected:
     size_t mFirstUsedEntry = INVALID_ENTRY;
     uint16_t mUsedEntryCount = 0;
     uint16_t mErasedEntryCount = 0;
+    bool mEmptyCheckPending = false;
 
     /**
      * This hash list stores hashes of namespace index, key, and ChunkIndex for quick lookup when searching items.
@@ -233,6 +312,7 @@ protected:
     static_assert(sizeof(Header) == 32, "header size must be 32 bytes");
     static_assert(ENTRY_TABLE_OFFSET % 32 == 0, "entry table offset should be aligned");
     static_assert(ENTRY_DATA_OFFSET % 32 == 0, "entry data offset should be aligned");
+    static_assert(sizeof(Snapshot::mRawHeader) == ENTRY_DATA_OFFSET, "snapshot must contain header and entry table");
 
 }; // class Page
 
@@ -7,7 +7,8 @@
 
 namespace nvs
 {
-esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t sectorCount)
+esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t sectorCount, ItemIndex* index,
+        Page::ItemVisitor* visitor)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
@@ -22,24 +23,12 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     if (!mPages) return ESP_ERR_NO_MEM;
 
     for (uint32_t i = 0; i < sectorCount; ++i) {
-        auto err = mPages[i].load(partition, baseSector + i);
+        mPages[i].setItemIndex(index);
+        auto err = mPages[i].load(partition, baseSector + i, visitor, mLazyLoad);
         if (err != ESP_OK) {
             return err;
         }
-        uint32_t seqNumber;
-        if (mPages[i].getSeqNumber(seqNumber) != ESP_OK) {
-            mFreePageList.push_back(&mPages[i]);
-        } else {
-            auto pos = std::find_if(std::begin(mPageList), std::end(mPageList), [=](const Page& page) -> bool {
-                uint32_t otherSeqNumber;
-                return page.getSeqNumber(otherSeqNumber) == ESP_OK && otherSeqNumber > seqNumber;
-            });
-            if (pos == mPageList.end()) {
-                mPageList.push_back(&mPages[i]);
-            } else {
-                mPageList.insert(pos, &mPages[i]);
-            }
-        }
+        addLoadedPage(&mPages[i]);
     }
 
     if (mPageList.empty()) {
@@ -55,20 +44,28 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     }
 
     // if power went out after a new item for the given key was written,
-    // but before the old one was erased, we end up with a duplicate item
+    // but before the old one was erased, we end up with a duplicate item.
+    // A single write can only leave its last item duplicated. A write batch (see Storage::writeBatch) orders
+    // its items so that the ones whose old versions still have to be erased are at the end of the last page,
+    // hence walk back from the last item until an item without an older duplicate is found.
     Page& lastPage = back();
-    size_t lastItemIndex = SIZE_MAX;
+    uint8_t itemIndices[Page::ENTRY_COUNT];
+    size_t itemCount = 0;
     Item item;
     size_t itemIndex = 0;
     while (lastPage.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
+        itemIndices[itemCount++] = itemIndex;
         itemIndex += item.span;
-        lastItemIndex = itemIndex;
     }
 
-    if (lastItemIndex != SIZE_MAX) {
-        auto last = PageManager::TPageListIterator(&lastPage);
-        TPageListIterator it;
+    auto last = PageManager::TPageListIterator(&lastPage);
+    while (itemCount > 0) {
+        itemIndex = itemIndices[--itemCount];
+        if (lastPage.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) != ESP_OK) {
+            break;
+        }
 
+        TPageListIterator it;
         for (it = begin(); it != last; ++it) {
 
             if ((it->state() != Page::PageState::FREEING) &&
@@ -76,7 +73,10 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
                 break;
             }
         }
-        if ((it == last) && (item.datatype == ItemType::BLOB_IDX)) {
+        if (it != last) {
+            continue;
+        }
+        if (item.datatype == ItemType::BLOB_IDX) {
             /* Rare case in which the blob was stored using old format, but power went just after writing
              * blob index during modification. Loop again and delete the old version blob*/
             for (it = begin(); it != last; ++it) {
@@ -87,6 +87,7 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
                 }
             }
         }
+        break;
     }
 
     // check if power went out while page was being freed
@@ -132,33 +133,149 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     return ESP_OK;
 }
 
-esp_err_t PageManager::requestNewPage()
+void PageManager::addLoadedPage(Page* page)
+{
+    uint32_t seqNumber;
+    if (page->getSeqNumber(seqNumber) != ESP_OK) {
+        mFreePageList.push_back(page);
+    } else {
+        auto pos = std::find_if(std::begin(mPageList), std::end(mPageList), [=](const Page& page) -> bool {
+            uint32_t otherSeqNumber;
+            return page.getSeqNumber(otherSeqNumber) == ESP_OK && otherSeqNumber > seqNumber;
+        });
+        if (pos == mPageList.end()) {
+            mPageList.push_back(page);
+        } else {
+            mPageList.insert(pos, page);
+        }
+    }
+}
+
+esp_err_t PageManager::loadSnapshots(Partition *partition, uint32_t baseSector, uint32_t sectorCount,
+        CheckpointReader& reader, ItemIndex* index)
 {
+    if (partition == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mBaseSector = baseSector;
+    mPageCount = sectorCount;
+    mPageList.clear();
+    mFreePageList.clear();
+    mPages.reset(new (nothrow) Page[sectorCount]);
+
+    if (!mPages) return ESP_ERR_NO_MEM;
+
+    std::unique_ptr<uint32_t[]> hashes(new (nothrow) uint32_t[Page::ENTRY_COUNT]);
+
+    if (!hashes) return ESP_ERR_NO_MEM;
+
+    for (uint32_t i = 0; i < sectorCount; ++i) {
+        Page::Snapshot snapshot;
+        auto err = reader.read(&snapshot, sizeof(snapshot));
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (snapshot.mHashCount > Page::ENTRY_COUNT) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        err = reader.read(hashes.get(), snapshot.mHashCount * sizeof(uint32_t));
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        mPages[i].setItemIndex(index);
+        err = mPages[i].loadSnapshot(partition, baseSector + i, snapshot, hashes.get());
+        if (err != ESP_OK) {
+            return err;
+        }
+        addLoadedPage(&mPages[i]);
+    }
+
+    // a snapshot is only taken of a consistent state, so there is nothing to recover
+    if (mPageList.empty()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    uint32_t lastSeqNo;
+    auto err = mPageList.back().getSeqNumber(lastSeqNo);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mSeqNumber = lastSeqNo + 1;
+
     if (mFreePageList.empty()) {
-        return ESP_ERR_NVS_INVALID_STATE;
+        return ESP_ERR_NVS_NO_FREE_PAGES;
     }
+    return ESP_OK;
+}
 
-    // do we have at least two free pages? in that case no erasing is required
-    if (mFreePageList.size() >= 2) {
-        return activatePage();
+esp_err_t PageManager::saveSnapshots(CheckpointWriter& writer)
+{
+    std::unique_ptr<uint32_t[]> hashes(new (nothrow) uint32_t[Page::ENTRY_COUNT]);
+
+    if (!hashes) return ESP_ERR_NO_MEM;
+
+    for (uint32_t i = 0; i < mPageCount; ++i) {
+        Page::Snapshot snapshot;
+        auto err = mPages[i].takeSnapshot(snapshot, hashes.get());
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = writer.write(&snapshot, sizeof(snapshot));
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = writer.write(hashes.get(), snapshot.mHashCount * sizeof(uint32_t));
+        if (err != ESP_OK) {
+            return err;
+        }
     }
+    return ESP_OK;
+}
+
+PageManager::TPageListIterator PageManager::selectReclaimPage(const Page* skipPage)
+{
+    TPageListIterator selected = end();
+    size_t selectedUnused = 0;
+    size_t selectedUsed = 0;
+    uint64_t selectedAge = 0;
 
-    // find the page with the higest number of erased items
-    TPageListIterator maxUnusedItemsPageIt;
-    size_t maxUnusedItems = 0;
     for (auto it = begin(); it != end(); ++it) {
+        size_t used = it->getUsedEntryCount();
+        size_t unused = Page::ENTRY_COUNT - used;
+        if (unused == 0 || it == skipPage) {
+            continue;
+        }
 
-        auto unused =  Page::ENTRY_COUNT - it->getUsedEntryCount();
-        if (unused > maxUnusedItems) {
-            maxUnusedItemsPageIt = it;
-            maxUnusedItems = unused;
+        if (mReclaimPolicy == ReclaimPolicy::GREEDY) {
+            // find the page with the higest number of erased items
+            if (unused > selectedUnused) {
+                selected = it;
+                selectedUnused = unused;
+            }
+            continue;
         }
-    }
 
-    if (maxUnusedItems == 0) {
-        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        // cost-benefit: unused * age / (ENTRY_COUNT + used), where copying the used entries costs reading and
+        // writing them. The age is the number of pages activated since the page was, compared by cross-multiplying.
+        uint32_t seqNumber;
+        if (it->getSeqNumber(seqNumber) != ESP_OK) {
+            continue;
+        }
+        uint64_t age = mSeqNumber - seqNumber + 1;
+        if (selected == end() ||
+                unused * age * (Page::ENTRY_COUNT + selectedUsed) > selectedUnused * selectedAge * (Page::ENTRY_COUNT + used)) {
+            selected = it;
+            selectedUnused = unused;
+            selectedUsed = used;
+            selectedAge = age;
+        }
     }
+    return selected;
+}
 
+esp_err_t PageManager::reclaimPage(TPageListIterator reclaimPageIt)
+{
     esp_err_t err = activatePage();
     if (err != ESP_OK) {
         return err;
@@ -166,7 +283,7 @@ esp_err_t PageManager::requestNewPage()
 
     Page* newPage = &mPageList.back();
 
-    Page* erasedPage = maxUnusedItemsPageIt;
+    Page* erasedPage = reclaimPageIt;
 
 #ifndef NDEBUG
     size_t usedEntries = erasedPage->getUsedEntryCount();
@@ -189,20 +306,66 @@ esp_err_t PageManager::requestNewPage()
     NVS_ASSERT_OR_RETURN(usedEntries == newPage->getUsedEntryCount(), ESP_FAIL);
 #endif
 
-    mPageList.erase(maxUnusedItemsPageIt);
+    mPageList.erase(reclaimPageIt);
     mFreePageList.push_back(erasedPage);
 
     return ESP_OK;
 }
 
+esp_err_t PageManager::requestNewPage()
+{
+    if (mFreePageList.empty()) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    // do we have at least two free pages? in that case no erasing is required
+    if (mFreePageList.size() >= 2) {
+        return activatePage();
+    }
+
+    TPageListIterator reclaimPageIt = selectReclaimPage();
+
+    if (reclaimPageIt == end()) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    esp_err_t err = reclaimPage(reclaimPageIt);
+    if (err != ESP_OK || mReclaimPolicy != ReclaimPolicy::HOT_COLD) {
+        return err;
+    }
+
+    // Items which survived until their page was reclaimed are likely to stay unchanged (cold), while newly
+    // written items are often rewritten soon (hot). If the copied items (almost) fill the new page, close it
+    // and reclaim one more page, so that new items aren't mixed with the cold ones and the cold ones don't
+    // have to be copied again each time the hot ones are reclaimed.
+    // Only done if the next page to reclaim has fewer items, otherwise all pages would be reclaimed in turn.
+    Page* coldPage = &mPageList.back();
+    if (coldPage->getUsedEntryCount() < HOT_COLD_SEAL_ENTRY_COUNT) {
+        return ESP_OK;
+    }
+    reclaimPageIt = selectReclaimPage(coldPage);
+    if (reclaimPageIt == end() || reclaimPageIt->getUsedEntryCount() >= HOT_COLD_SEAL_ENTRY_COUNT) {
+        return ESP_OK;
+    }
+    err = coldPage->markFull();
+    if (err != ESP_OK) {
+        return err;
+    }
+    return reclaimPage(reclaimPageIt);
+}
+
 esp_err_t PageManager::activatePage()
 {
     if (mFreePageList.empty()) {
         return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
     }
     Page* p = &mFreePageList.front();
+    auto err = p->verifyEmpty();
+    if (err != ESP_OK) {
+        return err;
+    }
     if (p->state() == Page::PageState::CORRUPT) {
-        auto err = p->erase();
+        err = p->erase();
         if (err != ESP_OK) {
             return err;
         }
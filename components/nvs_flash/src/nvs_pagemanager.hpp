@@ -16,8 +16,10 @@
 
 #include <memory>
 #include <list>
+#include "sdkconfig.h"
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
+#include "nvs_checkpoint.hpp"
 #include "partition.hpp"
 #include "intrusive_list.h"
 
@@ -29,9 +31,69 @@ class PageManager
     using TPageListIterator = TPageList::iterator;
 public:
 
+#ifdef CONFIG_NVS_LAZY_PAGE_LOAD
+    static const bool LAZY_LOAD_DEFAULT = true;
+#else
+    static const bool LAZY_LOAD_DEFAULT = false;
+#endif
+
+    /**
+     * How requestNewPage() chooses the page to reclaim once the partition runs out of free pages.
+     */
+    enum class ReclaimPolicy : uint8_t {
+        /** The page with the most unused entries, i.e. the one with the fewest items to copy. */
+        GREEDY,
+        /** Weighs the unused entries of a page against the cost of copying its items and prefers old pages,
+         * whose remaining items are unlikely to be rewritten soon. */
+        COST_BENEFIT,
+        /** Like COST_BENEFIT, but keeps the items copied by reclamation apart from newly written ones,
+         * see requestNewPage(). */
+        HOT_COLD,
+    };
+
+#if defined(CONFIG_NVS_RECLAIM_HOT_COLD)
+    static const ReclaimPolicy RECLAIM_POLICY_DEFAULT = ReclaimPolicy::HOT_COLD;
+#elif defined(CONFIG_NVS_RECLAIM_COST_BENEFIT)
+    static const ReclaimPolicy RECLAIM_POLICY_DEFAULT = ReclaimPolicy::COST_BENEFIT;
+#else
+    static const ReclaimPolicy RECLAIM_POLICY_DEFAULT = ReclaimPolicy::GREEDY;
+#endif
+
     PageManager() {}
 
-    esp_err_t load(Partition *partition, uint32_t baseSector, uint32_t sectorCount);
+    /**
+     * Loads all pages of the partition. The visitor, if any, is passed on to Page::load() for each page.
+     */
+    esp_err_t load(Partition *partition, uint32_t baseSector, uint32_t sectorCount, ItemIndex* index = nullptr,
+            Page::ItemVisitor* visitor = nullptr);
+
+    /**
+     * Restores all pages from the snapshots in an index checkpoint instead of loading them, see Page::loadSnapshot().
+     * Fails if any page has changed since the checkpoint was saved, load() has to be used then.
+     */
+    esp_err_t loadSnapshots(Partition *partition, uint32_t baseSector, uint32_t sectorCount,
+            CheckpointReader& reader, ItemIndex* index = nullptr);
+
+    esp_err_t saveSnapshots(CheckpointWriter& writer);
+
+    /**
+     * In lazy mode, load() doesn't check that uninitialized pages are empty,
+     * the check is done when a page is activated instead.
+     */
+    void setLazyLoad(bool lazy)
+    {
+        mLazyLoad = lazy;
+    }
+
+    void setReclaimPolicy(ReclaimPolicy policy)
+    {
+        mReclaimPolicy = policy;
+    }
+
+    ReclaimPolicy getReclaimPolicy() const
+    {
+        return mReclaimPolicy;
+    }
 
     TPageListIterator begin()
     {
@@ -66,12 +128,31 @@ protected:
 
     esp_err_t activatePage();
 
+    /**
+     * Returns the page to reclaim according to the reclamation policy, end() if no page has unused entries.
+     */
+    TPageListIterator selectReclaimPage(const Page* skipPage = nullptr);
+
+    /**
+     * Activates a free page, copies the items of the given page to it and erases the given page.
+     */
+    esp_err_t reclaimPage(TPageListIterator reclaimPageIt);
+
+    void addLoadedPage(Page* page);
+
+    /**
+     * Number of entries copied by reclamation from which HOT_COLD closes the receiving page.
+     */
+    static const size_t HOT_COLD_SEAL_ENTRY_COUNT = Page::ENTRY_COUNT * 15 / 16;
+
     TPageList mPageList;
     TPageList mFreePageList;
     std::unique_ptr<Page[]> mPages;
     uint32_t mBaseSector;
     uint32_t mPageCount;
     uint32_t mSeqNumber;
+    bool mLazyLoad = LAZY_LOAD_DEFAULT;
+    ReclaimPolicy mReclaimPolicy = RECLAIM_POLICY_DEFAULT;
 }; // class PageManager
 
 
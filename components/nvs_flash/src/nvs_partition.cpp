@@ -33,6 +33,7 @@ const char *NVSPartition::get_partition_name()
 
 esp_err_t NVSPartition::read_raw(size_t src_offset, void* dst, size_t size)
 {
+    mOpStats.countRead(size);
     return esp_partition_read_raw(mESPPartition, src_offset, dst, size);
 }
 
@@ -42,11 +43,13 @@ esp_err_t NVSPartition::read(size_t src_offset, void* dst, size_t size)
         return ESP_ERR_INVALID_ARG;
     }
 
+    mOpStats.countRead(size);
     return esp_partition_read(mESPPartition, src_offset, dst, size);
 }
 
 esp_err_t NVSPartition::write_raw(size_t dst_offset, const void* src, size_t size)
 {
+    mOpStats.countWrite(size);
     return esp_partition_write_raw(mESPPartition, dst_offset, src, size);
 }
 
@@ -56,11 +59,13 @@ esp_err_t NVSPartition::write(size_t dst_offset, const void* src, size_t size)
         return ESP_ERR_INVALID_ARG;
     }
 
+    mOpStats.countWrite(size);
     return esp_partition_write(mESPPartition, dst_offset, src, size);
 }
 
 esp_err_t NVSPartition::erase_range(size_t dst_offset, size_t size)
 {
+    mOpStats.countErase(size);
     return esp_partition_erase_range(mESPPartition, dst_offset, size);
 }
 
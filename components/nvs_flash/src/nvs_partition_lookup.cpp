@@ -1,3 +1,4 @@
+#include <cstring>
 #include "esp_partition.h"
 #include "nvs_partition_lookup.hpp"
 
@@ -32,6 +33,34 @@ esp_err_t lookup_nvs_partition(const char* label, NVSPartition **p)
     return ESP_OK;
 }
 
+esp_err_t lookup_checkpoint_partition(const char* label, NVSPartition **p)
+{
+    static const char SUFFIX[] = "_ckpt";
+    char checkpoint_label[NVS_PART_NAME_MAX_SIZE + 1];
+
+    if (strlen(label) + sizeof(SUFFIX) > sizeof(checkpoint_label)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    strcpy(checkpoint_label, label);
+    strcat(checkpoint_label, SUFFIX);
+
+    const esp_partition_t* esp_partition = esp_partition_find_first(
+            ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, checkpoint_label);
+
+    if (esp_partition == nullptr) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    NVSPartition *partition = new (std::nothrow) NVSPartition(esp_partition);
+    if (partition == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    *p = partition;
+
+    return ESP_OK;
+}
+
 #ifndef LINUX_TARGET
 esp_err_t lookup_nvs_encrypted_partition(const char* label, nvs_sec_cfg_t* cfg, NVSPartition **p)
 {
@@ -13,6 +13,11 @@ esp_err_t lookup_nvs_partition(const char* label, NVSPartition **p);
 
 esp_err_t lookup_nvs_encrypted_partition(const char* label, nvs_sec_cfg_t* cfg, NVSPartition **p);
 
+/**
+ * Looks up the data partition labelled "<label>_ckpt" which holds the index checkpoint of the NVS partition.
+ */
+esp_err_t lookup_checkpoint_partition(const char* label, NVSPartition **p);
+
 } // partition_lookup
 
 } // nvs
@@ -43,6 +43,7 @@ esp_err_t NVSPartitionManager::init_partition(const char *partition_label)
     NVS_ASSERT_OR_RETURN(SPI_FLASH_SEC_SIZE != 0, ESP_FAIL);
 
     NVSPartition *p = nullptr;
+    NVSPartition *checkpoint = nullptr;
     esp_err_t result = partition_lookup::lookup_nvs_partition(partition_label, &p);
 
     if (result != ESP_OK) {
@@ -51,22 +52,33 @@ esp_err_t NVSPartitionManager::init_partition(const char *partition_label)
 
     size = p->get_size();
 
-    result = init_custom(p, 0, size / SPI_FLASH_SEC_SIZE);
+#ifdef CONFIG_NVS_INDEX_CHECKPOINT
+    if (partition_lookup::lookup_checkpoint_partition(partition_label, &checkpoint) != ESP_OK) {
+        checkpoint = nullptr;
+    }
+#endif
+
+    result = init_custom(p, 0, size / SPI_FLASH_SEC_SIZE, checkpoint);
     if (result != ESP_OK) {
         goto error;
     }
 
     nvs_partition_list.push_back(p);
+    if (checkpoint != nullptr) {
+        nvs_checkpoint_partition_list.push_back(checkpoint);
+    }
 
     return ESP_OK;
 
 error:
+    delete checkpoint;
     delete p;
     return result;
 }
 #endif // ESP_PLATFORM
 
-esp_err_t NVSPartitionManager::init_custom(Partition *partition, uint32_t baseSector, uint32_t sectorCount)
+esp_err_t NVSPartitionManager::init_custom(Partition *partition, uint32_t baseSector, uint32_t sectorCount,
+        Partition *checkpointPartition)
 {
     Storage* new_storage = nullptr;
     Storage* storage = lookup_storage_from_name(partition->get_partition_name());
@@ -89,6 +101,9 @@ esp_err_t NVSPartitionManager::init_custom(Partition *partition, uint32_t baseSe
         }
     }
 
+    if (checkpointPartition != nullptr) {
+        storage->setCheckpointPartition(checkpointPartition);
+    }
     esp_err_t err = storage->init(baseSector, sectorCount);
     if (new_storage != nullptr) {
         if (err == ESP_OK) {
@@ -155,10 +170,25 @@ esp_err_t NVSPartitionManager::deinit_partition(const char *partition_label)
         }
     }
 
+    /* Save the index checkpoint for the next init, the checkpoint is simply not used if this fails */
+    Partition *checkpoint = storage->getCheckpointPartition();
+    if (checkpoint != nullptr) {
+        storage->saveCheckpoint();
+    }
+
     /* Finally delete the storage and its partition */
     nvs_storage_list.erase(storage);
     delete storage;
 
+    for (auto it = nvs_checkpoint_partition_list.begin(); it != nvs_checkpoint_partition_list.end(); ++it) {
+        if (checkpoint == it) {
+            NVSPartition *p = it;
+            nvs_checkpoint_partition_list.erase(it);
+            delete p;
+            break;
+        }
+    }
+
     for (auto it = nvs_partition_list.begin(); it != nvs_partition_list.end(); ++it) {
         if (strcmp(it->get_partition_name(), partition_label) == 0) {
             NVSPartition *p = it;
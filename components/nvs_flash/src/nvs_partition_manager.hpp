@@ -22,7 +22,12 @@ public:
 
     esp_err_t init_partition(const char *partition_label);
 
-    esp_err_t init_custom(Partition *partition, uint32_t baseSector, uint32_t sectorCount);
+    /**
+     * Initializes the storage on the given partition. If checkpointPartition is not nullptr, it holds the index
+     * checkpoint of the storage, see Storage::saveCheckpoint().
+     */
+    esp_err_t init_custom(Partition *partition, uint32_t baseSector, uint32_t sectorCount,
+            Partition *checkpointPartition = nullptr);
 
     esp_err_t secure_init_partition(const char *part_name, nvs_sec_cfg_t* cfg);
 
@@ -46,6 +51,11 @@ protected:
     intrusive_list<nvs::Storage> nvs_storage_list;
 
     intrusive_list<nvs::NVSPartition> nvs_partition_list;
+
+    /**
+     * Checkpoint partitions looked up by init_partition().
+     */
+    intrusive_list<nvs::NVSPartition> nvs_checkpoint_partition_list;
 };
 
 } // nvs
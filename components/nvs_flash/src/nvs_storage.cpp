@@ -25,6 +25,10 @@ namespace nvs
 
 Storage::~Storage()
 {
+    // writers of invalidated handles are deleted later, their chunks are erased as orphans on the next init
+    while (!mBlobWriters.empty()) {
+        mBlobWriters.front().close();
+    }
     clearNamespaces();
 }
 
@@ -33,98 +37,233 @@ void Storage::clearNamespaces()
     mNamespaces.clearAndFreeNodes();
 }
 
-esp_err_t Storage::populateBlobIndices(TBlobIndexList& blobIdxList)
+/**
+ * Collects namespaces, blob indices and blob data chunks while the pages are loaded,
+ * so that init() doesn't have to read all items again.
+ */
+class Storage::LoadVisitor : public Page::ItemVisitor
 {
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
+public:
+    LoadVisitor(Storage& storage, TBlobIndexList& blobIdxList, TDataChunkList& dataChunkList)
+        : mStorage(storage), mBlobIdxList(blobIdxList), mDataChunkList(dataChunkList)
+    {
+    }
 
-        /* If the power went off just after writing a blob index, the duplicate detection
-         * logic in pagemanager will remove the earlier index. So we should never find a
-         * duplicate index at this point */
+    esp_err_t visit(const Item& item) override
+    {
+        if (item.nsIndex == Page::NS_INDEX && item.datatype == ItemType::U8) {
+            return addNamespace(item);
+        } else if (item.datatype == ItemType::BLOB_IDX) {
+            return addBlobIndex(item);
+        } else if (item.datatype == ItemType::BLOB_DATA) {
+            return addDataChunk(item);
+        }
+        return ESP_OK;
+    }
 
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_IDX, nullptr, itemIndex, item) == ESP_OK) {
-            BlobIndexNode* entry = new (std::nothrow) BlobIndexNode;
+private:
+    esp_err_t addNamespace(const Item& item)
+    {
+        const uint8_t index = item.data[0];
+        bool used;
+        if (mStorage.mNamespaceUsage.get(index, &used) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        if (used) {
+            // the same namespace entry on a page which is being freed or an older duplicate
+            return ESP_OK;
+        }
 
-            if (!entry) return ESP_ERR_NO_MEM;
+        NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
 
-            item.getKey(entry->key, sizeof(entry->key));
-            entry->nsIndex = item.nsIndex;
-            entry->chunkStart = item.blobIndex.chunkStart;
-            entry->chunkCount = item.blobIndex.chunkCount;
+        if (!entry) return ESP_ERR_NO_MEM;
 
-            blobIdxList.push_back(entry);
-            itemIndex += item.span;
+        strncpy(entry->mName, item.key, sizeof(entry->mName) - 1);
+        entry->mName[sizeof(entry->mName) - 1] = 0;
+        entry->mIndex = index;
+        if (mStorage.mNamespaceUsage.set(index, true) != ESP_OK) {
+            delete entry;
+            return ESP_FAIL;
         }
+        mStorage.mNamespaces.push_back(entry);
+        return ESP_OK;
+    }
+
+    esp_err_t addBlobIndex(const Item& item)
+    {
+        auto iter = std::find_if(mBlobIdxList.begin(),
+                mBlobIdxList.end(),
+                [&] (const BlobIndexNode& e) -> bool
+                {return (strncmp(item.key, e.key, sizeof(e.key) - 1) == 0)
+                        && (item.nsIndex == e.nsIndex)
+                        && (item.blobIndex.chunkStart == e.chunkStart);});
+        if (iter != mBlobIdxList.end()) {
+            return ESP_OK;
+        }
+
+        BlobIndexNode* entry = new (std::nothrow) BlobIndexNode;
+
+        if (!entry) return ESP_ERR_NO_MEM;
+
+        strncpy(entry->key, item.key, sizeof(entry->key) - 1);
+        entry->key[sizeof(entry->key) - 1] = 0;
+        entry->nsIndex = item.nsIndex;
+        entry->chunkStart = item.blobIndex.chunkStart;
+        entry->chunkCount = item.blobIndex.chunkCount;
+
+        mBlobIdxList.push_back(entry);
+        return ESP_OK;
+    }
+
+    esp_err_t addDataChunk(const Item& item)
+    {
+        DataChunkNode* entry = new (std::nothrow) DataChunkNode;
+
+        if (!entry) return ESP_ERR_NO_MEM;
+
+        strncpy(entry->key, item.key, sizeof(entry->key) - 1);
+        entry->key[sizeof(entry->key) - 1] = 0;
+        entry->nsIndex = item.nsIndex;
+        entry->chunkIndex = item.chunkIndex;
+
+        mDataChunkList.push_back(entry);
+        return ESP_OK;
+    }
+
+    Storage& mStorage;
+    TBlobIndexList& mBlobIdxList;
+    TDataChunkList& mDataChunkList;
+};
+
+esp_err_t Storage::validateBlobIndices(TBlobIndexList& blobIdxList)
+{
+    /* Blob indices are collected before PageManager::load() recovers from an interrupted write or page
+     * reclamation, which may erase a duplicate index. Only keep the ones which can still be found. */
+    auto it = blobIdxList.begin();
+    while (it != blobIdxList.end()) {
+        auto next = it;
+        ++next;
+
+        Page* findPage;
+        Item item;
+        auto err = findItem(it->nsIndex, ItemType::BLOB_IDX, it->key, findPage, item, Page::CHUNK_ANY, it->chunkStart);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            BlobIndexNode* entry = &(*it);
+            blobIdxList.erase(it);
+            delete entry;
+        } else if (err != ESP_OK) {
+            return err;
+        }
+        it = next;
     }
 
     return ESP_OK;
 }
 
-void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
+void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList, TDataChunkList& dataChunkList)
 {
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
-        /* Chunks with same <ns,key> and with chunkIndex in the following ranges
-         * belong to same family.
-         * 1) VER_0_OFFSET <= chunkIndex < VER_1_OFFSET-1 => Version0 chunks
-         * 2) VER_1_OFFSET <= chunkIndex < VER_ANY => Version1 chunks
-         */
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_DATA, nullptr, itemIndex, item) == ESP_OK) {
-
-            auto iter = std::find_if(blobIdxList.begin(),
-                    blobIdxList.end(),
-                    [=] (const BlobIndexNode& e) -> bool
-                    {return (strncmp(item.key, e.key, sizeof(e.key) - 1) == 0)
-                            && (item.nsIndex == e.nsIndex)
-                            && (item.chunkIndex >=  static_cast<uint8_t> (e.chunkStart))
-                            && (item.chunkIndex < static_cast<uint8_t> (e.chunkStart) + e.chunkCount);});
-            if (iter == std::end(blobIdxList)) {
-                p.eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex);
+    /* Chunks with same <ns,key> and with chunkIndex in the following ranges
+     * belong to same family.
+     * 1) VER_0_OFFSET <= chunkIndex < VER_1_OFFSET-1 => Version0 chunks
+     * 2) VER_1_OFFSET <= chunkIndex < VER_ANY => Version1 chunks
+     */
+    for (auto chunk = dataChunkList.begin(); chunk != dataChunkList.end(); ++chunk) {
+        auto iter = std::find_if(blobIdxList.begin(),
+                blobIdxList.end(),
+                [=] (const BlobIndexNode& e) -> bool
+                {return (strncmp(chunk->key, e.key, sizeof(e.key) - 1) == 0)
+                        && (chunk->nsIndex == e.nsIndex)
+                        && (chunk->chunkIndex >=  static_cast<uint8_t> (e.chunkStart))
+                        && (chunk->chunkIndex < static_cast<uint8_t> (e.chunkStart) + e.chunkCount);});
+        if (iter == std::end(blobIdxList)) {
+            Page* findPage;
+            Item item;
+            if (findItem(chunk->nsIndex, ItemType::BLOB_DATA, chunk->key, findPage, item, chunk->chunkIndex) == ESP_OK) {
+                findPage->eraseItem(chunk->nsIndex, ItemType::BLOB_DATA, chunk->key, chunk->chunkIndex);
             }
-            itemIndex += item.span;
         }
     }
 }
 
-esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
+/**
+ * Namespace table entry in an index checkpoint.
+ */
+struct CheckpointNamespace {
+    char mName[Item::MAX_KEY_LENGTH + 1];
+    uint8_t mIndex;
+    uint8_t mReserved[3];
+};
+
+esp_err_t Storage::saveCheckpoint()
 {
-    auto err = mPageManager.load(mPartition, baseSector, sectorCount);
+    if (mCheckpointPartition == nullptr) {
+        return ESP_ERR_NVS_PART_NOT_FOUND;
+    }
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    // an old item which couldn't be erased is only removed by the full init()
+    if (mRecoveryPending) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    CheckpointWriter writer(mCheckpointPartition);
+    auto err = mPageManager.saveSnapshots(writer);
     if (err != ESP_OK) {
-        mState = StorageState::INVALID;
         return err;
     }
 
-    // load namespaces list
+    size_t namespaceCount = 0;
+    for (auto it = mNamespaces.begin(); it != mNamespaces.end(); ++it) {
+        CheckpointNamespace entry;
+        memset(&entry, 0xff, sizeof(entry));
+        strncpy(entry.mName, it->mName, sizeof(entry.mName));
+        entry.mIndex = it->mIndex;
+        err = writer.write(&entry, sizeof(entry));
+        if (err != ESP_OK) {
+            return err;
+        }
+        ++namespaceCount;
+    }
+
+    return writer.finish(mPageManager.getBaseSector(), mPageManager.getPageCount(), namespaceCount);
+}
+
+esp_err_t Storage::loadCheckpoint(uint32_t baseSector, uint32_t sectorCount)
+{
+    mItemIndex.clear();
+    mValueCache.clear();
     clearNamespaces();
     std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
-        while (p.findItem(Page::NS_INDEX, ItemType::U8, nullptr, itemIndex, item) == ESP_OK) {
-            NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
 
-            if (!entry) {
-                mState = StorageState::INVALID;
-                return ESP_ERR_NO_MEM;
-            }
+    CheckpointReader reader(mCheckpointPartition);
+    auto err = reader.begin(baseSector, sectorCount);
+    if (err != ESP_OK) {
+        return err;
+    }
 
-            item.getKey(entry->mName, sizeof(entry->mName));
-            err = item.getValue(entry->mIndex);
-            if (err != ESP_OK) {
-                delete entry;
-                return err;
-            }
-            if (mNamespaceUsage.set(entry->mIndex, true) != ESP_OK) {
-                delete entry;
-                return ESP_FAIL;
-            }
-            mNamespaces.push_back(entry);
-            itemIndex += item.span;
+    err = mPageManager.loadSnapshots(mPartition, baseSector, sectorCount, reader, mItemIndex.isEnabled() ? &mItemIndex : nullptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (size_t i = 0; i < reader.getNamespaceCount(); ++i) {
+        CheckpointNamespace entry;
+        err = reader.read(&entry, sizeof(entry));
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        NamespaceEntry* ns = new (std::nothrow) NamespaceEntry;
+
+        if (!ns) return ESP_ERR_NO_MEM;
+
+        strncpy(ns->mName, entry.mName, sizeof(ns->mName) - 1);
+        ns->mName[sizeof(ns->mName) - 1] = 0;
+        ns->mIndex = entry.mIndex;
+        mNamespaces.push_back(ns);
+        if (mNamespaceUsage.set(entry.mIndex, true) != ESP_OK) {
+            return ESP_FAIL;
         }
     }
     if (mNamespaceUsage.set(0, true) != ESP_OK) {
@@ -133,21 +272,64 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
     if (mNamespaceUsage.set(255, true) != ESP_OK) {
         return ESP_FAIL;
     }
-    mState = StorageState::ACTIVE;
 
-    // Populate list of multi-page index entries.
+    return reader.finish();
+}
+
+esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
+{
+    mRecoveryPending = false;
+
+    // A checkpoint is only saved after init() has removed orphaned blob data and a page which changed since
+    // then isn't restored, so none of the scans below are needed if the checkpoint can be used.
+    if (mCheckpointPartition != nullptr && loadCheckpoint(baseSector, sectorCount) == ESP_OK) {
+        mState = StorageState::ACTIVE;
+#ifdef DEBUG_STORAGE
+        debugCheck();
+#endif
+        return ESP_OK;
+    }
+
+    mItemIndex.clear();
+    mValueCache.clear();
+    clearNamespaces();
+    std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
+
+    // Namespaces and multi-page blob entries are collected while the pages are loaded,
+    // so that every item is only read once.
     TBlobIndexList blobIdxList;
-    err = populateBlobIndices(blobIdxList);
+    TDataChunkList dataChunkList;
+    LoadVisitor visitor(*this, blobIdxList, dataChunkList);
+    auto err = mPageManager.load(mPartition, baseSector, sectorCount, mItemIndex.isEnabled() ? &mItemIndex : nullptr, &visitor);
     if (err != ESP_OK) {
+        blobIdxList.clearAndFreeNodes();
+        dataChunkList.clearAndFreeNodes();
         mState = StorageState::INVALID;
-        return ESP_ERR_NO_MEM;
+        return err;
+    }
+
+    if (mNamespaceUsage.set(0, true) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    if (mNamespaceUsage.set(255, true) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    mState = StorageState::ACTIVE;
+
+    err = validateBlobIndices(blobIdxList);
+    if (err != ESP_OK) {
+        blobIdxList.clearAndFreeNodes();
+        dataChunkList.clearAndFreeNodes();
+        mState = StorageState::INVALID;
+        return err;
     }
 
     // Remove the entries for which there is no parent multi-page index.
-    eraseOrphanDataBlobs(blobIdxList);
+    eraseOrphanDataBlobs(blobIdxList, dataChunkList);
 
-    // Purge the blob index list
+    // Purge the blob index and data chunk lists
     blobIdxList.clearAndFreeNodes();
+    dataChunkList.clearAndFreeNodes();
 
 #ifdef DEBUG_STORAGE
     debugCheck();
@@ -162,6 +344,33 @@ bool Storage::isValid() const
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+    // Page::findItem only uses its hash list under the same conditions, so the index is a superset of the pages
+    // which can possibly return a match.
+    if (mItemIndex.isValid() && nsIndex != Page::NS_ANY && datatype != ItemType::ANY && key != nullptr) {
+        const uint32_t hash_24 = Item(nsIndex, datatype, 0, key, chunkIdx).calculateCrc32WithoutValue() & 0xffffff;
+        Page* candidates[MAX_INDEXED_PAGES];
+        size_t count = mItemIndex.find(hash_24, candidates, MAX_INDEXED_PAGES);
+        if (count <= MAX_INDEXED_PAGES) {
+            // keep the result of the linear search: pages are checked in the order of their sequence numbers
+            std::sort(candidates, candidates + count, [](const Page* a, const Page* b) -> bool {
+                uint32_t seqA = UINT32_MAX;
+                uint32_t seqB = UINT32_MAX;
+                a->getSeqNumber(seqA);
+                b->getSeqNumber(seqB);
+                return seqA < seqB;
+            });
+            for (size_t i = 0; i < count; ++i) {
+                size_t itemIndex = 0;
+                auto err = candidates[i]->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
+                if (err == ESP_OK) {
+                    page = candidates[i];
+                    return ESP_OK;
+                }
+            }
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -182,11 +391,7 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
     esp_err_t err = ESP_OK;
 
     /* Check how much maximum data can be accommodated**/
-    uint32_t max_pages = mPageManager.getPageCount() - 1;
-
-    if(max_pages > (Page::CHUNK_ANY-1)/2) {
-       max_pages = (Page::CHUNK_ANY-1)/2;
-    }
+    uint32_t max_pages = getMaxBlobChunkCount();
 
     if (dataSize > max_pages * Page::CHUNK_MAX_SIZE) {
         return ESP_ERR_NVS_VALUE_TOO_LONG;
@@ -284,6 +489,14 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    /* An open BlobWriter has reserved the version this blob would be written with */
+    if (datatype == ItemType::BLOB && isBlobWriterOpen(nsIndex, key)) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    mValueCache.invalidate(nsIndex, key);
+    mPartition->get_op_stats().countValue(nsIndex, dataSize);
+
     Page* findPage = nullptr;
     Item item;
 
@@ -340,6 +553,7 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
             err = eraseMultiPageBlob(nsIndex, key, prevStart);
 
             if (err == ESP_ERR_FLASH_OP_FAIL) {
+                mRecoveryPending = true;
                 return ESP_ERR_NVS_REMOVE_FAILED;
             }
             if (err != ESP_OK) {
@@ -399,11 +613,256 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
         }
         err = findPage->eraseItem(nsIndex, datatype, key);
         if (err == ESP_ERR_FLASH_OP_FAIL) {
+            mRecoveryPending = true;
+            return ESP_ERR_NVS_REMOVE_FAILED;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+static size_t batchItemSpan(const Storage::BatchItem& item)
+{
+    if (!isVariableLengthType(item.datatype)) {
+        return 1;
+    }
+    return 1 + (item.dataSize + Page::ENTRY_SIZE - 1) / Page::ENTRY_SIZE;
+}
+
+esp_err_t Storage::prepareBatch(uint8_t nsIndex, BatchItem** items, size_t& count, size_t& entryCount)
+{
+    size_t kept = 0;
+    entryCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        BatchItem* batchItem = items[i];
+        Page* findPage = nullptr;
+        Item item;
+        esp_err_t err = findItem(nsIndex, batchItem->datatype, batchItem->key, findPage, item);
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+
+        batchItem->oldPage = nullptr;
+        if (findPage != nullptr) {
+            // unchanged items are not written again, same as in writeItem
+            if (findPage->cmpItem(nsIndex, batchItem->datatype, batchItem->key,
+                    batchItem->getData(), batchItem->dataSize) == ESP_OK) {
+                continue;
+            }
+            size_t itemIndex = 0;
+            err = findPage->findItem(nsIndex, batchItem->datatype, batchItem->key, itemIndex, item);
+            if (err != ESP_OK) {
+                return err;
+            }
+            batchItem->oldPage = findPage;
+            batchItem->oldIndex = itemIndex;
+            batchItem->oldSpan = item.span;
+        }
+        entryCount += batchItemSpan(*batchItem);
+        items[kept++] = batchItem;
+    }
+    count = kept;
+    return ESP_OK;
+}
+
+/* Brings the items into the order in which they are written. PageManager::load only finishes the erasure of
+ * replaced items on earlier pages for a suffix of the last page, so the items replacing something on an earlier page
+ * go last. Replaced items on the current page are taken care of by Page::load already.
+ * Items replacing physically adjacent entries are grouped such that each group can be erased with one
+ * Page::eraseEntryRange call. That call erases back to front, so the group is ordered back to front as well.
+ */
+void Storage::orderBatch(BatchItem** items, size_t count)
+{
+    Page* currentPage = &getCurrentPage();
+    auto rank = [currentPage](const BatchItem* item) -> int {
+        if (item->oldPage == nullptr) {
+            return 0;
+        }
+        return (item->oldPage == currentPage) ? 1 : 2;
+    };
+    std::stable_sort(items, items + count, [&rank](const BatchItem* a, const BatchItem* b) -> bool {
+        int rankA = rank(a);
+        int rankB = rank(b);
+        if (rankA != rankB || rankA == 0) {
+            return rankA < rankB;
+        }
+        if (a->oldPage != b->oldPage) {
+            uint32_t seqA = UINT32_MAX;
+            uint32_t seqB = UINT32_MAX;
+            a->oldPage->getSeqNumber(seqA);
+            b->oldPage->getSeqNumber(seqB);
+            return seqA < seqB;
+        }
+        return a->oldIndex < b->oldIndex;
+    });
+
+    size_t begin = 0;
+    while (begin < count) {
+        size_t end = begin + 1;
+        if (items[begin]->oldPage != nullptr) {
+            while (end < count && items[end]->oldPage == items[end - 1]->oldPage &&
+                    items[end - 1]->oldIndex + items[end - 1]->oldSpan == items[end]->oldIndex) {
+                ++end;
+            }
+            std::reverse(items + begin, items + end);
+        }
+        begin = end;
+    }
+}
+
+static void serializeBatch(uint8_t nsIndex, Storage::BatchItem** items, size_t count, Item* entries, OpStats& opStats)
+{
+    size_t pos = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const Storage::BatchItem& batchItem = *items[i];
+        const size_t span = batchItemSpan(batchItem);
+        Item& header = entries[pos];
+        header = Item(nsIndex, batchItem.datatype, span, batchItem.key);
+        if (!isVariableLengthType(batchItem.datatype)) {
+            memcpy(header.data, batchItem.getData(), batchItem.dataSize);
+        } else {
+            const uint8_t* src = static_cast<const uint8_t*>(batchItem.getData());
+            opStats.countCrc();
+            header.varLength.dataCrc32 = Item::calculateCrc32(src, batchItem.dataSize);
+            header.varLength.dataSize = batchItem.dataSize;
+            header.varLength.reserved = 0xffff;
+            uint8_t* dst = entries[pos + 1].rawData;
+            std::fill_n(dst, (span - 1) * Page::ENTRY_SIZE, 0xff);
+            memcpy(dst, src, batchItem.dataSize);
+        }
+        opStats.countCrc();
+        header.crc32 = header.calculateCrc32();
+        pos += span;
+    }
+}
+
+esp_err_t Storage::writeBatch(uint8_t nsIndex, TBatchList& batch)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    size_t count = 0;
+    for (auto it = batch.begin(); it != batch.end(); ++it) {
+        if (it->datatype == ItemType::ANY || it->datatype == ItemType::BLOB ||
+                it->datatype == ItemType::BLOB_DATA || it->datatype == ItemType::BLOB_IDX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (it->dataSize > Page::CHUNK_MAX_SIZE) {
+            return ESP_ERR_NVS_VALUE_TOO_LONG;
+        }
+        ++count;
+    }
+    for (auto it = batch.begin(); it != batch.end(); ++it) {
+        mValueCache.invalidate(nsIndex, it->key);
+        mPartition->get_op_stats().countValue(nsIndex, it->dataSize);
+    }
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    BatchItem** items = new (std::nothrow) BatchItem*[count];
+    if (!items) {
+        return ESP_ERR_NO_MEM;
+    }
+    size_t i = 0;
+    for (auto it = batch.begin(); it != batch.end(); ++it) {
+        items[i++] = &(*it);
+    }
+    esp_err_t err = writeBatchItems(nsIndex, items, count);
+    delete[] items;
+    return err;
+}
+
+esp_err_t Storage::writeBatchItems(uint8_t nsIndex, BatchItem** items, size_t count)
+{
+    // each key may only occur once, otherwise two items would try to erase the same old item
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = i + 1; j < count; ++j) {
+            if (items[i]->datatype == items[j]->datatype && strcmp(items[i]->key, items[j]->key) == 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+
+    size_t entryCount;
+    esp_err_t err = prepareBatch(nsIndex, items, count, entryCount);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (count == 0) {
+        return ESP_OK;
+    }
+    if (entryCount > Page::ENTRY_COUNT) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    if (getCurrentPage().getFreeEntryCount() < entryCount) {
+        Page& page = getCurrentPage();
+        if (page.state() != Page::PageState::FULL) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (getCurrentPage().getFreeEntryCount() < entryCount) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+
+        // page reclamation may have moved the items which are about to be replaced
+        err = prepareBatch(nsIndex, items, count, entryCount);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    orderBatch(items, count);
+
+    Item* entries = new (std::nothrow) Item[entryCount];
+    if (!entries) {
+        return ESP_ERR_NO_MEM;
+    }
+    serializeBatch(nsIndex, items, count, entries, mPartition->get_op_stats());
+    err = getCurrentPage().writeItems(entries, entryCount);
+    delete[] entries;
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // erase the replaced items group by group in the order in which they were written
+    size_t begin = 0;
+    while (begin < count) {
+        size_t end = begin + 1;
+        Page* oldPage = items[begin]->oldPage;
+        if (oldPage == nullptr) {
+            begin = end;
+            continue;
+        }
+        while (end < count && items[end]->oldPage == oldPage &&
+                items[end]->oldIndex + items[end]->oldSpan == items[end - 1]->oldIndex) {
+            ++end;
+        }
+        err = oldPage->eraseEntryRange(items[end - 1]->oldIndex, items[begin]->oldIndex + items[begin]->oldSpan);
+        if (err == ESP_ERR_FLASH_OP_FAIL) {
+            mRecoveryPending = true;
             return ESP_ERR_NVS_REMOVE_FAILED;
         }
         if (err != ESP_OK) {
             return err;
         }
+        begin = end;
     }
 #ifdef DEBUG_STORAGE
     debugCheck();
@@ -563,11 +1022,30 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
         } // else check if the blob is stored with earlier version format without index
     }
 
+    const uint8_t* cachedData;
+    size_t cachedSize;
+    if (ValueCache::isCacheable(datatype, 0) && mValueCache.find(nsIndex, datatype, key, cachedData, cachedSize)) {
+        // same checks as in Page::readItem
+        if (!isVariableLengthType(datatype) && dataSize != cachedSize) {
+            return ESP_ERR_NVS_TYPE_MISMATCH;
+        }
+        if (dataSize < cachedSize) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        memcpy(data, cachedData, cachedSize);
+        return ESP_OK;
+    }
+
     auto err = findItem(nsIndex, datatype, key, findPage, item);
     if (err != ESP_OK) {
         return err;
     }
-    return findPage->readItem(nsIndex, datatype, key, data, dataSize);
+    err = findPage->readItem(nsIndex, datatype, key, data, dataSize);
+    if (err == ESP_OK) {
+        mValueCache.insert(nsIndex, datatype, key, data,
+                isVariableLengthType(datatype) ? item.varLength.dataSize : dataSize);
+    }
+    return err;
 
 }
 
@@ -616,12 +1094,351 @@ esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffse
     return ESP_OK;
 }
 
+esp_err_t Storage::readBlobRange(uint8_t nsIndex, const char* key, size_t offset, void* data, size_t dataSize)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+
+    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // blob stored with earlier version format without index
+        err = findItem(nsIndex, ItemType::BLOB, key, findPage, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        return findPage->readItemRange(nsIndex, ItemType::BLOB, key, offset, data, dataSize);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint8_t chunkCount = item.blobIndex.chunkCount;
+    VerOffset chunkStart = item.blobIndex.chunkStart;
+    size_t blobSize = item.blobIndex.dataSize;
+
+    if (offset > blobSize || dataSize > blobSize - offset) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    uint8_t* dst = static_cast<uint8_t*>(data);
+    size_t chunkOffset = 0;
+    for (uint8_t chunkNum = 0; chunkNum < chunkCount && dataSize > 0; chunkNum++) {
+        uint8_t chunkIdx = static_cast<uint8_t> (chunkStart) + chunkNum;
+        err = findItem(nsIndex, ItemType::BLOB_DATA, key, findPage, item, chunkIdx);
+        if (err != ESP_OK) {
+            return err;
+        }
+        size_t chunkSize = item.varLength.dataSize;
+        if (chunkOffset + chunkSize <= offset) {
+            chunkOffset += chunkSize;
+            continue;
+        }
+
+        size_t readOffset = offset - chunkOffset;
+        size_t readSize = (chunkSize - readOffset < dataSize) ? chunkSize - readOffset : dataSize;
+        err = findPage->readItemRange(nsIndex, ItemType::BLOB_DATA, key, readOffset, dst, readSize, chunkIdx);
+        if (err != ESP_OK) {
+            return err;
+        }
+        dst += readSize;
+        dataSize -= readSize;
+        offset += readSize;
+        chunkOffset += chunkSize;
+    }
+    NVS_ASSERT_OR_RETURN(dataSize == 0, ESP_FAIL);
+
+    return ESP_OK;
+}
+
+uint8_t Storage::getMaxBlobChunkCount()
+{
+    uint32_t maxChunks = mPageManager.getPageCount() - 1;
+
+    if (maxChunks > (Page::CHUNK_ANY - 1) / 2) {
+        maxChunks = (Page::CHUNK_ANY - 1) / 2;
+    }
+    return static_cast<uint8_t>(maxChunks);
+}
+
+esp_err_t Storage::startNewPage()
+{
+    Page& page = getCurrentPage();
+    if (page.state() != Page::PageState::FULL) {
+        esp_err_t err = page.markFull();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return mPageManager.requestNewPage();
+}
+
+bool Storage::isBlobWriterOpen(uint8_t nsIndex, const char* key)
+{
+    for (auto it = std::begin(mBlobWriters); it != std::end(mBlobWriters); ++it) {
+        if (it->mNsIndex == nsIndex && (key == nullptr || strncmp(it->mKey, key, sizeof(it->mKey)) == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Storage::BlobWriter::~BlobWriter()
+{
+    close();
+}
+
+void Storage::BlobWriter::close()
+{
+    if (isOpen()) {
+        mStorage->mBlobWriters.erase(this);
+    }
+    delete[] mBuffer;
+    mBuffer = nullptr;
+}
+
+esp_err_t Storage::BlobWriter::begin(uint8_t nsIndex, const char* key)
+{
+    if (isOpen()) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+    if (mStorage->mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    /* A second writer would pick the same version for its chunks */
+    if (mStorage->isBlobWriterOpen(nsIndex, key)) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+    auto err = mStorage->findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        return err;
+    }
+
+    /* Use the version which is not used by the current value */
+    mChunkStart = VerOffset::VER_0_OFFSET;
+    if (err == ESP_OK && item.blobIndex.chunkStart == VerOffset::VER_0_OFFSET) {
+        mChunkStart = VerOffset::VER_1_OFFSET;
+    }
+
+    mBuffer = new (std::nothrow) uint8_t[Page::CHUNK_MAX_SIZE];
+    if (!mBuffer) {
+        return ESP_ERR_NO_MEM;
+    }
+    strlcpy(mKey, key, sizeof(mKey));
+    mNsIndex = nsIndex;
+    mChunkCount = 0;
+    mMaxChunkCount = mStorage->getMaxBlobChunkCount();
+    mDataSize = 0;
+    mBufferUsed = 0;
+    mStorage->mBlobWriters.push_back(this);
+    return ESP_OK;
+}
+
+esp_err_t Storage::BlobWriter::writeChunk(const uint8_t* data, size_t dataSize, size_t& written)
+{
+    Page* page = &mStorage->getCurrentPage();
+    size_t tailroom = page->getVarDataTailroom();
+
+    /* Same placement as writeMultiPageBlob(): rather start the first chunk on a new page than leave
+     * only a small piece of the blob on the current one */
+    if (mChunkCount == 0U && ((tailroom < dataSize) || (tailroom == 0 && dataSize == 0)) && tailroom < Page::CHUNK_MAX_SIZE/10) {
+        esp_err_t err = mStorage->startNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        page = &mStorage->getCurrentPage();
+        if (page->getVarDataTailroom() == tailroom) {
+            /* We got the same page or we are not improving.*/
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        tailroom = page->getVarDataTailroom();
+    }
+    if (!tailroom) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    if (mChunkCount >= mMaxChunkCount) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    size_t chunkSize = (dataSize > tailroom) ? tailroom : dataSize;
+    esp_err_t err = page->writeItem(mNsIndex, ItemType::BLOB_DATA, mKey, data, chunkSize,
+            static_cast<uint8_t> (mChunkStart) + mChunkCount);
+    if (err != ESP_OK) {
+        NVS_ASSERT_OR_RETURN(err != ESP_ERR_NVS_PAGE_FULL, err);
+        return err;
+    }
+    mChunkCount++;
+    written = chunkSize;
+
+    if (chunkSize < dataSize || (tailroom - chunkSize) < Page::ENTRY_SIZE) {
+        return mStorage->startNewPage();
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::BlobWriter::append(const void* data, size_t dataSize)
+{
+    if (!isOpen()) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+    if (dataSize > mMaxChunkCount * Page::CHUNK_MAX_SIZE - mDataSize) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+    mStorage->mPartition->get_op_stats().countValue(mNsIndex, dataSize);
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    while (dataSize > 0) {
+        size_t written = 0;
+        esp_err_t err = ESP_OK;
+        if (mBufferUsed == 0 && dataSize >= Page::CHUNK_MAX_SIZE) {
+            /* Enough data for a complete chunk, write it from the caller's buffer */
+            err = writeChunk(src, dataSize, written);
+            src += written;
+            dataSize -= written;
+            mDataSize += written;
+        } else {
+            size_t copySize = Page::CHUNK_MAX_SIZE - mBufferUsed;
+            copySize = (dataSize < copySize) ? dataSize : copySize;
+            memcpy(mBuffer + mBufferUsed, src, copySize);
+            mBufferUsed += copySize;
+            src += copySize;
+            dataSize -= copySize;
+            mDataSize += copySize;
+            if (mBufferUsed == Page::CHUNK_MAX_SIZE) {
+                err = writeChunk(mBuffer, mBufferUsed, written);
+                mBufferUsed -= written;
+                memmove(mBuffer, mBuffer + written, mBufferUsed);
+            }
+        }
+        if (err != ESP_OK) {
+            abort();
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::BlobWriter::commit()
+{
+    if (!isOpen()) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_OK;
+    /* An empty blob still has one empty chunk */
+    while (err == ESP_OK && (mBufferUsed > 0 || mChunkCount == 0U)) {
+        size_t written = 0;
+        err = writeChunk(mBuffer, mBufferUsed, written);
+        mBufferUsed -= written;
+        memmove(mBuffer, mBuffer + written, mBufferUsed);
+    }
+
+    /* Look up the previous value only now, it may have been moved by page reclamation in the meantime */
+    Item item;
+    Page* findPage = nullptr;
+    bool hasPrevious = false;
+    VerOffset prevStart = VerOffset::VER_ANY;
+    if (err == ESP_OK) {
+        err = mStorage->findItem(mNsIndex, ItemType::BLOB_IDX, mKey, findPage, item);
+        if (err == ESP_OK) {
+            hasPrevious = true;
+            prevStart = item.blobIndex.chunkStart;
+            if (prevStart == mChunkStart) {
+                /* The key has been written by other means in the meantime */
+                abort();
+                return ESP_ERR_NVS_INVALID_STATE;
+            }
+        } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+
+    if (err == ESP_OK) {
+        std::fill_n(item.data, sizeof(item.data), 0xff);
+        item.blobIndex.dataSize = mDataSize;
+        item.blobIndex.chunkCount = mChunkCount;
+        item.blobIndex.chunkStart = mChunkStart;
+
+        /* Other items may have been written to the current page since the last chunk */
+        err = mStorage->getCurrentPage().writeItem(mNsIndex, ItemType::BLOB_IDX, mKey, item.data, sizeof(item.data));
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            err = mStorage->startNewPage();
+            if (err == ESP_OK) {
+                err = mStorage->getCurrentPage().writeItem(mNsIndex, ItemType::BLOB_IDX, mKey, item.data, sizeof(item.data));
+            }
+        }
+    }
+
+    if (err != ESP_OK) {
+        abort();
+        return (err == ESP_ERR_NVS_PAGE_FULL) ? ESP_ERR_NVS_NOT_ENOUGH_SPACE : err;
+    }
+    close();
+
+    mStorage->mValueCache.invalidate(mNsIndex, mKey);
+
+    if (hasPrevious) {
+        /* Erase the blob with earlier version*/
+        err = mStorage->eraseMultiPageBlob(mNsIndex, mKey, prevStart);
+    } else {
+        /* Support for earlier versions where BLOBS were stored without index */
+        err = mStorage->findItem(mNsIndex, ItemType::BLOB, mKey, findPage, item);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            return ESP_OK;
+        }
+        if (err == ESP_OK) {
+            err = findPage->eraseItem(mNsIndex, ItemType::BLOB, mKey);
+        }
+    }
+
+    if (err == ESP_ERR_FLASH_OP_FAIL) {
+        mStorage->mRecoveryPending = true;
+        return ESP_ERR_NVS_REMOVE_FAILED;
+    }
+    return err;
+}
+
+void Storage::BlobWriter::abort()
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    /* Look the chunks up again instead of remembering their pages, page reclamation may have moved them.
+     * Chunks which can't be erased now are removed as orphans by the next init(). */
+    for (uint8_t chunkNum = 0; chunkNum < mChunkCount; chunkNum++) {
+        Item item;
+        Page* findPage = nullptr;
+        uint8_t chunkIdx = static_cast<uint8_t> (mChunkStart) + chunkNum;
+        if (mStorage->findItem(mNsIndex, ItemType::BLOB_DATA, mKey, findPage, item, chunkIdx) == ESP_OK) {
+            findPage->eraseItem(mNsIndex, ItemType::BLOB_DATA, mKey, chunkIdx);
+        }
+    }
+    close();
+}
+
 esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key)
 {
     if (mState != StorageState::ACTIVE) {
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    /* The chunks of an open BlobWriter would be erased along with the blob */
+    if ((datatype == ItemType::BLOB || datatype == ItemType::ANY) && isBlobWriterOpen(nsIndex, key)) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    mValueCache.invalidate(nsIndex, key);
+
     if (datatype == ItemType::BLOB) {
         return eraseMultiPageBlob(nsIndex, key);
     }
@@ -646,6 +1463,12 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (isBlobWriterOpen(nsIndex, nullptr)) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    mValueCache.invalidateNamespace(nsIndex);
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         while (true) {
             auto err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
@@ -667,6 +1490,13 @@ esp_err_t Storage::getItemDataSize(uint8_t nsIndex, ItemType datatype, const cha
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    const uint8_t* cachedData;
+    size_t cachedSize;
+    if (datatype == ItemType::SZ && mValueCache.find(nsIndex, datatype, key, cachedData, cachedSize)) {
+        dataSize = cachedSize;
+        return ESP_OK;
+    }
+
     Item item;
     Page* findPage = nullptr;
     auto err = findItem(nsIndex, datatype, key, findPage, item);
@@ -726,6 +1556,32 @@ esp_err_t Storage::fillStats(nvs_stats_t& nvsStats)
     return mPageManager.fillStats(nvsStats);
 }
 
+esp_err_t Storage::fillOpStats(nvs_op_stats_t& opStats)
+{
+    mPartition->get_op_stats().fill(opStats);
+    return ESP_OK;
+}
+
+esp_err_t Storage::fillNamespaceOpStats(uint8_t nsIndex, nvs_namespace_op_stats_t& opStats)
+{
+    mPartition->get_op_stats().fillNamespace(nsIndex, opStats);
+    return ESP_OK;
+}
+
+void Storage::resetOpStats()
+{
+    mPartition->get_op_stats().reset();
+}
+
+esp_err_t Storage::fillValueCacheStats(nvs_value_cache_stats_t& cacheStats)
+{
+    cacheStats.hits = mValueCache.getHits();
+    cacheStats.misses = mValueCache.getMisses();
+    cacheStats.entries = mValueCache.size();
+    cacheStats.capacity = mValueCache.getCapacity();
+    return ESP_OK;
+}
+
 esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
 {
     usedEntries = 0;
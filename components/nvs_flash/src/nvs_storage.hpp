@@ -9,10 +9,13 @@
 #include <memory>
 #include <cstdlib>
 #include <unordered_map>
+#include "sdkconfig.h"
 #include "nvs.hpp"
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_item_index.hpp"
+#include "nvs_value_cache.hpp"
 #include "nvs_memory_management.hpp"
 #include "partition.hpp"
 
@@ -52,13 +55,134 @@ class Storage : public intrusive_list_node<Storage>, public ExceptionlessAllocat
 
     typedef intrusive_list<BlobIndexNode> TBlobIndexList;
 
+    struct DataChunkNode: public intrusive_list_node<DataChunkNode>, public ExceptionlessAllocatable {
+        public:
+            char key[Item::MAX_KEY_LENGTH + 1];
+            uint8_t nsIndex;
+            uint8_t chunkIndex;
+    };
+
+    typedef intrusive_list<DataChunkNode> TDataChunkList;
+
+    class LoadVisitor;
+
+    /**
+     * Upper bound of distinct pages an indexed lookup will check before falling back to a linear search.
+     * More than one page only occurs for hash collisions or while an item is being overwritten.
+     */
+    static const size_t MAX_INDEXED_PAGES = 8;
+
 public:
+    /**
+     * A value staged for a write batch, see writeBatch().
+     */
+    struct BatchItem : public intrusive_list_node<BatchItem>, public ExceptionlessAllocatable {
+    public:
+        BatchItem() : strData(nullptr)
+        {
+        }
+
+        ~BatchItem()
+        {
+            delete[] strData;
+        }
+
+        const void* getData() const
+        {
+            return (strData != nullptr) ? static_cast<const void*>(strData) : static_cast<const void*>(value);
+        }
+
+        ItemType datatype;
+        char key[Item::MAX_KEY_LENGTH + 1];
+        uint8_t value[8];
+        char* strData;
+        size_t dataSize;
+
+        // location of the item which is superseded by this one, filled in by writeBatch()
+        Page* oldPage;
+        size_t oldIndex;
+        size_t oldSpan;
+    };
+
+    typedef intrusive_list<BatchItem> TBatchList;
+
+    /**
+     * Writes a multi-page blob incrementally. At most one chunk of the blob is held in RAM; appended data which
+     * fills a whole chunk on its own is written without being copied.
+     *
+     * The chunks are written with the version offset which is not used by the current value of the key,
+     * so the current value stays readable until commit() writes the new blob index and erases the old value.
+     * If power goes off before that, the chunks written so far are erased as orphans by the next init().
+     * While the writer is open, writing or erasing the key by other means fails with ESP_ERR_NVS_INVALID_STATE.
+     */
+    class BlobWriter : public intrusive_list_node<BlobWriter>, public ExceptionlessAllocatable {
+    public:
+        BlobWriter(Storage* storage) : mStorage(storage) { }
+
+        ~BlobWriter();
+
+        esp_err_t begin(uint8_t nsIndex, const char* key);
+
+        /**
+         * Appends data to the blob. If writing fails, the chunks written so far are erased and the writer is
+         * closed.
+         */
+        esp_err_t append(const void* data, size_t dataSize);
+
+        /**
+         * Writes the remaining data and the blob index, erases the previous value of the key and closes the writer.
+         * If writing fails, the chunks written so far are erased.
+         */
+        esp_err_t commit();
+
+        /**
+         * Erases the chunks written so far and closes the writer.
+         */
+        void abort();
+
+        bool isOpen() const
+        {
+            return mBuffer != nullptr;
+        }
+
+    protected:
+        friend class Storage;
+
+        esp_err_t writeChunk(const uint8_t* data, size_t dataSize, size_t& written);
+
+        void close();
+
+        Storage* mStorage;
+        char mKey[Item::MAX_KEY_LENGTH + 1];
+        uint8_t mNsIndex = 0;
+        VerOffset mChunkStart = VerOffset::VER_0_OFFSET;
+        uint8_t mChunkCount = 0;
+        uint8_t mMaxChunkCount = 0;
+        size_t mDataSize = 0;
+        uint8_t* mBuffer = nullptr;
+        size_t mBufferUsed = 0;
+    };
+
+#ifdef CONFIG_NVS_ITEM_INDEX
+    static const bool ITEM_INDEX_DEFAULT = true;
+#else
+    static const bool ITEM_INDEX_DEFAULT = false;
+#endif
+
+#ifdef CONFIG_NVS_VALUE_CACHE_ENTRIES
+    static const size_t VALUE_CACHE_DEFAULT_ENTRIES = CONFIG_NVS_VALUE_CACHE_ENTRIES;
+#else
+    static const size_t VALUE_CACHE_DEFAULT_ENTRIES = 0;
+#endif
+
     ~Storage();
 
-    Storage(Partition *partition) : mPartition(partition) {
+    Storage(Partition *partition, bool useItemIndex = ITEM_INDEX_DEFAULT) : mPartition(partition) {
         if (partition == nullptr) {
             abort();
         }
+        mItemIndex.setEnabled(useItemIndex);
+        mValueCache.setCapacity(VALUE_CACHE_DEFAULT_ENTRIES);
     };
 
     esp_err_t init(uint32_t baseSector, uint32_t sectorCount);
@@ -69,6 +193,15 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
 
+    /**
+     * Writes all items of the batch as one contiguous run of entries on the current page and erases the items
+     * they replace afterwards. If power goes off before the run is complete, none of the items are stored.
+     * If power goes off while the replaced items are erased, the erasure is finished on the next init().
+     *
+     * Only primitive types and strings can be batched. The whole batch has to fit into one page.
+     */
+    esp_err_t writeBatch(uint8_t nsIndex, TBatchList& batch);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize);
 
     esp_err_t getItemDataSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize);
@@ -117,12 +250,68 @@ public:
 
     esp_err_t eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Reads dataSize bytes of the blob starting at offset. Only the chunks overlapping the range are read,
+     * the chunks before it are skipped using their item headers.
+     */
+    esp_err_t readBlobRange(uint8_t nsIndex, const char* key, size_t offset, void* data, size_t dataSize);
+
     void debugDump();
 
     void debugCheck();
 
+    /**
+     * Heap memory in bytes used by the partition-wide item index, 0 if the index is disabled.
+     */
+    size_t getItemIndexByteSize() const
+    {
+        return mItemIndex.getByteSize();
+    }
+
+    /**
+     * Sets the number of values the value cache can hold and drops all cached values. 0 disables the cache.
+     */
+    esp_err_t setValueCacheCapacity(size_t entries)
+    {
+        return mValueCache.setCapacity(entries);
+    }
+
+    void setReclaimPolicy(PageManager::ReclaimPolicy policy)
+    {
+        mPageManager.setReclaimPolicy(policy);
+    }
+
+    /**
+     * Sets the partition holding the index checkpoint of this storage, nullptr disables checkpoints.
+     * Has to be called before init() and the partition must outlive the storage.
+     */
+    void setCheckpointPartition(Partition* partition)
+    {
+        mCheckpointPartition = partition;
+    }
+
+    Partition* getCheckpointPartition() const
+    {
+        return mCheckpointPartition;
+    }
+
+    /**
+     * Saves the page states, hash lists and namespace table to the checkpoint partition, so that the next init()
+     * can restore them instead of reading every entry. The checkpoint is only used if none of the pages has
+     * changed since then.
+     */
+    esp_err_t saveCheckpoint();
+
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
+    esp_err_t fillValueCacheStats(nvs_value_cache_stats_t& cacheStats);
+
+    esp_err_t fillOpStats(nvs_op_stats_t& opStats);
+
+    esp_err_t fillNamespaceOpStats(uint8_t nsIndex, nvs_namespace_op_stats_t& opStats);
+
+    void resetOpStats();
+
     esp_err_t calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries);
 
     bool findEntry(nvs_opaque_iterator_t*, const char* name);
@@ -138,19 +327,42 @@ protected:
 
     void clearNamespaces();
 
-    esp_err_t populateBlobIndices(TBlobIndexList&);
+    esp_err_t loadCheckpoint(uint32_t baseSector, uint32_t sectorCount);
 
-    void eraseOrphanDataBlobs(TBlobIndexList&);
+    esp_err_t validateBlobIndices(TBlobIndexList&);
+
+    void eraseOrphanDataBlobs(TBlobIndexList&, TDataChunkList&);
 
     void fillEntryInfo(Item &item, nvs_entry_info_t &info);
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t prepareBatch(uint8_t nsIndex, BatchItem** items, size_t& count, size_t& entryCount);
+
+    void orderBatch(BatchItem** items, size_t count);
+
+    esp_err_t writeBatchItems(uint8_t nsIndex, BatchItem** items, size_t count);
+
+    uint8_t getMaxBlobChunkCount();
+
+    esp_err_t startNewPage();
+
+    /**
+     * Checks whether a BlobWriter is open for the key, or for any key of the namespace if key is nullptr.
+     */
+    bool isBlobWriterOpen(uint8_t nsIndex, const char* key);
+
 protected:
     Partition *mPartition;
+    Partition *mCheckpointPartition = nullptr;
+    bool mRecoveryPending = false;
     size_t mPageCount;
+    // declared before mPageManager, the pages update the index while being destroyed
+    ItemIndex mItemIndex;
+    ValueCache mValueCache;
     PageManager mPageManager;
     TNamespaces mNamespaces;
+    intrusive_list<BlobWriter> mBlobWriters;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
 };
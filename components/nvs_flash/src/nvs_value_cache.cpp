@@ -0,0 +1,193 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <new>
+#include <cstring>
+#include "nvs_value_cache.hpp"
+
+namespace nvs
+{
+
+ValueCache::ValueCache()
+{
+}
+
+ValueCache::~ValueCache()
+{
+    delete[] mNodes;
+}
+
+esp_err_t ValueCache::setCapacity(size_t capacity)
+{
+    if (capacity > MAX_CAPACITY) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    clear();
+    if (capacity == 0) {
+        return ESP_OK;
+    }
+
+    mNodes = new (std::nothrow) Node[capacity];
+    if (!mNodes) {
+        return ESP_ERR_NO_MEM;
+    }
+    mCapacity = capacity;
+    return ESP_OK;
+}
+
+void ValueCache::clear()
+{
+    mCount = 0;
+    mUsed = 0;
+    mHead = INVALID_NODE;
+    mTail = INVALID_NODE;
+    mFree = INVALID_NODE;
+}
+
+uint32_t ValueCache::hash(uint8_t nsIndex, const char* key)
+{
+    // same hash as used by HashList, it doesn't depend on the data type
+    return Item(nsIndex, ItemType::ANY, 0, key).calculateCrc32WithoutValue();
+}
+
+uint8_t ValueCache::lookup(uint32_t keyHash, uint8_t nsIndex, ItemType datatype, const char* key) const
+{
+    for (uint8_t node = mHead; node != INVALID_NODE; node = mNodes[node].mNext) {
+        const Node& n = mNodes[node];
+        if (n.mHash == keyHash && n.mNsIndex == nsIndex && n.mDatatype == datatype && strcmp(n.mKey, key) == 0) {
+            return node;
+        }
+    }
+    return INVALID_NODE;
+}
+
+void ValueCache::unlink(uint8_t node)
+{
+    Node& n = mNodes[node];
+    if (n.mPrev != INVALID_NODE) {
+        mNodes[n.mPrev].mNext = n.mNext;
+    } else {
+        mHead = n.mNext;
+    }
+    if (n.mNext != INVALID_NODE) {
+        mNodes[n.mNext].mPrev = n.mPrev;
+    } else {
+        mTail = n.mPrev;
+    }
+}
+
+void ValueCache::pushFront(uint8_t node)
+{
+    Node& n = mNodes[node];
+    n.mPrev = INVALID_NODE;
+    n.mNext = mHead;
+    if (mHead != INVALID_NODE) {
+        mNodes[mHead].mPrev = node;
+    } else {
+        mTail = node;
+    }
+    mHead = node;
+}
+
+void ValueCache::remove(uint8_t node)
+{
+    unlink(node);
+    mNodes[node].mNext = mFree;
+    mFree = node;
+    --mCount;
+}
+
+bool ValueCache::find(uint8_t nsIndex, ItemType datatype, const char* key, const uint8_t* &data, size_t& dataSize)
+{
+    if (!isEnabled()) {
+        return false;
+    }
+
+    uint8_t node = lookup(hash(nsIndex, key), nsIndex, datatype, key);
+    if (node == INVALID_NODE) {
+        ++mMisses;
+        return false;
+    }
+
+    ++mHits;
+    if (node != mHead) {
+        unlink(node);
+        pushFront(node);
+    }
+    data = mNodes[node].mData;
+    dataSize = mNodes[node].mDataSize;
+    return true;
+}
+
+void ValueCache::insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (!isEnabled() || !isCacheable(datatype, dataSize)) {
+        return;
+    }
+
+    const uint32_t keyHash = hash(nsIndex, key);
+    uint8_t node = lookup(keyHash, nsIndex, datatype, key);
+    if (node != INVALID_NODE) {
+        unlink(node);
+    } else if (mFree != INVALID_NODE) {
+        node = mFree;
+        mFree = mNodes[node].mNext;
+        ++mCount;
+    } else if (mUsed < mCapacity) {
+        node = mUsed++;
+        ++mCount;
+    } else {
+        // replace the least recently used value
+        node = mTail;
+        unlink(node);
+    }
+
+    Node& n = mNodes[node];
+    n.mHash = keyHash;
+    n.mNsIndex = nsIndex;
+    n.mDatatype = datatype;
+    n.mDataSize = dataSize;
+    strncpy(n.mKey, key, sizeof(n.mKey) - 1);
+    n.mKey[sizeof(n.mKey) - 1] = 0;
+    memcpy(n.mData, data, dataSize);
+    pushFront(node);
+}
+
+void ValueCache::invalidate(uint8_t nsIndex, const char* key)
+{
+    if (!isEnabled() || mCount == 0) {
+        return;
+    }
+
+    const uint32_t keyHash = hash(nsIndex, key);
+    uint8_t node = mHead;
+    while (node != INVALID_NODE) {
+        uint8_t next = mNodes[node].mNext;
+        const Node& n = mNodes[node];
+        if (n.mHash == keyHash && n.mNsIndex == nsIndex && strcmp(n.mKey, key) == 0) {
+            remove(node);
+        }
+        node = next;
+    }
+}
+
+void ValueCache::invalidateNamespace(uint8_t nsIndex)
+{
+    uint8_t node = mHead;
+    while (node != INVALID_NODE) {
+        uint8_t next = mNodes[node].mNext;
+        if (mNodes[node].mNsIndex == nsIndex) {
+            remove(node);
+        }
+        node = next;
+    }
+}
+
+} // namespace nvs
@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_value_cache_hpp
+#define nvs_value_cache_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include "esp_err.h"
+#include "nvs_types.hpp"
+
+namespace nvs
+{
+
+/**
+ * Size-bounded cache of decoded item values which are read frequently.
+ *
+ * Only primitive types and strings of up to MAX_VALUE_SIZE bytes (including the null terminator) are cached.
+ * When the cache is full, the least recently used value is replaced. The cache doesn't know anything about
+ * the flash contents, the owning Storage has to invalidate a key whenever it writes or erases it.
+ */
+class ValueCache
+{
+public:
+    static const size_t MAX_VALUE_SIZE = 32;
+
+    /**
+     * Upper bound of the capacity, so that entries can be linked with 8-bit indices.
+     */
+    static const size_t MAX_CAPACITY = 255;
+
+    ValueCache();
+    ~ValueCache();
+
+    /**
+     * Sets the maximum number of cached values and drops all cached values. A capacity of 0 disables the cache.
+     */
+    esp_err_t setCapacity(size_t capacity);
+
+    size_t getCapacity() const
+    {
+        return mCapacity;
+    }
+
+    bool isEnabled() const
+    {
+        return mCapacity > 0;
+    }
+
+    static bool isCacheable(ItemType datatype, size_t dataSize)
+    {
+        return (datatype != ItemType::ANY && datatype != ItemType::BLOB &&
+                datatype != ItemType::BLOB_DATA && datatype != ItemType::BLOB_IDX &&
+                dataSize <= MAX_VALUE_SIZE);
+    }
+
+    /**
+     * Looks up the value and counts a hit or a miss. On a hit, data points to the cached value which stays valid
+     * until the next call modifying the cache.
+     */
+    bool find(uint8_t nsIndex, ItemType datatype, const char* key, const uint8_t* &data, size_t& dataSize);
+
+    void insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * Drops the cached values of the key for all data types.
+     */
+    void invalidate(uint8_t nsIndex, const char* key);
+
+    void invalidateNamespace(uint8_t nsIndex);
+
+    void clear();
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    size_t getHits() const
+    {
+        return mHits;
+    }
+
+    size_t getMisses() const
+    {
+        return mMisses;
+    }
+
+private:
+    ValueCache(const ValueCache& other);
+    const ValueCache& operator= (const ValueCache& rhs);
+
+    static const uint8_t INVALID_NODE = 0xff;
+
+    struct Node {
+        uint32_t mHash;
+        uint8_t mPrev;
+        uint8_t mNext;
+        uint8_t mNsIndex;
+        ItemType mDatatype;
+        uint8_t mDataSize;
+        char mKey[Item::MAX_KEY_LENGTH + 1];
+        uint8_t mData[MAX_VALUE_SIZE];
+    };
+
+    static uint32_t hash(uint8_t nsIndex, const char* key);
+
+    uint8_t lookup(uint32_t keyHash, uint8_t nsIndex, ItemType datatype, const char* key) const;
+
+    void unlink(uint8_t node);
+
+    void pushFront(uint8_t node);
+
+    void remove(uint8_t node);
+
+    Node* mNodes = nullptr;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    size_t mUsed = 0;
+    uint8_t mHead = INVALID_NODE;
+    uint8_t mTail = INVALID_NODE;
+    uint8_t mFree = INVALID_NODE;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+}; // class ValueCache
+
+} // namespace nvs
+
+#endif /* nvs_value_cache_hpp */
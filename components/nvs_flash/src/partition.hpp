@@ -16,6 +16,7 @@
 #define PARTITION_HPP_
 
 #include "esp_err.h"
+#include "nvs_op_stats.hpp"
 
 namespace nvs {
 
@@ -52,6 +53,18 @@ public:
      * Return the partition size in bytes.
      */
     virtual uint32_t get_size() = 0;
+
+    /**
+     * Return the operation counters of the partition. The flash operations are counted by the implementations
+     * of the functions above, the logical operations by the NVS objects using the partition.
+     */
+    OpStats& get_op_stats()
+    {
+        return mOpStats;
+    }
+
+protected:
+    OpStats mOpStats;
 };
 
 } // nvs
@@ -0,0 +1,276 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "WL_Cache.h"
+
+static const char *TAG = "wl_cache";
+
+#define WL_CACHE_RESULT_CHECK(result) \
+    if (result != ESP_OK) { \
+        ESP_LOGE(TAG,"%s(%d): result = 0x%08x", __FUNCTION__, __LINE__, result); \
+        return (result); \
+    }
+
+WL_Cache::WL_Cache()
+{
+}
+
+WL_Cache::~WL_Cache()
+{
+    free(this->entries);
+    free(this->buffer);
+}
+
+esp_err_t WL_Cache::config(Flash_Access *flash, size_t sector_count, uint32_t flush_timeout_ms)
+{
+    if (flash == NULL || sector_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    this->flash = flash;
+    this->sector_size = flash->get_sector_size();
+    this->flush_timeout_ms = flush_timeout_ms;
+
+    this->entries = (wl_cache_entry_t *)calloc(sector_count, sizeof(wl_cache_entry_t));
+    this->buffer = (uint8_t *)malloc(sector_count * this->sector_size);
+    if (this->entries == NULL || this->buffer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < sector_count; i++) {
+        this->entries[i].state = WL_CACHE_FREE;
+        this->entries[i].data = &this->buffer[i * this->sector_size];
+    }
+    this->entry_count = sector_count;
+    ESP_LOGD(TAG, "%s - sectors= %i, sector_size= 0x%08x, flush_timeout_ms= %i", __func__, (int) sector_count, (uint32_t) this->sector_size, (int) flush_timeout_ms);
+    return ESP_OK;
+}
+
+size_t WL_Cache::get_flash_size()
+{
+    return this->flash->get_flash_size();
+}
+
+size_t WL_Cache::get_sector_size()
+{
+    return this->sector_size;
+}
+
+WL_Cache::wl_cache_entry_t *WL_Cache::find(size_t sector)
+{
+    for (size_t i = 0; i < this->entry_count; i++) {
+        if (this->entries[i].state != WL_CACHE_FREE && this->entries[i].sector == sector) {
+            return &this->entries[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t WL_Cache::get_free(wl_cache_entry_t **entry)
+{
+    // Prefer a free slot, then the least recently used clean one, and write back a dirty sector only if there is
+    // no other choice
+    wl_cache_entry_t *clean = NULL;
+    wl_cache_entry_t *dirty = NULL;
+    for (size_t i = 0; i < this->entry_count; i++) {
+        wl_cache_entry_t *it = &this->entries[i];
+        if (it->state == WL_CACHE_FREE) {
+            *entry = it;
+            return ESP_OK;
+        }
+        wl_cache_entry_t **lru = (it->state == WL_CACHE_CLEAN) ? &clean : &dirty;
+        if (*lru == NULL || (uint32_t)(this->use_count - it->last_used) > (uint32_t)(this->use_count - (*lru)->last_used)) {
+            *lru = it;
+        }
+    }
+    if (clean == NULL) {
+        esp_err_t result = this->write_back(dirty);
+        WL_CACHE_RESULT_CHECK(result);
+        this->stats.evictions++;
+        clean = dirty;
+    }
+    clean->state = WL_CACHE_FREE;
+    *entry = clean;
+    return ESP_OK;
+}
+
+esp_err_t WL_Cache::write_back(wl_cache_entry_t *entry)
+{
+    esp_err_t result = ESP_OK;
+    ESP_LOGD(TAG, "%s - sector= 0x%08x", __func__, (uint32_t) entry->sector);
+    result = this->flash->erase_range(entry->sector * this->sector_size, this->sector_size);
+    WL_CACHE_RESULT_CHECK(result);
+
+    // A sector which was erased and not written to is done with the erase
+    bool erased = true;
+    const uint32_t *words = (const uint32_t *)entry->data;
+    for (size_t i = 0; i < this->sector_size / sizeof(uint32_t); i++) {
+        if (words[i] != UINT32_MAX) {
+            erased = false;
+            break;
+        }
+    }
+    if (!erased) {
+        result = this->flash->write(entry->sector * this->sector_size, entry->data, this->sector_size);
+        WL_CACHE_RESULT_CHECK(result);
+    }
+    entry->state = WL_CACHE_CLEAN;
+    this->stats.sectors_written_back++;
+    return result;
+}
+
+esp_err_t WL_Cache::flush_expired()
+{
+    if (this->flush_timeout_ms == 0) {
+        return ESP_OK;
+    }
+    // There is no background task, so expired sectors are written back by the next access to the cache
+    uint32_t now = esp_log_timestamp();
+    for (size_t i = 0; i < this->entry_count; i++) {
+        wl_cache_entry_t *entry = &this->entries[i];
+        if (entry->state == WL_CACHE_DIRTY && now - entry->dirty_since >= this->flush_timeout_ms) {
+            esp_err_t result = this->write_back(entry);
+            WL_CACHE_RESULT_CHECK(result);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t WL_Cache::flush()
+{
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < this->entry_count; i++) {
+        if (this->entries[i].state == WL_CACHE_DIRTY) {
+            result = this->write_back(&this->entries[i]);
+            WL_CACHE_RESULT_CHECK(result);
+        }
+    }
+    return result;
+}
+
+esp_err_t WL_Cache::erase_sector(size_t sector)
+{
+    return this->erase_range(sector * this->sector_size, this->sector_size);
+}
+
+esp_err_t WL_Cache::erase_range(size_t start_address, size_t size)
+{
+    esp_err_t result = this->flush_expired();
+    WL_CACHE_RESULT_CHECK(result);
+    ESP_LOGD(TAG, "%s - start_address= 0x%08x, size= 0x%08x", __func__, (uint32_t) start_address, (uint32_t) size);
+    size_t erase_count = (size + this->sector_size - 1) / this->sector_size;
+    size_t start_sector = start_address / this->sector_size;
+
+    if (erase_count > this->entry_count) {
+        // Caching a range larger than the cache would only write back the sectors erased first, so the range is
+        // erased directly and the cached copies of its sectors are dropped
+        for (size_t i = 0; i < this->entry_count; i++) {
+            wl_cache_entry_t *entry = &this->entries[i];
+            if (entry->state != WL_CACHE_FREE && entry->sector >= start_sector && entry->sector < start_sector + erase_count) {
+                if (entry->state == WL_CACHE_DIRTY) {
+                    this->stats.erases_avoided++;
+                }
+                entry->state = WL_CACHE_FREE;
+            }
+        }
+        return this->flash->erase_range(start_address, size);
+    }
+
+    uint32_t now = (this->flush_timeout_ms != 0) ? esp_log_timestamp() : 0;
+    for (size_t i = 0; i < erase_count; i++) {
+        wl_cache_entry_t *entry = this->find(start_sector + i);
+        if (entry == NULL) {
+            result = this->get_free(&entry);
+            WL_CACHE_RESULT_CHECK(result);
+            entry->sector = start_sector + i;
+        }
+        if (entry->state == WL_CACHE_DIRTY) {
+            this->stats.erases_avoided++;
+        } else {
+            entry->dirty_since = now;
+        }
+        entry->state = WL_CACHE_DIRTY;
+        entry->last_used = ++this->use_count;
+        memset(entry->data, 0xFF, this->sector_size);
+    }
+    return result;
+}
+
+esp_err_t WL_Cache::write(size_t dest_addr, const void *src, size_t size)
+{
+    esp_err_t result = this->flush_expired();
+    WL_CACHE_RESULT_CHECK(result);
+    ESP_LOGD(TAG, "%s - dest_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) dest_addr, (uint32_t) size);
+    const uint8_t *data = (const uint8_t *)src;
+    size_t done = 0;
+    while (done < size) {
+        size_t addr = dest_addr + done;
+        size_t len = this->sector_size - addr % this->sector_size;
+        wl_cache_entry_t *entry = this->find(addr / this->sector_size);
+        if (entry == NULL) {
+            // Pass the run of uncached sectors to flash with a single call
+            while (done + len < size && this->find((addr + len) / this->sector_size) == NULL) {
+                len += this->sector_size;
+            }
+            len = (len < size - done) ? len : size - done;
+            result = this->flash->write(addr, &data[done], len);
+            WL_CACHE_RESULT_CHECK(result);
+            done += len;
+            continue;
+        }
+
+        len = (len < size - done) ? len : size - done;
+        if (entry->state == WL_CACHE_CLEAN) {
+            result = this->flash->write(addr, &data[done], len);
+            WL_CACHE_RESULT_CHECK(result);
+        }
+        // Writing can only clear bits, same as in flash
+        uint8_t *cached = &entry->data[addr % this->sector_size];
+        for (size_t i = 0; i < len; i++) {
+            cached[i] &= data[done + i];
+        }
+        entry->last_used = ++this->use_count;
+        this->stats.write_hits++;
+        done += len;
+    }
+    return result;
+}
+
+esp_err_t WL_Cache::read(size_t src_addr, void *dest, size_t size)
+{
+    esp_err_t result = this->flush_expired();
+    WL_CACHE_RESULT_CHECK(result);
+    ESP_LOGD(TAG, "%s - src_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) src_addr, (uint32_t) size);
+    uint8_t *data = (uint8_t *)dest;
+    size_t done = 0;
+    while (done < size) {
+        size_t addr = src_addr + done;
+        size_t len = this->sector_size - addr % this->sector_size;
+        wl_cache_entry_t *entry = this->find(addr / this->sector_size);
+        if (entry == NULL) {
+            while (done + len < size && this->find((addr + len) / this->sector_size) == NULL) {
+                len += this->sector_size;
+            }
+            len = (len < size - done) ? len : size - done;
+            result = this->flash->read(addr, &data[done], len);
+            WL_CACHE_RESULT_CHECK(result);
+            done += len;
+            continue;
+        }
+
+        len = (len < size - done) ? len : size - done;
+        memcpy(&data[done], &entry->data[addr % this->sector_size], len);
+        entry->last_used = ++this->use_count;
+        this->stats.read_hits++;
+        done += len;
+    }
+    return result;
+}
+
+void WL_Cache::get_stats(wl_cache_stats_t *stats)
+{
+    *stats = this->stats;
+}
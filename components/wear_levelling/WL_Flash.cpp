@@ -521,6 +521,19 @@ size_t WL_Flash::calcAddr(size_t addr)
     return result;
 }
 
+size_t WL_Flash::calcRunSize(size_t addr, size_t size)
+{
+    // calcAddr() maps the rotated address linearly, except that it skips the dummy sector and wraps around
+    // at the end of the flash, so the run ends at whichever of the two comes first
+    size_t rotated = (this->flash_size - this->state.wl_dummy_sec_move_count * this->cfg.wl_page_size + addr) % this->flash_size;
+    size_t dummy_addr = this->state.wl_dummy_sec_pos * this->cfg.wl_page_size;
+    size_t run_end = (rotated < dummy_addr) ? dummy_addr : this->flash_size;
+    if (size > run_end - rotated) {
+        size = run_end - rotated;
+    }
+    return size;
+}
+
 
 size_t WL_Flash::get_flash_size()
 {
@@ -577,15 +590,15 @@ esp_err_t WL_Flash::write(size_t dest_addr, const void *src, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - dest_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) dest_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.wl_page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(dest_addr + i * this->cfg.wl_page_size);
-        result = this->flash_drv->write(this->cfg.wl_partition_start_addr + virt_addr, &((uint8_t *)src)[i * this->cfg.wl_page_size], this->cfg.wl_page_size);
+    // write physically contiguous pages with a single driver call
+    size_t done = 0;
+    while (done < size) {
+        size_t virt_addr = this->calcAddr(dest_addr + done);
+        size_t run_size = this->calcRunSize(dest_addr + done, size - done);
+        result = this->flash_drv->write(this->cfg.wl_partition_start_addr + virt_addr, &((uint8_t *)src)[done], run_size);
         WL_RESULT_CHECK(result);
+        done += run_size;
     }
-    size_t virt_addr_last = this->calcAddr(dest_addr + count * this->cfg.wl_page_size);
-    result = this->flash_drv->write(this->cfg.wl_partition_start_addr + virt_addr_last, &((uint8_t *)src)[count * this->cfg.wl_page_size], size - count * this->cfg.wl_page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
@@ -596,16 +609,16 @@ esp_err_t WL_Flash::read(size_t src_addr, void *dest, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - src_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) src_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.wl_page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(src_addr + i * this->cfg.wl_page_size);
-        ESP_LOGV(TAG, "%s - real_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) (this->cfg.wl_partition_start_addr + virt_addr), (uint32_t) size);
-        result = this->flash_drv->read(this->cfg.wl_partition_start_addr + virt_addr, &((uint8_t *)dest)[i * this->cfg.wl_page_size], this->cfg.wl_page_size);
+    // read physically contiguous pages with a single driver call
+    size_t done = 0;
+    while (done < size) {
+        size_t virt_addr = this->calcAddr(src_addr + done);
+        size_t run_size = this->calcRunSize(src_addr + done, size - done);
+        ESP_LOGV(TAG, "%s - real_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) (this->cfg.wl_partition_start_addr + virt_addr), (uint32_t) run_size);
+        result = this->flash_drv->read(this->cfg.wl_partition_start_addr + virt_addr, &((uint8_t *)dest)[done], run_size);
         WL_RESULT_CHECK(result);
+        done += run_size;
     }
-    size_t virt_addr_last = this->calcAddr(src_addr + count * this->cfg.wl_page_size);
-    result = this->flash_drv->read(this->cfg.wl_partition_start_addr + virt_addr_last, &((uint8_t *)dest)[count * this->cfg.wl_page_size], size - count * this->cfg.wl_page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
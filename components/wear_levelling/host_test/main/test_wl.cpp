@@ -6,12 +6,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "esp_partition.h"
 #include "esp_private/partition_linux.h"
 
 #include "wear_levelling.h"
 #include "WL_Flash.h"
+#include "WL_Cache.h"
+#include "Partition.h"
 #include "crc32.h"
 
 
@@ -426,3 +429,198 @@ TEST_CASE("power down between WL status 1 and WL status 2 update", "[wear_levell
 
     free(tmp_state);
 }
+
+TEST_CASE("unaligned multi-sector access across the dummy sector", "[wear_levelling]")
+{
+    // Writes and reads back the whole partition in pieces of random size and offset. The partition is erased
+    // before each round, which moves the dummy sector, so pieces are split at different physical addresses.
+    wl_handle_t wl_handle;
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    esp_partition_fail_after(SIZE_MAX, 0);
+
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+
+    size_t sector_size = wl_sector_size(wl_handle);
+    size_t size = wl_size(wl_handle);
+    uint8_t *data = (uint8_t *) malloc(size);
+    uint8_t *read = (uint8_t *) malloc(size);
+    REQUIRE(data != NULL);
+    REQUIRE(read != NULL);
+
+    srand(0x3a1f);
+    for (int round = 0; round < 4; round++) {
+        REQUIRE(wl_erase_range(wl_handle, 0, size) == ESP_OK);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = (uint8_t) rand();
+        }
+
+        // piece sizes are multiples of 4 bytes, up to a bit more than 4 sectors
+        size_t offset = 0;
+        while (offset < size) {
+            size_t len = std::min((size_t) (rand() % (sector_size + 1)) * 4 + 4, size - offset);
+            REQUIRE(wl_write(wl_handle, offset, data + offset, len) == ESP_OK);
+            offset += len;
+        }
+
+        memset(read, 0, size);
+        offset = 0;
+        while (offset < size) {
+            size_t len = std::min((size_t) (rand() % (sector_size + 1)) * 4 + 4, size - offset);
+            REQUIRE(wl_read(wl_handle, offset, read + offset, len) == ESP_OK);
+            offset += len;
+        }
+        REQUIRE(memcmp(data, read, size) == 0);
+    }
+
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+
+    free(data);
+    free(read);
+}
+
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+TEST_CASE("write-back cache avoids repeated sector erases", "[wear_levelling][cache]")
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    esp_partition_fail_after(SIZE_MAX, 0);
+
+    // The cache is tested directly on top of the partition, so that every flash operation is visible in the stats
+    Partition part(partition);
+    WL_Cache cache;
+    const size_t cache_sectors = 4;
+    REQUIRE(cache.config(&part, cache_sectors, 0) == ESP_OK);
+    size_t sector_size = cache.get_sector_size();
+
+    uint8_t *data = (uint8_t *) malloc(sector_size * 2);
+    uint8_t *read = (uint8_t *) malloc(sector_size * 2);
+    REQUIRE(data != NULL);
+    REQUIRE(read != NULL);
+
+    // Rewrite two sectors many times, the way FATFS updates its FAT table and directory entries
+    const int rewrites = 50;
+    esp_partition_clear_stats();
+    for (int i = 0; i < rewrites; i++) {
+        memset(data, i, sector_size * 2);
+        REQUIRE(cache.erase_range(0, sector_size * 2) == ESP_OK);
+        REQUIRE(cache.write(0, data, sector_size * 2) == ESP_OK);
+    }
+    CHECK(esp_partition_get_erase_ops() == 0);
+    CHECK(esp_partition_get_write_ops() == 0);
+
+    // Reads are served from the cache, including a range which continues into an uncached sector
+    REQUIRE(cache.read(0, read, sector_size * 2) == ESP_OK);
+    REQUIRE(memcmp(data, read, sector_size * 2) == 0);
+    REQUIRE(cache.read(sector_size + 16, read, sector_size) == ESP_OK);
+    CHECK(esp_partition_get_read_ops() == 1);
+
+    REQUIRE(cache.flush() == ESP_OK);
+    CHECK(esp_partition_get_erase_ops() == 2);
+    CHECK(esp_partition_get_write_ops() == 2);
+    REQUIRE(part.read(0, read, sector_size * 2) == ESP_OK);
+    REQUIRE(memcmp(data, read, sector_size * 2) == 0);
+
+    wl_cache_stats_t stats;
+    cache.get_stats(&stats);
+    CHECK(stats.erases_avoided == (rewrites - 1) * 2);
+    CHECK(stats.sectors_written_back == 2);
+    CHECK(stats.evictions == 0);
+
+    // A write to a clean cached sector goes to flash right away
+    esp_partition_clear_stats();
+    memset(data, 0x0f, 16);
+    REQUIRE(cache.write(32, data, 16) == ESP_OK);
+    CHECK(esp_partition_get_write_ops() == 1);
+    REQUIRE(cache.read(32, read, 16) == ESP_OK);
+    REQUIRE(part.read(32, read + 16, 16) == ESP_OK);
+    REQUIRE(memcmp(read, read + 16, 16) == 0);
+
+    // Erasing more sectors than the cache holds writes back the least recently used dirty sector
+    for (size_t i = 0; i <= cache_sectors; i++) {
+        REQUIRE(cache.erase_sector(2 + i) == ESP_OK);
+    }
+    cache.get_stats(&stats);
+    CHECK(stats.evictions == 1);
+
+    // Ranges larger than the cache are erased directly and drop the cached copies
+    esp_partition_clear_stats();
+    REQUIRE(cache.erase_range(0, sector_size * (cache_sectors + 4)) == ESP_OK);
+    CHECK(esp_partition_get_erase_ops() == cache_sectors + 4);
+    REQUIRE(cache.flush() == ESP_OK);
+    CHECK(esp_partition_get_erase_ops() == cache_sectors + 4);
+
+    free(data);
+    free(read);
+}
+
+static void wl_benchmark_io(wl_handle_t wl_handle, size_t io_size, bool sequential, uint8_t *buf)
+{
+    size_t size = wl_size(wl_handle);
+    size_t requests = sequential ? size / io_size : 256;
+
+    REQUIRE(wl_erase_range(wl_handle, 0, size) == ESP_OK);
+
+    size_t *offsets = new size_t[requests];
+    for (size_t i = 0; i < requests; i++) {
+        offsets[i] = sequential ? i * io_size : (rand() % (size / io_size)) * io_size;
+    }
+
+    esp_partition_clear_stats();
+    for (size_t i = 0; i < requests; i++) {
+        REQUIRE(wl_write(wl_handle, offsets[i], buf, io_size) == ESP_OK);
+    }
+    size_t write_ops = esp_partition_get_write_ops();
+    size_t write_time = esp_partition_get_total_time();
+
+    esp_partition_clear_stats();
+    for (size_t i = 0; i < requests; i++) {
+        REQUIRE(wl_read(wl_handle, offsets[i], buf, io_size) == ESP_OK);
+    }
+    size_t read_ops = esp_partition_get_read_ops();
+    size_t read_time = esp_partition_get_total_time();
+
+    // a request is only split where it crosses the dummy sector or the end of the flash, which a sequential pass
+    // does at most once each
+    if (sequential) {
+        CHECK(write_ops <= requests + 2);
+        CHECK(read_ops <= requests + 2);
+    } else {
+        CHECK(write_ops <= requests * 3);
+        CHECK(read_ops <= requests * 3);
+    }
+
+    // emulated flash time in microseconds, so bytes per microsecond is MB/s
+    printf("%-10s %6zu B: %4zu requests, write %4zu ops %7.3f MB/s, read %4zu ops %7.3f MB/s\n",
+           sequential ? "sequential" : "random", io_size, requests,
+           write_ops, (double) (requests * io_size) / write_time,
+           read_ops, (double) (requests * io_size) / read_time);
+
+    delete[] offsets;
+}
+
+TEST_CASE("read and write throughput", "[wear_levelling][benchmark]")
+{
+    wl_handle_t wl_handle;
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    esp_partition_fail_after(SIZE_MAX, 0);
+
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+
+    const size_t io_sizes[] = {512, 4096, 16384, 65536};
+    uint8_t *buf = (uint8_t *) malloc(io_sizes[sizeof(io_sizes) / sizeof(io_sizes[0]) - 1]);
+    REQUIRE(buf != NULL);
+    memset(buf, 0x5a, io_sizes[sizeof(io_sizes) / sizeof(io_sizes[0]) - 1]);
+
+    srand(0x77e1);
+    for (size_t io_size : io_sizes) {
+        wl_benchmark_io(wl_handle, io_size, true, buf);
+        wl_benchmark_io(wl_handle, io_size, false, buf);
+    }
+
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+
+    free(buf);
+}
+#endif // CONFIG_ESP_PARTITION_ENABLE_STATS
@@ -21,6 +21,17 @@ typedef int32_t wl_handle_t;
 
 #define WL_INVALID_HANDLE -1
 
+/**
+* @brief Counters of the write-back sector cache, see wl_get_cache_stats
+*/
+typedef struct {
+    uint32_t erases_avoided;        /*!< Sector erases which never reached flash because the sector was erased again before it was written back */
+    uint32_t sectors_written_back;  /*!< Dirty sectors erased and written to flash */
+    uint32_t evictions;             /*!< Dirty sectors written back to make room for another sector */
+    uint32_t write_hits;            /*!< Writes to a cached sector, counted per sector */
+    uint32_t read_hits;             /*!< Reads from a cached sector, counted per sector */
+} wl_cache_stats_t;
+
 /**
 * @brief Mount WL for defined partition
 *
@@ -120,6 +131,34 @@ size_t wl_size(wl_handle_t handle);
 */
 size_t wl_sector_size(wl_handle_t handle);
 
+/**
+* @brief Write all sectors held by the write-back cache to flash
+*
+* Sectors erased with wl_erase_range are kept in RAM by the write-back cache (CONFIG_WL_CACHE_SECTORS) and
+* written to flash later. Call this function to make sure that the data written so far survives a power loss.
+* If the cache is disabled, the function does nothing.
+*
+* @param handle WL module handle that was initialized before
+*
+* @return
+*       - ESP_OK, if all cached sectors were written successfully or the cache is disabled;
+*       - or one of error codes from lower-level flash driver.
+*/
+esp_err_t wl_flush(wl_handle_t handle);
+
+/**
+* @brief Get the counters of the write-back cache
+*
+* @param handle WL module handle that was initialized before
+* @param[out] stats counters since the WL instance was mounted
+*
+* @return
+*       - ESP_OK, if the counters were filled;
+*       - ESP_ERR_INVALID_ARG, if stats is NULL;
+*       - ESP_ERR_NOT_SUPPORTED, if the write-back cache is disabled.
+*/
+esp_err_t wl_get_cache_stats(wl_handle_t handle, wl_cache_stats_t *stats);
+
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _WL_Cache_H_
+#define _WL_Cache_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "Flash_Access.h"
+#include "wear_levelling.h"
+
+/**
+* @brief Write-back cache of erased sectors in front of a wear levelling instance. Class implements Flash_Access interface
+*
+* A sector erased through the cache is not erased in flash right away. It is kept in RAM, filled with 0xFF, and the
+* following writes to it are applied to the RAM copy. The sector is erased and written to flash when the cache is
+* flushed, when its slot is needed for another sector, or when it was dirty for longer than the flush timeout.
+* Erasing a sector again before it was written back costs no flash erase at all.
+*
+* Writes to sectors that are not cached are passed to the underlying instance directly. Data of dirty sectors is
+* lost if power goes off before they are written back.
+*/
+class WL_Cache : public Flash_Access
+{
+public:
+    WL_Cache();
+    ~WL_Cache() override;
+
+    esp_err_t config(Flash_Access *flash, size_t sector_count, uint32_t flush_timeout_ms);
+
+    size_t get_flash_size() override;
+    size_t get_sector_size() override;
+
+    esp_err_t erase_sector(size_t sector) override;
+    esp_err_t erase_range(size_t start_address, size_t size) override;
+
+    esp_err_t write(size_t dest_addr, const void *src, size_t size) override;
+    esp_err_t read(size_t src_addr, void *dest, size_t size) override;
+
+    /**
+    * @brief Writes all dirty sectors back to flash. The state of the underlying instance is not flushed.
+    */
+    esp_err_t flush() override;
+
+    void get_stats(wl_cache_stats_t *stats);
+
+protected:
+    enum {
+        WL_CACHE_FREE,
+        WL_CACHE_CLEAN,     /*!< copy of the sector as stored in flash*/
+        WL_CACHE_DIRTY,     /*!< sector has to be erased and written back*/
+    };
+
+    typedef struct {
+        size_t sector;
+        uint32_t last_used;
+        uint32_t dirty_since;
+        uint8_t state;
+        uint8_t *data;
+    } wl_cache_entry_t;
+
+    Flash_Access *flash = NULL;
+    size_t sector_size = 0;
+    size_t entry_count = 0;
+    uint32_t flush_timeout_ms = 0;
+    uint32_t use_count = 0;
+    wl_cache_entry_t *entries = NULL;
+    uint8_t *buffer = NULL;
+    wl_cache_stats_t stats = {};
+
+    wl_cache_entry_t *find(size_t sector);
+    esp_err_t get_free(wl_cache_entry_t **entry);
+    esp_err_t write_back(wl_cache_entry_t *entry);
+    esp_err_t flush_expired();
+};
+
+#endif // _WL_Cache_H_
@@ -13,6 +13,7 @@
 #include "WL_Flash.h"
 #include "WL_Ext_Perf.h"
 #include "WL_Ext_Safe.h"
+#include "WL_Cache.h"
 #include "SPI_Flash.h"
 #include "Partition.h"
 
@@ -36,12 +37,22 @@
 #define WL_DEFAULT_START_ADDR   0
 #endif //WL_DEFAULT_START_ADDR
 
+#ifndef CONFIG_WL_CACHE_SECTORS
+#define CONFIG_WL_CACHE_SECTORS 0
+#endif // CONFIG_WL_CACHE_SECTORS
+
+#ifndef CONFIG_WL_CACHE_FLUSH_TIMEOUT_MS
+#define CONFIG_WL_CACHE_FLUSH_TIMEOUT_MS 0
+#endif // CONFIG_WL_CACHE_FLUSH_TIMEOUT_MS
+
 #ifndef WL_CURRENT_VERSION
 #define WL_CURRENT_VERSION  2
 #endif //WL_CURRENT_VERSION
 
 typedef struct {
     WL_Flash *instance;
+    WL_Cache *cache;        // NULL if the write-back cache is disabled
+    Flash_Access *access;   // cache or instance, used for erase, write and read
     _lock_t lock;
 } wl_instance_t;
 
@@ -58,6 +69,7 @@ esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
     WL_Flash *wl_flash = NULL;
     void *part_ptr = NULL;
     Partition *part = NULL;
+    WL_Cache *cache = NULL;
     esp_err_t result = ESP_OK;
     *out_handle = WL_INVALID_HANDLE;
 
@@ -147,7 +159,25 @@ esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
         goto out;
     }
 
+#if CONFIG_WL_CACHE_SECTORS > 0
+    // Same for the write-back cache in front of WL_Flash
+    cache = (WL_Cache *)malloc(sizeof(WL_Cache));
+    if (cache == NULL) {
+        result = ESP_ERR_NO_MEM;
+        ESP_LOGE(TAG, "%s: can't allocate WL_Cache", __func__);
+        goto out;
+    }
+    cache = new (cache) WL_Cache();
+    result = cache->config(wl_flash, CONFIG_WL_CACHE_SECTORS, CONFIG_WL_CACHE_FLUSH_TIMEOUT_MS);
+    if (ESP_OK != result) {
+        ESP_LOGE(TAG, "%s: cache config instance=0x%08x, result=0x%x", __func__, *out_handle, result);
+        goto out;
+    }
+#endif // CONFIG_WL_CACHE_SECTORS
+
     s_instances[*out_handle].instance = wl_flash;
+    s_instances[*out_handle].cache = cache;
+    s_instances[*out_handle].access = cache ? (Flash_Access *)cache : (Flash_Access *)wl_flash;
     // Initialise the lock for respective WL handle
     _lock_init(&s_instances[*out_handle].lock);
 
@@ -157,6 +187,10 @@ esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
 out:
     _lock_release(&s_instances_lock);
     *out_handle = WL_INVALID_HANDLE;
+    if (cache) {
+        cache->~WL_Cache();
+        free(cache);
+    }
     if (wl_flash) {
         wl_flash->~WL_Flash();
         free(wl_flash);
@@ -174,15 +208,26 @@ esp_err_t wl_unmount(wl_handle_t handle)
     _lock_acquire(&s_instances_lock);
     result = check_handle(handle, __func__);
     if (result == ESP_OK) {
-        // We have to flush state of the component
-        result = s_instances[handle].instance->flush();
+        // Write back the cached sectors first, then flush state of the component
+        if (s_instances[handle].cache) {
+            result = s_instances[handle].cache->flush();
+        }
+        if (result == ESP_OK) {
+            result = s_instances[handle].instance->flush();
+        }
         // We use placement new in wl_mount, so call destructor directly
         Flash_Access *drv = s_instances[handle].instance->get_drv();
         drv->~Flash_Access();
         free(drv);
+        if (s_instances[handle].cache) {
+            s_instances[handle].cache->~WL_Cache();
+            free(s_instances[handle].cache);
+            s_instances[handle].cache = NULL;
+        }
         s_instances[handle].instance->~WL_Flash();
         free(s_instances[handle].instance);
         s_instances[handle].instance = NULL;
+        s_instances[handle].access = NULL;
         _lock_close(&s_instances[handle].lock); // also zeroes the lock variable
     }
     _lock_release(&s_instances_lock);
@@ -196,7 +241,7 @@ esp_err_t wl_erase_range(wl_handle_t handle, size_t start_addr, size_t size)
         return result;
     }
     _lock_acquire(&s_instances[handle].lock);
-    result = s_instances[handle].instance->erase_range(start_addr, size);
+    result = s_instances[handle].access->erase_range(start_addr, size);
     _lock_release(&s_instances[handle].lock);
     return result;
 }
@@ -208,7 +253,7 @@ esp_err_t wl_write(wl_handle_t handle, size_t dest_addr, const void *src, size_t
         return result;
     }
     _lock_acquire(&s_instances[handle].lock);
-    result = s_instances[handle].instance->write(dest_addr, src, size);
+    result = s_instances[handle].access->write(dest_addr, src, size);
     _lock_release(&s_instances[handle].lock);
     return result;
 }
@@ -220,7 +265,7 @@ esp_err_t wl_read(wl_handle_t handle, size_t src_addr, void *dest, size_t size)
         return result;
     }
     _lock_acquire(&s_instances[handle].lock);
-    result = s_instances[handle].instance->read(src_addr, dest, size);
+    result = s_instances[handle].access->read(src_addr, dest, size);
     _lock_release(&s_instances[handle].lock);
     return result;
 }
@@ -249,6 +294,39 @@ size_t wl_sector_size(wl_handle_t handle)
     return result;
 }
 
+esp_err_t wl_flush(wl_handle_t handle)
+{
+    esp_err_t result = check_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_instances[handle].lock);
+    if (s_instances[handle].cache) {
+        result = s_instances[handle].cache->flush();
+    }
+    _lock_release(&s_instances[handle].lock);
+    return result;
+}
+
+esp_err_t wl_get_cache_stats(wl_handle_t handle, wl_cache_stats_t *stats)
+{
+    esp_err_t result = check_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    _lock_acquire(&s_instances[handle].lock);
+    if (s_instances[handle].cache) {
+        s_instances[handle].cache->get_stats(stats);
+    } else {
+        result = ESP_ERR_NOT_SUPPORTED;
+    }
+    _lock_release(&s_instances[handle].lock);
+    return result;
+}
+
 static esp_err_t check_handle(wl_handle_t handle, const char *func)
 {
     if (handle == WL_INVALID_HANDLE) {